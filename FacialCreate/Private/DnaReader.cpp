@@ -19,6 +19,7 @@ TArray<dna::Position> DnaReader::jointPositions;
 TArray<dna::Position> DnaReader::oldJointPositions;
 TArray<dna::Position> DnaReader::newVertexPositions;
 TArray<dna::Position> DnaReader::oldVertexPositions;
+DnaRigIndex DnaReader::rigIndex;
 
 const char* DnaReader::eyeLeftJoints[6] = { "FACIAL_L_EyelidUpperA",
 											"FACIAL_L_EyelidLowerB",
@@ -50,10 +51,12 @@ void DnaReader::readDna()
 
 	reader->read();
 	if (!dna::Status::isOk()) {
+		rigIndex.reset();
 		UE_LOG(LogTemp, Error, TEXT("An error occurred while loading the DNA file"));
 		return;
 	}
 	dnaReader = dnac::makeScoped<dnac::DNACalibDNAReader>(reader.get());
+	rigIndex.build(dnaReader.get());
 
 	UE_LOG(LogTemp, Log, TEXT("Successfully read DNA file"));
 }
@@ -76,6 +79,8 @@ void DnaReader::setDnaLod()
 	dnac::SetLODsCommand setLodsCmd(nullptr);
 	setLodsCmd.setLODs(dnac::ConstArrayView<std::uint16_t>(LODS.GetData(), LODS.Num()));
 	setLodsCmd.run(dnaReader.get());
+	// 去掉的 LOD 会改变关节组的行列，重建索引
+	rigIndex.build(dnaReader.get());
 
 	UE_LOG(LogTemp, Log, TEXT("Successfully amended DNA with %d LODs"), LODS.Num());
 }
@@ -513,55 +518,34 @@ void DnaReader::processMouthNode(const char* UpperjointName, const char* Lowerjo
 
 void DnaReader::amendJointGroupAsValue(int jointIndex, float valueX, float valueY, float valueZ)
 {
-    int jointGroupCount = dnaReader->getJointGroupCount();
+    float _valueX = valueX * valueX;
+    const float XYZMult[9] = { _valueX, valueY, valueZ, valueX, valueY, valueZ, valueX, valueY, valueZ };
 
-    for (int i = 0; i < jointGroupCount; i++)
+    // 只访问包含该关节的关节组，以及其中输出该关节九个属性的行
+    for (uint16_t i : rigIndex.jointGroupsOfJoint(jointIndex))
     {
-        TArray<uint16_t> jointGroupJointIndices;
-        auto arrayViewIndices = dnaReader->getJointGroupJointIndices(i);
-        for (size_t j = 0; j < arrayViewIndices.size(); ++j) {
-            jointGroupJointIndices.Add(arrayViewIndices[j]);
-        }
+        auto arrayViewValues = dnaReader->getJointGroupValues(i);
+        TArray<float> jointGroupValues(arrayViewValues.data(), static_cast<int32>(arrayViewValues.size()));
+        const int inputCount = rigIndex.inputCount(i);
 
-        if (jointGroupJointIndices.Contains(jointIndex))
+        for (int k = jointIndex * 9; k < jointIndex * 9 + 9; k++)
         {
-			auto arrayViewInputIndices = dnaReader->getJointGroupInputIndices(i);
-
-            TArray<uint16_t> jointGroupOutputIndices;
-            auto arrayViewOutputIndices = dnaReader->getJointGroupOutputIndices(i);
-            for (size_t j = 0; j < arrayViewOutputIndices.size(); ++j) 
-            {
-                jointGroupOutputIndices.Add(arrayViewOutputIndices[j]);
-            }
-
-            TArray<float> jointGroupValues;
-            auto arrayViewValues = dnaReader->getJointGroupValues(i);
-            for (size_t j = 0; j < arrayViewValues.size(); ++j) {
-                jointGroupValues.Add(arrayViewValues[j]);
-            }
-            float _valueX = valueX * valueX;
-            TArray<float> XYZMult = { _valueX, valueY, valueZ, valueX, valueY, valueZ, valueX, valueY, valueZ };
-            for (int k = jointIndex * 9; k < jointIndex * 9 + 9; k++)
+            for (const DnaRigIndex::Cell& cell : rigIndex.outputCells(k))
             {
-                if (jointGroupOutputIndices.Contains(k))
+                if (cell.jointGroup != i)
                 {
-                    for (int p = 0; p < jointGroupOutputIndices.Num(); p++)
-                    {
-                        if (jointGroupOutputIndices[p] == k)
-                        {
-                            for (int l = p * arrayViewInputIndices.size(); l < p * arrayViewInputIndices.size() + arrayViewInputIndices.size(); l++)
-                            {
-                                jointGroupValues[l] *= XYZMult[l % 9];
-                            }
-                        }
-                    }
+                    continue;
+                }
+                for (int l = cell.index * inputCount; l < cell.index * inputCount + inputCount; l++)
+                {
+                    jointGroupValues[l] *= XYZMult[l % 9];
                 }
             }
+        }
 
-            writer->setJointGroupValues(i, jointGroupValues.GetData(), jointGroupValues.Num());
+        writer->setJointGroupValues(i, jointGroupValues.GetData(), jointGroupValues.Num());
 
-            UE_LOG(LogTemp, Log, TEXT("Modified joint group %d for joint %s with multiplier %f,%f,%f"), i, UTF8_TO_TCHAR(dnaReader->getJointName(jointIndex)), _valueX, valueY, valueZ);
-        }
+        UE_LOG(LogTemp, Log, TEXT("Modified joint group %d for joint %s with multiplier %f,%f,%f"), i, UTF8_TO_TCHAR(dnaReader->getJointName(jointIndex)), _valueX, valueY, valueZ);
     }
 }
 
@@ -0,0 +1,129 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "DnaRigIndex.h"
+
+namespace
+{
+	// 两遍遍历所有关节组建立 CSR 表：第一遍统计每个键的条目数，第二遍按关节组顺序填入。
+	// visit(group, emit) 对关节组中的每个条目调用 emit(key, entry)，超出 keyCount 的键被忽略
+	template <typename EntryType, typename VisitType>
+	void buildTable(int32 keyCount, uint16_t jointGroupCount, VisitType&& visit, TArray<int32>& offsets, TArray<EntryType>& entries)
+	{
+		offsets.Init(0, keyCount + 1);
+		for (uint16_t i = 0; i < jointGroupCount; ++i)
+		{
+			visit(i, [&](int32 key, const EntryType&)
+			{
+				if (key < keyCount)
+				{
+					++offsets[key + 1];
+				}
+			});
+		}
+		for (int32 key = 0; key < keyCount; ++key)
+		{
+			offsets[key + 1] += offsets[key];
+		}
+
+		entries.SetNumUninitialized(offsets[keyCount]);
+		TArray<int32> next(offsets.GetData(), keyCount);
+		for (uint16_t i = 0; i < jointGroupCount; ++i)
+		{
+			visit(i, [&](int32 key, const EntryType& entry)
+			{
+				if (key < keyCount)
+				{
+					entries[next[key]++] = entry;
+				}
+			});
+		}
+	}
+
+	template <typename EntryType>
+	TArrayView<const EntryType> tableRow(const TArray<int32>& offsets, const TArray<EntryType>& entries, int32 key)
+	{
+		if (key < 0 || key + 1 >= offsets.Num())
+		{
+			return TArrayView<const EntryType>();
+		}
+		return TArrayView<const EntryType>(entries.GetData() + offsets[key], offsets[key + 1] - offsets[key]);
+	}
+}
+
+void DnaRigIndex::build(const dnac::DNACalibDNAReader* reader)
+{
+	reset();
+	if (!reader)
+	{
+		return;
+	}
+
+	const uint16_t jointGroupCount = reader->getJointGroupCount();
+	const int32 jointCount = reader->getJointCount();
+	const int32 rawControlCount = reader->getRawControlCount();
+
+	inputCounts.SetNumUninitialized(jointGroupCount);
+	for (uint16_t i = 0; i < jointGroupCount; ++i)
+	{
+		inputCounts[i] = static_cast<uint16_t>(reader->getJointGroupInputIndices(i).size());
+	}
+
+	buildTable<uint16_t>(jointCount, jointGroupCount, [&](uint16_t i, auto&& emit)
+	{
+		auto arrayViewIndices = reader->getJointGroupJointIndices(i);
+		for (size_t j = 0; j < arrayViewIndices.size(); ++j)
+		{
+			emit(arrayViewIndices[j], i);
+		}
+	}, jointGroupOffsets, jointGroups);
+
+	buildTable<Cell>(rawControlCount, jointGroupCount, [&](uint16_t i, auto&& emit)
+	{
+		auto arrayViewInputIndices = reader->getJointGroupInputIndices(i);
+		for (size_t j = 0; j < arrayViewInputIndices.size(); ++j)
+		{
+			emit(arrayViewInputIndices[j], Cell{ i, static_cast<uint16_t>(j) });
+		}
+	}, inputOffsets, inputCellList);
+
+	buildTable<Cell>(jointCount * 9, jointGroupCount, [&](uint16_t i, auto&& emit)
+	{
+		auto arrayViewOutputIndices = reader->getJointGroupOutputIndices(i);
+		for (size_t k = 0; k < arrayViewOutputIndices.size(); ++k)
+		{
+			emit(arrayViewOutputIndices[k], Cell{ i, static_cast<uint16_t>(k) });
+		}
+	}, outputOffsets, outputCellList);
+
+	bBuilt = true;
+	UE_LOG(LogTemp, Log, TEXT("Built joint group index: %d joint groups, %d joint entries, %d input cells, %d output cells"),
+		jointGroupCount, jointGroups.Num(), inputCellList.Num(), outputCellList.Num());
+}
+
+void DnaRigIndex::reset()
+{
+	jointGroupOffsets.Empty();
+	jointGroups.Empty();
+	inputOffsets.Empty();
+	inputCellList.Empty();
+	outputOffsets.Empty();
+	outputCellList.Empty();
+	inputCounts.Empty();
+	bBuilt = false;
+}
+
+TArrayView<const uint16_t> DnaRigIndex::jointGroupsOfJoint(int32 jointIndex) const
+{
+	return tableRow(jointGroupOffsets, jointGroups, jointIndex);
+}
+
+TArrayView<const DnaRigIndex::Cell> DnaRigIndex::inputCells(int32 rawControlIndex) const
+{
+	return tableRow(inputOffsets, inputCellList, rawControlIndex);
+}
+
+TArrayView<const DnaRigIndex::Cell> DnaRigIndex::outputCells(int32 outputIndex) const
+{
+	return tableRow(outputOffsets, outputCellList, outputIndex);
+}
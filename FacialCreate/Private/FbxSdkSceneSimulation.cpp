@@ -74,65 +74,43 @@ void FbxSdkSceneSimulation::getPoseToJointMove(uint16_t poseIndex, FString poseN
         return;
     }
 
-    uint16_t jointGroupCount = reader->getJointGroupCount();
-    
     TArray<FString> attributes = { TEXT("TranslateX"), TEXT("TranslateY"), TEXT("TranslateZ"), 
                                  TEXT("RotateX"), TEXT("RotateY"), TEXT("RotateZ") };
 
-    for (uint16_t i = 0; i < jointGroupCount; ++i)
+    // 只访问以该控制器为输入的关节组列，按关节组、列的顺序与逐组扫描时一致
+    for (const DnaRigIndex::Cell& cell : DnaReader::rigIndex.inputCells(poseIndex))
     {
-        TArray<uint16_t> jointGroupInputIndices;
-        auto arrayViewInputIndices = reader->getJointGroupInputIndices(i);
-        for (size_t j = 0; j < arrayViewInputIndices.size(); ++j)
-        {
-            jointGroupInputIndices.Add(arrayViewInputIndices[j]);
-        }
+        auto arrayViewValues = reader->getJointGroupValues(cell.jointGroup);
+        auto arrayViewOutputIndices = reader->getJointGroupOutputIndices(cell.jointGroup);
+        const size_t inputCount = DnaReader::rigIndex.inputCount(cell.jointGroup);
 
-        if (jointGroupInputIndices.Contains(poseIndex))
+        for (size_t k = 0; k < arrayViewOutputIndices.size(); ++k)
         {
-            TArray<float> jointGroupValues;
-            auto arrayViewValues = reader->getJointGroupValues(i);
-            for (size_t j = 0; j < arrayViewValues.size(); ++j) {
-                jointGroupValues.Add(arrayViewValues[j]);
-            }
+            size_t valuesindex = k * inputCount + cell.index;
+            uint16_t jointOutputIndex = arrayViewOutputIndices[k];
+
+            uint16_t quotient = jointOutputIndex / 9;
+            uint16_t remainder = jointOutputIndex % 9;
 
-            TArray<uint16_t> jointGroupOutputIndices;
-            auto arrayViewOutputIndices = reader->getJointGroupOutputIndices(i);
+            const char* jointName = reader->getJointName(quotient);
 
-            for (uint16_t j = 0; j < jointGroupInputIndices.Num(); ++j)
+            FbxNode* jointNode = UFbxSdkReader::FindNode(jointName);
+
+            if (jointNode)
             {
-                if (jointGroupInputIndices[j] == poseIndex)
+                const int axisIndex = remainder % 3;  // 获取xyz轴的索引
+                if (remainder < 3)  // Translation
+                {
+                    FbxDouble3 translation = jointNode->LclTranslation.Get();
+                    translation[axisIndex] += arrayViewValues[valuesindex];
+                    jointNode->LclTranslation.Set(translation);
+                }
+                else  // Rotation
                 {
-                    for (size_t k = 0; k < arrayViewOutputIndices.size(); ++k)
-                    {
-                        uint16_t valuesindex = k * jointGroupInputIndices.Num() + j;
-                        uint16_t jointOutputIndex = arrayViewOutputIndices[k];
-                        
-                        uint16_t quotient = jointOutputIndex / 9;
-                        uint16_t remainder = jointOutputIndex % 9;
-
-                        const char* jointName = reader->getJointName(quotient);
-
-                        FbxNode* jointNode = UFbxSdkReader::FindNode(jointName);
-
-                        if (jointNode)
-                        {
-                            const int axisIndex = remainder % 3;  // 获取xyz轴的索引
-                            if (remainder < 3)  // Translation
-                            {
-                                FbxDouble3 translation = jointNode->LclTranslation.Get();
-                                translation[axisIndex] += jointGroupValues[valuesindex];
-                                jointNode->LclTranslation.Set(translation);
-                            }
-                            else  // Rotation
-                            {
-                                FbxDouble3 rotation = jointNode->LclRotation.Get();
-                                rotation[axisIndex] = jointGroupValues[valuesindex];
-                                jointNode->LclRotation.Set(rotation);
-
-                            }
-                        }
-                    }
+                    FbxDouble3 rotation = jointNode->LclRotation.Get();
+                    rotation[axisIndex] = arrayViewValues[valuesindex];
+                    jointNode->LclRotation.Set(rotation);
+
                 }
             }
         }
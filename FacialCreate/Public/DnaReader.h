@@ -5,6 +5,7 @@
 #include "CoreMinimal.h"
 #include "fbxsdk.h"
 #include "dnacalib/DNACalib.h"
+#include "DnaRigIndex.h"
 
 
 class FACIALCREATE_API DnaReader
@@ -29,6 +30,8 @@ public:
 	static TArray<dna::Position> oldJointPositions;
 	static TArray<dna::Position> newVertexPositions;
 	static TArray<dna::Position> oldVertexPositions;
+	// dnaReader 关节组的反向索引，readDna 与 setDnaLod 之后建立
+	static DnaRigIndex rigIndex;
 	static const char* eyeLeftJoints[6];
 	static const char* eyeRightJoints[6];
 
@@ -0,0 +1,48 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "dnacalib/DNACalib.h"
+
+/**
+ * DNA 关节组的反向索引，读取 DNA 后建立一次，关节组结构改变（如 SetLODsCommand）后重建：
+ * 关节 -> 包含它的关节组，原始控制器 -> (关节组, 列)，输出索引 -> (关节组, 行)。
+ * 关节组的值按行存放，第 row 行第 column 列为 values[row * 输入数 + column]。
+ * 三张表都是按键排列的扁平数组，查询不复制 DNA 数据
+ */
+class FACIALCREATE_API DnaRigIndex
+{
+public:
+	struct Cell
+	{
+		uint16_t jointGroup;
+		uint16_t index;   // inputCells 中为列号，outputCells 中为行号
+	};
+
+	void build(const dnac::DNACalibDNAReader* reader);
+	void reset();
+	bool isBuilt() const { return bBuilt; }
+
+	// 包含该关节的关节组，升序
+	TArrayView<const uint16_t> jointGroupsOfJoint(int32 jointIndex) const;
+
+	// 以该原始控制器为输入的 (关节组, 列)，按关节组、列升序
+	TArrayView<const Cell> inputCells(int32 rawControlIndex) const;
+
+	// 输出该属性的 (关节组, 行)，outputIndex = 关节索引 * 9 + 属性（平移 xyz、旋转 xyz、缩放 xyz）
+	TArrayView<const Cell> outputCells(int32 outputIndex) const;
+
+	// 关节组的输入数，即值矩阵的列数
+	uint16_t inputCount(uint16_t jointGroup) const { return inputCounts[jointGroup]; }
+
+private:
+	TArray<int32> jointGroupOffsets;   // 关节数 + 1 个
+	TArray<uint16_t> jointGroups;
+	TArray<int32> inputOffsets;        // 原始控制器数 + 1 个
+	TArray<Cell> inputCellList;
+	TArray<int32> outputOffsets;       // 关节数 * 9 + 1 个
+	TArray<Cell> outputCellList;
+	TArray<uint16_t> inputCounts;
+	bool bBuilt = false;
+};
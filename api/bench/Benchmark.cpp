@@ -0,0 +1,485 @@
+#include "BlendShapeJson.h"
+#include "BlendShapePipeline.h"
+#include "ContentHash.h"
+#include "Log.h"
+#include "MeshKernels.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+using namespace cf;
+
+// characterfactory-bench：在 resources 中的FBX与权重文件上逐阶段重复运行流水线，
+// 输出耗时、吞吐量与峰值内存，并把各阶段输出的哈希与基准文件比对，保证优化前后结果一致
+
+namespace {
+
+    using Clock = chrono::steady_clock;
+
+    // 坐标按 1e-6 量化后再求哈希，容忍不改变结果的末位舍入差异
+    const double kHashQuantum = 1e-6;
+
+    struct StageResult {
+        string name;
+        double minMs = 0.0;
+        double meanMs = 0.0;
+        double units = 0.0;        // 每次迭代处理的数据量
+        const char* unitName = "";
+        uint64_t hash = 0;
+        bool hashed = false;
+        size_t peakBytes = 0;
+    };
+
+    // 累积需要求哈希的数据，最后一次性计算 XXH64
+    class OutputHash {
+    public:
+        void add(const string& text) {
+            add(static_cast<uint64_t>(text.size()));
+            mBytes.insert(mBytes.end(), text.begin(), text.end());
+        }
+        void add(uint64_t value) {
+            const uint8_t* p = reinterpret_cast<const uint8_t*>(&value);
+            mBytes.insert(mBytes.end(), p, p + sizeof(value));
+        }
+        void addQuantized(const double* values, size_t count) {
+            for (size_t i = 0; i < count; ++i) {
+                add(static_cast<uint64_t>(llround(values[i] / kHashQuantum)));
+            }
+        }
+        void addMeshes(const MeshSet& meshes) {
+            add(static_cast<uint64_t>(meshes.meshCount()));
+            for (size_t m = 0; m < meshes.meshCount(); ++m) {
+                add(meshes.name(m));
+                addQuantized(meshes.x(m), meshes.vertexCount(m));
+                addQuantized(meshes.y(m), meshes.vertexCount(m));
+                addQuantized(meshes.z(m), meshes.vertexCount(m));
+            }
+        }
+        uint64_t value() const { return hashBytes(mBytes.data(), mBytes.size()); }
+
+    private:
+        vector<uint8_t> mBytes;
+    };
+
+    // 把收到的通道写入哈希，不保存数据
+    class HashingHost : public BlendShapeHost {
+    public:
+        explicit HashingHost(const MeshSet& base) : mBase(base) {}
+
+        bool beginMesh(const string& meshName, size_t& vertexCount) override {
+            int slot = mBase.find(meshName);
+            if (slot < 0) {
+                return false;
+            }
+            vertexCount = mBase.vertexCount(slot);
+            hash.add(meshName);
+            return true;
+        }
+        bool addTarget(const string& channelName, const SparseShapeDelta& delta) override {
+            hash.add(channelName);
+            for (uint32_t index : delta.indices) {
+                hash.add(static_cast<uint64_t>(index));
+            }
+            hash.addQuantized(delta.dx.data(), delta.size());
+            hash.addQuantized(delta.dy.data(), delta.size());
+            hash.addQuantized(delta.dz.data(), delta.size());
+            return true;
+        }
+        void endMesh(size_t targetCount) override { hash.add(static_cast<uint64_t>(targetCount)); }
+
+        OutputHash hash;
+
+    private:
+        const MeshSet& mBase;
+    };
+
+    size_t peakMemoryBytes() {
+#ifdef _WIN32
+        PROCESS_MEMORY_COUNTERS counters;
+        if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+            return counters.PeakWorkingSetSize;
+        }
+        return 0;
+#else
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) != 0) {
+            return 0;
+        }
+#ifdef __APPLE__
+        return static_cast<size_t>(usage.ru_maxrss);
+#else
+        return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+    }
+
+    // fn 完成一次阶段运行并返回输出哈希；计时只包含 fn 内部标记的区间
+    using StageFn = function<uint64_t(double& elapsedMs)>;
+
+    StageResult runStage(const string& name, int iterations, double units, const char* unitName, bool hashed, const StageFn& fn) {
+        StageResult result;
+        result.name = name;
+        result.units = units;
+        result.unitName = unitName;
+        result.hashed = hashed;
+        result.minMs = 1e300;
+
+        double totalMs = 0.0;
+        for (int i = 0; i < iterations; ++i) {
+            double elapsedMs = 0.0;
+            uint64_t hash = fn(elapsedMs);
+            if (i == 0) {
+                result.hash = hash;
+            } else if (hash != result.hash) {
+                logError(name + ": output differs between iterations");
+            }
+            totalMs += elapsedMs;
+            result.minMs = min(result.minMs, elapsedMs);
+        }
+        result.meanMs = totalMs / iterations;
+        result.peakBytes = peakMemoryBytes();
+        return result;
+    }
+
+    double elapsedSince(Clock::time_point start) {
+        return chrono::duration<double, milli>(Clock::now() - start).count();
+    }
+
+    map<string, string> readGolden(const string& path) {
+        map<string, string> golden;
+        ifstream file(path);
+        string stage, hash;
+        while (file >> stage >> hash) {
+            if (!stage.empty() && stage[0] != '#') {
+                golden[stage] = hash;
+            }
+        }
+        return golden;
+    }
+
+    string hexHash(uint64_t hash) {
+        char text[17];
+        snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(hash));
+        return text;
+    }
+
+    const char* kUsage =
+        "Usage: characterfactory-bench [options]\n"
+        "\n"
+        "Options:\n"
+        "  --resources <dir>      directory with the FBX files and skin_weights.json (default: resources)\n"
+        "  --iterations <n>       runs per stage (default 5)\n"
+        "  --workers <n>          import worker threads, 0 = all cores (default 1)\n"
+        "  --kernels <isa>        vertex kernels: scalar, sse2 or avx2 (default: best supported)\n"
+        "  --golden <file>        compare stage output hashes against this file\n"
+        "  --update-golden        write the current hashes to the golden file instead of comparing\n"
+        "  -h, --help             show this help\n";
+
+}
+
+int main(int argc, char** argv) {
+    string resourceDir = "resources";
+    string goldenPath;
+    bool updateGolden = false;
+    int iterations = 5;
+    PipelineOptions options;
+    options.workerCount = 1;
+
+    for (int i = 1; i < argc; ++i) {
+        const string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "-h" || arg == "--help") {
+            fputs(kUsage, stdout);
+            return 0;
+        } else if (arg == "--resources" && hasValue) {
+            resourceDir = argv[++i];
+        } else if (arg == "--iterations" && hasValue) {
+            iterations = max(1, atoi(argv[++i]));
+        } else if (arg == "--workers" && hasValue) {
+            options.workerCount = static_cast<unsigned>(max(0, atoi(argv[++i])));
+        } else if (arg == "--kernels" && hasValue) {
+            const string isa = argv[++i];
+            if (isa == "scalar") {
+                setKernelIsa(KernelIsa::Scalar);
+            } else if (isa == "sse2") {
+                setKernelIsa(KernelIsa::Sse2);
+            } else if (isa == "avx2") {
+                setKernelIsa(KernelIsa::Avx2);
+            } else {
+                fprintf(stderr, "characterfactory-bench: unknown kernels %s\n\n%s", isa.c_str(), kUsage);
+                return 2;
+            }
+        } else if (arg == "--golden" && hasValue) {
+            goldenPath = argv[++i];
+        } else if (arg == "--update-golden") {
+            updateGolden = true;
+        } else {
+            fprintf(stderr, "characterfactory-bench: unknown argument %s\n\n%s", arg.c_str(), kUsage);
+            return 2;
+        }
+    }
+
+    // 与插件示例一致：trump 为底模
+    const vector<string> fbxFiles = {
+        resourceDir + "/trump.fbx", resourceDir + "/bigear.fbx", resourceDir + "/cooper.fbx", resourceDir + "/farrukh.fbx"
+    };
+    const string weightPath = resourceDir + "/skin_weights.json";
+    const string cachePath = "bench_skin_weights.cfw";
+    const string outputPath = "bench_blendshapes.json";
+
+    ScopedLogSink quiet([](LogLevel level, const string& message) {
+        if (level != LogLevel::Info) {
+            fprintf(stderr, "%s%s\n", level == LogLevel::Error ? "Error: " : "Warning: ", message.c_str());
+        }
+    });
+
+    BlendShapePipeline pipeline(options);
+    vector<StageResult> results;
+
+    // 阶段之间传递的数据取自各阶段第一次运行的结果
+    vector<MeshSet> loaded = pipeline.loadFbxFiles(fbxFiles);
+    if (loaded.size() != fbxFiles.size()) {
+        logError("Failed to read the benchmark FBX files from " + resourceDir);
+        return 1;
+    }
+    size_t totalVertices = 0;
+    for (const MeshSet& meshes : loaded) {
+        totalVertices += meshes.vertexCount();
+    }
+    const size_t targetVertices = totalVertices - loaded[0].vertexCount();
+
+    results.push_back(runStage("load", iterations, static_cast<double>(totalVertices), "vertices", true, [&](double& ms) {
+        auto start = Clock::now();
+        vector<MeshSet> meshes = pipeline.loadFbxFiles(fbxFiles);
+        ms = elapsedSince(start);
+        OutputHash hash;
+        for (const MeshSet& set : meshes) {
+            hash.addMeshes(set);
+        }
+        return hash.value();
+    }));
+
+    // 几何缓存命中：先用一次读取填充临时缓存目录，之后每次都从缓存加载
+    const string geometryCacheDir = "bench_geometry_cache";
+    PipelineOptions cachedOptions = options;
+    cachedOptions.geometryCacheDir = geometryCacheDir;
+    BlendShapePipeline cachedPipeline(cachedOptions);
+    cachedPipeline.loadFbxFiles(fbxFiles);
+    results.push_back(runStage("load-cached", iterations, static_cast<double>(totalVertices), "vertices", true, [&](double& ms) {
+        auto start = Clock::now();
+        vector<MeshSet> meshes = cachedPipeline.loadFbxFiles(fbxFiles);
+        ms = elapsedSince(start);
+        OutputHash hash;
+        for (const MeshSet& set : meshes) {
+            hash.addMeshes(set);
+        }
+        return hash.value();
+    }));
+    filesystem::remove_all(geometryCacheDir);
+
+    vector<MeshSet> registered = loaded;
+    pipeline.registerHeads(registered);
+    const double headVertices = static_cast<double>(loaded[0].vertexCount(loaded[0].find("head_lod0_mesh")) * (loaded.size() - 1));
+    results.push_back(runStage("register", iterations, headVertices, "vertices", true, [&](double& ms) {
+        vector<MeshSet> meshes = loaded;
+        auto start = Clock::now();
+        pipeline.registerHeads(meshes);
+        ms = elapsedSince(start);
+        OutputHash hash;
+        for (const MeshSet& set : meshes) {
+            hash.addMeshes(set);
+        }
+        return hash.value();
+    }));
+
+    remove(cachePath.c_str());
+    RegionWeightMap weights = BlendShapePipeline::loadRegionWeights(weightPath, cachePath);
+    auto hashWeights = [](const RegionWeightMap& map) {
+        OutputHash hash;
+        for (size_t r = 0; r < map.regionCount(); ++r) {
+            hash.add(map.region(r).regionName);
+            for (size_t k = 0; k < map.nonZeroCount(r); ++k) {
+                uint32_t bits;
+                memcpy(&bits, map.weights(r) + k, sizeof(bits));
+                hash.add(static_cast<uint64_t>(map.indices(r)[k]) << 32 | bits);
+            }
+        }
+        return hash.value();
+    };
+    const double weightEntries = static_cast<double>(weights.totalNonZeroCount());
+    results.push_back(runStage("weights-json", iterations, weightEntries, "entries", true, [&](double& ms) {
+        remove(cachePath.c_str());
+        auto start = Clock::now();
+        RegionWeightMap map = BlendShapePipeline::loadRegionWeights(weightPath, cachePath);
+        ms = elapsedSince(start);
+        return hashWeights(map);
+    }));
+    results.push_back(runStage("weights-cache", iterations, weightEntries, "entries", true, [&](double& ms) {
+        auto start = Clock::now();
+        RegionWeightMap map = BlendShapePipeline::loadRegionWeights(weightPath, cachePath);
+        ms = elapsedSince(start);
+        return hashWeights(map);
+    }));
+
+    vector<MeshSet> aligned = pipeline.alignRegionsByCenter(registered, weights);
+    results.push_back(runStage("align", iterations, static_cast<double>(targetVertices), "vertices", true, [&](double& ms) {
+        auto start = Clock::now();
+        vector<MeshSet> meshes = pipeline.alignRegionsByCenter(registered, weights);
+        ms = elapsedSince(start);
+        OutputHash hash;
+        for (const MeshSet& set : meshes) {
+            hash.addMeshes(set);
+        }
+        return hash.value();
+    }));
+
+    vector<MeshSet> gaps = BlendShapePipeline::getMeshGap(aligned);
+    results.push_back(runStage("gap", iterations, static_cast<double>(targetVertices), "vertices", true, [&](double& ms) {
+        auto start = Clock::now();
+        vector<MeshSet> result = BlendShapePipeline::getMeshGap(aligned);
+        ms = elapsedSince(start);
+        OutputHash hash;
+        for (const MeshSet& set : result) {
+            hash.addMeshes(set);
+        }
+        return hash.value();
+    }));
+
+    PipelineResult prepared;
+    prepared.weights = weights;
+    prepared.base = aligned[0];
+    prepared.gaps = gaps;
+    const double channelCount = static_cast<double>(weights.regionCount() * options.channelSuffixes.size());
+    results.push_back(runStage("shapes", iterations, channelCount, "shapes", true, [&](double& ms) {
+        HashingHost host(prepared.base);
+        auto start = Clock::now();
+        pipeline.build(prepared, host);
+        ms = elapsedSince(start);
+        return host.hash.value();
+    }));
+
+    // 融合求差：配准变换、区域偏移与减法一次完成，输出的通道应与分阶段结果一致（与 shapes 的哈希相同）
+    const vector<SimilarityTransform> transforms = pipeline.solveHeadTransforms(loaded);
+    PipelineTraffic fusedTraffic;
+    results.push_back(runStage("fused", iterations, static_cast<double>(targetVertices), "vertices", true, [&](double& ms) {
+        auto start = Clock::now();
+        PipelineResult fused;
+        fused.gaps = pipeline.evaluateGaps(loaded, transforms, weights, &fusedTraffic);
+        ms = elapsedSince(start);
+        fused.weights = weights;
+        HashingHost host(loaded[0]);
+        pipeline.build(fused, host);
+        return host.hash.value();
+    }));
+
+    // 插件中的 saveFbxFile 依赖 FBX SDK，这里以JSON输出代替，只计时不比对哈希
+    double outputBytes = 0.0;
+    results.push_back(runStage("write", iterations, 0.0, "MB", false, [&](double& ms) {
+        auto start = Clock::now();
+        JsonBlendShapeHost host(prepared.base);
+        pipeline.build(prepared, host);
+        string error;
+        if (!host.save(outputPath, error)) {
+            logError(error);
+        }
+        ms = elapsedSince(start);
+        ifstream file(outputPath, ios::binary | ios::ate);
+        outputBytes = static_cast<double>(file.tellg());
+        return uint64_t(0);
+    }));
+    results.back().units = outputBytes / (1024.0 * 1024.0);
+
+    remove(cachePath.c_str());
+    remove(outputPath.c_str());
+
+    map<string, string> golden;
+    if (!goldenPath.empty() && !updateGolden) {
+        golden = readGolden(goldenPath);
+        if (golden.empty()) {
+            logError("Cannot read golden hashes from " + goldenPath);
+            return 1;
+        }
+    }
+
+    printf("Vertex kernels: %s\n", kernelIsaName(activeKernelIsa()));
+    printf("%-14s %6s %10s %10s %16s %10s %-18s %s\n", "stage", "iters", "mean ms", "min ms", "throughput", "peak MB", "hash", "golden");
+    int mismatches = 0;
+    for (const StageResult& result : results) {
+        const double perSecond = result.minMs > 0.0 ? result.units / (result.minMs / 1000.0) : 0.0;
+        char throughput[64];
+        snprintf(throughput, sizeof(throughput), "%.3g %s/s", perSecond, result.unitName);
+
+        string status = "-";
+        if (result.hashed && !golden.empty()) {
+            auto it = golden.find(result.name);
+            if (it == golden.end()) {
+                status = "missing";
+                ++mismatches;
+            } else if (it->second != hexHash(result.hash)) {
+                status = "MISMATCH (expected " + it->second + ")";
+                ++mismatches;
+            } else {
+                status = "ok";
+            }
+        }
+        printf("%-14s %6d %10.3f %10.3f %16s %10.1f %-18s %s\n", result.name.c_str(), iterations, result.meanMs, result.minMs,
+               throughput, result.peakBytes / (1024.0 * 1024.0), result.hashed ? hexHash(result.hash).c_str() : "-", status.c_str());
+    }
+
+    // 分阶段：配准原地读写所有目标顶点，对齐前复制全部模型，再逐网格求差
+    PipelineTraffic stagedTraffic;
+    for (size_t i = 0; i < loaded.size(); ++i) {
+        const uint64_t bytes = loaded[i].vertexCount() * 3 * sizeof(double);
+        stagedTraffic.bytesRead += (i > 0 ? 2 : 1) * bytes;
+        stagedTraffic.bytesWritten += (i > 0 ? 2 : 1) * bytes;
+        stagedTraffic.transientBytes += bytes;
+    }
+    for (const MeshSet& gap : gaps) {
+        const uint64_t bytes = gap.vertexCount() * 3 * sizeof(double);
+        stagedTraffic.bytesRead += 2 * bytes;
+        stagedTraffic.bytesWritten += bytes;
+        stagedTraffic.transientBytes += bytes;
+    }
+    auto printTraffic = [](const char* label, const PipelineTraffic& traffic) {
+        printf("%-8s read %8.1f MB  written %8.1f MB  transient %8.1f MB\n", label, traffic.bytesRead / (1024.0 * 1024.0),
+               traffic.bytesWritten / (1024.0 * 1024.0), traffic.transientBytes / (1024.0 * 1024.0));
+    };
+    printf("\nCoordinate traffic for register + align + gap:\n");
+    printTraffic("staged", stagedTraffic);
+    printTraffic("fused", fusedTraffic);
+
+    if (updateGolden) {
+        if (goldenPath.empty()) {
+            logError("--update-golden needs --golden <file>");
+            return 2;
+        }
+        ofstream file(goldenPath, ios::trunc);
+        file << "# stage output hashes from characterfactory-bench (coordinates quantized to " << kHashQuantum << ")\n";
+        for (const StageResult& result : results) {
+            if (result.hashed) {
+                file << result.name << " " << hexHash(result.hash) << "\n";
+            }
+        }
+        printf("Golden hashes written to %s\n", goldenPath.c_str());
+        return 0;
+    }
+
+    return mismatches == 0 ? 0 : 1;
+}
@@ -8,12 +8,14 @@
 #include <maya/MSelectionList.h>
 #include <maya/MFileIO.h>
 #include <maya/MFnDependencyNode.h>
+#include <maya/MSyntax.h>
 #include <string>
 #include <vector>
 #include <array>
 #include <map>
 #include <algorithm>
 #include <fbxsdk.h>
+#include "MeshCapture.h"
 
 using namespace std;
 
@@ -26,16 +28,17 @@ public:
     virtual ~characterfactoryautorigcreate();
 
     static void* creator();
+    static MSyntax newSyntax();
     MStatus doIt(const MArgList& args) override;
     virtual bool isUndoable() const override { return false; }
     
-    // FBX导出方法
-    MString FbxExporter();
+    // 把场景中的 *_lod0_mesh 直接转换为全局FBX场景（不经过FBX文件），没有可用网格时返回 false
+    bool CaptureFbxScene(MeshCaptureStats& stats);
     
-    // 创建FBX场景方法
+    // 从FBX文件创建全局FBX场景
     bool CreateFbxScene(const char* fbxPath);
     
-    // 获取全局FBX场景
+    // 获取全局FBX场景（由 FbxSession 持有）
     static FbxScene* GetGlobalFbxScene();
 
     static const char* commandName;
@@ -43,10 +46,6 @@ public:
 private:
     class Implementation;
     Implementation* pImpl;
-    
-    // 全局FBX管理器和场景
-    static FbxManager* mGlobalFbxManager;
-    static FbxScene* mGlobalFbxScene;
 };
     
 }  // namespace cf
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "MeshSet.h"
+#include "RegionWeights.h"
+#include "ShapeDelta.h"
+
+using namespace std;
+
+namespace cf {
+
+// 接收 blendShape 目标的宿主：FBX 场景、Maya 场景或测试中的内存实现。
+// 调用顺序为 beginMesh -> addTarget* -> endMesh
+class BlendShapeHost {
+public:
+    virtual ~BlendShapeHost() = default;
+
+    // 开始为底模网格生成 blendShape，返回底模顶点数；网格不存在时返回 false，该网格被跳过
+    virtual bool beginMesh(const string& meshName, size_t& vertexCount) = 0;
+
+    // 添加一个稀疏目标通道，delta 中的位移相对于底模顶点
+    virtual bool addTarget(const string& channelName, const SparseShapeDelta& delta) = 0;
+
+    // 当前网格的所有通道已添加，targetCount 为成功添加的通道数
+    virtual void endMesh(size_t targetCount) = 0;
+};
+
+struct BlendShapeBuildStats {
+    size_t meshes = 0;          // 生成了 blendShape 的网格数
+    size_t skippedMeshes = 0;   // 宿主中不存在的网格数
+    size_t channels = 0;        // 添加的通道数
+    size_t prunedChannels = 0;  // 位移全部低于阈值而跳过的通道数
+    size_t failedChannels = 0;  // 宿主拒绝的通道数
+    size_t shapePoints = 0;     // 写入的目标顶点总数
+    size_t densePoints = 0;     // 稠密写法需要的目标顶点总数
+    size_t lodMeshes = 0;       // 由 lod0 传播生成了通道的 LOD 网格数
+    size_t lodChannels = 0;     // 传播到 LOD 网格的通道数（不计入 channels）
+    size_t lodPoints = 0;       // LOD 通道的目标顶点总数
+};
+
+// 为权重表中的每个 (网格, 区域, 后缀) 生成通道 meshName + regionName + "_" + suffix，
+// 其位移取自 distance[后缀序号] 中对应网格的差值
+BlendShapeBuildStats buildBlendShapes(const RegionWeightMap& weights, const vector<MeshSet>& distance,
+                                      const vector<string>& suffixes, double epsilon, BlendShapeHost& host);
+
+// 单精度差值，通道与统计和双精度版本相同
+BlendShapeBuildStats buildBlendShapes(const RegionWeightMap& weights, const vector<MeshSetF>& distance,
+                                      const vector<string>& suffixes, double epsilon, BlendShapeHost& host);
+
+}
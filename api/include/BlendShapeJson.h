@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+#include <nlohmann/json.hpp>
+#include "BlendShapeBuilder.h"
+#include "MeshSet.h"
+
+using namespace std;
+
+namespace cf {
+
+// 把 blendShape 通道写成JSON，供命令行工具等不依赖 Maya/FBX SDK 的场合使用：
+// {mesh: {channel: {"indices": [i, ...], "deltas": [dx, dy, dz, ...]}}}
+class JsonBlendShapeHost : public BlendShapeHost {
+public:
+    // 底模网格取自 baseMeshes（通常为 PipelineResult::base），不存在的网格被跳过
+    explicit JsonBlendShapeHost(const MeshSet& baseMeshes);
+
+    bool beginMesh(const string& meshName, size_t& vertexCount) override;
+    bool addTarget(const string& channelName, const SparseShapeDelta& delta) override;
+    void endMesh(size_t targetCount) override;
+
+    const nlohmann::json& json() const { return mJson; }
+    bool save(const string& path, string& error) const;
+
+private:
+    const MeshSet& mBaseMeshes;
+    nlohmann::json mJson;
+    nlohmann::json mCurrent;
+    string mMeshName;
+};
+
+}
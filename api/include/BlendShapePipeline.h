@@ -0,0 +1,214 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "BlendShapeBuilder.h"
+#include "GeometryCache.h"
+#include "LodTransfer.h"
+#include "MeshSet.h"
+#include "RegionWeights.h"
+#include "Registration.h"
+
+using namespace std;
+
+namespace cf {
+
+class JobProgress;
+class SessionCache;
+
+// 融合求差阶段坐标的存储与计算精度；配准求解与区域中心的累加始终使用 double
+enum class GeometryPrecision {
+    Double,
+    Float     // 目标模型与差值以 float 保存，内存减半，批量内核每条指令处理两倍的顶点
+};
+
+const char* geometryPrecisionName(GeometryPrecision precision);
+
+struct PipelineOptions {
+    unsigned workerCount = 0;        // 导入FBX、区域对齐与求差的工作线程数，0 表示使用硬件并发数
+    bool useNativeReader = true;     // 二进制FBX优先使用 FbxBinaryReader
+    SimilarityOptions similarity;    // 头部配准参数
+    double deltaEpsilon = 1e-6;      // blendShape 目标的位移阈值
+    string weightCachePath;          // 权重二进制缓存路径，为空时放在权重JSON旁边
+    bool fusedEvaluation = true;     // 配准、区域对齐与求差在一次遍历中完成，不复制整套模型
+    string geometryCacheDir;         // 提取出的几何的持久缓存目录，为空时不使用缓存
+    uint64_t geometryCacheBudget = GeometryCache::kDefaultBudgetBytes;  // 几何缓存的大小上限（字节）
+    bool surfaceTransfer = true;     // 顶点数与底模不同的网格按最近点投影转移到底模拓扑，关闭时跳过这些网格
+    GeometryPrecision precision = GeometryPrecision::Double;  // Float 只对融合求差生效
+    bool lodPropagation = false;     // 底模中 lod0 网格的通道经重心转移映射传播到同一文件中的各 LOD 网格
+    string lodTransferDir;           // LOD 转移映射的持久缓存目录，为空时每次重新计算
+    vector<string> channelSuffixes = {"source_L", "source_M", "source_R"};
+};
+
+// 读取单个FBX文件的顶点；原生读取器不可用或失败时调用，可能在工作线程上并发执行
+using MeshLoader = function<bool(const string& fbxPath, MeshSet& meshData, string& error)>;
+
+// 配准、区域对齐与求差阶段对顶点坐标数组的稠密读写量（字节），稀疏的区域权重访问不计入
+struct PipelineTraffic {
+    uint64_t bytesRead = 0;
+    uint64_t bytesWritten = 0;
+    uint64_t transientBytes = 0;   // 为中间结果分配的坐标数组（对齐副本与差值）
+};
+
+// 流水线的中间结果
+struct PipelineResult {
+    RegionWeightMap weights;
+    MeshSet base;                  // 区域对齐后的底模顶点
+    GeometryPrecision precision = GeometryPrecision::Double;
+    vector<MeshSet> gaps;          // gaps[i] 为第 i+1 个输入模型相对底模的差值；融合模式下只含有权重的网格
+    vector<MeshSetF> floatGaps;    // precision 为 Float 时的差值，此时 gaps 为空
+    vector<SimilarityTransform> transforms;  // 各目标模型到底模的头部配准变换
+    shared_ptr<const LodTransferSet> lods;   // 开启 lodPropagation 时底模的 LOD 转移映射
+    PipelineTraffic traffic;
+};
+
+// head 的一个区域在底模上的顶点索引、权重与中心
+struct HeadRegion {
+    string name;
+    vector<uint32_t> indices;      // 升序，只含小于 HeadRegionCenters::vertexLimit 的顶点
+    vector<float> weights;
+    array<double, 3> baseCenter = {0.0, 0.0, 0.0};
+};
+
+// 底模一侧的 head 区域数据，对齐多个目标模型时只计算一次；
+// 只能用于 head 顶点数不小于 vertexLimit 的目标（顶点数更少的目标需要按其顶点数重新过滤）
+struct HeadRegionCenters {
+    size_t vertexLimit = 0;
+    vector<HeadRegion> regions;    // 与权重表中 head 区域的顺序一致，过滤后为空的区域不保留
+};
+
+// 多底模批处理中一个底模的结果
+struct BatchResult {
+    string baseFile;
+    bool prepared = false;         // 底模无法读取或没有可用的目标模型时为 false
+    PipelineResult result;
+};
+
+// 不依赖 Maya 与 FBX SDK 的 blendShape 生成流程：
+// 读取FBX -> 头部相似变换配准 -> 区域中心对齐 -> 计算差值 -> 通过 BlendShapeHost 输出通道。
+// 日志通过 Log.h 输出，且只在调用线程上输出
+class BlendShapePipeline {
+public:
+    explicit BlendShapePipeline(const PipelineOptions& options = PipelineOptions());
+
+    const PipelineOptions& options() const { return mOptions; }
+
+    // 设置原生读取器之外的读取方式（如 FBX SDK），未设置时只支持二进制FBX
+    void setFallbackLoader(MeshLoader loader) { mFallbackLoader = std::move(loader); }
+
+    // prepare 与 prepareBatch 向 progress 报告阶段与读取的文件数，并在阶段之间检查取消（取消时返回 false /
+    // 所有底模未准备）。报告的比例在 [0, kPrepareProgressEnd] 内，其余留给调用方的输出阶段；为空时不报告
+    void setProgress(JobProgress* progress) { mProgress = progress; }
+    static constexpr double kPrepareProgressEnd = 0.8;
+
+    // 进程内的已加载网格缓存（插件会话使用），命中且文件未变时不再读取文件也不查几何缓存；为空时不使用
+    void setSessionCache(SessionCache* cache) { mSessionCache = cache; }
+
+    // 计算权重与差值，fbxFiles[0] 为底模；输入少于两个可读模型时返回 false
+    bool prepare(const vector<string>& fbxFiles, const string& weightJsonPath, PipelineResult& result);
+
+    // 多个底模对同一套目标模型：所有文件合并去重后只读取一次，权重只加载一次，目标几何在各底模之间只读共享
+    // （只有需要拓扑转移的目标按底模复制）。各底模的配准与融合求差在 workerCount 个线程上并行，
+    // 日志在调用线程上按底模顺序输出。targetFiles 中与底模相同的文件在该底模的结果中跳过，
+    // 每个底模的结果与 prepare({底模, 其余目标...}) 的融合求差逐位一致
+    vector<BatchResult> prepareBatch(const vector<string>& baseFiles, const vector<string>& targetFiles, const string& weightJsonPath);
+
+    // 把 prepare 的结果作为 blendShape 通道交给宿主；结果带有 LOD 转移映射时通道同时传播到各 LOD 网格
+    BlendShapeBuildStats build(const PipelineResult& result, BlendShapeHost& host) const;
+
+    bool run(const vector<string>& fbxFiles, const string& weightJsonPath, BlendShapeHost& host, BlendShapeBuildStats* stats = nullptr);
+
+    // 按输入顺序读取所有FBX文件，失败或无网格的文件会被跳过；前 baseCount 个文件为底模，
+    // 与任一底模顶点数不同的网格额外读取三角形拓扑。loadedIndices 非空时输出每个结果对应的输入序号
+    vector<MeshSet> loadFbxFiles(const vector<string>& fbxFiles, size_t baseCount = 1, vector<size_t>* loadedIndices = nullptr);
+
+    // 把每个目标模型按 head_lod0_mesh 相似变换对齐到 meshes[0]，原地修改顶点
+    vector<SimilarityTransform> registerHeads(vector<MeshSet>& meshes) const;
+
+    // 把各目标模型中与底模同名但顶点数不同的网格重采样到底模拓扑：底模顶点投影到目标网格最近的表面点，
+    // 按重心坐标插值。需要目标网格的三角形拓扑（loadFbxFiles 在开启 surfaceTransfer 时读取）；
+    // head 顶点数不同时先做最近点迭代配准。映射按 (底模网格, 目标拓扑) 缓存在 SurfaceMappingCache::shared() 中。
+    // 返回重采样的网格个数
+    size_t transferMismatchedTopology(vector<MeshSet>& meshes) const;
+
+    // 只转移单个目标模型，model 为日志中的模型序号
+    size_t transferMismatchedTopology(const MeshSet& base, MeshSet& target, size_t model) const;
+
+    // target 中是否有与 base 同名但顶点数不同的网格
+    static bool hasMismatchedMeshes(const MeshSet& base, const MeshSet& target);
+
+    // 只求解 registerHeads 使用的变换，不修改顶点；无法配准的模型得到单位矩阵
+    vector<SimilarityTransform> solveHeadTransforms(const vector<MeshSet>& meshes) const;
+    vector<SimilarityTransform> solveHeadTransforms(const MeshSet& base, const vector<const MeshSet*>& targets) const;
+
+    // 融合求差：对每个目标模型逐网格一次遍历完成配准变换、区域对齐偏移与底模减法，
+    // 只写出差值，不修改 meshes 也不生成对齐副本。结果与
+    // registerHeads -> alignRegionsByCenter -> getMeshGap 逐位一致（权重非空时只计算有权重的网格）
+    vector<MeshSet> evaluateGaps(const vector<MeshSet>& meshes, const vector<SimilarityTransform>& transforms,
+                                 const RegionWeightMap& weights, PipelineTraffic* traffic = nullptr) const;
+
+    // 同上，目标模型以指针给出，可在多个底模之间共享而不复制
+    vector<MeshSet> evaluateGaps(const MeshSet& base, const vector<const MeshSet*>& targets, const vector<SimilarityTransform>& transforms,
+                                 const RegionWeightMap& weights, PipelineTraffic* traffic = nullptr) const;
+
+    // 单精度融合求差：变换矩阵与偏移舍入到 float 后在 float 坐标上计算，区域中心仍按 double 累加。
+    // 与双精度结果的差约为坐标量级乘以 float 的机器精度
+    vector<MeshSetF> evaluateGaps(const MeshSetF& base, const vector<const MeshSetF*>& targets, const vector<SimilarityTransform>& transforms,
+                                  const RegionWeightMap& weights, PipelineTraffic* traffic = nullptr) const;
+
+    // 读取权重（优先使用二进制缓存），路径为空或读取失败时返回空表
+    static RegionWeightMap loadRegionWeights(const string& weightJsonPath, const string& cachePath = string());
+
+    // 底模区域中心只计算一次；各目标的区域中心按 (目标, 区域)、偏移按 (目标, 顶点分块)、
+    // 跟随网格按 (目标, 网格) 在 workerCount 个线程上并行，结果与逐个调用 adjustVerticesByRegion 逐位一致
+    vector<MeshSet> alignRegionsByCenter(const vector<MeshSet>& fbxData, const RegionWeightMap& weights) const;
+    void adjustVerticesByRegion(const MeshSet& baseMesh, MeshSet& targetMesh, const RegionWeightMap& weights) const;
+
+    // 按 head 各区域中心差把 targetMesh 的 targetSlot 网格向底模对齐，返回各区域的偏移（Scalar 为 double 或 float）
+    template <typename Scalar>
+    static map<string, array<double, 3>> alignHeadRegions(const BasicMeshSet<Scalar>& baseMesh, BasicMeshSet<Scalar>& targetMesh, int targetSlot,
+                                                          const RegionWeightMap& weights);
+
+    // 同上，底模区域由 computeHeadRegionCenters 预先计算；targetSlot 网格的顶点数须不小于 base.vertexLimit
+    template <typename Scalar>
+    static map<string, array<double, 3>> alignHeadRegions(const HeadRegionCenters& base, BasicMeshSet<Scalar>& targetMesh, int targetSlot);
+
+    // 底模 head 各区域过滤后的索引与中心，只保留小于 vertexLimit 的顶点；底模或权重中没有 head 时为空
+    template <typename Scalar>
+    static HeadRegionCenters computeHeadRegionCenters(const BasicMeshSet<Scalar>& baseMesh, const RegionWeightMap& weights,
+                                                      size_t vertexLimit = SIZE_MAX);
+
+    // 区域中心，坐标精度为 float 时同样以 double 累加
+    template <typename Scalar>
+    static array<double, 3> calculateRegionCenter(const BasicMeshSet<Scalar>& meshes, size_t mesh, const vector<uint32_t>& indices);
+
+    // 各目标模型与底模同名、同顶点数网格的逐顶点差值（底模 - 目标），顶点数不同的网格记录警告后跳过
+    static vector<MeshSet> getMeshGap(const vector<MeshSet>& meshData);
+
+    // 通过 FbxBinaryReader 直接读取二进制FBX的顶点数组；topology 非空时同时读取多边形索引并输出各网格的拓扑指纹。
+    // 读取器的非致命警告（如跳过的重名网格）追加到 warnings，为空时丢弃；函数本身不输出日志
+    static bool readNativeMeshVertices(const string& fbxPath, unsigned workerCount, MeshSet& meshData, string& error,
+                                       vector<uint64_t>* topology = nullptr, vector<string>* warnings = nullptr);
+
+    // 单个顶点的参考实现；批量变换使用 MeshKernels.h 中的 transformPoints
+    static array<double, 3> applyTransformation(const array<double, 3>& point, const array<array<double, 4>, 4>& transform);
+
+private:
+    // 进入下一阶段；已取消时记录日志并返回 false
+    bool checkpoint(const char* stage, double start, double end, size_t steps = 0) const;
+
+    // 读取底模的 LOD 转移映射；底模不是二进制FBX或没有 LOD 网格时返回空
+    shared_ptr<const LodTransferSet> loadLodTransfers(const string& baseFile, unsigned workerCount) const;
+
+    PipelineOptions mOptions;
+    MeshLoader mFallbackLoader;
+    JobProgress* mProgress = nullptr;
+    SessionCache* mSessionCache = nullptr;
+};
+
+}
@@ -3,6 +3,7 @@
 #include <maya/MPxCommand.h>
 #include <maya/MString.h>
 #include <maya/MArgList.h>
+#include <maya/MSyntax.h>
 #include <string>
 #include <vector>
 
@@ -24,6 +25,7 @@ public:
     virtual ~characterfactoryfbxhandle();
 
     static void* creator();
+    static MSyntax newSyntax();
     MStatus doIt(const MArgList& args) override;
     virtual bool isUndoable() const override { return false; }
 
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+using namespace std;
+
+namespace cf {
+
+// 64位内容哈希（XXH64 算法，结果与 xxHash 参考实现一致），用于缓存失效判断
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 0);
+
+// 对整个文件内容求哈希，文件不存在或为空时返回 false
+bool hashFile(const string& path, uint64_t& hash);
+
+}
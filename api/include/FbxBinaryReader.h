@@ -0,0 +1,56 @@
+#pragma once
+
+#include "MappedFile.h"
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace cf {
+
+// 从二进制FBX中读取的单个网格几何数据
+struct FbxMeshArrays {
+    vector<double> vertices;            // 控制点坐标，按 x,y,z 交错存放
+    vector<int32_t> polygonVertexIndex; // 多边形顶点索引，每个多边形最后一个索引按位取反
+};
+
+// 轻量级二进制FBX 7.x读取器。
+// 通过内存映射遍历节点记录树，只解压被请求网格的 Vertices/PolygonVertexIndex 数组，
+// 不依赖FBX SDK，不创建FbxScene。
+class FbxBinaryReader {
+public:
+    FbxBinaryReader();
+    ~FbxBinaryReader();
+
+    bool open(const string& path);
+    void close();
+
+    uint32_t version() const { return mVersion; }
+    const string& lastError() const { return mError; }
+
+    // 上一次 readMeshes 跳过的重名网格等非致命问题
+    const vector<string>& warnings() const { return mWarnings; }
+
+    // meshNames 为空时读取所有网格，同名网格只读取第一个（其余记入 warnings）；workerCount 控制并行解压数组的线程数，0 表示自动
+    bool readMeshes(const vector<string>& meshNames, bool withPolygonIndices, map<string, FbxMeshArrays>& meshes, unsigned workerCount = 0);
+
+    // 检查文件头是否为二进制FBX
+    static bool isBinaryFbx(const string& path);
+
+private:
+    struct NodeRecord;
+    struct Property;
+
+    bool readNodeRecord(size_t offset, NodeRecord& record);
+    bool readProperty(size_t& offset, size_t end, Property& property);
+    bool decodeArray(const Property& property, char elementType, void* output, size_t elementCount, string& error) const;
+
+    MappedFile mFile;
+    uint32_t mVersion;
+    string mError;
+    vector<string> mWarnings;
+};
+
+}
@@ -4,9 +4,16 @@
 #include <vector>
 #include <map>
 #include <array>
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include <fbxsdk.h>
 #include <nlohmann/json.hpp>
+#include <maya/MStatus.h>
+#include <maya/MString.h>
+#include "BlendShapePipeline.h"
+#include "MeshSet.h"
+#include "PipelineJob.h"
 
 using namespace std;
 
@@ -15,43 +22,98 @@ namespace cf {
 class FbxModelHandle {
 public:
     FbxModelHandle();
-    ~FbxModelHandle();
     void processMultipleFbxFiles(const vector<string>& fbxFiles, const string& outputPath = "", const string& jsonPath = "");
+
+    // 多底模批处理：所有底模对同一套目标模型生成 blendShape，目标只读取一次；
+    // 各底模的输出（<底模>_blendshape.fbx）在工作线程上并行写出，之后依次导入当前场景
+    void processBatch(const vector<string>& baseFiles, const vector<string>& targetFiles, const string& jsonPath = "");
+
+    // 异步版本：在 PipelineJobEngine::shared() 上提交任务并立即返回任务编号。读取、求差以及（非直接模式下）
+    // 写入 blendShape 并导出在后台线程上进行，阶段之间检查取消；删除旧模型、导入输出或直接创建 blendShape
+    // 只在主线程的空闲任务中进行。onFinished 在收尾后于主线程调用
+    uint64_t submitMultipleFbxFiles(const vector<string>& fbxFiles, const string& jsonPath = "",
+                                    function<void(JobState)> onFinished = nullptr);
+    uint64_t submitBatch(const vector<string>& baseFiles, const vector<string>& targetFiles, const string& jsonPath = "",
+                         function<void(JobState)> onFinished = nullptr);
+
+    // 在主线程上收尾已结束后台阶段的异步任务，日志输出到脚本编辑器
+    static void finishPendingJobs();
     static MStatus deleteModelByName(const MString& modelName);
 
+    // 批量删除名称（忽略命名空间）在 modelNames 中的变换节点：一次场景遍历，一个 MDagModifier
+    static MStatus deleteModelsByName(const vector<string>& modelNames, unsigned* deletedCount = nullptr);
+
+    // 导入FBX时的工作线程数，0 表示使用硬件并发数，1 表示串行导入
+    void setWorkerCount(unsigned workerCount) { mOptions.workerCount = workerCount; }
+
+    // 是否优先使用原生二进制FBX读取器（不经过FBX SDK）提取顶点
+    void setUseNativeReader(bool useNativeReader) { mOptions.useNativeReader = useNativeReader; }
+
+    // 头部配准的鲁棒重加权迭代次数，0 表示只做一次最小二乘
+    void setRobustIterations(int iterations) { mOptions.similarity.robustIterations = iterations; }
+
+    // blendShape 目标中位移长度不超过该值的顶点不写入，所有顶点都不超过时跳过整个通道
+    void setDeltaEpsilon(double epsilon) { mOptions.deltaEpsilon = epsilon; }
+
+    // 配准、区域对齐与求差是否合并为一次遍历（默认开启），关闭时按阶段分别处理整套模型
+    void setFusedEvaluation(bool fused) { mOptions.fusedEvaluation = fused; }
+
+    // 顶点数与底模不同的网格是否按最近点投影转移到底模拓扑（默认开启），关闭时这些网格不生成通道
+    void setSurfaceTransfer(bool enabled) { mOptions.surfaceTransfer = enabled; }
+
+    // 是否把 lod0 网格的通道传播到底模中的各 LOD 网格（默认关闭），转移映射缓存在 directory 中
+    void setLodPropagation(bool enabled, const string& directory) {
+        mOptions.lodPropagation = enabled;
+        mOptions.lodTransferDir = directory;
+    }
+
+    // 融合求差使用的坐标精度，Float 时目标模型与差值以 float 保存
+    void setPrecision(GeometryPrecision precision) { mOptions.precision = precision; }
+
+    // 提取出的几何的缓存目录（为空时不缓存）与大小上限
+    void setGeometryCache(const string& directory, uint64_t budgetBytes) {
+        mOptions.geometryCacheDir = directory;
+        mOptions.geometryCacheBudget = budgetBytes;
+    }
+
+    // 直接在当前场景的底模网格上创建 blendShape，不再导出并重新导入 FBX 文件
+    void setDirectBlendShapes(bool direct) { mDirectBlendShapes = direct; }
+
 private:
-    bool createFbxScene(const char* fbxPath);
-    
-    map<string, vector<array<double, 3>>> getModelVertices();
+    // 一次命令的全部中间状态：后台阶段写入，主线程阶段读取
+    struct BlendShapeWork;
 
-    void processNode(FbxNode* node, map<string, vector<array<double, 3>>>& meshData);
-    
-    void saveJsonFile(const vector<map<string, vector<array<double, 3>>>>& data, const string& filePath);
-    
-    array<array<double,4>,4> calculateRigidTransformation(const vector<array<double,3>>& src_points, const vector<array<double,3>>& tgt_points);
-    
-    array<double,3> applyTransformation(const array<double,3>& point, const array<array<double,4>,4>& transform);
-    
-    vector<map<string, vector<array<double, 3>>>> getMeshGap(const vector<map<string, vector<array<double, 3>>>>& meshData);
-    
-    void createBlendShapes(const string& basefbx, const nlohmann::json& weightJson, const vector<map<string, vector<array<double,3>>>>& distance, map<string, vector<array<double,3>>>& vertexData);
-    
-    nlohmann::json readWeightJson(const string& weightJsonPath);
+    shared_ptr<BlendShapeWork> createWork(bool batch, const vector<string>& baseFiles, const vector<string>& fbxFiles, const string& jsonPath) const;
 
-    FbxNode* findNodeByName(FbxNode* rootNode, const string& nodeName);
-    
-    bool saveFbxFile(const string& outputPath);
-    
-    // Region-based alignment functions
-    vector<map<string, vector<array<double, 3>>>> alignRegionsByCenter(const vector<map<string, vector<array<double, 3>>>>& fbxData, const nlohmann::json& weightJson);
-    map<string, vector<array<double, 3>>> adjustVerticesByRegion(const map<string, vector<array<double, 3>>>& baseMesh, map<string, vector<array<double, 3>>>& targetMesh, const nlohmann::json& regionWeights);
-    array<double, 3> calculateRegionCenter(const vector<array<double, 3>>& vertices);
-    vector<array<double, 3>> adjustRegionVertices(const vector<array<double, 3>>& baseVertices, vector<array<double, 3>>& targetVertices, double weight);
+    // 读取、求差，非直接模式下还在各底模场景上写入 blendShape 并导出；不调用 Maya API，可在工作线程上执行。
+    // progress 非空时报告进度并在阶段之间检查取消
+    static bool computeBlendShapes(BlendShapeWork& work, JobProgress* progress);
+
+    // 删除同名旧模型并导入导出的文件，或直接在场景中创建 blendShape（只能在主线程调用）
+    static void applyBlendShapes(BlendShapeWork& work);
+
+    static uint64_t submitWork(shared_ptr<BlendShapeWork> work, function<void(JobState)> onFinished);
+
+    static void processNode(FbxNode* node, MeshSet& meshData);
+
+    // 使用调用方提供的FbxManager导入单个文件，作为原生读取器之外的回退，可在工作线程上调用；
+    // keptScene 非空时不销毁解析出的场景，交给调用方
+    static bool importMeshVertices(FbxManager* manager, const string& fbxPath, MeshSet& meshData, string& error, FbxScene** keptScene);
+
+    static void logBuildStats(const BlendShapeBuildStats& stats, double deltaEpsilon, double elapsedMs);
+
+    static FbxNode* findNodeByName(FbxNode* rootNode, const string& nodeName);
+
+    // 以 ASCII FBX 导出场景，不调用 Maya API，可在工作线程上调用
+    static bool exportScene(FbxManager* manager, FbxScene* scene, const string& outputPath, string& error);
+
+    // 把导出的文件导入当前 Maya 场景（只能在主线程调用）
+    static void reimportFbx(const string& outputPath);
     
 private:
     
-    FbxManager* mFbxManager;
-    FbxScene* mFbxScene;
+    PipelineOptions mOptions;
+    bool mDirectBlendShapes;
 };
 
 }
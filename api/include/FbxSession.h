@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <fbxsdk.h>
+#include "SessionCache.h"
+
+using namespace std;
+
+namespace cf {
+
+// FBX SDK 对象不能跨线程共享，并发调用各自借用一个独立的 FbxManager；归还的管理器留给之后的调用复用
+class FbxManagerPool {
+public:
+    FbxManagerPool() = default;
+    ~FbxManagerPool();
+
+    FbxManagerPool(const FbxManagerPool&) = delete;
+    FbxManagerPool& operator=(const FbxManagerPool&) = delete;
+
+    // 没有空闲的管理器时新建一个，失败时返回 nullptr
+    FbxManager* acquire();
+    void release(FbxManager* manager);
+
+    size_t idleCount() const;
+
+private:
+    mutable mutex mLock;
+    vector<FbxManager*> mIdle;
+};
+
+// 与借出的 FbxManager 一起持有的场景，析构时销毁场景并把管理器归还给 pool。
+// stamp 为导入前源文件的状态，场景放入会话缓存时使用
+class PooledFbxScene {
+public:
+    PooledFbxScene(shared_ptr<FbxManagerPool> pool, FbxManager* manager, FbxScene* scene, const FileStamp& stamp = FileStamp())
+        : mPool(std::move(pool)), mManager(manager), mScene(scene), mStamp(stamp) {}
+    ~PooledFbxScene();
+
+    PooledFbxScene(const PooledFbxScene&) = delete;
+    PooledFbxScene& operator=(const PooledFbxScene&) = delete;
+
+    FbxManager* manager() const { return mManager; }
+    FbxScene* scene() const { return mScene; }
+    const FileStamp& stamp() const { return mStamp; }
+
+private:
+    shared_ptr<FbxManagerPool> mPool;
+    FbxManager* mManager;
+    FbxScene* mScene;
+    FileStamp mStamp;
+};
+
+// 估计场景占用的内存（控制点、多边形顶点及其法线与UV、节点），作为会话缓存的预算计量
+uint64_t estimateSceneBytes(FbxScene* scene);
+
+struct FbxSessionStats {
+    bool open = false;
+    SessionCacheStats cache;
+    size_t idleManagers = 0;
+};
+
+// 插件范围的会话。打开后各命令（包括后台任务）共享同一个 FbxManager 池，并在 SessionCache 中
+// 按 (路径, 大小, 修改时间) 缓存提取出的网格与未修改的底模场景，总量受预算限制；关闭时全部释放。
+// 未打开时每个命令使用各自的管理器池，不缓存。characterfactoryautorigcreate 的场景始终由会话持有，
+// 关闭会话或卸载插件时释放。除 autoRig 场景外的接口可在任意线程调用
+class FbxSession {
+public:
+    static FbxSession& shared();
+
+    FbxSession() = default;
+    ~FbxSession();
+
+    FbxSession(const FbxSession&) = delete;
+    FbxSession& operator=(const FbxSession&) = delete;
+
+    // 已打开时只修改预算
+    void open(uint64_t budgetBytes);
+    void close();
+    bool isOpen() const;
+
+    // 打开时返回会话的管理器池，否则返回新建的临时池
+    shared_ptr<FbxManagerPool> managers();
+
+    // 打开时返回会话缓存，否则返回空指针
+    shared_ptr<SessionCache> cache();
+
+    FbxSessionStats stats() const;
+
+    // 导入 fbxPath 替换 characterfactoryautorigcreate 之前的场景，路径为空时创建空场景
+    bool loadAutoRigScene(const string& fbxPath, string& error);
+
+    // 用 create 在借出的管理器上创建的场景替换之前的场景；create 失败时返回 nullptr 并给出 error
+    bool replaceAutoRigScene(const function<FbxScene*(FbxManager*, string&)>& create, string& error);
+    FbxScene* autoRigScene() const;
+
+    // 在给定的 FbxManager 上导入整个场景，失败时返回 nullptr；可在工作线程上调用
+    static FbxScene* importScene(FbxManager* manager, const string& fbxPath, string& error);
+
+private:
+    mutable mutex mLock;
+    shared_ptr<FbxManagerPool> mManagers;
+    shared_ptr<SessionCache> mCache;
+    unique_ptr<PooledFbxScene> mAutoRigScene;
+};
+
+}
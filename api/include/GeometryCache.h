@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "MeshSet.h"
+
+using namespace std;
+
+namespace cf {
+
+// 源文件的缓存键：内容哈希以及用于快速预检的大小与修改时间
+struct GeometryCacheKey {
+    string path;
+    uint64_t contentHash = 0;
+    uint64_t size = 0;
+    int64_t modifiedTime = 0;
+    bool valid = false;
+};
+
+struct GeometryCacheStats {
+    uint64_t hits = 0;
+    uint64_t precheckHits = 0;    // 大小与修改时间未变，未重新计算内容哈希
+    uint64_t misses = 0;
+    uint64_t stores = 0;
+    uint64_t evictions = 0;
+    uint64_t entryCount = 0;
+    uint64_t totalBytes = 0;      // 缓存目录中几何文件的总大小
+    uint64_t budgetBytes = 0;
+};
+
+// 按FBX文件内容哈希寻址的几何缓存，跨命令运行持久保存在 directory 中：
+//   <内容哈希>.cfg  每个源文件提取出的网格顶点（SoA，与 MeshSet 布局一致）及拓扑指纹，可直接内存映射
+//   index.json      路径 -> (大小, 修改时间, 内容哈希) 的预检表以及各条目的最近使用时间
+// 大小与修改时间都未变化时直接使用记录的哈希，否则重新计算内容哈希；内容相同的文件共享同一条目。
+// 总大小超过预算时按最近使用时间淘汰。lookup/store 可在多个线程上并发调用
+class GeometryCache {
+public:
+    static const uint64_t kDefaultBudgetBytes = 1024ull * 1024 * 1024;
+
+    // directory 不存在时在首次写入时创建
+    explicit GeometryCache(const string& directory, uint64_t budgetBytes = kDefaultBudgetBytes);
+
+    const string& directory() const { return mDirectory; }
+
+    // 查找 path 的几何；key 总是被填充（源文件不可读时 key.valid 为 false），未命中时交给 store 使用。
+    // topology 非空时输出每个网格的拓扑指纹（0 表示未知）
+    bool lookup(const string& path, GeometryCacheKey& key, MeshSet& meshes, vector<uint64_t>* topology = nullptr);
+
+    // 写入新提取的几何，topology 为空或与网格数一致
+    bool store(const GeometryCacheKey& key, const MeshSet& meshes, const vector<uint64_t>& topology, string& error);
+
+    // 淘汰最久未使用的条目直到总大小不超过预算，并写出索引
+    bool flush(string& error);
+
+    GeometryCacheStats stats() const;
+
+    // 插件默认使用的缓存目录：系统临时目录下的 CharacterFactory/geometry
+    static string defaultDirectory();
+
+    // 计算单个网格多边形顶点索引的拓扑指纹
+    static uint64_t topologyFingerprint(const int32_t* polygonVertexIndex, size_t count);
+
+private:
+    struct FileRecord {
+        uint64_t size;
+        int64_t modifiedTime;
+        uint64_t contentHash;
+    };
+    struct Entry {
+        uint64_t bytes;
+        int64_t lastUsed;
+    };
+
+    string entryPath(uint64_t contentHash) const;
+    bool readEntry(const string& entryFile, const GeometryCacheKey& key, MeshSet& meshes, vector<uint64_t>* topology) const;
+    void loadIndex();
+    int64_t nextUseStamp();
+
+    string mDirectory;
+    uint64_t mBudgetBytes;
+    mutable mutex mLock;
+    map<string, FileRecord> mFiles;
+    map<uint64_t, Entry> mEntries;
+    GeometryCacheStats mStats;
+    int64_t mUseStamp = 0;
+    bool mDirty = false;
+};
+
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "BlendShapeBuilder.h"
+#include "MeshSet.h"
+#include "RegionWeights.h"
+
+using namespace std;
+
+namespace cf {
+
+class MappedFile;
+
+// 交换文件（.cfx）：流程结果的带版本二进制容器，包含若干组网格顶点（附拓扑指纹）、
+// 稀疏 blendShape 通道与区域权重。各数组段按 64 字节对齐，读取方内存映射后直接使用，
+// 不再解析 FBX 或 JSON。格式见 InterchangeFile.cpp
+
+// 文件中的一个网格，坐标指向映射的文件
+struct InterchangeMesh {
+    string name;
+    size_t meshSet = 0;           // 所属网格组
+    size_t vertexCount = 0;
+    uint64_t topology = 0;        // 拓扑指纹，0 表示未知
+    const double* x = nullptr;
+    const double* y = nullptr;
+    const double* z = nullptr;
+};
+
+// 一组网格（例如对齐后的底模），网格在 mesh() 中连续存放
+struct InterchangeMeshSet {
+    string name;
+    size_t firstMesh = 0;
+    size_t meshCount = 0;
+};
+
+// 一个稀疏通道，位移相对于第一组网格中同名网格的顶点
+struct InterchangeChannel {
+    string mesh;
+    string name;
+    size_t pointCount = 0;
+    const uint32_t* indices = nullptr;  // 升序
+    const double* dx = nullptr;
+    const double* dy = nullptr;
+    const double* dz = nullptr;
+};
+
+// 一个 (网格, 区域) 的稀疏权重
+struct InterchangeWeightRegion {
+    string mesh;
+    string region;
+    size_t count = 0;
+    const uint32_t* indices = nullptr;  // 升序
+    const float* weights = nullptr;
+};
+
+// 收集网格、权重与通道并写出交换文件。作为 BlendShapeHost 时通道的底模网格取自第一组网格，
+// 其中不存在的网格被跳过
+class InterchangeWriter : public BlendShapeHost {
+public:
+    InterchangeWriter() = default;
+
+    // 复制 meshes 作为一组网格，返回组序号；topology 为空时取各网格已读取的拓扑指纹
+    size_t addMeshSet(const string& name, const MeshSet& meshes, const vector<uint64_t>& topology = {});
+
+    void setWeights(const RegionWeightMap& weights) { mWeights = weights; }
+
+    bool beginMesh(const string& meshName, size_t& vertexCount) override;
+    bool addTarget(const string& channelName, const SparseShapeDelta& delta) override;
+    void endMesh(size_t targetCount) override;
+
+    size_t channelCount() const { return mChannels.size(); }
+
+    // 先写临时文件再替换 path
+    bool save(const string& path, string& error) const;
+
+private:
+    struct MeshSetRecord {
+        string name;
+        MeshSet meshes;
+        vector<uint64_t> topology;
+    };
+
+    struct ChannelRecord {
+        string mesh;
+        string name;
+        uint64_t pointOffset;
+        uint64_t pointCount;
+    };
+
+    vector<MeshSetRecord> mMeshSets;
+    RegionWeightMap mWeights;
+    vector<ChannelRecord> mChannels;
+    vector<uint32_t> mPointIndices;
+    vector<double> mDx;
+    vector<double> mDy;
+    vector<double> mDz;
+    string mMeshName;
+};
+
+// 只读打开交换文件：网格、通道与权重的数组直接指向映射的文件，名称等小表在打开时复制。
+// 对象持有映射，移动后原对象为空
+class InterchangeFile {
+public:
+    static const uint32_t kVersion = 1;
+    static const char* defaultExtension() { return ".cfx"; }
+
+    InterchangeFile();
+    ~InterchangeFile();
+
+    InterchangeFile(InterchangeFile&&) noexcept;
+    InterchangeFile& operator=(InterchangeFile&&) noexcept;
+    InterchangeFile(const InterchangeFile&) = delete;
+    InterchangeFile& operator=(const InterchangeFile&) = delete;
+
+    // 格式、版本不符或任一段越界时返回 false
+    bool open(const string& path, string& error);
+    void close();
+    bool isOpen() const;
+
+    size_t meshSetCount() const { return mMeshSets.size(); }
+    const InterchangeMeshSet& meshSet(size_t s) const { return mMeshSets[s]; }
+    int findMeshSet(const string& name) const;
+
+    size_t meshCount() const { return mMeshes.size(); }
+    const InterchangeMesh& mesh(size_t m) const { return mMeshes[m]; }
+    int findMesh(size_t meshSet, const string& name) const;
+
+    // 把一组网格复制为 MeshSet（例如作为后续计算的输入）
+    bool readMeshSet(size_t meshSet, MeshSet& meshes) const;
+
+    size_t channelCount() const { return mChannels.size(); }
+    const InterchangeChannel& channel(size_t c) const { return mChannels[c]; }
+
+    size_t weightRegionCount() const { return mWeightRegions.size(); }
+    const InterchangeWeightRegion& weightRegion(size_t r) const { return mWeightRegions[r]; }
+
+    // 映射的文件字节数
+    size_t fileSize() const;
+
+private:
+    unique_ptr<MappedFile> mFile;
+    vector<InterchangeMeshSet> mMeshSets;
+    vector<InterchangeMesh> mMeshes;
+    vector<InterchangeChannel> mChannels;
+    vector<InterchangeWeightRegion> mWeightRegions;
+};
+
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "BlendShapeBuilder.h"
+#include "MeshSet.h"
+#include "Registration.h"
+#include "ShapeDelta.h"
+
+using namespace std;
+
+namespace cf {
+
+// "head_lod3_mesh" -> ("head", 3)；不符合 <prefix>_lod<N>_mesh 形式时返回 false
+bool parseLodMeshName(const string& name, string& prefix, int& lod);
+string lodMeshName(const string& prefix, int lod);
+
+// 从 LOD 网格到同名 lod0 网格的重心转移映射：LOD 的每个顶点投影到 lod0 表面最近的三角形，
+// 位移按三个角点的重心坐标插值。映射只取决于两者的拓扑，按拓扑指纹缓存在磁盘上，
+// 同一套模板的所有角色共用
+class LodTransferMap {
+public:
+    LodTransferMap() = default;
+
+    // lod0Triangles 为 lod0 网格的三角形顶点索引（见 triangulatePolygons）
+    static LodTransferMap build(const PointSpan& lod0, const vector<uint32_t>& lod0Triangles, const PointSpan& lod, unsigned workerCount);
+
+    // 写出缓存文件（先写临时文件再替换），记录两个网格的拓扑指纹
+    bool write(const string& path, uint64_t lod0Topology, uint64_t lodTopology, string& error) const;
+
+    // 读取缓存文件；格式不合法或拓扑指纹不一致时返回 false
+    static bool read(const string& path, uint64_t lod0Topology, uint64_t lodTopology, LodTransferMap& map, string& error);
+
+    bool empty() const { return mVertices.empty(); }
+    size_t lod0VertexCount() const { return mLod0VertexCount; }
+    size_t lodVertexCount() const { return mVertices.size() / 3; }
+    double rmsDistance() const { return mRmsDistance; }
+    double maxDistance() const { return mMaxDistance; }
+
+    // 稀疏收集：只访问引用了 lod0Delta 中顶点的 LOD 顶点，位移长度不超过 epsilon 的顶点被剔除。
+    // 可在多个线程上并发调用
+    void propagate(const SparseShapeDelta& lod0Delta, double epsilon, SparseShapeDelta& lodDelta) const;
+
+private:
+    // 由映射生成 lod0 顶点 -> 引用它的 LOD 顶点的 CSR 反向索引
+    void buildReferences();
+
+    size_t mLod0VertexCount = 0;
+    vector<uint32_t> mVertices;          // 每个 LOD 顶点三个 lod0 顶点
+    vector<double> mWeights;             // 对应的重心坐标
+    vector<uint32_t> mReferenceOffsets;  // lod0VertexCount + 1 个
+    vector<uint32_t> mReferences;        // 升序的 LOD 顶点
+    double mRmsDistance = 0.0;
+    double mMaxDistance = 0.0;
+};
+
+// 一个 LOD 网格的转移映射
+struct LodTransfer {
+    string lod0Mesh;
+    string lodMesh;
+    int lod = 0;
+    shared_ptr<const LodTransferMap> map;
+};
+
+// 底模文件中全部 LOD 网格的转移映射
+struct LodTransferSet {
+    vector<LodTransfer> transfers;  // 按 lod0 网格、LOD 序号排列
+    size_t built = 0;               // 本次新计算的映射数
+    size_t cached = 0;              // 从磁盘缓存读取的映射数
+
+    bool empty() const { return transfers.empty(); }
+};
+
+// 转移映射的磁盘缓存目录，文件名为两个拓扑指纹
+class LodTransferCache {
+public:
+    explicit LodTransferCache(const string& directory) : mDirectory(directory) {}
+
+    // 系统临时目录下的 CharacterFactory/lod；无法取得临时目录时返回空字符串
+    static string defaultDirectory();
+
+    const string& directory() const { return mDirectory; }
+    string entryPath(uint64_t lod0Topology, uint64_t lodTopology) const;
+
+    // 读取二进制FBX中所有 <prefix>_lod<N>_mesh（N ≥ 1）与同一文件中的 <prefix>_lod0_mesh，
+    // 命中缓存时直接读取映射，否则计算并写入缓存（写入失败只记录警告）。目录为空时不使用缓存
+    bool load(const string& fbxPath, unsigned workerCount, LodTransferSet& set, string& error) const;
+
+private:
+    string mDirectory;
+};
+
+struct LodPropagationStats {
+    size_t meshes = 0;          // 生成了通道的 LOD 网格数
+    size_t skippedMeshes = 0;   // 宿主中不存在或顶点数与映射不符的 LOD 网格数
+    size_t channels = 0;
+    size_t prunedChannels = 0;  // 转移后位移全部低于阈值的通道数
+    size_t points = 0;
+};
+
+// 包装另一个宿主：lod0 网格的通道原样转交，当前网格结束时把它的全部通道经转移映射
+// 在 workerCount 个线程上并行传播到各 LOD 网格，再按 LOD 顺序交给被包装的宿主。
+// LOD 通道名为把通道名开头的 lod0 网格名替换为 LOD 网格名
+class LodPropagationHost : public BlendShapeHost {
+public:
+    LodPropagationHost(BlendShapeHost& host, const LodTransferSet& lods, double epsilon, unsigned workerCount);
+
+    bool beginMesh(const string& meshName, size_t& vertexCount) override;
+    bool addTarget(const string& channelName, const SparseShapeDelta& delta) override;
+    void endMesh(size_t targetCount) override;
+
+    const LodPropagationStats& stats() const { return mStats; }
+
+private:
+    BlendShapeHost& mHost;
+    const LodTransferSet& mLods;
+    double mEpsilon;
+    unsigned mWorkerCount;
+    string mMeshName;
+    vector<const LodTransfer*> mActive;   // 当前网格的 LOD
+    vector<pair<string, SparseShapeDelta>> mChannels;
+    LodPropagationStats mStats;
+};
+
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace cf {
+
+enum class LogLevel {
+    Info,
+    Warning,
+    Error
+};
+
+// 日志输出目标：Maya 插件接到 MGlobal，命令行工具使用默认的 stderr 输出
+using LogSink = function<void(LogLevel level, const string& message)>;
+
+// 替换全局日志输出目标并返回原来的目标，传入空函数恢复默认输出
+LogSink setLogSink(LogSink sink);
+
+void logMessage(LogLevel level, const string& message);
+
+inline void logInfo(const string& message) { logMessage(LogLevel::Info, message); }
+inline void logWarning(const string& message) { logMessage(LogLevel::Warning, message); }
+inline void logError(const string& message) { logMessage(LogLevel::Error, message); }
+
+// 在作用域内临时替换日志输出目标
+class ScopedLogSink {
+public:
+    explicit ScopedLogSink(LogSink sink) : mPrevious(setLogSink(std::move(sink))) {}
+    ~ScopedLogSink() { setLogSink(std::move(mPrevious)); }
+
+    ScopedLogSink(const ScopedLogSink&) = delete;
+    ScopedLogSink& operator=(const ScopedLogSink&) = delete;
+
+private:
+    LogSink mPrevious;
+};
+
+// 在作用域内把当前线程的日志暂存起来，不经过日志输出目标；
+// 工作线程上用它收集日志，之后由调用线程按顺序 replay（MGlobal 只能在主线程使用）
+class ThreadLogBuffer {
+public:
+    ThreadLogBuffer();
+    ~ThreadLogBuffer();
+
+    ThreadLogBuffer(const ThreadLogBuffer&) = delete;
+    ThreadLogBuffer& operator=(const ThreadLogBuffer&) = delete;
+
+    const vector<pair<LogLevel, string>>& messages() const { return mMessages; }
+
+    // 把 messages 按顺序交给 logMessage，在调用线程上输出
+    static void replay(const vector<pair<LogLevel, string>>& messages);
+
+private:
+    friend void logMessage(LogLevel level, const string& message);
+
+    vector<pair<LogLevel, string>> mMessages;
+    ThreadLogBuffer* mPrevious;
+};
+
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace cf {
+
+// 只读内存映射文件，析构时自动解除映射
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    bool isOpen() const { return mData != nullptr; }
+    const uint8_t* data() const { return mData; }
+    size_t size() const { return mSize; }
+
+private:
+    const uint8_t* mData;
+    size_t mSize;
+#ifdef _WIN32
+    void* mFileHandle;
+    void* mMappingHandle;
+#endif
+};
+
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include <maya/MDagPath.h>
+#include <maya/MObject.h>
+#include "BlendShapeBuilder.h"
+#include "Log.h"
+
+using namespace std;
+
+namespace cf {
+
+// 核心库日志转发到 Maya 脚本编辑器（核心库只在调用线程上输出日志），只能在主线程上使用
+void mayaLogSink(LogLevel level, const string& message);
+
+// 直接在当前 Maya 场景中创建 blendShape 节点：
+// 位移写入 inputTarget[0].inputTargetGroup[i].inputTargetItem[6000] 的稀疏点/组件数据，
+// 不生成目标网格，也不经过 FBX 文件导出与导入。底模网格需已存在于场景中（按节点名查找）
+class MayaBlendShapeHost : public BlendShapeHost {
+public:
+    MayaBlendShapeHost();
+
+    bool beginMesh(const string& meshName, size_t& vertexCount) override;
+    bool addTarget(const string& channelName, const SparseShapeDelta& delta) override;
+    void endMesh(size_t targetCount) override;
+
+private:
+    bool createDeformer();
+
+    string mMeshName;
+    MDagPath mMeshPath;
+    MObject mBlendShape;
+    unsigned mTargetIndex;
+};
+
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace cf {
+
+// 欧拉角旋转顺序，取值与 FBX 的 EFbxRotationOrder 一致
+enum class RotationOrder {
+    XYZ,
+    XZY,
+    YZX,
+    YXZ,
+    ZXY,
+    ZYX
+};
+
+// 节点的局部变换，旋转单位为度
+struct MeshTransform {
+    array<double, 3> translation = {0.0, 0.0, 0.0};
+    array<double, 3> rotation = {0.0, 0.0, 0.0};
+    array<double, 3> scale = {1.0, 1.0, 1.0};
+    RotationOrder rotationOrder = RotationOrder::XYZ;
+};
+
+// 网格源一次读出的原始数组（如 MFnMesh::getRawPoints），指针只在下一次 readMesh 之前有效
+struct RawMesh {
+    const float* points = nullptr;            // 局部空间 xyz 交错
+    size_t vertexCount = 0;
+    const int32_t* polygonCounts = nullptr;   // 每个多边形的顶点数
+    size_t polygonCount = 0;
+    const int32_t* polygonVertices = nullptr; // 按多边形依次排列的顶点索引
+    size_t polygonVertexCount = 0;
+    MeshTransform transform;
+};
+
+// 按名称提供场景中的网格。插件中由 Maya 场景实现，测试中可用内存中的网格代替
+class MeshCaptureSource {
+public:
+    virtual ~MeshCaptureSource() = default;
+
+    // 网格不存在时返回 false 且 error 为空；存在但无法读取时返回 false 并给出原因
+    virtual bool readMesh(const string& name, RawMesh& mesh, string& error) = 0;
+};
+
+// 转换后的网格，控制点与多边形可直接写入 FbxMesh
+struct CapturedMesh {
+    string name;
+    MeshTransform transform;
+    vector<double> points;                // xyz 交错
+    vector<int32_t> polygonCounts;
+    vector<int32_t> polygonVertices;
+
+    size_t vertexCount() const { return points.size() / 3; }
+    size_t polygonCount() const { return polygonCounts.size(); }
+};
+
+struct MeshCaptureStats {
+    size_t meshes = 0;           // 成功转换的网格数
+    size_t missingMeshes = 0;    // 源中不存在的网格数
+    size_t invalidMeshes = 0;    // 无法读取或数据不合法的网格数
+    size_t vertices = 0;
+    size_t polygons = 0;
+};
+
+// 检查并复制一个原始网格：多边形顶点数不少于 3，顶点数之和与索引个数一致，索引不越界
+bool convertRawMesh(const string& name, const RawMesh& raw, CapturedMesh& mesh, string& error);
+
+// 按 names 的顺序从 source 读取网格并转换，不存在或不合法的网格跳过并记录警告
+MeshCaptureStats captureMeshes(MeshCaptureSource& source, const vector<string>& names, vector<CapturedMesh>& meshes);
+
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+using namespace std;
+
+namespace cf {
+
+// 顶点批量运算的指令集实现，运行时按 CPU 支持情况选择
+enum class KernelIsa {
+    Scalar,
+    Sse2,
+    Avx2
+};
+
+// 当前使用的实现；首次调用时检测 CPU
+KernelIsa activeKernelIsa();
+
+// 强制使用指定实现（测试与基准用），超出 CPU 支持范围时降到可用的最高级别，返回实际生效的实现
+KernelIsa setKernelIsa(KernelIsa isa);
+
+// CPU 支持的最高级别
+KernelIsa detectKernelIsa();
+
+const char* kernelIsaName(KernelIsa isa);
+
+// 对 SoA 顶点数组原地应用 4x4 仿射矩阵（只使用前三行）。
+// 各实现都不使用 FMA，累加顺序与 BlendShapePipeline::applyTransformation 相同，结果逐位一致
+void transformPoints(const array<array<double, 4>, 4>& transform, double* x, double* y, double* z, size_t count);
+
+// 非原地版本：out = T * p
+void transformPoints(const array<array<double, 4>, 4>& transform, const double* x, const double* y, const double* z,
+                     double* outX, double* outY, double* outZ, size_t count);
+
+// 配准、整体偏移与求差合并为一次遍历：out = base - ((T * p) - offset)。
+// 与先 transformPoints、再减去 offset、最后 subtractPoints 的结果逐位一致
+void transformedGap(const array<array<double, 4>, 4>& transform, const array<double, 3>& offset,
+                    const double* bx, const double* by, const double* bz,
+                    const double* x, const double* y, const double* z,
+                    double* outX, double* outY, double* outZ, size_t count);
+
+// out = a - b，逐分量计算；out 可以与 a 或 b 指向同一数组
+void subtractPoints(const double* ax, const double* ay, const double* az,
+                    const double* bx, const double* by, const double* bz,
+                    double* outX, double* outY, double* outZ, size_t count);
+
+// 单精度版本：矩阵与偏移先舍入到 float，之后全部以 float 计算，每条指令处理的顶点数是双精度的两倍。
+// 累加顺序与双精度版本相同，各实现之间同样逐位一致
+void transformPoints(const array<array<double, 4>, 4>& transform, float* x, float* y, float* z, size_t count);
+
+void transformPoints(const array<array<double, 4>, 4>& transform, const float* x, const float* y, const float* z,
+                     float* outX, float* outY, float* outZ, size_t count);
+
+void transformedGap(const array<array<double, 4>, 4>& transform, const array<double, 3>& offset,
+                    const float* bx, const float* by, const float* bz,
+                    const float* x, const float* y, const float* z,
+                    float* outX, float* outY, float* outZ, size_t count);
+
+void subtractPoints(const float* ax, const float* ay, const float* az,
+                    const float* bx, const float* by, const float* bz,
+                    float* outX, float* outY, float* outZ, size_t count);
+
+}
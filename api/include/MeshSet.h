@@ -0,0 +1,134 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace cf {
+
+// 网格名称驻留后的编号，同名网格在所有角色之间共享同一个编号
+using MeshNameId = uint32_t;
+
+const MeshNameId kInvalidMeshName = 0xFFFFFFFFu;
+
+// 驻留网格名称（线程安全），返回稳定的编号
+MeshNameId internMeshName(const string& name);
+
+// 查找已驻留的名称，未驻留时返回 kInvalidMeshName
+MeshNameId findMeshName(const string& name);
+
+const string& meshNameOf(MeshNameId id);
+
+// 单个网格在 MeshSet 坐标缓冲中的区间
+struct MeshRange {
+    MeshNameId name;
+    size_t offset;
+    size_t count;
+};
+
+// 网格的三角形拓扑（多边形按扇形三角化），只在需要做最近点转移时读取
+struct MeshTopology {
+    vector<uint32_t> triangles;   // 每三个顶点索引一个三角形
+    uint64_t fingerprint = 0;     // 原始多边形索引的内容哈希，同一拓扑的模型相同
+};
+
+// 一个角色的全部网格，按结构体数组（SoA）存放在同一块连续缓冲中：
+// [x0..xN) [y0..yN) [z0..zN)，每个网格占用其中一段 [offset, offset + count)。
+// 坐标类型 Scalar 为 double（MeshSet）或 float（MeshSetF）；读取与逐顶点接口始终使用 double
+template <typename Scalar>
+class BasicMeshSet {
+public:
+    using ScalarType = Scalar;
+
+    BasicMeshSet();
+
+    // 转换坐标精度，网格顺序与拓扑保持不变
+    template <typename Other>
+    explicit BasicMeshSet(const BasicMeshSet<Other>& other);
+
+    size_t meshCount() const { return mMeshes.size(); }
+    bool empty() const { return mMeshes.empty(); }
+
+    // 所有网格的顶点总数
+    size_t vertexCount() const { return mUsed; }
+
+    // 追加一个网格并返回其序号，坐标初始化为 0；同名网格已存在时替换之
+    size_t addMesh(MeshNameId name, size_t count);
+    size_t addMesh(const string& name, size_t count) { return addMesh(internMeshName(name), count); }
+
+    // 按名称查找网格序号，不存在时返回 -1
+    int find(MeshNameId name) const;
+    int find(const string& name) const { return find(findMeshName(name)); }
+
+    const MeshRange& range(size_t mesh) const { return mMeshes[mesh]; }
+    MeshNameId nameId(size_t mesh) const { return mMeshes[mesh].name; }
+    const string& name(size_t mesh) const { return meshNameOf(mMeshes[mesh].name); }
+    size_t vertexCount(size_t mesh) const { return mMeshes[mesh].count; }
+
+    Scalar* x(size_t mesh) { return xData() + mMeshes[mesh].offset; }
+    Scalar* y(size_t mesh) { return yData() + mMeshes[mesh].offset; }
+    Scalar* z(size_t mesh) { return zData() + mMeshes[mesh].offset; }
+    const Scalar* x(size_t mesh) const { return xData() + mMeshes[mesh].offset; }
+    const Scalar* y(size_t mesh) const { return yData() + mMeshes[mesh].offset; }
+    const Scalar* z(size_t mesh) const { return zData() + mMeshes[mesh].offset; }
+
+    // 整个角色的坐标分量，长度为 vertexCount()
+    Scalar* xData() { return mCoords.data(); }
+    Scalar* yData() { return mCoords.data() + mCapacity; }
+    Scalar* zData() { return mCoords.data() + 2 * mCapacity; }
+    const Scalar* xData() const { return mCoords.data(); }
+    const Scalar* yData() const { return mCoords.data() + mCapacity; }
+    const Scalar* zData() const { return mCoords.data() + 2 * mCapacity; }
+
+    array<double, 3> vertex(size_t mesh, size_t i) const {
+        size_t k = mMeshes[mesh].offset + i;
+        return {static_cast<double>(xData()[k]), static_cast<double>(yData()[k]), static_cast<double>(zData()[k])};
+    }
+
+    void setVertex(size_t mesh, size_t i, const array<double, 3>& v) {
+        size_t k = mMeshes[mesh].offset + i;
+        xData()[k] = static_cast<Scalar>(v[0]);
+        yData()[k] = static_cast<Scalar>(v[1]);
+        zData()[k] = static_cast<Scalar>(v[2]);
+    }
+
+    // 与交错格式 (x,y,z,x,y,z...) 之间的转换
+    void setInterleaved(size_t mesh, const double* xyz);
+    vector<array<double, 3>> vertices(size_t mesh) const;
+
+    // 可选的三角形拓扑，拷贝时共享；网格被替换时清除，未设置时返回 nullptr
+    const MeshTopology* topology(size_t mesh) const { return mTopology[mesh].get(); }
+    void setTopology(size_t mesh, shared_ptr<const MeshTopology> topology) { mTopology[mesh] = std::move(topology); }
+
+    // 坐标缓冲占用的字节数（按已使用的顶点计）
+    size_t coordinateBytes() const { return 3 * mUsed * sizeof(Scalar); }
+
+    void reserve(size_t meshCount, size_t vertexCount);
+    void clear();
+
+private:
+    template <typename Other>
+    friend class BasicMeshSet;
+
+    void grow(size_t capacity);
+
+    vector<MeshRange> mMeshes;
+    vector<int32_t> mSlotByName;   // 名称编号 -> 网格序号
+    vector<shared_ptr<const MeshTopology>> mTopology;  // 与 mMeshes 一一对应
+    vector<Scalar> mCoords;        // 3 * mCapacity
+    size_t mCapacity;
+    size_t mUsed;
+};
+
+using MeshSet = BasicMeshSet<double>;
+using MeshSetF = BasicMeshSet<float>;
+
+extern template class BasicMeshSet<double>;
+extern template class BasicMeshSet<float>;
+
+}
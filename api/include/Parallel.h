@@ -0,0 +1,86 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cf {
+
+// 解析工作线程数量：0 表示使用硬件并发数
+inline unsigned resolveWorkerCount(unsigned requested, size_t taskCount) {
+    unsigned workers = requested;
+    if (workers == 0) {
+        workers = std::thread::hardware_concurrency();
+    }
+    if (workers == 0) {
+        workers = 1;
+    }
+    if (taskCount < workers) {
+        workers = static_cast<unsigned>(std::max<size_t>(taskCount, 1));
+    }
+    return workers;
+}
+
+// 在 workerCount 个线程上执行 fn(workerIndex, taskIndex)，任务按原子计数器动态分配。
+// workerIndex 可用于访问每个线程独占的资源（例如各自的 FbxManager）。
+template <typename Fn>
+void parallelForWorkers(size_t taskCount, unsigned workerCount, Fn&& fn) {
+    if (taskCount == 0) {
+        return;
+    }
+
+    unsigned workers = resolveWorkerCount(workerCount, taskCount);
+    if (workers == 1) {
+        for (size_t i = 0; i < taskCount; ++i) {
+            fn(0u, i);
+        }
+        return;
+    }
+
+    std::atomic<size_t> next(0);
+    std::exception_ptr firstError;
+    std::mutex errorMutex;
+
+    auto worker = [&](unsigned workerIndex) {
+        for (;;) {
+            size_t i = next.fetch_add(1);
+            if (i >= taskCount) {
+                break;
+            }
+            try {
+                fn(workerIndex, i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!firstError) {
+                    firstError = std::current_exception();
+                }
+                next.store(taskCount);
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(workers - 1);
+    for (unsigned w = 1; w < workers; ++w) {
+        threads.emplace_back(worker, w);
+    }
+    worker(0);
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    if (firstError) {
+        std::rethrow_exception(firstError);
+    }
+}
+
+template <typename Fn>
+void parallelFor(size_t taskCount, unsigned workerCount, Fn&& fn) {
+    parallelForWorkers(taskCount, workerCount, [&](unsigned, size_t i) { fn(i); });
+}
+
+}
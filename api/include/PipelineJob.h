@@ -0,0 +1,146 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "Log.h"
+
+using namespace std;
+
+namespace cf {
+
+// 某一时刻的任务进度；stepsDone/stepCount 为当前阶段内的步数（读取阶段为第几个文件）
+struct JobProgressSnapshot {
+    string stage;
+    size_t stepsDone = 0;
+    size_t stepCount = 0;
+    double fraction = 0.0;         // 整个任务的完成比例 [0, 1]
+    double elapsedSeconds = 0.0;
+    double etaSeconds = -1.0;      // 按已用时间与完成比例线性估计，尚无进度时为 -1
+};
+
+// 任务进度与协作式取消标志，可在多个线程上同时访问。
+// 执行方在阶段之间调用 beginStage 并检查 cancelled()，阶段内部每完成一步调用 advance()
+class JobProgress {
+public:
+    JobProgress();
+
+    JobProgress(const JobProgress&) = delete;
+    JobProgress& operator=(const JobProgress&) = delete;
+
+    // 进入新阶段，该阶段覆盖整个任务的 [start, end] 比例，分 steps 步完成（0 表示不细分）
+    void beginStage(const string& stage, double start, double end, size_t steps = 0);
+    void advance(size_t steps = 1);
+
+    void cancel() { mCancelled = true; }
+    bool cancelled() const { return mCancelled; }
+
+    // 任务结束时调用，之后已用时间不再增长
+    void stop();
+
+    JobProgressSnapshot snapshot() const;
+
+private:
+    mutable mutex mLock;
+    chrono::steady_clock::time_point mStart;
+    chrono::steady_clock::time_point mStop;
+    bool mStopped;
+    string mStage;
+    double mStageStart;
+    double mStageEnd;
+    size_t mSteps;
+    size_t mDone;
+    atomic<bool> mCancelled;
+};
+
+enum class JobState {
+    Running,       // work 正在后台线程上执行
+    Finishing,     // work 已结束，等待 runPendingFinalizers 在宿主主线程上收尾
+    Succeeded,
+    Failed,
+    Cancelled
+};
+
+const char* jobStateName(JobState state);
+
+struct JobStatus {
+    uint64_t id = 0;
+    JobState state = JobState::Running;
+    JobProgressSnapshot progress;
+};
+
+// 后台任务：work 在独立线程上执行，线程上的日志先缓存；finish 由宿主在主线程上调用
+// runPendingFinalizers 时执行，执行前按顺序输出缓存的日志。只有 finish 可以修改宿主场景。
+// 取消是协作式的：cancel 只设置标志，work 在阶段之间检查；work 结束后才取消的任务
+// 仍会调用 finish（结果为 Cancelled），由 finish 跳过场景修改并释放资源
+class PipelineJobEngine {
+public:
+    // 返回 false 表示失败（失败原因通过日志输出）
+    using Work = function<bool(JobProgress& progress)>;
+    // outcome 为 Succeeded、Failed 或 Cancelled
+    using Finish = function<void(JobState outcome)>;
+    // work 结束时在后台线程上调用，宿主借此安排一次主线程上的 runPendingFinalizers
+    using CompletionNotifier = function<void()>;
+
+    PipelineJobEngine() = default;
+    ~PipelineJobEngine();
+
+    PipelineJobEngine(const PipelineJobEngine&) = delete;
+    PipelineJobEngine& operator=(const PipelineJobEngine&) = delete;
+
+    // 插件使用的全局实例
+    static PipelineJobEngine& shared();
+
+    void setCompletionNotifier(CompletionNotifier notifier);
+
+    // 立即返回任务编号（从 1 开始递增）
+    uint64_t submit(Work work, Finish finish = nullptr);
+
+    // 编号不存在时返回 false
+    bool status(uint64_t id, JobStatus& status) const;
+    bool cancel(uint64_t id);
+
+    // 在调用线程（宿主主线程）上收尾所有已结束 work 的任务，按提交顺序执行，返回收尾的个数
+    size_t runPendingFinalizers();
+
+    // 阻塞到任务的 work 结束（不收尾），编号不存在时立即返回；用于测试与无界面的调用方
+    void waitForWork(uint64_t id);
+
+    // 还在运行或等待收尾的任务数
+    size_t activeCount() const;
+
+    // 取消所有任务并等待后台线程结束，等待收尾的任务不再调用 finish（宿主卸载时使用）
+    void shutdown();
+
+private:
+    struct Job {
+        uint64_t id = 0;
+        JobState state = JobState::Running;
+        bool succeeded = false;
+        bool finalizing = false;
+        JobProgress progress;
+        Work work;
+        Finish finish;
+        thread worker;
+        vector<pair<LogLevel, string>> logs;
+    };
+
+    void execute(Job& job);
+
+    mutable mutex mLock;
+    condition_variable mWorkDone;
+    map<uint64_t, unique_ptr<Job>> mJobs;
+    uint64_t mNextId = 1;
+    CompletionNotifier mNotifier;
+};
+
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "MeshSet.h"
+
+using namespace std;
+
+namespace cf {
+
+// 单个 (网格, 区域) 的稀疏权重在扁平数组中的区间 [begin, end)
+struct WeightRegion {
+    MeshNameId mesh;
+    string regionName;
+    uint32_t begin;
+    uint32_t end;
+};
+
+// 同一网格的区域在 regions 中连续存放
+struct WeightMesh {
+    MeshNameId mesh;
+    uint32_t firstRegion;
+    uint32_t regionCount;
+};
+
+// RegionWeightMap::load 的附加信息
+struct RegionWeightLoadInfo {
+    bool fromCache = false;     // 命中缓存，未解析JSON
+    bool cacheWritten = false;  // 未命中缓存并成功写出新缓存
+    uint64_t sourceHash = 0;    // JSON 内容哈希
+    string cacheMessage;        // 缓存失效或写出失败的原因，仅用于日志
+};
+
+// 由权重JSON编译得到的 CSR 稀疏权重表：
+// 每个区域保存升序的顶点索引与 float 权重，权重为 0 的顶点在编译时剔除。
+// 网格与区域的顺序与JSON对象的键顺序一致。
+// 编译结果可写成二进制缓存文件，之后直接内存映射使用，索引/权重数组不再拷贝
+class RegionWeightMap {
+public:
+    RegionWeightMap() = default;
+
+    // 编译 {mesh: {region: {"index": weight}}} 形式的JSON
+    static RegionWeightMap compile(const nlohmann::json& weightJson);
+
+    // 加载权重JSON：若缓存文件记录的JSON内容哈希与当前文件一致则直接映射缓存，
+    // 否则解析JSON重新编译并重写缓存。cachePath 为空时使用 defaultCachePath(jsonPath)
+    static bool load(const string& jsonPath, RegionWeightMap& map, string& error, const string& cachePath = string(), RegionWeightLoadInfo* info = nullptr);
+
+    // 缓存文件与JSON同目录，例如 skin_weights.json -> skin_weights.json.cfw
+    static string defaultCachePath(const string& jsonPath) { return jsonPath + ".cfw"; }
+
+    // 写出二进制缓存（先写临时文件再替换），sourceHash/sourceSize 为源JSON的内容哈希与字节数
+    bool writeCache(const string& cachePath, uint64_t sourceHash, uint64_t sourceSize, string& error) const;
+
+    // 映射缓存文件；格式不合法或与 sourceHash/sourceSize 不一致时返回 false
+    static bool openCache(const string& cachePath, uint64_t sourceHash, uint64_t sourceSize, RegionWeightMap& map, string& error);
+
+    // 数据是否直接来自映射的缓存文件
+    bool isMapped() const { return mMapped; }
+
+    bool empty() const { return mRegions.empty(); }
+
+    size_t meshCount() const { return mMeshes.size(); }
+    const WeightMesh& mesh(size_t m) const { return mMeshes[m]; }
+    int findMesh(MeshNameId mesh) const;
+
+    size_t regionCount() const { return mRegions.size(); }
+    const WeightRegion& region(size_t r) const { return mRegions[r]; }
+
+    // 区域内非零权重的个数及其索引/权重数组
+    size_t nonZeroCount(size_t r) const { return mRegions[r].end - mRegions[r].begin; }
+    const uint32_t* indices(size_t r) const { return mIndices + mRegions[r].begin; }
+    const float* weights(size_t r) const { return mWeights + mRegions[r].begin; }
+
+    size_t totalNonZeroCount() const { return mNonZeroCount; }
+
+private:
+    vector<WeightMesh> mMeshes;
+    vector<WeightRegion> mRegions;
+    // 持有索引/权重数组的存储（编译得到的数组或映射的缓存文件），拷贝时共享且只读
+    shared_ptr<const void> mStorage;
+    const uint32_t* mIndices = nullptr;
+    const float* mWeights = nullptr;
+    size_t mNonZeroCount = 0;
+    bool mMapped = false;
+};
+
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+using namespace std;
+
+namespace cf {
+
+// 以结构体数组形式给出的点集，x/y/z 各自连续存放
+struct PointSpan {
+    const double* x;
+    const double* y;
+    const double* z;
+    size_t count;
+};
+
+struct SimilarityOptions {
+    bool withScale = true;        // false 时只求刚体变换（scale 固定为 1）
+    int robustIterations = 0;     // 鲁棒重加权（Huber IRLS）迭代次数，0 表示只做一次最小二乘
+    double robustCutoff = 2.5;    // Huber 阈值，为残差中位数的倍数
+};
+
+struct SimilarityTransform {
+    array<array<double, 4>, 4> matrix;  // 行主序，作用于列向量 [x y z 1]
+    double scale = 1.0;
+    double rmsError = 0.0;
+    bool valid = false;
+};
+
+// Umeyama 相似变换求解：寻找 s、R、t 使 Σ w_i ||to_i - (s R from_i + t)||² 最小。
+// 通过 3x3 SVD 求旋转并处理反射，结果只依赖输入数据，可重复、可缓存
+SimilarityTransform solveSimilarity(const PointSpan& from, const PointSpan& to, const SimilarityOptions& options = SimilarityOptions());
+
+// 3x3 奇异值分解 A = U diag(s) V^T，奇异值降序排列，U、V 为正交矩阵
+void singularValueDecomposition3x3(const array<array<double, 3>, 3>& a, array<array<double, 3>, 3>& u, array<double, 3>& s, array<array<double, 3>, 3>& v);
+
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <typeindex>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace cf {
+
+// 文件的大小与修改时间，任一变化即认为内容已变
+struct FileStamp {
+    uint64_t size = 0;
+    int64_t modifiedTime = 0;
+
+    bool operator==(const FileStamp& other) const { return size == other.size && modifiedTime == other.modifiedTime; }
+    bool operator!=(const FileStamp& other) const { return !(*this == other); }
+};
+
+// 文件不存在或不可读时返回 false
+bool readFileStamp(const string& path, FileStamp& stamp);
+
+struct SessionCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t stale = 0;           // 文件已变化而丢弃的条目
+    uint64_t evictions = 0;
+    uint64_t entryCount = 0;
+    uint64_t totalBytes = 0;      // 各条目放入时估计的字节数之和
+    uint64_t budgetBytes = 0;
+};
+
+// 进程内的已加载对象缓存，键为 (对象类型, 文件路径)，条目记录读取前文件的大小与修改时间，文件变化后自动失效。
+// 所有类型的条目共享同一个字节预算（字节数由放入方估计），超出时淘汰最久未使用的条目；
+// 淘汰只释放缓存持有的引用，调用方仍持有的对象在其释放后才析构。可在多个线程上并发调用
+class SessionCache {
+public:
+    static const uint64_t kDefaultBudgetBytes = 1024ull * 1024 * 1024;
+
+    explicit SessionCache(uint64_t budgetBytes = kDefaultBudgetBytes);
+
+    // 命中且文件未变时返回共享的对象，调用方只读使用
+    template <typename T>
+    shared_ptr<T> find(const string& path) {
+        return static_pointer_cast<T>(lookup(type_index(typeid(T)), path, false));
+    }
+
+    // 命中时把对象移出缓存交给调用方独占使用（例如会被修改的场景），用完后可以原来的 stamp 再次 insert
+    template <typename T>
+    shared_ptr<T> take(const string& path) {
+        return static_pointer_cast<T>(lookup(type_index(typeid(T)), path, true));
+    }
+
+    // 放入或替换 path 的对象。stamp 须在读取文件之前取得，读取期间文件被修改时条目在下次查找时失效，
+    // 而不会把旧内容记为新文件的结果；bytes 超过整个预算时不缓存并返回 false
+    template <typename T>
+    bool insert(const string& path, const FileStamp& stamp, shared_ptr<T> value, uint64_t bytes) {
+        return store(type_index(typeid(T)), path, stamp, static_pointer_cast<void>(std::move(value)), bytes);
+    }
+
+    // 修改预算，立即按新预算淘汰
+    void setBudget(uint64_t budgetBytes);
+
+    void clear();
+
+    SessionCacheStats stats() const;
+
+private:
+    using Key = pair<type_index, string>;
+
+    struct Entry {
+        shared_ptr<void> value;
+        FileStamp stamp;
+        uint64_t bytes = 0;
+        list<Key>::iterator use;
+    };
+
+    shared_ptr<void> lookup(type_index type, const string& path, bool remove);
+    bool store(type_index type, const string& path, const FileStamp& stamp, shared_ptr<void> value, uint64_t bytes);
+
+    // 持锁调用；被移除的对象放入 released，在锁外析构
+    void erase(map<Key, Entry>::iterator it, vector<shared_ptr<void>>& released);
+    void evictToBudget(vector<shared_ptr<void>>& released);
+
+    mutable mutex mLock;
+    map<Key, Entry> mEntries;
+    list<Key> mUse;               // 前端为最近使用
+    SessionCacheStats mStats;
+};
+
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+namespace cf {
+
+// 单个 blendShape 通道的稀疏目标：只保存受影响的顶点索引及其位移（目标 - 底模）
+struct SparseShapeDelta {
+    vector<uint32_t> indices;  // 升序
+    vector<double> dx;
+    vector<double> dy;
+    vector<double> dz;
+
+    size_t size() const { return indices.size(); }
+    bool empty() const { return indices.empty(); }
+    void clear();
+};
+
+// 由区域的稀疏权重和网格差值计算通道位移：delta_i = -gap_i * w_i。
+// 索引不小于 vertexLimit 的顶点被忽略，位移长度不超过 epsilon 的顶点被剔除；
+// 结果为空说明该通道可以整体跳过
+void buildSparseDelta(const uint32_t* indices, const float* weights, size_t count,
+                      const double* gapX, const double* gapY, const double* gapZ, size_t vertexLimit,
+                      double epsilon, SparseShapeDelta& out);
+
+// 单精度差值：逐顶点换算为 double 后按同样的方式计算
+void buildSparseDelta(const uint32_t* indices, const float* weights, size_t count,
+                      const float* gapX, const float* gapY, const float* gapZ, size_t vertexLimit,
+                      double epsilon, SparseShapeDelta& out);
+
+}
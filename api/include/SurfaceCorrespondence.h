@@ -0,0 +1,136 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "MeshSet.h"
+#include "Registration.h"
+
+using namespace std;
+
+namespace cf {
+
+// 把 FBX 的多边形顶点索引（每个多边形最后一个索引按位取反）按扇形三角化；越界的多边形被丢弃
+vector<uint32_t> triangulatePolygons(const int32_t* polygonVertexIndex, size_t count, size_t vertexCount);
+
+// 三角形表面上离查询点最近的点
+struct SurfacePoint {
+    uint32_t triangle = 0;
+    array<double, 3> barycentric = {1.0, 0.0, 0.0};  // 相对三角形三个顶点的重心坐标
+    array<double, 3> position = {0.0, 0.0, 0.0};
+    double distanceSquared = 0.0;
+};
+
+// 三角形包围盒层次（BVH），节点按先序存放，左子节点紧跟父节点。
+// 只引用构建时给出的坐标与三角形数组，查询期间它们必须保持有效且不被修改
+class TriangleBvh {
+public:
+    TriangleBvh(const PointSpan& points, const vector<uint32_t>& triangles);
+
+    bool empty() const { return mNodes.empty(); }
+    size_t triangleCount() const { return mTriangleOrder.size(); }
+    const PointSpan& points() const { return mPoints; }
+    const vector<uint32_t>& triangles() const { return mTriangles; }
+
+    // 最近点查询，可在多个线程上并发调用；empty() 时返回默认值
+    SurfacePoint closestPoint(const array<double, 3>& point) const;
+
+private:
+    struct Node {
+        array<double, 3> boxMin;
+        array<double, 3> boxMax;
+        uint32_t first;       // 叶节点：mTriangleOrder 中的起点；内部节点：右子节点序号
+        uint32_t count;       // 叶节点的三角形个数，内部节点为 0
+    };
+
+    uint32_t build(vector<array<double, 3>>& centroids, uint32_t begin, uint32_t end);
+    array<double, 3> corner(uint32_t triangle, int k) const;
+
+    PointSpan mPoints;
+    const vector<uint32_t>& mTriangles;
+    vector<uint32_t> mTriangleOrder;
+    vector<Node> mNodes;
+};
+
+// 一组查询点在目标网格表面上的对应：第 i 个点 = Σ weights[3i+k] * 目标顶点 vertices[3i+k]
+struct SurfaceMapping {
+    vector<uint32_t> vertices;
+    vector<double> weights;
+    double rmsDistance = 0.0;
+    double maxDistance = 0.0;
+
+    size_t size() const { return vertices.size() / 3; }
+};
+
+// 把每个查询点投影到最近的表面点，按顶点分块在 workerCount 个线程上并行（0 表示硬件并发数）
+SurfaceMapping projectToSurface(const TriangleBvh& bvh, const PointSpan& query, unsigned workerCount);
+
+// 按映射对 source 的顶点做重心插值，输出 mapping.size() 个点
+void interpolateSurface(const SurfaceMapping& mapping, const PointSpan& source, double* x, double* y, double* z);
+
+struct SurfaceRegistrationOptions {
+    int maxIterations = 50;           // 最近点迭代（ICP）的最大次数
+    double tolerance = 1e-9;          // 单次增量（缩放、旋转角、相对 RMS 半径的平移）小于该值时停止
+    double pointToPointWeight = 0.01; // 点到点误差相对点到面误差的权重，防止平坦区域沿切向退化
+};
+
+// 顶点不一一对应时的相似配准：先按质心与 RMS 半径对齐（假定两者朝向大致一致），
+// 再反复把 base 顶点投影到目标表面、按点到面误差求解相似变换增量。
+// 目标为 targetBvh 引用的网格，返回目标到 base 的变换；mapping 非空时输出收敛后 base 顶点在目标表面上的对应
+SimilarityTransform registerToSurface(const PointSpan& base, const TriangleBvh& targetBvh, const SurfaceRegistrationOptions& options,
+                                      unsigned workerCount, SurfaceMapping* mapping = nullptr);
+
+// 仿射变换（行主序 4x4，最后一行为 0 0 0 1）的逆；线性部分奇异时返回 false
+bool invertAffine(const array<array<double, 4>, 4>& matrix, array<array<double, 4>, 4>& inverse);
+
+// 映射只取决于底模网格与目标拓扑：同一拓扑的目标模型（同一套扫描或重拓扑模板）之间顶点一一对应，
+// 因此同名底模网格、相同底模坐标与相同目标拓扑指纹的映射可以直接复用
+struct SurfaceMappingKey {
+    MeshNameId mesh = kInvalidMeshName;
+    uint64_t baseHash = 0;            // 底模网格坐标的内容哈希
+    uint64_t targetTopology = 0;      // 目标网格的拓扑指纹
+
+    bool operator<(const SurfaceMappingKey& other) const {
+        if (mesh != other.mesh) return mesh < other.mesh;
+        if (baseHash != other.baseHash) return baseHash < other.baseHash;
+        return targetTopology < other.targetTopology;
+    }
+};
+
+struct SurfaceMappingCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    size_t entryCount = 0;
+};
+
+// 进程内的映射缓存（线程安全），按最近使用淘汰；在 Maya 会话中跨多次命令保留
+class SurfaceMappingCache {
+public:
+    static const size_t kDefaultCapacity = 32;
+
+    explicit SurfaceMappingCache(size_t capacity = kDefaultCapacity) : mCapacity(capacity) {}
+
+    static SurfaceMappingCache& shared();
+
+    shared_ptr<const SurfaceMapping> find(const SurfaceMappingKey& key);
+    void insert(const SurfaceMappingKey& key, shared_ptr<const SurfaceMapping> mapping);
+    void clear();
+
+    SurfaceMappingCacheStats stats() const;
+
+private:
+    using Entry = pair<SurfaceMappingKey, shared_ptr<const SurfaceMapping>>;
+
+    mutable mutex mLock;
+    size_t mCapacity;
+    list<Entry> mEntries;     // 最近使用的在前
+    map<SurfaceMappingKey, list<Entry>::iterator> mIndex;
+    SurfaceMappingCacheStats mStats;
+};
+
+}
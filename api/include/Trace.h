@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+using namespace std;
+
+namespace cf {
+
+// 追踪：开启后每个 TraceSpan 记录一个带线程ID和计数参数的耗时区间，
+// 停止时写成 Chrome trace JSON（chrome://tracing 或 ui.perfetto.dev 打开）。
+// 未开启时 TraceSpan 只读取一次原子标志，不分配内存也不取时间
+
+namespace detail {
+    extern atomic<bool> gTracingEnabled;
+}
+
+inline bool isTracing() { return detail::gTracingEnabled.load(memory_order_relaxed); }
+
+// 清空已记录的区间并开始记录。记录缓冲区是进程内共享的，已在记录时返回 false 且不影响当前记录
+bool startTracing();
+
+// 停止记录，把已记录的区间写到 path 并清空；未开启过追踪时写出空的 trace
+bool stopTracing(const string& path, string& error);
+
+// 作用域内的耗时区间。name 必须是字符串字面量（只保存指针）
+class TraceSpan {
+public:
+    explicit TraceSpan(const char* name) : mName(isTracing() ? name : nullptr) {
+        if (mName) {
+            begin();
+        }
+    }
+    TraceSpan(const char* name, const string& detail) : TraceSpan(name) {
+        if (mName) {
+            mDetail = detail;
+        }
+    }
+    ~TraceSpan() {
+        if (mName) {
+            end();
+        }
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+    bool active() const { return mName != nullptr; }
+
+    // 附加计数参数（字节数、顶点数等），key 必须是字符串字面量，每个区间最多 kMaxArgs 个
+    void setArg(const char* key, int64_t value) {
+        if (mName) {
+            addArg(key, value);
+        }
+    }
+
+    // 提前结束区间（之后析构不再记录）
+    void finish() {
+        if (mName) {
+            end();
+            mName = nullptr;
+        }
+    }
+
+    static const int kMaxArgs = 4;
+
+private:
+    void begin();
+    void end();
+    void addArg(const char* key, int64_t value);
+
+    const char* mName;
+    string mDetail;
+    int64_t mStartUs = 0;
+    const char* mArgKeys[kMaxArgs] = {};
+    int64_t mArgValues[kMaxArgs] = {};
+    int mArgCount = 0;
+};
+
+}
@@ -1,9 +1,17 @@
 #include "Commands.h"
 #include "AutoRigCreate.h"
+#include "FbxSession.h"
+#include "MayaBlendShape.h"
+#include "Trace.h"
+#include <maya/MArgDatabase.h>
 #include <maya/MGlobal.h>
 #include <maya/MSelectionList.h>
-#include <maya/MFileIO.h>
-#include <maya/MFnDependencyNode.h>
+#include <maya/MDagPath.h>
+#include <maya/MEulerRotation.h>
+#include <maya/MFnMesh.h>
+#include <maya/MFnTransform.h>
+#include <maya/MIntArray.h>
+#include <maya/MVector.h>
 #include <string>
 #include <vector>
 #include <array>
@@ -14,18 +22,123 @@ using namespace std;
 
 namespace cf {
 
-FbxManager* characterfactoryautorigcreate::mGlobalFbxManager = nullptr;
-FbxScene* characterfactoryautorigcreate::mGlobalFbxScene = nullptr;
+static const char* kTraceFlag = "-tr";
+static const char* kTraceFlagLong = "-trace";
+
+
+namespace {
+
+    // 从 Maya 场景读取网格：点坐标用 getRawPoints 一次取得，多边形用 getVertices 一次取得
+    class MayaMeshSource : public MeshCaptureSource {
+    public:
+        bool readMesh(const string& name, RawMesh& mesh, string& error) override {
+            MSelectionList selection;
+            MDagPath path;
+            if (!selection.add(name.c_str()) || !selection.getDagPath(0, path)) {
+                return false;
+            }
+            MDagPath shape = path;
+            MStatus status = shape.extendToShape();
+            MFnMesh fnMesh(shape, &status);
+            if (!status) {
+                error = "Not a mesh: " + name;
+                return false;
+            }
+
+            mesh.points = fnMesh.getRawPoints(&status);
+            mesh.vertexCount = static_cast<size_t>(fnMesh.numVertices());
+            MIntArray counts;
+            MIntArray vertices;
+            if (!status || !fnMesh.getVertices(counts, vertices)) {
+                error = "Failed to read mesh: " + name;
+                return false;
+            }
+            mCounts.resize(counts.length());
+            mVertices.resize(vertices.length());
+            counts.get(mCounts.data());
+            vertices.get(mVertices.data());
+            mesh.polygonCounts = mCounts.data();
+            mesh.polygonCount = mCounts.size();
+            mesh.polygonVertices = mVertices.data();
+            mesh.polygonVertexCount = mVertices.size();
+
+            MFnTransform transform(path.transform());
+            MVector translation = transform.getTranslation(MSpace::kTransform);
+            MEulerRotation rotation;
+            transform.getRotation(rotation);
+            double scale[3] = {1.0, 1.0, 1.0};
+            transform.getScale(scale);
+            const double toDegrees = 180.0 / 3.14159265358979323846;
+            mesh.transform.translation = {translation.x, translation.y, translation.z};
+            mesh.transform.rotation = {rotation.x * toDegrees, rotation.y * toDegrees, rotation.z * toDegrees};
+            mesh.transform.scale = {scale[0], scale[1], scale[2]};
+            mesh.transform.rotationOrder = rotationOrder(rotation.order);
+            return true;
+        }
+
+    private:
+        static RotationOrder rotationOrder(MEulerRotation::RotationOrder order) {
+            switch (order) {
+            case MEulerRotation::kYZX: return RotationOrder::YZX;
+            case MEulerRotation::kZXY: return RotationOrder::ZXY;
+            case MEulerRotation::kXZY: return RotationOrder::XZY;
+            case MEulerRotation::kYXZ: return RotationOrder::YXZ;
+            case MEulerRotation::kZYX: return RotationOrder::ZYX;
+            default: return RotationOrder::XYZ;
+            }
+        }
+
+        vector<int> mCounts;
+        vector<int> mVertices;
+    };
+
+    // 按 FBXExport 的结构（变换节点 + 名为 <节点名>Shape 的网格）建立场景
+    FbxScene* createCapturedScene(FbxManager* manager, const vector<CapturedMesh>& meshes, string& error) {
+        TraceSpan span("buildCapturedScene");
+        FbxScene* scene = FbxScene::Create(manager, "");
+        if (!scene) {
+            error = "Failed to create global FBX Scene";
+            return nullptr;
+        }
+
+        for (const CapturedMesh& mesh : meshes) {
+            FbxNode* node = FbxNode::Create(scene, mesh.name.c_str());
+            FbxMesh* fbxMesh = FbxMesh::Create(scene, (mesh.name + "Shape").c_str());
+            fbxMesh->InitControlPoints(static_cast<int>(mesh.vertexCount()));
+            FbxVector4* points = fbxMesh->GetControlPoints();
+            for (size_t i = 0; i < mesh.vertexCount(); ++i) {
+                points[i].Set(mesh.points[3 * i], mesh.points[3 * i + 1], mesh.points[3 * i + 2]);
+            }
+            size_t next = 0;
+            for (int32_t count : mesh.polygonCounts) {
+                fbxMesh->BeginPolygon();
+                for (int32_t k = 0; k < count; ++k) {
+                    fbxMesh->AddPolygon(mesh.polygonVertices[next++]);
+                }
+                fbxMesh->EndPolygon();
+            }
+
+            node->SetNodeAttribute(fbxMesh);
+            const MeshTransform& transform = mesh.transform;
+            node->SetRotationOrder(FbxNode::eSourcePivot, static_cast<EFbxRotationOrder>(transform.rotationOrder));
+            node->LclTranslation.Set(FbxDouble3(transform.translation[0], transform.translation[1], transform.translation[2]));
+            node->LclRotation.Set(FbxDouble3(transform.rotation[0], transform.rotation[1], transform.rotation[2]));
+            node->LclScaling.Set(FbxDouble3(transform.scale[0], transform.scale[1], transform.scale[2]));
+            scene->GetRootNode()->AddChild(node);
+        }
+        span.setArg("meshes", static_cast<int64_t>(meshes.size()));
+        return scene;
+    }
+
+}
 
 class characterfactoryautorigcreate::Implementation {
 public:
     Implementation() {}
     ~Implementation() {}
 
-    MString FbxExporter() {
-        MStatus status;
-
-        vector<string> meshNameList = {
+    bool CaptureFbxScene(MeshCaptureStats& stats) {
+        const vector<string> meshNameList = {
             "head_lod0_mesh", 
             "teeth_lod0_mesh",
             "saliva_lod0_mesh", 
@@ -36,47 +149,26 @@ public:
             "eyeEdge_lod0_mesh", 
             "cartilage_lod0_mesh"
         };
-        
-        MSelectionList selectionList;
-        
-        int selectedCount = 0;
-        for (const auto& meshName : meshNameList) {
-            status = selectionList.add(meshName.c_str());
-            if (status) {
-                selectedCount++;
-                MGlobal::displayInfo(MString("Successfully added model to selection: ") + meshName.c_str());
-            } else {
-                MGlobal::displayWarning(MString("Failed to add model to selection: ") + meshName.c_str());
-            }
-        }
-        
-        status = MGlobal::setActiveSelectionList(selectionList);
-        if (!status) {
-            MGlobal::displayError("Failed to set active selection");
-            return MString("Failed to select models");
+
+        ScopedLogSink logSink(mayaLogSink);
+        MayaMeshSource source;
+        vector<CapturedMesh> meshes;
+        stats = captureMeshes(source, meshNameList, meshes);
+        if (meshes.empty()) {
+            MGlobal::displayWarning("No models found, cannot create FBX scene");
+            return false;
         }
-        
-        if (selectedCount > 0) {
-            MGlobal::displayInfo(MString("Successfully selected ") + selectedCount + " models");
-            
-            MString projectDir;
-            MGlobal::executeCommand("workspace -q -rd", projectDir);
-            
-            MString exportPath = projectDir + "scenes/character_export.fbx";
-            MString exportCommand = "FBXExport -f \"" + exportPath + "\" -s";
-            
-            status = MGlobal::executeCommand(exportCommand);
-            if (status) {
-                MGlobal::displayInfo(MString("Successfully exported FBX to: ") + exportPath);
-                return exportPath;
-            } else {
-                MGlobal::displayError(MString("Failed to export FBX to: ") + exportPath);
-                return MString("Failed to export FBX");
-            }
-        } else {
-            MGlobal::displayWarning("No models found, cannot export FBX");
-            return MString("No models found");
+        MGlobal::displayInfo(MString("Captured ") + static_cast<double>(stats.meshes) + " models (" + static_cast<double>(stats.vertices) + " vertices, "
+                             + static_cast<double>(stats.polygons) + " polygons)");
+
+        string error;
+        bool created = FbxSession::shared().replaceAutoRigScene([&](FbxManager* manager, string& createError) {
+            return createCapturedScene(manager, meshes, createError);
+        }, error);
+        if (!created) {
+            MGlobal::displayError(error.c_str());
         }
+        return created;
     }
 };
 
@@ -90,86 +182,80 @@ void* characterfactoryautorigcreate::creator() {
     return new characterfactoryautorigcreate();
 }
 
-MString characterfactoryautorigcreate::FbxExporter() {
-    return pImpl->FbxExporter();
+MSyntax characterfactoryautorigcreate::newSyntax() {
+    MSyntax syntax;
+    syntax.addFlag(kTraceFlag, kTraceFlagLong, MSyntax::kString);
+    return syntax;
 }
 
-bool characterfactoryautorigcreate::CreateFbxScene(const char* fbxPath) {
-    if (!mGlobalFbxManager) {
-        mGlobalFbxManager = FbxManager::Create();
-        if (!mGlobalFbxManager) {
-            MGlobal::displayError("Failed to create global FBX Manager");
-            return false;
-        }
-
-        FbxIOSettings* ios = FbxIOSettings::Create(mGlobalFbxManager, IOSROOT);
-        mGlobalFbxManager->SetIOSettings(ios);
-    }
-
-    if (mGlobalFbxScene) {
-        mGlobalFbxScene->Destroy();
-        mGlobalFbxScene = nullptr;
-    }
+bool characterfactoryautorigcreate::CaptureFbxScene(MeshCaptureStats& stats) {
+    return pImpl->CaptureFbxScene(stats);
+}
 
-    mGlobalFbxScene = FbxScene::Create(mGlobalFbxManager, "");
-    if (!mGlobalFbxScene) {
-        MGlobal::displayError("Failed to create global FBX Scene");
+bool characterfactoryautorigcreate::CreateFbxScene(const char* fbxPath) {
+    // 场景由插件会话持有，替换时释放之前的场景，关闭会话或卸载插件时释放
+    string error;
+    if (!FbxSession::shared().loadAutoRigScene(fbxPath ? fbxPath : "", error)) {
+        MGlobal::displayError(error.c_str());
         return false;
     }
 
-    if (fbxPath && strlen(fbxPath) > 0) {
-        FbxImporter* importer = FbxImporter::Create(mGlobalFbxManager, "");
-        bool importStatus = importer->Initialize(fbxPath, -1, mGlobalFbxManager->GetIOSettings());
-
-        if (!importStatus) {
-            MGlobal::displayError(MString("Failed to initialize importer for: ") + fbxPath);
-            importer->Destroy();
-            return false;
-        }
-
-        importStatus = importer->Import(mGlobalFbxScene);
-        importer->Destroy();
-
-        if (!importStatus) {
-            MGlobal::displayError(MString("Failed to import FBX file: ") + fbxPath);
-            return false;
-        }
-    }
-
     MGlobal::displayInfo("Successfully created global FBX scene");
     return true;
 }
 
 FbxScene* characterfactoryautorigcreate::GetGlobalFbxScene() {
-    return mGlobalFbxScene;
+    return FbxSession::shared().autoRigScene();
 }
 
 MStatus characterfactoryautorigcreate::doIt(const MArgList& args) {
     MStatus status = MS::kSuccess;
+    MArgDatabase argData(syntax(), args, &status);
+    if (!status) {
+        MGlobal::displayError("Invalid arguments for characterfactoryautorigcreate [-trace path]");
+        return status;
+    }
+
+    MString tracePath;
+    if (argData.isFlagSet(kTraceFlag)) {
+        status = argData.getFlagArgument(kTraceFlag, 0, tracePath);
+        if (!status) {
+            MGlobal::displayError("Failed to get trace flag argument");
+            return status;
+        }
+        if (!startTracing()) {
+            MGlobal::displayError("A trace is already being recorded by another command or background job; wait for it to finish before using -trace");
+            return MS::kFailure;
+        }
+    }
 
     MGlobal::displayInfo("Executing characterfactoryautorigcreate command");
     
-    MString exportPath = FbxExporter();
-    
-    if (!exportPath.length() || exportPath == "Failed to export FBX" || exportPath == "No models found") {
-        MGlobal::displayWarning("Failed to export FBX or no models found, cannot create FBX scene");
+    TraceSpan span("characterfactoryautorigcreate");
+    MeshCaptureStats stats;
+    if (CaptureFbxScene(stats)) {
+        MGlobal::displayInfo("Successfully created global FBX scene from captured models");
+
+        if (FbxScene* scene = GetGlobalFbxScene()) {
+            int nodeCount = scene->GetNodeCount();
+            MGlobal::displayInfo(MString("Global FBX scene contains ") + nodeCount + " nodes");
+        }
     } else {
-        const char* fbxPathCStr = exportPath.asChar();
-        
-        if (CreateFbxScene(fbxPathCStr)) {
-            MGlobal::displayInfo("Successfully created global FBX scene from exported file");
-            
-            if (mGlobalFbxScene) {
-                int nodeCount = mGlobalFbxScene->GetNodeCount();
-                MGlobal::displayInfo(MString("Global FBX scene contains ") + nodeCount + " nodes");
-            }
+        MGlobal::displayError("Failed to create global FBX scene");
+    }
+    
+    span.finish();
+    if (tracePath.length() > 0) {
+        string error;
+        if (stopTracing(tracePath.asChar(), error)) {
+            MGlobal::displayInfo(MString("Trace written to ") + tracePath);
         } else {
-            MGlobal::displayError("Failed to create global FBX scene");
+            MGlobal::displayWarning(error.c_str());
         }
     }
-    
+
     MPxCommand::clearResult();
-    MPxCommand::setResult(exportPath);
+    MPxCommand::setResult(static_cast<int>(stats.meshes));
     
     return status;
 }
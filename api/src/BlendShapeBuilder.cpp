@@ -0,0 +1,80 @@
+#include "BlendShapeBuilder.h"
+#include "Trace.h"
+#include <algorithm>
+
+namespace cf {
+
+    namespace {
+
+        template <typename Scalar>
+        BlendShapeBuildStats buildBlendShapesFrom(const RegionWeightMap& weights, const vector<BasicMeshSet<Scalar>>& distance,
+                                                  const vector<string>& suffixes, double epsilon, BlendShapeHost& host) {
+            BlendShapeBuildStats stats;
+            SparseShapeDelta delta;
+
+            for (size_t m = 0; m < weights.meshCount(); ++m) {
+                const WeightMesh& weightMesh = weights.mesh(m);
+                const string& meshName = meshNameOf(weightMesh.mesh);
+                TraceSpan span("buildMeshShapes", meshName);
+                size_t baseVertexCount = 0;
+                if (!host.beginMesh(meshName, baseVertexCount)) {
+                    ++stats.skippedMeshes;
+                    continue;
+                }
+
+                size_t targetCount = 0;
+                const size_t pointsBefore = stats.shapePoints;
+                for (uint32_t r = weightMesh.firstRegion; r < weightMesh.firstRegion + weightMesh.regionCount; ++r) {
+                    const string& regionName = weights.region(r).regionName;
+
+                    for (size_t suffixIndex = 0; suffixIndex < suffixes.size(); ++suffixIndex) {
+                        int slot = suffixIndex < distance.size() ? distance[suffixIndex].find(weightMesh.mesh) : -1;
+                        if (slot >= 0) {
+                            const BasicMeshSet<Scalar>& meshDistances = distance[suffixIndex];
+                            const size_t vertexLimit = min(baseVertexCount, meshDistances.vertexCount(slot));
+                            buildSparseDelta(weights.indices(r), weights.weights(r), weights.nonZeroCount(r),
+                                             meshDistances.x(slot), meshDistances.y(slot), meshDistances.z(slot),
+                                             vertexLimit, epsilon, delta);
+                        } else {
+                            delta.clear();
+                        }
+                        if (delta.empty()) {
+                            ++stats.prunedChannels;
+                            continue;
+                        }
+
+                        if (!host.addTarget(meshName + regionName + "_" + suffixes[suffixIndex], delta)) {
+                            ++stats.failedChannels;
+                            continue;
+                        }
+                        ++targetCount;
+                        ++stats.channels;
+                        stats.shapePoints += delta.size();
+                        stats.densePoints += baseVertexCount;
+                    }
+                }
+
+                host.endMesh(targetCount);
+                span.setArg("channels", static_cast<int64_t>(targetCount));
+                span.setArg("points", static_cast<int64_t>(stats.shapePoints - pointsBefore));
+                if (targetCount > 0) {
+                    ++stats.meshes;
+                }
+            }
+
+            return stats;
+        }
+
+    }
+
+    BlendShapeBuildStats buildBlendShapes(const RegionWeightMap& weights, const vector<MeshSet>& distance,
+                                          const vector<string>& suffixes, double epsilon, BlendShapeHost& host) {
+        return buildBlendShapesFrom(weights, distance, suffixes, epsilon, host);
+    }
+
+    BlendShapeBuildStats buildBlendShapes(const RegionWeightMap& weights, const vector<MeshSetF>& distance,
+                                          const vector<string>& suffixes, double epsilon, BlendShapeHost& host) {
+        return buildBlendShapesFrom(weights, distance, suffixes, epsilon, host);
+    }
+
+}
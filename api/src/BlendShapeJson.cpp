@@ -0,0 +1,55 @@
+#include "BlendShapeJson.h"
+#include "Trace.h"
+#include <fstream>
+
+namespace cf {
+
+    JsonBlendShapeHost::JsonBlendShapeHost(const MeshSet& baseMeshes) : mBaseMeshes(baseMeshes), mJson(nlohmann::json::object()) {}
+
+    bool JsonBlendShapeHost::beginMesh(const string& meshName, size_t& vertexCount) {
+        int slot = mBaseMeshes.find(meshName);
+        if (slot < 0) {
+            return false;
+        }
+        mMeshName = meshName;
+        mCurrent = nlohmann::json::object();
+        vertexCount = mBaseMeshes.vertexCount(slot);
+        return true;
+    }
+
+    bool JsonBlendShapeHost::addTarget(const string& channelName, const SparseShapeDelta& delta) {
+        nlohmann::json deltas = nlohmann::json::array();
+        for (size_t k = 0; k < delta.size(); ++k) {
+            deltas.push_back(delta.dx[k]);
+            deltas.push_back(delta.dy[k]);
+            deltas.push_back(delta.dz[k]);
+        }
+        mCurrent[channelName] = {{"indices", delta.indices}, {"deltas", std::move(deltas)}};
+        return true;
+    }
+
+    void JsonBlendShapeHost::endMesh(size_t targetCount) {
+        if (targetCount > 0) {
+            mJson[mMeshName] = std::move(mCurrent);
+        }
+        mCurrent = nlohmann::json();
+    }
+
+    bool JsonBlendShapeHost::save(const string& path, string& error) const {
+        TraceSpan span("writeJson", path);
+        ofstream file(path, ios::binary | ios::trunc);
+        if (!file) {
+            error = "Failed to open file for writing: " + path;
+            return false;
+        }
+        const string text = mJson.dump();
+        file << text;
+        if (!file) {
+            error = "Failed to write file: " + path;
+            return false;
+        }
+        span.setArg("bytes", static_cast<int64_t>(text.size()));
+        return true;
+    }
+
+}
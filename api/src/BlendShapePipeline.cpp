@@ -0,0 +1,1400 @@
+#include "BlendShapePipeline.h"
+#include "ContentHash.h"
+#include "FbxBinaryReader.h"
+#include "Log.h"
+#include "MeshKernels.h"
+#include "Parallel.h"
+#include "PipelineJob.h"
+#include "SessionCache.h"
+#include "SurfaceCorrespondence.h"
+#include "Trace.h"
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <filesystem>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <sstream>
+
+namespace cf {
+
+    namespace {
+
+        using Clock = chrono::steady_clock;
+
+        double elapsedMs(Clock::time_point start) {
+            return chrono::duration<double, milli>(Clock::now() - start).count();
+        }
+
+        string formatNumber(double value, int precision = 3) {
+            ostringstream stream;
+            stream << fixed << setprecision(precision) << value;
+            return stream.str();
+        }
+
+        // 随 head 区域整体平移的网格（区域名 -> 网格名）
+        const map<string, vector<string>>& regionFollowerMeshes() {
+            static const map<string, vector<string>> followers = {
+                {"eyes_blendshape", {"saliva_lod0_mesh", "eyeRight_lod0_mesh", "eyeLeft_lod0_mesh", "eyeshell_lod0_mesh", "eyelashes_lod0_mesh", "eyeEdge_lod0_mesh", "cartilage_lod0_mesh"}},
+                {"mouth_blendshape", {"teeth_lod0_mesh"}}
+            };
+            return followers;
+        }
+
+        const size_t kPointBytes = 3 * sizeof(double);
+
+        string formatMegabytes(uint64_t bytes) {
+            return formatNumber(static_cast<double>(bytes) / (1024.0 * 1024.0), 1) + " MB";
+        }
+
+        // 读取 meshNames 中各网格的多边形索引并三角化，写入 meshData 中顶点数一致的同名网格
+        bool readTriangleTopology(const string& fbxPath, const vector<string>& meshNames, unsigned workerCount, MeshSet& meshData, string& error) {
+            FbxBinaryReader reader;
+            map<string, FbxMeshArrays> meshes;
+            if (!reader.open(fbxPath) || !reader.readMeshes(meshNames, true, meshes, workerCount)) {
+                error = reader.lastError();
+                return false;
+            }
+            for (const string& warning : reader.warnings()) {
+                logWarning(warning + " in " + fbxPath);
+            }
+            for (const auto& [meshName, arrays] : meshes) {
+                int slot = meshData.find(meshName);
+                if (slot < 0 || arrays.vertices.size() / 3 != meshData.vertexCount(slot)) {
+                    continue;
+                }
+                auto topology = make_shared<MeshTopology>();
+                topology->triangles = triangulatePolygons(arrays.polygonVertexIndex.data(), arrays.polygonVertexIndex.size(), meshData.vertexCount(slot));
+                topology->fingerprint = GeometryCache::topologyFingerprint(arrays.polygonVertexIndex.data(), arrays.polygonVertexIndex.size());
+                meshData.setTopology(slot, std::move(topology));
+            }
+            return true;
+        }
+
+        vector<const MeshSet*> targetsOf(const vector<MeshSet>& meshes) {
+            vector<const MeshSet*> targets;
+            for (size_t i = 1; i < meshes.size(); ++i) {
+                targets.push_back(&meshes[i]);
+            }
+            return targets;
+        }
+
+        uint64_t meshContentHash(const MeshSet& meshes, size_t mesh) {
+            const size_t bytes = meshes.vertexCount(mesh) * sizeof(double);
+            return hashBytes(meshes.z(mesh), bytes, hashBytes(meshes.y(mesh), bytes, hashBytes(meshes.x(mesh), bytes)));
+        }
+
+        // 每个任务处理的顶点数，用于把 head 的区域偏移按顶点分块并行应用
+        const size_t kAlignChunk = 4096;
+
+        // 多个目标模型的 head 区域对齐，heads[t] 为目标网格集与其 head 序号（为负时跳过）。
+        // 区域中心按 (目标, 区域) 并行归约，偏移按 (目标, 顶点分块) 并行应用；每个顶点仍按区域顺序依次减去偏移，
+        // 结果与逐个目标调用 alignHeadRegions 逐位一致。head 顶点数少于 shared.vertexLimit 的目标单独过滤底模区域
+        template <typename Scalar>
+        vector<map<string, array<double, 3>>> alignHeadRegionsParallel(const BasicMeshSet<Scalar>& baseMesh, const RegionWeightMap& weights,
+                                                                       const HeadRegionCenters& shared, const vector<pair<BasicMeshSet<Scalar>*, int>>& heads,
+                                                                       unsigned workerCount) {
+            TraceSpan span("alignHeadRegions");
+            const size_t targetCount = heads.size();
+            deque<HeadRegionCenters> ownCenters;
+            vector<const HeadRegionCenters*> centers(targetCount, nullptr);
+            vector<size_t> firstRegion(targetCount + 1, 0);
+            vector<size_t> firstChunk(targetCount + 1, 0);
+            for (size_t t = 0; t < targetCount; ++t) {
+                const int slot = heads[t].second;
+                size_t regionCount = 0;
+                size_t chunkCount = 0;
+                if (slot >= 0) {
+                    const size_t count = heads[t].first->vertexCount(slot);
+                    centers[t] = &shared;
+                    if (count < shared.vertexLimit) {
+                        ownCenters.push_back(BlendShapePipeline::computeHeadRegionCenters(baseMesh, weights, count));
+                        centers[t] = &ownCenters.back();
+                    }
+                    regionCount = centers[t]->regions.size();
+                    chunkCount = regionCount > 0 ? (count + kAlignChunk - 1) / kAlignChunk : 0;
+                }
+                firstRegion[t + 1] = firstRegion[t] + regionCount;
+                firstChunk[t + 1] = firstChunk[t] + chunkCount;
+            }
+            auto targetOf = [](const vector<size_t>& first, size_t task) {
+                return static_cast<size_t>(upper_bound(first.begin(), first.end(), task) - first.begin()) - 1;
+            };
+
+            // 子区域之间可能重叠，偏移全部基于调整前的目标顶点计算，之后再统一应用
+            vector<array<double, 3>> offsets(firstRegion[targetCount]);
+            parallelFor(offsets.size(), workerCount, [&](size_t task) {
+                const size_t t = targetOf(firstRegion, task);
+                const HeadRegion& region = centers[t]->regions[task - firstRegion[t]];
+                array<double, 3> targetCenter = BlendShapePipeline::calculateRegionCenter(*heads[t].first, heads[t].second, region.indices);
+                offsets[task] = {
+                    targetCenter[0] - region.baseCenter[0],
+                    targetCenter[1] - region.baseCenter[1],
+                    targetCenter[2] - region.baseCenter[2]
+                };
+            });
+
+            parallelFor(firstChunk[targetCount], workerCount, [&](size_t task) {
+                const size_t t = targetOf(firstChunk, task);
+                const uint32_t lo = static_cast<uint32_t>((task - firstChunk[t]) * kAlignChunk);
+                const uint32_t hi = static_cast<uint32_t>(min<size_t>(lo + kAlignChunk, heads[t].first->vertexCount(heads[t].second)));
+                Scalar* x = heads[t].first->x(heads[t].second);
+                Scalar* y = heads[t].first->y(heads[t].second);
+                Scalar* z = heads[t].first->z(heads[t].second);
+                const vector<HeadRegion>& regions = centers[t]->regions;
+                for (size_t r = 0; r < regions.size(); ++r) {
+                    const array<double, 3>& offset = offsets[firstRegion[t] + r];
+                    const vector<uint32_t>& indices = regions[r].indices;
+                    for (size_t k = lower_bound(indices.begin(), indices.end(), lo) - indices.begin(); k < indices.size() && indices[k] < hi; ++k) {
+                        const uint32_t index = indices[k];
+                        const double weight = regions[r].weights[k];
+                        x[index] = static_cast<Scalar>(x[index] - offset[0] * weight);
+                        y[index] = static_cast<Scalar>(y[index] - offset[1] * weight);
+                        z[index] = static_cast<Scalar>(z[index] - offset[2] * weight);
+                    }
+                }
+            });
+
+            vector<map<string, array<double, 3>>> offsetMaps(targetCount);
+            for (size_t t = 0; t < targetCount; ++t) {
+                for (size_t r = firstRegion[t]; r < firstRegion[t + 1]; ++r) {
+                    offsetMaps[t][centers[t]->regions[r - firstRegion[t]].name] = offsets[r];
+                }
+            }
+            span.setArg("targets", static_cast<int64_t>(targetCount));
+            span.setArg("regions", static_cast<int64_t>(offsets.size()));
+            return offsetMaps;
+        }
+
+        // 随 head 区域整体平移的网格：按 (目标, 网格) 并行，每个网格按 offsetMaps[t] 的顺序依次减去偏移
+        void applyFollowerOffsets(const vector<pair<MeshSet*, int>>& targets, const vector<map<string, array<double, 3>>>& offsetMaps, unsigned workerCount) {
+            struct FollowerTask {
+                MeshSet* meshes;
+                int slot;
+                vector<array<double, 3>> offsets;
+            };
+            vector<FollowerTask> tasks;
+            for (size_t t = 0; t < targets.size(); ++t) {
+                map<int, size_t> taskOfSlot;
+                for (const auto& [subRegionName, offset] : offsetMaps[t]) {
+                    auto followers = regionFollowerMeshes().find(subRegionName);
+                    if (followers == regionFollowerMeshes().end()) {
+                        continue;
+                    }
+                    for (const auto& modelName : followers->second) {
+                        int slot = targets[t].first->find(modelName);
+                        if (slot < 0) {
+                            continue;
+                        }
+                        auto inserted = taskOfSlot.emplace(slot, tasks.size());
+                        if (inserted.second) {
+                            tasks.push_back({targets[t].first, slot, {}});
+                        }
+                        tasks[inserted.first->second].offsets.push_back(offset);
+                    }
+                }
+            }
+
+            parallelFor(tasks.size(), workerCount, [&](size_t task) {
+                const FollowerTask& follower = tasks[task];
+                double* x = follower.meshes->x(follower.slot);
+                double* y = follower.meshes->y(follower.slot);
+                double* z = follower.meshes->z(follower.slot);
+                const size_t count = follower.meshes->vertexCount(follower.slot);
+                for (const array<double, 3>& offset : follower.offsets) {
+                    for (size_t i = 0; i < count; ++i) {
+                        x[i] -= offset[0];
+                        y[i] -= offset[1];
+                        z[i] -= offset[2];
+                    }
+                }
+            });
+        }
+
+        // 融合求差的实现，Scalar 为坐标的存储与计算精度。布局与日志在调用线程上建立，
+        // head 变换按目标、区域对齐按 (目标, 区域)、求差按 (目标, 网格) 在 workerCount 个线程上并行
+        template <typename Scalar>
+        vector<BasicMeshSet<Scalar>> evaluateGapsOf(const BasicMeshSet<Scalar>& baseMesh, const vector<const BasicMeshSet<Scalar>*>& targets,
+                                                    const vector<SimilarityTransform>& transforms, const RegionWeightMap& weights, PipelineTraffic* traffic,
+                                                    unsigned workerCount) {
+            using Meshes = BasicMeshSet<Scalar>;
+            const size_t pointBytes = 3 * sizeof(Scalar);
+            if (targets.empty()) {
+                logWarning("Need at least two meshes to calculate gap");
+                return {};
+            }
+
+            TraceSpan span("evaluateGaps");
+            const array<array<double, 4>, 4> identity = {{{1.0, 0.0, 0.0, 0.0}, {0.0, 1.0, 0.0, 0.0}, {0.0, 0.0, 1.0, 0.0}, {0.0, 0.0, 0.0, 1.0}}};
+            const array<double, 3> noOffset = {0.0, 0.0, 0.0};
+            const MeshNameId headName = internMeshName("head_lod0_mesh");
+            // 与 alignRegionsByCenter 的条件一致：至少两个目标模型才做区域对齐
+            const bool alignRegions = !weights.empty() && targets.size() >= 2;
+            const size_t targetCount = targets.size();
+            auto matrixOf = [&](size_t t) -> const array<array<double, 4>, 4>& {
+                return t < transforms.size() ? transforms[t].matrix : identity;
+            };
+
+            // 先按底模顺序建立全部差值网格；没有权重的网格不会生成通道，不计算
+            struct GapPair {
+                size_t target;
+                size_t baseSlot;
+                size_t targetSlot;
+                size_t gapSlot;
+            };
+            vector<GapPair> pairs;
+            vector<Meshes> result(targetCount);
+            vector<int> gapHeads(targetCount, -1);
+            vector<Meshes> scratch(targetCount);
+            vector<PipelineTraffic> counted(targetCount);
+            for (size_t t = 0; t < targetCount; ++t) {
+                const Meshes& targetMesh = *targets[t];
+                const size_t firstPair = pairs.size();
+                size_t gapVertices = 0;
+                for (size_t baseSlot = 0; baseSlot < baseMesh.meshCount(); ++baseSlot) {
+                    const MeshNameId name = baseMesh.nameId(baseSlot);
+                    int targetSlot = targetMesh.find(name);
+                    if (targetSlot < 0) {
+                        continue;
+                    }
+                    if (targetMesh.vertexCount(targetSlot) != baseMesh.vertexCount(baseSlot)) {
+                        logWarning("Skipping " + baseMesh.name(baseSlot) + " of model " + to_string(t + 1) + ": " + to_string(targetMesh.vertexCount(targetSlot))
+                                   + " vertices, base has " + to_string(baseMesh.vertexCount(baseSlot)));
+                        continue;
+                    }
+                    if (!weights.empty() && weights.findMesh(name) < 0) {
+                        continue;
+                    }
+                    pairs.push_back({t, baseSlot, static_cast<size_t>(targetSlot), 0});
+                    gapVertices += baseMesh.vertexCount(baseSlot);
+                }
+                Meshes& gap = result[t];
+                gap.reserve(pairs.size() - firstPair, gapVertices);
+                for (size_t p = firstPair; p < pairs.size(); ++p) {
+                    pairs[p].gapSlot = gap.addMesh(baseMesh.nameId(pairs[p].baseSlot), baseMesh.vertexCount(pairs[p].baseSlot));
+                    if (baseMesh.nameId(pairs[p].baseSlot) == headName) {
+                        gapHeads[t] = static_cast<int>(pairs[p].gapSlot);
+                    }
+                }
+                counted[t].transientBytes += gapVertices * pointBytes;
+                // 顶点数与底模不一致的 head 不输出差值，但仍需要它的区域偏移
+                const int targetHead = targetMesh.find(headName);
+                if (alignRegions && gapHeads[t] < 0 && targetHead >= 0) {
+                    scratch[t].addMesh(headName, targetMesh.vertexCount(targetHead));
+                    counted[t].transientBytes += scratch[t].vertexCount() * pointBytes;
+                }
+            }
+
+            // head 先变换写入差值数组，区域对齐直接在其上进行，最后再与底模相减
+            vector<map<MeshNameId, vector<array<double, 3>>>> meshOffsets(targetCount);
+            if (alignRegions) {
+                vector<pair<Meshes*, int>> heads(targetCount, {nullptr, -1});
+                parallelFor(targetCount, workerCount, [&](size_t t) {
+                    const Meshes& targetMesh = *targets[t];
+                    const int targetHead = targetMesh.find(headName);
+                    Meshes& headMesh = gapHeads[t] >= 0 ? result[t] : scratch[t];
+                    const int slot = gapHeads[t] >= 0 ? gapHeads[t] : (scratch[t].empty() ? -1 : 0);
+                    if (slot < 0) {
+                        return;
+                    }
+                    transformPoints(matrixOf(t), targetMesh.x(targetHead), targetMesh.y(targetHead), targetMesh.z(targetHead),
+                                    headMesh.x(slot), headMesh.y(slot), headMesh.z(slot), headMesh.vertexCount(slot));
+                    counted[t].bytesRead += headMesh.vertexCount(slot) * pointBytes;
+                    counted[t].bytesWritten += headMesh.vertexCount(slot) * pointBytes;
+                    heads[t] = {&headMesh, slot};
+                });
+
+                const HeadRegionCenters centers = BlendShapePipeline::computeHeadRegionCenters(baseMesh, weights);
+                vector<map<string, array<double, 3>>> regionOffsets = alignHeadRegionsParallel(baseMesh, weights, centers, heads, workerCount);
+                for (size_t t = 0; t < targetCount; ++t) {
+                    for (const auto& [subRegionName, offset] : regionOffsets[t]) {
+                        auto followers = regionFollowerMeshes().find(subRegionName);
+                        if (followers == regionFollowerMeshes().end()) {
+                            continue;
+                        }
+                        for (const auto& modelName : followers->second) {
+                            meshOffsets[t][internMeshName(modelName)].push_back(offset);
+                        }
+                    }
+                }
+                scratch.clear();
+            }
+
+            vector<PipelineTraffic> pairCounted(pairs.size());
+            parallelFor(pairs.size(), workerCount, [&](size_t p) {
+                const GapPair& pair = pairs[p];
+                const Meshes& targetMesh = *targets[pair.target];
+                Meshes& gap = result[pair.target];
+                const auto& matrix = matrixOf(pair.target);
+                PipelineTraffic& count = pairCounted[p];
+                const bool isHead = static_cast<int>(pair.gapSlot) == gapHeads[pair.target];
+                const MeshNameId name = baseMesh.nameId(pair.baseSlot);
+                const size_t vertexCount = baseMesh.vertexCount(pair.baseSlot);
+                const Scalar* bx = baseMesh.x(pair.baseSlot);
+                const Scalar* by = baseMesh.y(pair.baseSlot);
+                const Scalar* bz = baseMesh.z(pair.baseSlot);
+                Scalar* gx = gap.x(pair.gapSlot);
+                Scalar* gy = gap.y(pair.gapSlot);
+                Scalar* gz = gap.z(pair.gapSlot);
+                auto offsets = meshOffsets[pair.target].find(name);
+                const size_t offsetCount = offsets == meshOffsets[pair.target].end() ? 0 : offsets->second.size();
+
+                if (!isHead && offsetCount <= 1) {
+                    // 常见情况：变换、整体偏移与减法一次完成
+                    transformedGap(matrix, offsetCount == 0 ? noOffset : offsets->second[0], bx, by, bz,
+                                   targetMesh.x(pair.targetSlot), targetMesh.y(pair.targetSlot), targetMesh.z(pair.targetSlot),
+                                   gx, gy, gz, vertexCount);
+                    count.bytesRead += 2 * vertexCount * pointBytes;
+                    count.bytesWritten += vertexCount * pointBytes;
+                    return;
+                }
+
+                if (!isHead) {
+                    transformPoints(matrix, targetMesh.x(pair.targetSlot), targetMesh.y(pair.targetSlot), targetMesh.z(pair.targetSlot),
+                                    gx, gy, gz, vertexCount);
+                    count.bytesRead += vertexCount * pointBytes;
+                    count.bytesWritten += vertexCount * pointBytes;
+                }
+                // 多个整体偏移按 adjustVerticesByRegion 的顺序依次应用
+                for (size_t o = 0; o < offsetCount; ++o) {
+                    const array<double, 3>& offset = offsets->second[o];
+                    for (size_t k = 0; k < vertexCount; ++k) {
+                        gx[k] = static_cast<Scalar>(gx[k] - offset[0]);
+                        gy[k] = static_cast<Scalar>(gy[k] - offset[1]);
+                        gz[k] = static_cast<Scalar>(gz[k] - offset[2]);
+                    }
+                    count.bytesRead += vertexCount * pointBytes;
+                    count.bytesWritten += vertexCount * pointBytes;
+                }
+                subtractPoints(bx, by, bz, gx, gy, gz, gx, gy, gz, vertexCount);
+                count.bytesRead += 2 * vertexCount * pointBytes;
+                count.bytesWritten += vertexCount * pointBytes;
+            });
+
+            PipelineTraffic total;
+            for (const vector<PipelineTraffic>* group : {&counted, &pairCounted}) {
+                for (const PipelineTraffic& part : *group) {
+                    total.bytesRead += part.bytesRead;
+                    total.bytesWritten += part.bytesWritten;
+                    total.transientBytes += part.transientBytes;
+                }
+            }
+            span.setArg("bytesRead", static_cast<int64_t>(total.bytesRead));
+            span.setArg("bytesWritten", static_cast<int64_t>(total.bytesWritten));
+            if (traffic) {
+                *traffic = total;
+            }
+            return result;
+        }
+
+    }
+
+    const char* geometryPrecisionName(GeometryPrecision precision) {
+        return precision == GeometryPrecision::Float ? "float" : "double";
+    }
+
+    BlendShapePipeline::BlendShapePipeline(const PipelineOptions& options) : mOptions(options) {}
+
+    bool BlendShapePipeline::checkpoint(const char* stage, double start, double end, size_t steps) const {
+        if (!mProgress) {
+            return true;
+        }
+        if (mProgress->cancelled()) {
+            logWarning(string("Cancelled before stage: ") + stage);
+            return false;
+        }
+        mProgress->beginStage(stage, start, end, steps);
+        return true;
+    }
+
+    bool BlendShapePipeline::prepare(const vector<string>& fbxFiles, const string& weightJsonPath, PipelineResult& result) {
+        TraceSpan span("prepare");
+        result = PipelineResult();
+        if (fbxFiles.size() < 2) {
+            logError("Need at least two FBX files to process");
+            return false;
+        }
+
+        if (!checkpoint("load", 0.0, 0.5, fbxFiles.size())) {
+            return false;
+        }
+        vector<size_t> sources;
+        vector<MeshSet> fbxData = loadFbxFiles(fbxFiles, 1, &sources);
+        if (fbxData.size() < 2) {
+            logError("Need at least two readable FBX files to process");
+            return false;
+        }
+
+        if (!checkpoint("transfer", 0.5, 0.55)) {
+            return false;
+        }
+        if (mOptions.surfaceTransfer) {
+            transferMismatchedTopology(fbxData);
+        }
+
+        if (!checkpoint("register", 0.55, 0.6)) {
+            return false;
+        }
+
+        if (mOptions.precision == GeometryPrecision::Float && !mOptions.fusedEvaluation) {
+            logWarning("Float precision requires fused evaluation, using double");
+        }
+
+        if (mOptions.fusedEvaluation && mOptions.precision == GeometryPrecision::Float) {
+            // 配准在 double 上求解，之后目标模型逐个转换为 float 并释放 double 副本
+            result.precision = GeometryPrecision::Float;
+            result.transforms = solveHeadTransforms(fbxData);
+            if (!checkpoint("weights", 0.6, 0.62)) {
+                return false;
+            }
+            result.weights = loadRegionWeights(weightJsonPath, mOptions.weightCachePath);
+            if (!checkpoint("evaluate", 0.62, kPrepareProgressEnd)) {
+                return false;
+            }
+            const MeshSetF baseF(fbxData[0]);
+            vector<MeshSetF> targetsF;
+            targetsF.reserve(fbxData.size() - 1);
+            for (size_t i = 1; i < fbxData.size(); ++i) {
+                targetsF.emplace_back(fbxData[i]);
+                fbxData[i] = MeshSet();
+            }
+            vector<const MeshSetF*> targets;
+            for (const MeshSetF& target : targetsF) {
+                targets.push_back(&target);
+            }
+            result.floatGaps = evaluateGaps(baseF, targets, result.transforms, result.weights, &result.traffic);
+            result.base = std::move(fbxData[0]);
+        } else if (mOptions.fusedEvaluation) {
+            result.transforms = solveHeadTransforms(fbxData);
+            if (!checkpoint("weights", 0.6, 0.62)) {
+                return false;
+            }
+            result.weights = loadRegionWeights(weightJsonPath, mOptions.weightCachePath);
+            if (!checkpoint("evaluate", 0.62, kPrepareProgressEnd)) {
+                return false;
+            }
+            result.gaps = evaluateGaps(fbxData, result.transforms, result.weights, &result.traffic);
+            result.base = std::move(fbxData[0]);
+        } else {
+            PipelineTraffic& traffic = result.traffic;
+            result.transforms = registerHeads(fbxData);
+            for (size_t i = 1; i < fbxData.size(); ++i) {
+                traffic.bytesRead += fbxData[i].vertexCount() * kPointBytes;
+                traffic.bytesWritten += fbxData[i].vertexCount() * kPointBytes;
+            }
+            if (!checkpoint("weights", 0.6, 0.62)) {
+                return false;
+            }
+            result.weights = loadRegionWeights(weightJsonPath, mOptions.weightCachePath);
+
+            if (!checkpoint("align", 0.62, 0.7)) {
+                return false;
+            }
+            vector<MeshSet> alignedData;
+            if (!result.weights.empty()) {
+                logInfo("Aligning facial features based on region centers...");
+                alignedData = alignRegionsByCenter(fbxData, result.weights);
+                if (fbxData.size() >= 3) {
+                    // 对齐前整体复制一份
+                    for (const MeshSet& meshes : fbxData) {
+                        traffic.bytesRead += meshes.vertexCount() * kPointBytes;
+                        traffic.bytesWritten += meshes.vertexCount() * kPointBytes;
+                        traffic.transientBytes += meshes.vertexCount() * kPointBytes;
+                    }
+                }
+            } else {
+                alignedData = std::move(fbxData);
+            }
+
+            if (!checkpoint("evaluate", 0.7, kPrepareProgressEnd)) {
+                return false;
+            }
+            result.gaps = getMeshGap(alignedData);
+            for (const MeshSet& gap : result.gaps) {
+                traffic.bytesRead += 2 * gap.vertexCount() * kPointBytes;
+                traffic.bytesWritten += gap.vertexCount() * kPointBytes;
+                traffic.transientBytes += gap.vertexCount() * kPointBytes;
+            }
+            result.base = std::move(alignedData[0]);
+        }
+        if (mOptions.lodPropagation) {
+            result.lods = loadLodTransfers(fbxFiles[sources[0]], mOptions.workerCount);
+        }
+        if (!checkpoint("prepared", kPrepareProgressEnd, kPrepareProgressEnd)) {
+            return false;
+        }
+
+        logInfo(string("Memory traffic (") + (mOptions.fusedEvaluation ? "fused, " : "staged, ") + geometryPrecisionName(result.precision) + "): read "
+                + formatMegabytes(result.traffic.bytesRead)
+                + ", written " + formatMegabytes(result.traffic.bytesWritten) + ", transient " + formatMegabytes(result.traffic.transientBytes));
+        return true;
+    }
+
+    vector<BatchResult> BlendShapePipeline::prepareBatch(const vector<string>& baseFiles, const vector<string>& targetFiles, const string& weightJsonPath) {
+        TraceSpan span("prepareBatch");
+        span.setArg("bases", static_cast<int64_t>(baseFiles.size()));
+        span.setArg("targets", static_cast<int64_t>(targetFiles.size()));
+        vector<BatchResult> results(baseFiles.size());
+        if (baseFiles.empty() || targetFiles.empty()) {
+            logError("Need at least one base and one target FBX file to process");
+            return results;
+        }
+
+        // 底模与目标合并去重，底模在前，每个文件只读取一次
+        vector<string> files;
+        map<string, size_t> fileIndex;
+        auto addFile = [&](const string& path) {
+            auto inserted = fileIndex.emplace(path, files.size());
+            if (inserted.second) {
+                files.push_back(path);
+            }
+            return inserted.first->second;
+        };
+        vector<size_t> baseIndex;
+        for (size_t b = 0; b < baseFiles.size(); ++b) {
+            results[b].baseFile = baseFiles[b];
+            baseIndex.push_back(addFile(baseFiles[b]));
+        }
+        const size_t baseCount = files.size();
+        vector<size_t> targetIndex;
+        for (const string& target : targetFiles) {
+            targetIndex.push_back(addFile(target));
+        }
+
+        if (!checkpoint("load", 0.0, 0.5, files.size())) {
+            return results;
+        }
+        vector<size_t> sources;
+        vector<MeshSet> loaded = loadFbxFiles(files, baseCount, &sources);
+        vector<int> slotOf(files.size(), -1);
+        for (size_t k = 0; k < sources.size(); ++k) {
+            slotOf[sources[k]] = static_cast<int>(k);
+        }
+        if (!checkpoint("weights", 0.5, 0.55)) {
+            return results;
+        }
+        const RegionWeightMap weights = loadRegionWeights(weightJsonPath, mOptions.weightCachePath);
+
+        // 单精度模式下所有读取的模型各转换一次 float 副本，在各底模之间共享；double 数据仍用于配准与拓扑转移
+        const bool useFloat = mOptions.precision == GeometryPrecision::Float;
+        vector<MeshSetF> loadedF;
+        if (useFloat) {
+            loadedF.reserve(loaded.size());
+            for (const MeshSet& meshes : loaded) {
+                loadedF.emplace_back(meshes);
+            }
+        }
+
+        // 各底模并行求解；目标几何只读共享，只有需要拓扑转移的目标按底模复制一份。
+        // 多个底模时并行度来自底模之间，单个底模内部的求差不再另开线程
+        const unsigned innerWorkers = baseFiles.size() > 1 ? 1u : mOptions.workerCount;
+        if (!checkpoint("prepareBases", 0.55, kPrepareProgressEnd, baseFiles.size())) {
+            return results;
+        }
+        vector<vector<pair<LogLevel, string>>> logs(baseFiles.size());
+        auto prepareBase = [&](size_t b) {
+            ThreadLogBuffer buffer;
+            TraceSpan baseSpan("prepareBase", baseFiles[b]);
+            BatchResult& entry = results[b];
+            const int baseSlot = slotOf[baseIndex[b]];
+            if (baseSlot < 0) {
+                logError("Cannot use base " + baseFiles[b] + ": the file could not be read");
+                logs[b] = buffer.messages();
+                return;
+            }
+
+            const MeshSet& base = loaded[baseSlot];
+            deque<MeshSet> transferred;
+            deque<MeshSetF> transferredF;
+            vector<const MeshSet*> targets;
+            vector<const MeshSetF*> targetsF;
+            for (size_t t = 0; t < targetFiles.size(); ++t) {
+                const int slot = slotOf[targetIndex[t]];
+                if (targetIndex[t] == baseIndex[b] || slot < 0) {
+                    continue;
+                }
+                const MeshSet* target = &loaded[slot];
+                const MeshSetF* targetF = useFloat ? &loadedF[slot] : nullptr;
+                if (mOptions.surfaceTransfer && hasMismatchedMeshes(base, *target)) {
+                    transferred.push_back(*target);
+                    transferMismatchedTopology(base, transferred.back(), targets.size() + 1);
+                    target = &transferred.back();
+                    if (useFloat) {
+                        transferredF.emplace_back(*target);
+                        targetF = &transferredF.back();
+                    }
+                }
+                targets.push_back(target);
+                targetsF.push_back(targetF);
+            }
+            if (targets.empty()) {
+                logError("Need at least one readable target besides " + baseFiles[b]);
+                logs[b] = buffer.messages();
+                return;
+            }
+
+            entry.result.transforms = solveHeadTransforms(base, targets);
+            entry.result.weights = weights;
+            if (useFloat) {
+                entry.result.precision = GeometryPrecision::Float;
+                entry.result.floatGaps = evaluateGapsOf(loadedF[baseSlot], targetsF, entry.result.transforms, weights, &entry.result.traffic, innerWorkers);
+            } else {
+                entry.result.gaps = evaluateGapsOf(base, targets, entry.result.transforms, weights, &entry.result.traffic, innerWorkers);
+            }
+            entry.result.base = base;
+            if (mOptions.lodPropagation) {
+                entry.result.lods = loadLodTransfers(baseFiles[b], innerWorkers);
+            }
+            entry.prepared = true;
+            baseSpan.setArg("targets", static_cast<int64_t>(targets.size()));
+            logInfo(string("Memory traffic (fused, ") + geometryPrecisionName(entry.result.precision) + "): read "
+                    + formatMegabytes(entry.result.traffic.bytesRead) + ", written "
+                    + formatMegabytes(entry.result.traffic.bytesWritten) + ", transient " + formatMegabytes(entry.result.traffic.transientBytes));
+            logs[b] = buffer.messages();
+        };
+        // 取消时尚未开始的底模不再处理，已开始的底模完成后丢弃
+        parallelFor(baseFiles.size(), mOptions.workerCount, [&](size_t b) {
+            if (mProgress && mProgress->cancelled()) {
+                return;
+            }
+            prepareBase(b);
+            if (mProgress) {
+                mProgress->advance();
+            }
+        });
+
+        if (mProgress && mProgress->cancelled()) {
+            logWarning("Cancelled while preparing bases");
+            for (BatchResult& entry : results) {
+                entry.prepared = false;
+                entry.result = PipelineResult();
+            }
+            return results;
+        }
+        for (size_t b = 0; b < baseFiles.size(); ++b) {
+            logInfo("Base " + to_string(b + 1) + "/" + to_string(baseFiles.size()) + ": " + baseFiles[b]);
+            ThreadLogBuffer::replay(logs[b]);
+        }
+        return results;
+    }
+
+    BlendShapeBuildStats BlendShapePipeline::build(const PipelineResult& result, BlendShapeHost& host) const {
+        TraceSpan span("buildBlendShapes");
+        auto buildInto = [&](BlendShapeHost& target) {
+            if (result.precision == GeometryPrecision::Float) {
+                return buildBlendShapes(result.weights, result.floatGaps, mOptions.channelSuffixes, mOptions.deltaEpsilon, target);
+            }
+            return buildBlendShapes(result.weights, result.gaps, mOptions.channelSuffixes, mOptions.deltaEpsilon, target);
+        };
+        if (!result.lods || result.lods->empty()) {
+            return buildInto(host);
+        }
+
+        LodPropagationHost lodHost(host, *result.lods, mOptions.deltaEpsilon, mOptions.workerCount);
+        BlendShapeBuildStats stats = buildInto(lodHost);
+        const LodPropagationStats& lodStats = lodHost.stats();
+        stats.lodMeshes = lodStats.meshes;
+        stats.lodChannels = lodStats.channels;
+        stats.lodPoints = lodStats.points;
+        logInfo("Propagated " + to_string(lodStats.channels) + " channels to " + to_string(lodStats.meshes) + " LOD meshes ("
+                + to_string(lodStats.prunedChannels) + " pruned, " + to_string(lodStats.skippedMeshes) + " meshes skipped)");
+        return stats;
+    }
+
+    shared_ptr<const LodTransferSet> BlendShapePipeline::loadLodTransfers(const string& baseFile, unsigned workerCount) const {
+        TraceSpan span("lodTransfers", baseFile);
+        auto lods = make_shared<LodTransferSet>();
+        string error;
+        if (!LodTransferCache(mOptions.lodTransferDir).load(baseFile, workerCount, *lods, error)) {
+            logWarning("LOD propagation disabled: " + error);
+            return nullptr;
+        }
+        if (lods->empty()) {
+            logWarning("LOD propagation disabled: no LOD meshes in " + baseFile);
+            return nullptr;
+        }
+        logInfo("Loaded " + to_string(lods->transfers.size()) + " LOD transfer maps (" + to_string(lods->cached) + " cached, "
+                + to_string(lods->built) + " built)");
+        return lods;
+    }
+
+    bool BlendShapePipeline::run(const vector<string>& fbxFiles, const string& weightJsonPath, BlendShapeHost& host, BlendShapeBuildStats* stats) {
+        PipelineResult result;
+        if (!prepare(fbxFiles, weightJsonPath, result)) {
+            return false;
+        }
+        BlendShapeBuildStats buildStats = build(result, host);
+        if (stats) {
+            *stats = buildStats;
+        }
+        return true;
+    }
+
+    bool BlendShapePipeline::readNativeMeshVertices(const string& fbxPath, unsigned workerCount, MeshSet& meshData, string& error,
+                                                    vector<uint64_t>* topology, vector<string>* warnings) {
+        TraceSpan span("extractVertices", fbxPath);
+        FbxBinaryReader reader;
+        map<string, FbxMeshArrays> meshes;
+        if (!reader.open(fbxPath) || !reader.readMeshes({}, topology != nullptr, meshes, workerCount)) {
+            error = reader.lastError();
+            return false;
+        }
+        if (warnings) {
+            for (const string& warning : reader.warnings()) {
+                warnings->push_back(warning + " in " + fbxPath);
+            }
+        }
+
+        size_t totalVertices = 0;
+        for (const auto& [meshName, arrays] : meshes) {
+            totalVertices += arrays.vertices.size() / 3;
+        }
+
+        meshData.reserve(meshes.size(), totalVertices);
+        if (topology) {
+            topology->clear();
+        }
+        for (const auto& [meshName, arrays] : meshes) {
+            size_t slot = meshData.addMesh(meshName, arrays.vertices.size() / 3);
+            meshData.setInterleaved(slot, arrays.vertices.data());
+            if (topology) {
+                topology->push_back(GeometryCache::topologyFingerprint(arrays.polygonVertexIndex.data(), arrays.polygonVertexIndex.size()));
+            }
+        }
+        span.setArg("meshes", static_cast<int64_t>(meshes.size()));
+        span.setArg("vertices", static_cast<int64_t>(totalVertices));
+        return true;
+    }
+
+    vector<MeshSet> BlendShapePipeline::loadFbxFiles(const vector<string>& fbxFiles, size_t baseCount, vector<size_t>* loadedIndices) {
+        TraceSpan span("loadFbxFiles");
+        auto totalStart = Clock::now();
+
+        vector<MeshSet> loaded(fbxFiles.size());
+        vector<double> fileMs(fbxFiles.size(), 0.0);
+        vector<string> errors(fbxFiles.size());
+        vector<string> warnings(fbxFiles.size());
+        vector<char> fromCache(fbxFiles.size(), 0);
+        vector<char> fromSession(fbxFiles.size(), 0);
+
+        // 内容未变的文件直接从几何缓存读取
+        unique_ptr<GeometryCache> cache;
+        if (!mOptions.geometryCacheDir.empty()) {
+            cache = make_unique<GeometryCache>(mOptions.geometryCacheDir, mOptions.geometryCacheBudget);
+        }
+
+        // 二进制FBX优先走原生读取器，失败或非二进制文件再交给回退读取器（如 FBX SDK）
+        auto loadOne = [&](size_t i, unsigned arrayWorkers) {
+            TraceSpan fileSpan("importFile", fbxFiles[i]);
+            auto start = Clock::now();
+            bool done = false;
+            GeometryCacheKey key;
+            vector<uint64_t> topology;
+            // 会话缓存的条目以读取前的文件状态为准，读取期间文件被修改时下次查找即失效
+            FileStamp stamp;
+            if (mSessionCache) {
+                readFileStamp(fbxFiles[i], stamp);
+                if (shared_ptr<MeshSet> cached = mSessionCache->find<MeshSet>(fbxFiles[i])) {
+                    loaded[i] = *cached;
+                    done = true;
+                    fromSession[i] = 1;
+                }
+            }
+            if (!done && cache && cache->lookup(fbxFiles[i], key, loaded[i])) {
+                done = true;
+                fromCache[i] = 1;
+            }
+            if (!done && mOptions.useNativeReader && FbxBinaryReader::isBinaryFbx(fbxFiles[i])) {
+                string error;
+                vector<string> readerWarnings;
+                done = readNativeMeshVertices(fbxFiles[i], arrayWorkers, loaded[i], error, cache ? &topology : nullptr, &readerWarnings);
+                if (!done) {
+                    warnings[i] = "Native FBX reader failed for " + fbxFiles[i] + ": " + error;
+                    loaded[i].clear();
+                    topology.clear();
+                }
+                for (const string& warning : readerWarnings) {
+                    warnings[i] += (warnings[i].empty() ? "" : "\n") + warning;
+                }
+            }
+            if (!done) {
+                if (mFallbackLoader) {
+                    done = mFallbackLoader(fbxFiles[i], loaded[i], errors[i]);
+                } else if (errors[i].empty()) {
+                    errors[i] = "Cannot read " + fbxFiles[i] + ": not a readable binary FBX file";
+                }
+            }
+            string cacheError;
+            if (done && !fromCache[i] && !fromSession[i] && key.valid && !loaded[i].empty() && !cache->store(key, loaded[i], topology, cacheError)) {
+                warnings[i] += (warnings[i].empty() ? "" : "\n") + cacheError;
+            }
+            if (done && mSessionCache && !fromSession[i] && !loaded[i].empty()) {
+                mSessionCache->insert(fbxFiles[i], stamp, make_shared<MeshSet>(loaded[i]), loaded[i].coordinateBytes());
+            }
+            fileMs[i] = elapsedMs(start);
+            if (mProgress) {
+                mProgress->advance();
+            }
+            if (fileSpan.active()) {
+                fileSpan.setArg("fromCache", fromCache[i]);
+                fileSpan.setArg("fromSession", fromSession[i]);
+                error_code sizeError;
+                uintmax_t bytes = filesystem::file_size(fbxFiles[i], sizeError);
+                fileSpan.setArg("bytes", sizeError ? 0 : static_cast<int64_t>(bytes));
+                fileSpan.setArg("vertices", static_cast<int64_t>(loaded[i].vertexCount()));
+            }
+        };
+
+        unsigned workers = resolveWorkerCount(mOptions.workerCount, fbxFiles.size());
+        if (workers == 1) {
+            for (size_t i = 0; i < fbxFiles.size(); ++i) {
+                logInfo("Processing FBX file: " + fbxFiles[i]);
+                loadOne(i, mOptions.workerCount);
+            }
+        } else {
+            logInfo("Importing " + to_string(fbxFiles.size()) + " FBX files with " + to_string(workers) + " workers");
+            parallelFor(fbxFiles.size(), workers, [&](size_t i) {
+                loadOne(i, 1);
+            });
+        }
+
+        // 日志只在调用线程上输出（MGlobal 只能在主线程调用），导入结束后统一输出
+        vector<MeshSet> fbxData;
+        vector<size_t> sources;
+        for (size_t i = 0; i < fbxFiles.size(); ++i) {
+            if (!warnings[i].empty()) {
+                logWarning(warnings[i]);
+            }
+            if (!errors[i].empty()) {
+                logError(errors[i]);
+                continue;
+            }
+            logInfo("Imported " + fbxFiles[i] + ": " + to_string(loaded[i].meshCount()) + " meshes in " + formatNumber(fileMs[i]) + " ms"
+                    + (fromSession[i] ? " (session cache)" : fromCache[i] ? " (geometry cache)" : ""));
+            if (!loaded[i].empty()) {
+                fbxData.push_back(std::move(loaded[i]));
+                sources.push_back(i);
+            }
+        }
+
+        // 与任一底模顶点数不同的网格需要三角形拓扑做最近点转移，只读取这些网格的多边形索引
+        const size_t loadedBases = max<size_t>(1, count_if(sources.begin(), sources.end(), [&](size_t i) { return i < baseCount; }));
+        for (size_t i = loadedBases; mOptions.surfaceTransfer && i < fbxData.size(); ++i) {
+            MeshSet& meshes = fbxData[i];
+            const string& path = fbxFiles[sources[i]];
+            vector<string> names;
+            for (size_t slot = 0; slot < meshes.meshCount(); ++slot) {
+                for (size_t b = 0; b < loadedBases && !meshes.topology(slot); ++b) {
+                    int baseSlot = fbxData[b].find(meshes.nameId(slot));
+                    if (baseSlot >= 0 && fbxData[b].vertexCount(baseSlot) != meshes.vertexCount(slot)) {
+                        names.push_back(meshes.name(slot));
+                        break;
+                    }
+                }
+            }
+            if (names.empty()) {
+                continue;
+            }
+            string error;
+            if (!FbxBinaryReader::isBinaryFbx(path)) {
+                logWarning("Cannot read polygons of " + path + ": not a binary FBX file");
+            } else if (!readTriangleTopology(path, names, mOptions.workerCount, meshes, error)) {
+                logWarning("Cannot read polygons of " + path + ": " + error);
+            }
+        }
+        if (loadedIndices) {
+            *loadedIndices = std::move(sources);
+        }
+
+        if (cache) {
+            string error;
+            if (!cache->flush(error)) {
+                logWarning(error);
+            }
+            GeometryCacheStats stats = cache->stats();
+            logInfo("Geometry cache: " + to_string(stats.hits) + " hits (" + to_string(stats.precheckHits) + " without rehashing), "
+                    + to_string(stats.misses) + " misses, " + to_string(stats.evictions) + " evicted; " + to_string(stats.entryCount) + " entries, "
+                    + formatMegabytes(stats.totalBytes) + " of " + formatMegabytes(stats.budgetBytes) + " in " + cache->directory());
+        }
+
+        logInfo("FBX import finished in " + formatNumber(elapsedMs(totalStart)) + " ms");
+        return fbxData;
+    }
+
+    size_t BlendShapePipeline::transferMismatchedTopology(vector<MeshSet>& meshes) const {
+        size_t transferred = 0;
+        for (size_t i = 1; i < meshes.size(); ++i) {
+            transferred += transferMismatchedTopology(meshes[0], meshes[i], i);
+        }
+        return transferred;
+    }
+
+    bool BlendShapePipeline::hasMismatchedMeshes(const MeshSet& base, const MeshSet& target) {
+        for (size_t slot = 0; slot < target.meshCount(); ++slot) {
+            int baseSlot = base.find(target.nameId(slot));
+            if (baseSlot >= 0 && base.vertexCount(baseSlot) != target.vertexCount(slot)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    size_t BlendShapePipeline::transferMismatchedTopology(const MeshSet& base, MeshSet& target, size_t i) const {
+        if (!hasMismatchedMeshes(base, target)) {
+            return 0;
+        }
+
+        TraceSpan span("surfaceTransfer");
+        const MeshNameId headName = internMeshName("head_lod0_mesh");
+        const int baseHead = base.find(headName);
+        SurfaceMappingCache& cache = SurfaceMappingCache::shared();
+        size_t transferred = 0;
+        size_t cacheHits = 0;
+
+        vector<MeshNameId> mismatched;
+        for (size_t slot = 0; slot < target.meshCount(); ++slot) {
+            int baseSlot = base.find(target.nameId(slot));
+            if (baseSlot >= 0 && base.vertexCount(baseSlot) != target.vertexCount(slot)) {
+                mismatched.push_back(target.nameId(slot));
+            }
+        }
+
+        // 目标到底模的粗配准，用于把底模顶点变换到目标坐标系中再投影
+        SimilarityTransform transform;
+        transform.matrix = {{{1.0, 0.0, 0.0, 0.0}, {0.0, 1.0, 0.0, 0.0}, {0.0, 0.0, 1.0, 0.0}, {0.0, 0.0, 0.0, 1.0}}};
+        const int head = target.find(headName);
+        if (baseHead >= 0 && head >= 0) {
+            PointSpan basePoints = {base.x(baseHead), base.y(baseHead), base.z(baseHead), base.vertexCount(baseHead)};
+            PointSpan targetPoints = {target.x(head), target.y(head), target.z(head), target.vertexCount(head)};
+            const MeshTopology* topology = target.topology(head);
+            if (basePoints.count == targetPoints.count) {
+                transform = solveSimilarity(targetPoints, basePoints, mOptions.similarity);
+            } else if (topology) {
+                SurfaceMappingKey key = {headName, meshContentHash(base, baseHead), topology->fingerprint};
+                shared_ptr<const SurfaceMapping> mapping = cache.find(key);
+                if (mapping) {
+                    // 已知对应关系，一次求解即可
+                    vector<double> matched(3 * basePoints.count);
+                    interpolateSurface(*mapping, targetPoints, matched.data(), matched.data() + basePoints.count, matched.data() + 2 * basePoints.count);
+                    PointSpan matchedPoints = {matched.data(), matched.data() + basePoints.count, matched.data() + 2 * basePoints.count, basePoints.count};
+                    transform = solveSimilarity(matchedPoints, basePoints, mOptions.similarity);
+                } else {
+                    TraceSpan icpSpan("registerToSurface");
+                    auto start = Clock::now();
+                    TriangleBvh bvh(targetPoints, topology->triangles);
+                    auto solved = make_shared<SurfaceMapping>();
+                    transform = registerToSurface(basePoints, bvh, SurfaceRegistrationOptions(), mOptions.workerCount, solved.get());
+                    if (transform.valid && solved->size() == basePoints.count) {
+                        cache.insert(key, solved);
+                    }
+                    logInfo("Surface registration of model " + to_string(i) + ": scale " + formatNumber(transform.scale, 6) + " rms "
+                            + formatNumber(solved->rmsDistance, 6) + " (" + formatNumber(elapsedMs(start)) + " ms)");
+                }
+            }
+        }
+        array<array<double, 4>, 4> inverse;
+        if (!transform.valid || !invertAffine(transform.matrix, inverse)) {
+            logWarning("Cannot register model " + to_string(i) + " for surface transfer, projecting without transform");
+            inverse = {{{1.0, 0.0, 0.0, 0.0}, {0.0, 1.0, 0.0, 0.0}, {0.0, 0.0, 1.0, 0.0}, {0.0, 0.0, 0.0, 1.0}}};
+        }
+
+        for (MeshNameId name : mismatched) {
+            // 替换网格会压缩缓冲，序号每次重新查找
+            const int slot = target.find(name);
+            const int baseSlot = base.find(name);
+            const MeshTopology* topology = target.topology(slot);
+            const size_t baseCount = base.vertexCount(baseSlot);
+            const size_t targetCount = target.vertexCount(slot);
+            if (!topology || topology->triangles.empty()) {
+                logWarning("Skipping " + meshNameOf(name) + " of model " + to_string(i) + ": " + to_string(targetCount)
+                           + " vertices, base has " + to_string(baseCount) + " and no polygons are available");
+                continue;
+            }
+
+            auto start = Clock::now();
+            SurfaceMappingKey key = {name, meshContentHash(base, baseSlot), topology->fingerprint};
+            shared_ptr<const SurfaceMapping> mapping = cache.find(key);
+            const bool cached = mapping != nullptr;
+            PointSpan targetPoints = {target.x(slot), target.y(slot), target.z(slot), targetCount};
+            if (!mapping) {
+                vector<double> query(3 * baseCount);
+                transformPoints(inverse, base.x(baseSlot), base.y(baseSlot), base.z(baseSlot),
+                                query.data(), query.data() + baseCount, query.data() + 2 * baseCount, baseCount);
+                PointSpan queryPoints = {query.data(), query.data() + baseCount, query.data() + 2 * baseCount, baseCount};
+                TriangleBvh bvh(targetPoints, topology->triangles);
+                mapping = make_shared<SurfaceMapping>(projectToSurface(bvh, queryPoints, mOptions.workerCount));
+                cache.insert(key, mapping);
+            } else {
+                ++cacheHits;
+            }
+
+            vector<double> resampled(3 * baseCount);
+            interpolateSurface(*mapping, targetPoints, resampled.data(), resampled.data() + baseCount, resampled.data() + 2 * baseCount);
+            size_t newSlot = target.addMesh(name, baseCount);
+            copy(resampled.begin(), resampled.begin() + baseCount, target.x(newSlot));
+            copy(resampled.begin() + baseCount, resampled.begin() + 2 * baseCount, target.y(newSlot));
+            copy(resampled.begin() + 2 * baseCount, resampled.end(), target.z(newSlot));
+            ++transferred;
+            logInfo("Surface transfer " + meshNameOf(name) + " of model " + to_string(i) + ": " + to_string(targetCount) + " -> "
+                    + to_string(baseCount) + " vertices, rms distance " + formatNumber(mapping->rmsDistance, 6) + ", max "
+                    + formatNumber(mapping->maxDistance, 6) + (cached ? " (cached mapping)" : "") + " (" + formatNumber(elapsedMs(start)) + " ms)");
+        }
+
+        span.setArg("meshes", static_cast<int64_t>(transferred));
+        span.setArg("cacheHits", static_cast<int64_t>(cacheHits));
+        return transferred;
+    }
+
+    vector<SimilarityTransform> BlendShapePipeline::solveHeadTransforms(const vector<MeshSet>& meshes) const {
+        if (meshes.empty()) {
+            return {};
+        }
+        return solveHeadTransforms(meshes[0], targetsOf(meshes));
+    }
+
+    vector<SimilarityTransform> BlendShapePipeline::solveHeadTransforms(const MeshSet& base, const vector<const MeshSet*>& targets) const {
+        const MeshNameId headName = internMeshName("head_lod0_mesh");
+        const array<array<double, 4>, 4> identity = {{{1.0, 0.0, 0.0, 0.0}, {0.0, 1.0, 0.0, 0.0}, {0.0, 0.0, 1.0, 0.0}, {0.0, 0.0, 0.0, 1.0}}};
+
+        vector<SimilarityTransform> transforms;
+        int baseHead = base.find(headName);
+        for (size_t i = 1; i <= targets.size(); ++i) {
+            logInfo("Computing transform for model " + to_string(i));
+            SimilarityTransform transform;
+            transform.matrix = identity;
+
+            int head = targets[i - 1]->find(headName);
+            if (baseHead < 0 || head < 0) {
+                logWarning("head_lod0_mesh not found, skipping registration");
+                transforms.push_back(transform);
+                continue;
+            }
+
+            const MeshSet& source = base;
+            const MeshSet& target = *targets[i - 1];
+            const size_t sourceCount = source.vertexCount(baseHead);
+            const size_t targetCount = target.vertexCount(head);
+            logInfo("Computing transform with source points: " + to_string(sourceCount) + " target points: " + to_string(targetCount));
+            if (sourceCount != targetCount || sourceCount < 3) {
+                logWarning("Invalid points for transform computation");
+                transforms.push_back(transform);
+                continue;
+            }
+
+            // 使用全部对应顶点求解目标到基础模型的相似变换
+            TraceSpan solveSpan("solveSimilarity");
+            solveSpan.setArg("vertices", static_cast<int64_t>(sourceCount));
+            auto start = Clock::now();
+            PointSpan from = {target.x(head), target.y(head), target.z(head), targetCount};
+            PointSpan to = {source.x(baseHead), source.y(baseHead), source.z(baseHead), sourceCount};
+            SimilarityTransform solved = solveSimilarity(from, to, mOptions.similarity);
+            if (!solved.valid) {
+                logWarning("Degenerate points for transform computation, using identity");
+                transforms.push_back(transform);
+                continue;
+            }
+            logInfo("Registration scale: " + formatNumber(solved.scale, 6) + " rms: " + formatNumber(solved.rmsError, 6) + " (" + formatNumber(elapsedMs(start)) + " ms)");
+            transforms.push_back(solved);
+        }
+
+        for (size_t i = 0; i < transforms.size(); ++i) {
+            ostringstream msg;
+            msg << "Transform----------------------------- " << (i + 1) << ":\n";
+            for (const auto& row : transforms[i].matrix) {
+                for (double val : row) {
+                    msg << val << " ";
+                }
+                msg << "\n";
+            }
+            logInfo(msg.str());
+        }
+
+        return transforms;
+    }
+
+    vector<SimilarityTransform> BlendShapePipeline::registerHeads(vector<MeshSet>& meshes) const {
+        TraceSpan span("registerHeads");
+        vector<SimilarityTransform> transforms = solveHeadTransforms(meshes);
+
+        size_t transformedVertices = 0;
+        for (size_t i = 1; i < meshes.size(); ++i) {
+            // 同一角色的所有网格在 SoA 数组中连续存放，整体一次变换
+            MeshSet& target = meshes[i];
+            transformPoints(transforms[i - 1].matrix, target.xData(), target.yData(), target.zData(), target.vertexCount());
+            transformedVertices += target.vertexCount();
+        }
+        span.setArg("vertices", static_cast<int64_t>(transformedVertices));
+
+        return transforms;
+    }
+
+    array<double, 3> BlendShapePipeline::applyTransformation(const array<double, 3>& point, const array<array<double, 4>, 4>& transform) {
+        array<double, 3> result = {0.0, 0.0, 0.0};
+        for (int i = 0; i < 3; ++i) {
+            result[i] = transform[i][3];
+            for (int j = 0; j < 3; ++j) {
+                result[i] += transform[i][j] * point[j];
+            }
+        }
+        return result;
+    }
+
+    RegionWeightMap BlendShapePipeline::loadRegionWeights(const string& weightJsonPath, const string& cachePath) {
+        if (weightJsonPath.empty()) {
+            return RegionWeightMap();
+        }
+
+        TraceSpan span("loadRegionWeights", weightJsonPath);
+        RegionWeightMap weights;
+        RegionWeightLoadInfo info;
+        string error;
+        auto start = Clock::now();
+        if (!RegionWeightMap::load(weightJsonPath, weights, error, cachePath, &info)) {
+            logError(error);
+            return RegionWeightMap();
+        }
+
+        span.setArg("entries", static_cast<int64_t>(weights.totalNonZeroCount()));
+        span.setArg("fromCache", info.fromCache ? 1 : 0);
+        if (info.fromCache) {
+            logInfo("Weight cache hit: " + (cachePath.empty() ? RegionWeightMap::defaultCachePath(weightJsonPath) : cachePath) + " (" + formatNumber(elapsedMs(start)) + " ms)");
+        } else {
+            logInfo("Weight JSON compiled: " + weightJsonPath + " (" + formatNumber(elapsedMs(start)) + " ms)");
+            if (!info.cacheWritten) {
+                logWarning(info.cacheMessage);
+            }
+        }
+        return weights;
+    }
+
+    vector<MeshSet> BlendShapePipeline::alignRegionsByCenter(const vector<MeshSet>& fbxData, const RegionWeightMap& weights) const {
+        if (fbxData.size() < 3) {
+            logWarning("Need at least two meshes to perform region alignment");
+            return fbxData;
+        }
+
+        TraceSpan span("alignRegions");
+        vector<MeshSet> result = fbxData;
+        const auto& baseMesh = result[0];
+
+        logInfo("Performing region-based alignment");
+
+        // 底模区域中心只计算一次，各目标共享
+        const HeadRegionCenters centers = computeHeadRegionCenters(baseMesh, weights);
+        vector<pair<MeshSet*, int>> targets;
+        size_t vertexCount = 0;
+        for (size_t i = 1; i < result.size(); ++i) {
+            targets.push_back({&result[i], result[i].find("head_lod0_mesh")});
+            vertexCount += result[i].vertexCount();
+        }
+        vector<map<string, array<double, 3>>> offsetMaps = alignHeadRegionsParallel(baseMesh, weights, centers, targets, mOptions.workerCount);
+        applyFollowerOffsets(targets, offsetMaps, mOptions.workerCount);
+        span.setArg("vertices", static_cast<int64_t>(vertexCount));
+
+        logInfo("Region alignment completed");
+        return result;
+    }
+
+    void BlendShapePipeline::adjustVerticesByRegion(const MeshSet& baseMesh, MeshSet& targetMesh, const RegionWeightMap& weights) const {
+        map<string, array<double, 3>> offsetMap = alignHeadRegions(baseMesh, targetMesh, targetMesh.find("head_lod0_mesh"), weights);
+        for (const auto& [subRegionName, offset] : offsetMap) {
+            auto followers = regionFollowerMeshes().find(subRegionName);
+            if (followers == regionFollowerMeshes().end()) {
+                continue;
+            }
+            for (const auto& modelName : followers->second) {
+                int slot = targetMesh.find(modelName);
+                if (slot < 0) {
+                    continue;
+                }
+                double* x = targetMesh.x(slot);
+                double* y = targetMesh.y(slot);
+                double* z = targetMesh.z(slot);
+                for (size_t i = 0; i < targetMesh.vertexCount(slot); ++i) {
+                    x[i] -= offset[0];
+                    y[i] -= offset[1];
+                    z[i] -= offset[2];
+                }
+            }
+        }
+    }
+
+    template <typename Scalar>
+    map<string, array<double, 3>> BlendShapePipeline::alignHeadRegions(const BasicMeshSet<Scalar>& baseMesh, BasicMeshSet<Scalar>& targetMesh, int targetSlot,
+                                                                       const RegionWeightMap& weights) {
+        if (targetSlot < 0) {
+            return {};
+        }
+        return alignHeadRegions(computeHeadRegionCenters(baseMesh, weights, targetMesh.vertexCount(targetSlot)), targetMesh, targetSlot);
+    }
+
+    template <typename Scalar>
+    map<string, array<double, 3>> BlendShapePipeline::alignHeadRegions(const HeadRegionCenters& base, BasicMeshSet<Scalar>& targetMesh, int targetSlot) {
+        // 子区域之间可能重叠，偏移量全部基于调整前的目标顶点计算，之后再统一应用
+        map<string, array<double, 3>> offsetMap;
+        if (targetSlot < 0) {
+            return offsetMap;
+        }
+        vector<array<double, 3>> offsets;
+        offsets.reserve(base.regions.size());
+        for (const HeadRegion& region : base.regions) {
+            array<double, 3> targetCenter = calculateRegionCenter(targetMesh, targetSlot, region.indices);
+            offsets.push_back({
+                targetCenter[0] - region.baseCenter[0],
+                targetCenter[1] - region.baseCenter[1],
+                targetCenter[2] - region.baseCenter[2]
+            });
+            offsetMap[region.name] = offsets.back();
+        }
+
+        Scalar* x = targetMesh.x(targetSlot);
+        Scalar* y = targetMesh.y(targetSlot);
+        Scalar* z = targetMesh.z(targetSlot);
+        for (size_t r = 0; r < base.regions.size(); ++r) {
+            const HeadRegion& region = base.regions[r];
+            for (size_t i = 0; i < region.indices.size(); ++i) {
+                uint32_t index = region.indices[i];
+                double weight = region.weights[i];
+                x[index] = static_cast<Scalar>(x[index] - offsets[r][0] * weight);
+                y[index] = static_cast<Scalar>(y[index] - offsets[r][1] * weight);
+                z[index] = static_cast<Scalar>(z[index] - offsets[r][2] * weight);
+            }
+        }
+        return offsetMap;
+    }
+
+    template <typename Scalar>
+    HeadRegionCenters BlendShapePipeline::computeHeadRegionCenters(const BasicMeshSet<Scalar>& baseMesh, const RegionWeightMap& weights, size_t vertexLimit) {
+        HeadRegionCenters centers;
+        const MeshNameId headName = internMeshName("head_lod0_mesh");
+        int headEntry = weights.findMesh(headName);
+        int baseSlot = baseMesh.find(headName);
+        if (headEntry < 0 || baseSlot < 0) {
+            return centers;
+        }
+
+        const WeightMesh& head = weights.mesh(headEntry);
+        centers.vertexLimit = min(vertexLimit, baseMesh.vertexCount(baseSlot));
+        for (uint32_t r = head.firstRegion; r < head.firstRegion + head.regionCount; ++r) {
+            HeadRegion region;
+            region.name = weights.region(r).regionName;
+            const uint32_t* indices = weights.indices(r);
+            const float* regionWeights = weights.weights(r);
+            for (size_t k = 0; k < weights.nonZeroCount(r); ++k) {
+                if (indices[k] < centers.vertexLimit) {
+                    region.indices.push_back(indices[k]);
+                    region.weights.push_back(regionWeights[k]);
+                }
+            }
+            if (region.indices.empty()) {
+                continue;
+            }
+            region.baseCenter = calculateRegionCenter(baseMesh, baseSlot, region.indices);
+            centers.regions.push_back(std::move(region));
+        }
+        return centers;
+    }
+
+    template <typename Scalar>
+    array<double, 3> BlendShapePipeline::calculateRegionCenter(const BasicMeshSet<Scalar>& meshes, size_t mesh, const vector<uint32_t>& indices) {
+        array<double, 3> center = {0.0, 0.0, 0.0};
+
+        if (indices.empty()) {
+            return center;
+        }
+
+        const Scalar* x = meshes.x(mesh);
+        const Scalar* y = meshes.y(mesh);
+        const Scalar* z = meshes.z(mesh);
+        for (uint32_t index : indices) {
+            center[0] += x[index];
+            center[1] += y[index];
+            center[2] += z[index];
+        }
+
+        for (int i = 0; i < 3; ++i) {
+            center[i] /= static_cast<double>(indices.size());
+        }
+
+        return center;
+    }
+
+    template map<string, array<double, 3>> BlendShapePipeline::alignHeadRegions(const MeshSet&, MeshSet&, int, const RegionWeightMap&);
+    template map<string, array<double, 3>> BlendShapePipeline::alignHeadRegions(const MeshSetF&, MeshSetF&, int, const RegionWeightMap&);
+    template map<string, array<double, 3>> BlendShapePipeline::alignHeadRegions(const HeadRegionCenters&, MeshSet&, int);
+    template map<string, array<double, 3>> BlendShapePipeline::alignHeadRegions(const HeadRegionCenters&, MeshSetF&, int);
+    template HeadRegionCenters BlendShapePipeline::computeHeadRegionCenters(const MeshSet&, const RegionWeightMap&, size_t);
+    template HeadRegionCenters BlendShapePipeline::computeHeadRegionCenters(const MeshSetF&, const RegionWeightMap&, size_t);
+    template array<double, 3> BlendShapePipeline::calculateRegionCenter(const MeshSet&, size_t, const vector<uint32_t>&);
+    template array<double, 3> BlendShapePipeline::calculateRegionCenter(const MeshSetF&, size_t, const vector<uint32_t>&);
+
+    vector<MeshSet> BlendShapePipeline::getMeshGap(const vector<MeshSet>& meshData) {
+        if (meshData.size() < 2) {
+            logWarning("Need at least two meshes to calculate gap");
+            return {};
+        }
+
+        TraceSpan span("meshGap");
+        vector<MeshSet> result;
+        result.reserve(meshData.size() - 1);
+
+        const auto& baseMesh = meshData[0];
+
+        for (size_t i = 1; i < meshData.size(); ++i) {
+            const auto& currentMesh = meshData[i];
+            MeshSet regionGap;
+            regionGap.reserve(baseMesh.meshCount(), baseMesh.vertexCount());
+
+            for (size_t baseSlot = 0; baseSlot < baseMesh.meshCount(); ++baseSlot) {
+                int currentSlot = currentMesh.find(baseMesh.nameId(baseSlot));
+                if (currentSlot < 0) {
+                    continue;
+                }
+
+                const size_t expectedSize = baseMesh.vertexCount(baseSlot);
+                if (currentMesh.vertexCount(currentSlot) != expectedSize) {
+                    logWarning("Skipping " + baseMesh.name(baseSlot) + " of model " + to_string(i) + ": " + to_string(currentMesh.vertexCount(currentSlot))
+                               + " vertices, base has " + to_string(expectedSize));
+                    continue;
+                }
+
+                size_t gapSlot = regionGap.addMesh(baseMesh.nameId(baseSlot), expectedSize);
+                subtractPoints(baseMesh.x(baseSlot), baseMesh.y(baseSlot), baseMesh.z(baseSlot),
+                               currentMesh.x(currentSlot), currentMesh.y(currentSlot), currentMesh.z(currentSlot),
+                               regionGap.x(gapSlot), regionGap.y(gapSlot), regionGap.z(gapSlot), expectedSize);
+            }
+
+            result.push_back(std::move(regionGap));
+        }
+        if (span.active()) {
+            size_t vertexCount = 0;
+            for (const MeshSet& gap : result) {
+                vertexCount += gap.vertexCount();
+            }
+            span.setArg("vertices", static_cast<int64_t>(vertexCount));
+        }
+
+        return result;
+    }
+
+    vector<MeshSet> BlendShapePipeline::evaluateGaps(const vector<MeshSet>& meshes, const vector<SimilarityTransform>& transforms,
+                                                     const RegionWeightMap& weights, PipelineTraffic* traffic) const {
+        if (meshes.size() < 2) {
+            logWarning("Need at least two meshes to calculate gap");
+            return {};
+        }
+        return evaluateGaps(meshes[0], targetsOf(meshes), transforms, weights, traffic);
+    }
+
+    vector<MeshSet> BlendShapePipeline::evaluateGaps(const MeshSet& baseMesh, const vector<const MeshSet*>& targets, const vector<SimilarityTransform>& transforms,
+                                                     const RegionWeightMap& weights, PipelineTraffic* traffic) const {
+        return evaluateGapsOf(baseMesh, targets, transforms, weights, traffic, mOptions.workerCount);
+    }
+
+    vector<MeshSetF> BlendShapePipeline::evaluateGaps(const MeshSetF& baseMesh, const vector<const MeshSetF*>& targets, const vector<SimilarityTransform>& transforms,
+                                                      const RegionWeightMap& weights, PipelineTraffic* traffic) const {
+        return evaluateGapsOf(baseMesh, targets, transforms, weights, traffic, mOptions.workerCount);
+    }
+
+}
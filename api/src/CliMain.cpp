@@ -0,0 +1,358 @@
+#include "BlendShapeJson.h"
+#include "BlendShapePipeline.h"
+#include "InterchangeFile.h"
+#include "Log.h"
+#include "Parallel.h"
+#include "Trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace cf;
+
+// characterfactory-cli：不启动 Maya，在命令行上运行与 characterfactoryfbxhandle 相同的流程，
+// 结果以JSON（见 BlendShapeJson.h）或二进制交换文件（见 InterchangeFile.h）写出
+
+namespace {
+
+    const char* kUsage =
+        "Usage: characterfactory-cli [options] <base.fbx> <target.fbx>...\n"
+        "       characterfactory-cli [options] -b <base.fbx> [-b <base.fbx>...] <target.fbx>...\n"
+        "\n"
+        "Options:\n"
+        "  -o, --output <path>            output file (required); with --base, the output directory\n"
+        "  -f, --format <json|cfx>        output format (default: cfx if the output ends in .cfx, else json);\n"
+        "                                 cfx is the memory-mappable binary interchange file holding the\n"
+        "                                 aligned base meshes, the channels and the region weights\n"
+        "  -b, --base <path>              batch mode: generate one <base name>.json (or .cfx) per base against all\n"
+        "                                 positional FBX files, which are then all targets; repeatable\n"
+        "  -j, --weights <path>           region weight JSON (skin_weights.json)\n"
+        "  -c, --weight-cache <path>      compiled weight cache file (default: next to the weight JSON)\n"
+        "  -g, --geometry-cache <dir>     cache extracted FBX geometry in this directory across runs\n"
+        "      --geometry-cache-budget <MB>  size limit of the geometry cache (default 1024)\n"
+        "  -l, --list <file>              read FBX paths from a file, one per line\n"
+        "  -w, --workers <n>              import worker threads, 0 = all cores (default 0)\n"
+        "  -r, --robust-iterations <n>    robust reweighting iterations for head registration (default 0)\n"
+        "  -e, --delta-epsilon <value>    drop target vertices whose delta is not above this (default 1e-6)\n"
+        "      --staged                   run registration, region alignment and gap as separate passes\n"
+        "      --precision <double|float>  storage and arithmetic precision of the fused gap pass (default double)\n"
+        "      --no-surface-transfer      skip meshes whose vertex count differs from the base instead of\n"
+        "                                 resampling them onto the base topology by closest-point projection\n"
+        "      --lods                     propagate the lod0 channels to the <name>_lod<N>_mesh meshes of the base\n"
+        "                                 through closest-triangle barycentric transfer maps\n"
+        "      --lod-cache <dir>          transfer map cache directory (default: CharacterFactory/lod in the\n"
+        "                                 system temp directory)\n"
+        "  -t, --trace <path>             write a Chrome trace JSON of the pipeline stages\n"
+        "  -q, --quiet                    only print warnings and errors\n"
+        "  -h, --help                     show this help\n"
+        "\n"
+        "FBX paths may also be given as one ';'-separated argument, as in the Maya command.\n";
+
+    void splitPaths(const string& text, vector<string>& paths) {
+        size_t start = 0;
+        while (start <= text.size()) {
+            size_t end = text.find(';', start);
+            if (end == string::npos) {
+                end = text.size();
+            }
+            if (end > start) {
+                paths.push_back(text.substr(start, end - start));
+            }
+            start = end + 1;
+        }
+    }
+
+    bool readListFile(const string& path, vector<string>& paths) {
+        ifstream file(path);
+        if (!file) {
+            return false;
+        }
+        string line;
+        while (getline(file, line)) {
+            while (!line.empty() && (line.back() == '\r' || line.back() == ' ' || line.back() == '\t')) {
+                line.pop_back();
+            }
+            if (!line.empty() && line[0] != '#') {
+                paths.push_back(line);
+            }
+        }
+        return true;
+    }
+
+    bool parseUnsigned(const char* text, unsigned& value) {
+        char* end = nullptr;
+        unsigned long parsed = strtoul(text, &end, 10);
+        if (*text == '\0' || *end != '\0' || text[0] == '-') {
+            return false;
+        }
+        value = static_cast<unsigned>(parsed);
+        return true;
+    }
+
+    bool parseDouble(const char* text, double& value) {
+        char* end = nullptr;
+        value = strtod(text, &end);
+        return *text != '\0' && *end == '\0';
+    }
+
+    int usageError(const string& message) {
+        fprintf(stderr, "characterfactory-cli: %s\n\n%s", message.c_str(), kUsage);
+        return 2;
+    }
+
+    enum class OutputFormat {
+        Json,
+        Interchange
+    };
+
+    // 生成通道并按 format 写出 result
+    bool writeResult(const BlendShapePipeline& pipeline, const PipelineResult& result, OutputFormat format, const string& path,
+                     BlendShapeBuildStats& stats, string& error) {
+        if (format == OutputFormat::Interchange) {
+            InterchangeWriter writer;
+            writer.addMeshSet("base", result.base);
+            writer.setWeights(result.weights);
+            stats = pipeline.build(result, writer);
+            return writer.save(path, error);
+        }
+        JsonBlendShapeHost host(result.base);
+        stats = pipeline.build(result, host);
+        return host.save(path, error);
+    }
+
+    int runPipeline(const PipelineOptions& options, const vector<string>& fbxFiles, const string& weightPath, const string& outputPath,
+                    OutputFormat format) {
+        auto start = chrono::steady_clock::now();
+        BlendShapePipeline pipeline(options);
+        PipelineResult result;
+        if (!pipeline.prepare(fbxFiles, weightPath, result)) {
+            return 1;
+        }
+
+        BlendShapeBuildStats stats;
+        string error;
+        if (!writeResult(pipeline, result, format, outputPath, stats, error)) {
+            logError(error);
+            return 1;
+        }
+
+        double elapsedMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        logInfo("Wrote " + to_string(stats.channels) + " channels (" + to_string(stats.prunedChannels) + " pruned, "
+                + to_string(stats.shapePoints) + " points) to " + outputPath + " in " + to_string(static_cast<long long>(elapsedMs + 0.5)) + " ms");
+        return 0;
+    }
+
+    // 输出文件名取底模文件名（不含扩展名），重名时追加底模序号
+    vector<string> batchOutputPaths(const vector<string>& baseFiles, const string& outputDir, const string& extension) {
+        vector<string> stems;
+        for (const string& base : baseFiles) {
+            stems.push_back(filesystem::path(base).stem().string());
+        }
+        vector<string> paths;
+        set<string> used;
+        for (size_t b = 0; b < baseFiles.size(); ++b) {
+            string name = stems[b];
+            if (count(stems.begin(), stems.end(), name) > 1 || used.count(name)) {
+                name += "_" + to_string(b + 1);
+            }
+            used.insert(name);
+            paths.push_back((filesystem::path(outputDir) / (name + extension)).string());
+        }
+        return paths;
+    }
+
+    int runBatch(const PipelineOptions& options, const vector<string>& baseFiles, const vector<string>& targetFiles,
+                 const string& weightPath, const string& outputDir, OutputFormat format) {
+        auto start = chrono::steady_clock::now();
+        error_code dirError;
+        filesystem::create_directories(outputDir, dirError);
+        if (dirError) {
+            logError("Cannot create output directory " + outputDir + ": " + dirError.message());
+            return 1;
+        }
+
+        BlendShapePipeline pipeline(options);
+        vector<BatchResult> results = pipeline.prepareBatch(baseFiles, targetFiles, weightPath);
+        const vector<string> outputPaths = batchOutputPaths(baseFiles, outputDir, format == OutputFormat::Interchange ? InterchangeFile::defaultExtension() : ".json");
+
+        // 各底模的通道生成与写出互不依赖，并行执行，日志之后按底模顺序输出
+        vector<vector<pair<LogLevel, string>>> logs(results.size());
+        vector<char> written(results.size(), 0);
+        parallelFor(results.size(), options.workerCount, [&](size_t b) {
+            ThreadLogBuffer buffer;
+            if (results[b].prepared) {
+                BlendShapeBuildStats stats;
+                string error;
+                if (writeResult(pipeline, results[b].result, format, outputPaths[b], stats, error)) {
+                    written[b] = 1;
+                    logInfo("Wrote " + to_string(stats.channels) + " channels (" + to_string(stats.prunedChannels) + " pruned, "
+                            + to_string(stats.shapePoints) + " points) for " + baseFiles[b] + " to " + outputPaths[b]);
+                } else {
+                    logError(error);
+                }
+            }
+            logs[b] = buffer.messages();
+        });
+
+        size_t writtenCount = 0;
+        for (size_t b = 0; b < results.size(); ++b) {
+            ThreadLogBuffer::replay(logs[b]);
+            writtenCount += written[b];
+        }
+        double elapsedMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        logInfo("Batch finished: " + to_string(writtenCount) + " of " + to_string(results.size()) + " bases written in "
+                + to_string(static_cast<long long>(elapsedMs + 0.5)) + " ms");
+        return writtenCount == results.size() ? 0 : 1;
+    }
+
+}
+
+int main(int argc, char** argv) {
+    PipelineOptions options;
+    options.lodTransferDir = LodTransferCache::defaultDirectory();
+    vector<string> fbxFiles;
+    vector<string> baseFiles;
+    string outputPath;
+    string weightPath;
+    string tracePath;
+    string formatName;
+    bool quiet = false;
+
+    for (int i = 1; i < argc; ++i) {
+        const string arg = argv[i];
+        auto nextValue = [&]() -> const char* {
+            return i + 1 < argc ? argv[++i] : nullptr;
+        };
+
+        if (arg == "-h" || arg == "--help") {
+            fputs(kUsage, stdout);
+            return 0;
+        } else if (arg == "--staged") {
+            options.fusedEvaluation = false;
+        } else if (arg == "--precision") {
+            const char* value = nextValue();
+            if (!value) return usageError("missing value for " + arg);
+            if (string(value) == "float") {
+                options.precision = GeometryPrecision::Float;
+            } else if (string(value) == "double") {
+                options.precision = GeometryPrecision::Double;
+            } else {
+                return usageError("invalid value for " + arg);
+            }
+        } else if (arg == "--no-surface-transfer") {
+            options.surfaceTransfer = false;
+        } else if (arg == "--lods") {
+            options.lodPropagation = true;
+        } else if (arg == "--lod-cache") {
+            const char* value = nextValue();
+            if (!value) return usageError("missing value for " + arg);
+            options.lodTransferDir = value;
+        } else if (arg == "-q" || arg == "--quiet") {
+            quiet = true;
+        } else if (arg == "-o" || arg == "--output") {
+            const char* value = nextValue();
+            if (!value) return usageError("missing value for " + arg);
+            outputPath = value;
+        } else if (arg == "-f" || arg == "--format") {
+            const char* value = nextValue();
+            if (!value) return usageError("missing value for " + arg);
+            formatName = value;
+            if (formatName != "json" && formatName != "cfx") {
+                return usageError("invalid value for " + arg);
+            }
+        } else if (arg == "-b" || arg == "--base") {
+            const char* value = nextValue();
+            if (!value) return usageError("missing value for " + arg);
+            splitPaths(value, baseFiles);
+        } else if (arg == "-j" || arg == "--weights") {
+            const char* value = nextValue();
+            if (!value) return usageError("missing value for " + arg);
+            weightPath = value;
+        } else if (arg == "-c" || arg == "--weight-cache") {
+            const char* value = nextValue();
+            if (!value) return usageError("missing value for " + arg);
+            options.weightCachePath = value;
+        } else if (arg == "-t" || arg == "--trace") {
+            const char* value = nextValue();
+            if (!value) return usageError("missing value for " + arg);
+            tracePath = value;
+        } else if (arg == "-g" || arg == "--geometry-cache") {
+            const char* value = nextValue();
+            if (!value) return usageError("missing value for " + arg);
+            options.geometryCacheDir = value;
+        } else if (arg == "--geometry-cache-budget") {
+            unsigned megabytes = 0;
+            const char* value = nextValue();
+            if (!value || !parseUnsigned(value, megabytes)) return usageError("invalid value for " + arg);
+            options.geometryCacheBudget = static_cast<uint64_t>(megabytes) * 1024 * 1024;
+        } else if (arg == "-l" || arg == "--list") {
+            const char* value = nextValue();
+            if (!value) return usageError("missing value for " + arg);
+            if (!readListFile(value, fbxFiles)) {
+                return usageError(string("cannot read list file ") + value);
+            }
+        } else if (arg == "-w" || arg == "--workers") {
+            const char* value = nextValue();
+            if (!value || !parseUnsigned(value, options.workerCount)) return usageError("invalid value for " + arg);
+        } else if (arg == "-r" || arg == "--robust-iterations") {
+            unsigned iterations = 0;
+            const char* value = nextValue();
+            if (!value || !parseUnsigned(value, iterations)) return usageError("invalid value for " + arg);
+            options.similarity.robustIterations = static_cast<int>(iterations);
+        } else if (arg == "-e" || arg == "--delta-epsilon") {
+            const char* value = nextValue();
+            if (!value || !parseDouble(value, options.deltaEpsilon) || options.deltaEpsilon < 0.0) return usageError("invalid value for " + arg);
+        } else if (!arg.empty() && arg[0] == '-') {
+            return usageError("unknown option " + arg);
+        } else {
+            splitPaths(arg, fbxFiles);
+        }
+    }
+
+    if (outputPath.empty()) {
+        return usageError("no output path given");
+    }
+    if (baseFiles.empty() && fbxFiles.size() < 2) {
+        return usageError("need a base FBX and at least one target FBX");
+    }
+    if (!baseFiles.empty() && fbxFiles.empty()) {
+        return usageError("need at least one target FBX");
+    }
+
+    OutputFormat format = OutputFormat::Json;
+    if (formatName == "cfx" || (formatName.empty() && baseFiles.empty() && filesystem::path(outputPath).extension() == InterchangeFile::defaultExtension())) {
+        format = OutputFormat::Interchange;
+    }
+
+    if (quiet) {
+        setLogSink([](LogLevel level, const string& message) {
+            if (level != LogLevel::Info) {
+                fprintf(stderr, "%s%s\n", level == LogLevel::Error ? "Error: " : "Warning: ", message.c_str());
+            }
+        });
+    }
+
+    auto run = [&]() {
+        return baseFiles.empty() ? runPipeline(options, fbxFiles, weightPath, outputPath, format)
+                                 : runBatch(options, baseFiles, fbxFiles, weightPath, outputPath, format);
+    };
+    if (tracePath.empty()) {
+        return run();
+    }
+
+    startTracing();
+    int exitCode = run();
+    string error;
+    if (!stopTracing(tracePath, error)) {
+        logError(error);
+        return exitCode == 0 ? 1 : exitCode;
+    }
+    logInfo("Trace written to " + tracePath);
+    return exitCode;
+}
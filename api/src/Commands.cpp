@@ -1,10 +1,18 @@
 #include "Commands.h"
 #include "FbxHandle.h"
+#include "FbxSession.h"
 #include "AutoRigCreate.h"
+#include "GeometryCache.h"
+#include "LodTransfer.h"
+#include "PipelineJob.h"
+#include "Trace.h"
 #include <maya/MFnPlugin.h>
 #include <maya/MGlobal.h>
 #include <maya/MArgList.h>
+#include <maya/MArgDatabase.h>
 #include <maya/MStringArray.h>
+#include <iomanip>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -20,6 +28,92 @@ public:
 const char* characterfactoryfbxhandle::commandName = "characterfactoryfbxhandle";
 const char* characterfactoryautorigcreate::commandName = "characterfactoryautorigcreate";
 
+static const char* kWorkersFlag = "-w";
+static const char* kWorkersFlagLong = "-workers";
+static const char* kNativeReaderFlag = "-nr";
+static const char* kNativeReaderFlagLong = "-nativeReader";
+static const char* kRobustFlag = "-rb";
+static const char* kRobustFlagLong = "-robustIterations";
+static const char* kDeltaEpsilonFlag = "-de";
+static const char* kDeltaEpsilonFlagLong = "-deltaEpsilon";
+static const char* kDirectFlag = "-d";
+static const char* kDirectFlagLong = "-direct";
+static const char* kFusedFlag = "-fu";
+static const char* kFusedFlagLong = "-fused";
+static const char* kGeometryCacheFlag = "-gc";
+static const char* kGeometryCacheFlagLong = "-geometryCache";
+static const char* kGeometryBudgetFlag = "-gcb";
+static const char* kGeometryBudgetFlagLong = "-geometryCacheBudget";
+static const char* kTraceFlag = "-tr";
+static const char* kTraceFlagLong = "-trace";
+static const char* kSurfaceTransferFlag = "-st";
+static const char* kSurfaceTransferFlagLong = "-surfaceTransfer";
+static const char* kLodPropagationFlag = "-lp";
+static const char* kLodPropagationFlagLong = "-lodPropagation";
+static const char* kBasesFlag = "-b";
+static const char* kBasesFlagLong = "-bases";
+static const char* kPrecisionFlag = "-pr";
+static const char* kPrecisionFlagLong = "-precision";
+static const char* kBackgroundFlag = "-bg";
+static const char* kBackgroundFlagLong = "-background";
+static const char* kJobStatusFlag = "-js";
+static const char* kJobStatusFlagLong = "-jobStatus";
+static const char* kCancelJobFlag = "-cj";
+static const char* kCancelJobFlagLong = "-cancelJob";
+static const char* kOpenSessionFlag = "-os";
+static const char* kOpenSessionFlagLong = "-openSession";
+static const char* kCloseSessionFlag = "-cs";
+static const char* kCloseSessionFlagLong = "-closeSession";
+static const char* kQuerySessionFlag = "-qs";
+static const char* kQuerySessionFlagLong = "-querySession";
+
+// 与 newSyntax() 中的标志保持一致
+static const char* kUsage =
+    "Usage: characterfactoryfbxhandle fbx_files_list output_path [json_path]"
+    " [-workers count] [-nativeReader bool] [-robustIterations count] [-deltaEpsilon value]"
+    " [-direct bool] [-fused bool] [-geometryCache dir] [-geometryCacheBudget mb] [-trace path]"
+    " [-surfaceTransfer bool] [-lodPropagation bool] [-bases base_files_list] [-precision double|float]"
+    " [-background bool]; characterfactoryfbxhandle -jobStatus id | -cancelJob id;"
+    " characterfactoryfbxhandle -openSession budget_mb | -closeSession | -querySession";
+
+static MString formatMegabytes(uint64_t bytes) {
+    ostringstream stream;
+    stream << fixed << setprecision(1) << static_cast<double>(bytes) / (1024.0 * 1024.0);
+    return MString(stream.str().c_str());
+}
+
+// 会话查询的结果：open/closed、缓存条目数、已用 MB、预算 MB、命中、未命中、淘汰次数、空闲的 FbxManager 数
+static MStringArray sessionResult(const FbxSessionStats& stats) {
+    MStringArray result;
+    result.append(stats.open ? "open" : "closed");
+    result.append(to_string(stats.cache.entryCount).c_str());
+    result.append(formatMegabytes(stats.cache.totalBytes));
+    result.append(formatMegabytes(stats.cache.budgetBytes));
+    result.append(to_string(stats.cache.hits).c_str());
+    result.append(to_string(stats.cache.misses).c_str());
+    result.append(to_string(stats.cache.evictions).c_str());
+    result.append(to_string(stats.idleManagers).c_str());
+    return result;
+}
+
+// 任务状态查询的结果：状态、阶段、阶段内已完成步数、总步数、完成百分比、已用秒数、预计剩余秒数（未知时为 -1）
+static MStringArray jobStatusResult(const JobStatus& status) {
+    auto format = [](double value) {
+        ostringstream stream;
+        stream << fixed << setprecision(1) << value;
+        return MString(stream.str().c_str());
+    };
+    MStringArray result;
+    result.append(jobStateName(status.state));
+    result.append(status.progress.stage.c_str());
+    result.append(to_string(status.progress.stepsDone).c_str());
+    result.append(to_string(status.progress.stepCount).c_str());
+    result.append(format(status.progress.fraction * 100.0));
+    result.append(format(status.progress.elapsedSeconds));
+    result.append(status.progress.etaSeconds < 0.0 ? MString("-1") : format(status.progress.etaSeconds));
+    return result;
+}
+
 characterfactoryfbxhandle::characterfactoryfbxhandle() : pImpl(new Implementation()) {}
 characterfactoryfbxhandle::~characterfactoryfbxhandle() {
     delete pImpl;
@@ -29,20 +123,89 @@ void* characterfactoryfbxhandle::creator() {
     return new characterfactoryfbxhandle();
 }
 
+MSyntax characterfactoryfbxhandle::newSyntax() {
+    MSyntax syntax;
+    syntax.setObjectType(MSyntax::kStringObjects, 0, 3);
+    syntax.addFlag(kWorkersFlag, kWorkersFlagLong, MSyntax::kUnsigned);
+    syntax.addFlag(kNativeReaderFlag, kNativeReaderFlagLong, MSyntax::kBoolean);
+    syntax.addFlag(kRobustFlag, kRobustFlagLong, MSyntax::kUnsigned);
+    syntax.addFlag(kDeltaEpsilonFlag, kDeltaEpsilonFlagLong, MSyntax::kDouble);
+    syntax.addFlag(kDirectFlag, kDirectFlagLong, MSyntax::kBoolean);
+    syntax.addFlag(kFusedFlag, kFusedFlagLong, MSyntax::kBoolean);
+    syntax.addFlag(kGeometryCacheFlag, kGeometryCacheFlagLong, MSyntax::kString);
+    syntax.addFlag(kGeometryBudgetFlag, kGeometryBudgetFlagLong, MSyntax::kUnsigned);
+    syntax.addFlag(kTraceFlag, kTraceFlagLong, MSyntax::kString);
+    syntax.addFlag(kSurfaceTransferFlag, kSurfaceTransferFlagLong, MSyntax::kBoolean);
+    syntax.addFlag(kLodPropagationFlag, kLodPropagationFlagLong, MSyntax::kBoolean);
+    syntax.addFlag(kBasesFlag, kBasesFlagLong, MSyntax::kString);
+    syntax.addFlag(kPrecisionFlag, kPrecisionFlagLong, MSyntax::kString);
+    syntax.addFlag(kBackgroundFlag, kBackgroundFlagLong, MSyntax::kBoolean);
+    syntax.addFlag(kJobStatusFlag, kJobStatusFlagLong, MSyntax::kUnsigned);
+    syntax.addFlag(kCancelJobFlag, kCancelJobFlagLong, MSyntax::kUnsigned);
+    syntax.addFlag(kOpenSessionFlag, kOpenSessionFlagLong, MSyntax::kUnsigned);
+    syntax.addFlag(kCloseSessionFlag, kCloseSessionFlagLong);
+    syntax.addFlag(kQuerySessionFlag, kQuerySessionFlagLong);
+    return syntax;
+}
+
 MStatus characterfactoryfbxhandle::doIt(const MArgList& args) {
     MStatus status = MS::kSuccess;
-    if (args.length() < 2 || args.length() > 3) {
-        MGlobal::displayError("Expected 2-3 arguments: fbx_files_list, output_path, [json_path]");
-        return MS::kFailure;
-    }
-
-    MString fbxListStr;
-    status = args.get(0, fbxListStr);
+    MArgDatabase argData(syntax(), args, &status);
     if (!status) {
-        MGlobal::displayError("Failed to get fbx files list");
+        MGlobal::displayError(MString("Invalid arguments. ") + kUsage);
         return status;
     }
 
+    // 会话：打开后之后的调用共享 FbxManager 并复用已读取的网格与底模场景，不处理文件
+    if (argData.isFlagSet(kOpenSessionFlag) || argData.isFlagSet(kCloseSessionFlag) || argData.isFlagSet(kQuerySessionFlag)) {
+        FbxSession& session = FbxSession::shared();
+        if (argData.isFlagSet(kOpenSessionFlag)) {
+            unsigned budgetMb = 0;
+            status = argData.getFlagArgument(kOpenSessionFlag, 0, budgetMb);
+            if (!status) {
+                MGlobal::displayError("Failed to get openSession flag argument");
+                return status;
+            }
+            session.open(budgetMb > 0 ? static_cast<uint64_t>(budgetMb) * 1024 * 1024 : SessionCache::kDefaultBudgetBytes);
+        } else if (argData.isFlagSet(kCloseSessionFlag)) {
+            session.close();
+        }
+        clearResult();
+        setResult(sessionResult(session.stats()));
+        return MS::kSuccess;
+    }
+
+    // 查询或取消异步任务，不处理文件
+    if (argData.isFlagSet(kJobStatusFlag) || argData.isFlagSet(kCancelJobFlag)) {
+        const bool query = argData.isFlagSet(kJobStatusFlag);
+        unsigned jobId = 0;
+        status = argData.getFlagArgument(query ? kJobStatusFlag : kCancelJobFlag, 0, jobId);
+        if (!status) {
+            MGlobal::displayError(query ? "Failed to get jobStatus flag argument" : "Failed to get cancelJob flag argument");
+            return status;
+        }
+        JobStatus jobStatus;
+        if (!PipelineJobEngine::shared().status(jobId, jobStatus)) {
+            MGlobal::displayError(MString("Unknown job: ") + jobId);
+            return MS::kInvalidParameter;
+        }
+        clearResult();
+        if (query) {
+            setResult(jobStatusResult(jobStatus));
+        } else {
+            setResult(PipelineJobEngine::shared().cancel(jobId));
+        }
+        return MS::kSuccess;
+    }
+
+    MStringArray objects;
+    status = argData.getObjects(objects);
+    if (!status || objects.length() < 2 || objects.length() > 3) {
+        MGlobal::displayError(MString("Expected 2-3 arguments. ") + kUsage);
+        return MS::kFailure;
+    }
+
+    MString fbxListStr = objects[0];
     MStringArray fbxFiles;
     status = fbxListStr.split(';', fbxFiles);  
     if (!status) {
@@ -55,24 +218,216 @@ MStatus characterfactoryfbxhandle::doIt(const MArgList& args) {
         pImpl->fbxFiles.push_back(fbxFiles[i].asChar());
     }
 
-    MString outputPath;
-    status = args.get(1, outputPath);
-    if (!status) {
-        MGlobal::displayError("Failed to get output path argument");
-        return status;
-    }
+    MString outputPath = objects[1];
     
     MString jsonPath;
-    if (args.length() == 3) {
-        status = args.get(2, jsonPath);
+    if (objects.length() == 3) {
+        jsonPath = objects[2];
+    }
+
+    // 0 表示按硬件并发数自动选择，1 表示串行导入
+    unsigned workerCount = 0;
+    if (argData.isFlagSet(kWorkersFlag)) {
+        status = argData.getFlagArgument(kWorkersFlag, 0, workerCount);
+        if (!status) {
+            MGlobal::displayError("Failed to get workers flag argument");
+            return status;
+        }
+    }
+
+    bool useNativeReader = true;
+    if (argData.isFlagSet(kNativeReaderFlag)) {
+        status = argData.getFlagArgument(kNativeReaderFlag, 0, useNativeReader);
+        if (!status) {
+            MGlobal::displayError("Failed to get nativeReader flag argument");
+            return status;
+        }
+    }
+
+    unsigned robustIterations = 0;
+    if (argData.isFlagSet(kRobustFlag)) {
+        status = argData.getFlagArgument(kRobustFlag, 0, robustIterations);
+        if (!status) {
+            MGlobal::displayError("Failed to get robustIterations flag argument");
+            return status;
+        }
+    }
+
+    // 异步执行：立即返回任务编号，场景修改在主线程空闲时完成
+    bool background = false;
+    if (argData.isFlagSet(kBackgroundFlag)) {
+        status = argData.getFlagArgument(kBackgroundFlag, 0, background);
+        if (!status) {
+            MGlobal::displayError("Failed to get background flag argument");
+            return status;
+        }
+    }
+
+    double deltaEpsilon = 1e-6;
+    if (argData.isFlagSet(kDeltaEpsilonFlag)) {
+        status = argData.getFlagArgument(kDeltaEpsilonFlag, 0, deltaEpsilon);
+        if (!status) {
+            MGlobal::displayError("Failed to get deltaEpsilon flag argument");
+            return status;
+        }
+        if (deltaEpsilon < 0.0) {
+            MGlobal::displayError("deltaEpsilon must not be negative");
+            return MS::kInvalidParameter;
+        }
+    }
+
+    bool direct = false;
+    if (argData.isFlagSet(kDirectFlag)) {
+        status = argData.getFlagArgument(kDirectFlag, 0, direct);
+        if (!status) {
+            MGlobal::displayError("Failed to get direct flag argument");
+            return status;
+        }
+    }
+
+    bool fused = true;
+    if (argData.isFlagSet(kFusedFlag)) {
+        status = argData.getFlagArgument(kFusedFlag, 0, fused);
+        if (!status) {
+            MGlobal::displayError("Failed to get fused flag argument");
+            return status;
+        }
+    }
+
+    bool surfaceTransfer = true;
+    if (argData.isFlagSet(kSurfaceTransferFlag)) {
+        status = argData.getFlagArgument(kSurfaceTransferFlag, 0, surfaceTransfer);
+        if (!status) {
+            MGlobal::displayError("Failed to get surfaceTransfer flag argument");
+            return status;
+        }
+    }
+
+    bool lodPropagation = false;
+    if (argData.isFlagSet(kLodPropagationFlag)) {
+        status = argData.getFlagArgument(kLodPropagationFlag, 0, lodPropagation);
+        if (!status) {
+            MGlobal::displayError("Failed to get lodPropagation flag argument");
+            return status;
+        }
+    }
+
+    GeometryPrecision precision = GeometryPrecision::Double;
+    if (argData.isFlagSet(kPrecisionFlag)) {
+        MString precisionName;
+        status = argData.getFlagArgument(kPrecisionFlag, 0, precisionName);
+        if (!status) {
+            MGlobal::displayError("Failed to get precision flag argument");
+            return status;
+        }
+        if (precisionName == "float") {
+            precision = GeometryPrecision::Float;
+        } else if (precisionName != "double") {
+            MGlobal::displayError("precision must be \"double\" or \"float\"");
+            return MS::kInvalidParameter;
+        }
+    }
+
+    // 多底模批处理：-bases 给出分号分隔的底模列表，此时第一个参数全部是目标模型
+    vector<string> baseFiles;
+    if (argData.isFlagSet(kBasesFlag)) {
+        MString basesStr;
+        status = argData.getFlagArgument(kBasesFlag, 0, basesStr);
+        if (!status) {
+            MGlobal::displayError("Failed to get bases flag argument");
+            return status;
+        }
+        MStringArray bases;
+        basesStr.split(';', bases);
+        for (unsigned int i = 0; i < bases.length(); ++i) {
+            baseFiles.push_back(bases[i].asChar());
+        }
+        if (baseFiles.empty()) {
+            MGlobal::displayError("bases flag requires at least one base file");
+            return MS::kInvalidParameter;
+        }
+    }
+
+    // 默认缓存到系统临时目录，传入空字符串关闭缓存
+    MString geometryCacheDir = GeometryCache::defaultDirectory().c_str();
+    if (argData.isFlagSet(kGeometryCacheFlag)) {
+        status = argData.getFlagArgument(kGeometryCacheFlag, 0, geometryCacheDir);
+        if (!status) {
+            MGlobal::displayError("Failed to get geometryCache flag argument");
+            return status;
+        }
+    }
+
+    unsigned geometryBudgetMb = static_cast<unsigned>(GeometryCache::kDefaultBudgetBytes / (1024 * 1024));
+    if (argData.isFlagSet(kGeometryBudgetFlag)) {
+        status = argData.getFlagArgument(kGeometryBudgetFlag, 0, geometryBudgetMb);
         if (!status) {
-            MGlobal::displayError("Failed to get json path argument");
+            MGlobal::displayError("Failed to get geometryCacheBudget flag argument");
             return status;
         }
     }
 
+    // 指定路径时记录本次命令各阶段的耗时区间，结束后写成 Chrome trace JSON
+    MString tracePath;
+    if (argData.isFlagSet(kTraceFlag)) {
+        status = argData.getFlagArgument(kTraceFlag, 0, tracePath);
+        if (!status) {
+            MGlobal::displayError("Failed to get trace flag argument");
+            return status;
+        }
+        if (!startTracing()) {
+            MGlobal::displayError("A trace is already being recorded by another command or background job; wait for it to finish before using -trace");
+            return MS::kFailure;
+        }
+    }
+
     FbxModelHandle fbxHandle;
-    fbxHandle.processMultipleFbxFiles(pImpl->fbxFiles, outputPath.asChar(), jsonPath.asChar());
+    fbxHandle.setWorkerCount(workerCount);
+    fbxHandle.setUseNativeReader(useNativeReader);
+    fbxHandle.setRobustIterations(static_cast<int>(robustIterations));
+    fbxHandle.setDeltaEpsilon(deltaEpsilon);
+    fbxHandle.setDirectBlendShapes(direct);
+    fbxHandle.setFusedEvaluation(fused);
+    fbxHandle.setSurfaceTransfer(surfaceTransfer);
+    fbxHandle.setLodPropagation(lodPropagation, LodTransferCache::defaultDirectory());
+    fbxHandle.setPrecision(precision);
+    fbxHandle.setGeometryCache(geometryCacheDir.asChar(), static_cast<uint64_t>(geometryBudgetMb) * 1024 * 1024);
+    if (background) {
+        // 跟踪在任务收尾后写出
+        string traceFile = tracePath.asChar();
+        auto onFinished = [traceFile](JobState) {
+            if (traceFile.empty()) {
+                return;
+            }
+            string error;
+            if (stopTracing(traceFile, error)) {
+                MGlobal::displayInfo(MString("Trace written to ") + traceFile.c_str());
+            } else {
+                MGlobal::displayWarning(error.c_str());
+            }
+        };
+        uint64_t jobId = baseFiles.empty() ? fbxHandle.submitMultipleFbxFiles(pImpl->fbxFiles, jsonPath.asChar(), onFinished)
+                                           : fbxHandle.submitBatch(baseFiles, pImpl->fbxFiles, jsonPath.asChar(), onFinished);
+        MGlobal::displayInfo(MString("Started job ") + static_cast<unsigned>(jobId));
+        clearResult();
+        setResult(static_cast<int>(jobId));
+        return MS::kSuccess;
+    }
+
+    if (baseFiles.empty()) {
+        fbxHandle.processMultipleFbxFiles(pImpl->fbxFiles, outputPath.asChar(), jsonPath.asChar());
+    } else {
+        fbxHandle.processBatch(baseFiles, pImpl->fbxFiles, jsonPath.asChar());
+    }
+
+    if (tracePath.length() > 0) {
+        string error;
+        if (stopTracing(tracePath.asChar(), error)) {
+            MGlobal::displayInfo(MString("Trace written to ") + tracePath);
+        } else {
+            MGlobal::displayWarning(error.c_str());
+        }
+    }
 
     clearResult();
     setResult("FBX files processed successfully");
@@ -86,7 +441,8 @@ CHARACTER_FACTORY_EXPORT MStatus initializePlugin(MObject obj) {
     MFnPlugin plugin(obj, "CharacterFactory", "1.0", "Any");
 
     status = plugin.registerCommand(cf::characterfactoryfbxhandle::commandName,
-                                  cf::characterfactoryfbxhandle::creator);
+                                  cf::characterfactoryfbxhandle::creator,
+                                  cf::characterfactoryfbxhandle::newSyntax);
     if (!status) {
         status.perror("Failed to register command: characterfactoryfbxhandle");
         return status;
@@ -94,7 +450,8 @@ CHARACTER_FACTORY_EXPORT MStatus initializePlugin(MObject obj) {
     
     // 注册AutoRigCreate命令
     status = plugin.registerCommand(cf::characterfactoryautorigcreate::commandName,
-                                  cf::characterfactoryautorigcreate::creator);
+                                  cf::characterfactoryautorigcreate::creator,
+                                  cf::characterfactoryautorigcreate::newSyntax);
     if (!status) {
         status.perror("Failed to register command: characterfactoryautorigcreate");
         return status;
@@ -107,6 +464,10 @@ CHARACTER_FACTORY_EXPORT MStatus uninitializePlugin(MObject obj) {
     MStatus status;
     MFnPlugin plugin(obj);
 
+    // 卸载前取消并等待所有异步任务，未收尾的任务不再修改场景；之后释放会话持有的场景与管理器
+    cf::PipelineJobEngine::shared().shutdown();
+    cf::FbxSession::shared().close();
+
     status = plugin.deregisterCommand(cf::characterfactoryfbxhandle::commandName);
     if (!status) {
         status.perror("Failed to deregister command: characterfactoryfbxhandle");
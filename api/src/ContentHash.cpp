@@ -0,0 +1,109 @@
+#include "ContentHash.h"
+#include "MappedFile.h"
+#include <cstring>
+
+namespace cf {
+
+    namespace {
+
+        const uint64_t kPrime1 = 11400714785074694791ULL;
+        const uint64_t kPrime2 = 14029467366897019727ULL;
+        const uint64_t kPrime3 = 1609587929392839161ULL;
+        const uint64_t kPrime4 = 9650029242287828579ULL;
+        const uint64_t kPrime5 = 2870177450012600261ULL;
+
+        inline uint64_t rotl(uint64_t value, int bits) {
+            return (value << bits) | (value >> (64 - bits));
+        }
+
+        // 按小端读取，memcpy 避免未对齐访问
+        inline uint64_t read64(const uint8_t* p) {
+            uint64_t value;
+            memcpy(&value, p, sizeof(value));
+            return value;
+        }
+
+        inline uint32_t read32(const uint8_t* p) {
+            uint32_t value;
+            memcpy(&value, p, sizeof(value));
+            return value;
+        }
+
+        inline uint64_t xxRound(uint64_t acc, uint64_t input) {
+            acc += input * kPrime2;
+            acc = rotl(acc, 31);
+            return acc * kPrime1;
+        }
+
+        inline uint64_t mergeRound(uint64_t acc, uint64_t value) {
+            acc ^= xxRound(0, value);
+            return acc * kPrime1 + kPrime4;
+        }
+
+    }
+
+    uint64_t hashBytes(const void* data, size_t size, uint64_t seed) {
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        const uint8_t* end = p + size;
+        uint64_t hash;
+
+        if (size >= 32) {
+            // 四路独立累加器，每次处理32字节
+            uint64_t v1 = seed + kPrime1 + kPrime2;
+            uint64_t v2 = seed + kPrime2;
+            uint64_t v3 = seed;
+            uint64_t v4 = seed - kPrime1;
+            const uint8_t* limit = end - 32;
+            do {
+                v1 = xxRound(v1, read64(p));
+                v2 = xxRound(v2, read64(p + 8));
+                v3 = xxRound(v3, read64(p + 16));
+                v4 = xxRound(v4, read64(p + 24));
+                p += 32;
+            } while (p <= limit);
+
+            hash = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+            hash = mergeRound(hash, v1);
+            hash = mergeRound(hash, v2);
+            hash = mergeRound(hash, v3);
+            hash = mergeRound(hash, v4);
+        } else {
+            hash = seed + kPrime5;
+        }
+
+        hash += static_cast<uint64_t>(size);
+
+        while (p + 8 <= end) {
+            hash ^= xxRound(0, read64(p));
+            hash = rotl(hash, 27) * kPrime1 + kPrime4;
+            p += 8;
+        }
+        if (p + 4 <= end) {
+            hash ^= static_cast<uint64_t>(read32(p)) * kPrime1;
+            hash = rotl(hash, 23) * kPrime2 + kPrime3;
+            p += 4;
+        }
+        while (p < end) {
+            hash ^= (*p) * kPrime5;
+            hash = rotl(hash, 11) * kPrime1;
+            ++p;
+        }
+
+        hash ^= hash >> 33;
+        hash *= kPrime2;
+        hash ^= hash >> 29;
+        hash *= kPrime3;
+        hash ^= hash >> 32;
+        return hash;
+    }
+
+    bool hashFile(const string& path, uint64_t& hash) {
+        MappedFile file;
+        if (!file.open(path)) {
+            return false;
+        }
+        hash = hashBytes(file.data(), file.size());
+        return true;
+    }
+
+}
@@ -0,0 +1,638 @@
+#include "FbxBinaryReader.h"
+#include "Parallel.h"
+#include <cstring>
+#include <fstream>
+#include <set>
+#include <unordered_map>
+
+namespace cf {
+
+    namespace {
+
+        const char kFbxBinaryMagic[] = "Kaydara FBX Binary  ";
+        const size_t kFbxHeaderSize = 27;
+
+        template <typename T>
+        T readLE(const uint8_t* p) {
+            T value;
+            memcpy(&value, p, sizeof(T));
+            return value;
+        }
+
+        // 最小实现的 zlib/deflate 解压器（RFC 1950/1951），FBX压缩数组只需要这一种编码
+        class Inflater {
+        public:
+            Inflater(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize)
+                : mSrc(src), mSrcSize(srcSize), mPos(0), mBitBuf(0), mBitCount(0),
+                  mDst(dst), mDstSize(dstSize), mOut(0), mError(false) {}
+
+            bool run() {
+                // zlib 头：CMF/FLG，不支持预设字典
+                if (mSrcSize < 2) return false;
+                uint8_t cmf = mSrc[0];
+                uint8_t flg = mSrc[1];
+                if ((cmf & 0x0F) != 8 || ((cmf << 8) | flg) % 31 != 0 || (flg & 0x20)) return false;
+                mPos = 2;
+
+                bool last = false;
+                while (!last) {
+                    last = getBits(1) != 0;
+                    uint32_t type = getBits(2);
+                    if (mError) return false;
+
+                    bool ok = false;
+                    if (type == 0) {
+                        ok = storedBlock();
+                    } else if (type == 1) {
+                        ok = fixedBlock();
+                    } else if (type == 2) {
+                        ok = dynamicBlock();
+                    }
+                    if (!ok || mError) return false;
+                }
+                return mOut == mDstSize;
+            }
+
+        private:
+            static const int kMaxBits = 15;
+            static const int kFastBits = 10;
+
+            struct Huffman {
+                uint16_t count[kMaxBits + 1];
+                uint16_t symbol[320];
+                uint16_t fast[1 << kFastBits];  // (码长 << 9) | 符号，0 表示需要走慢路径
+            };
+
+            void refill() {
+                while (mBitCount <= 56 && mPos < mSrcSize) {
+                    mBitBuf |= static_cast<uint64_t>(mSrc[mPos++]) << mBitCount;
+                    mBitCount += 8;
+                }
+            }
+
+            uint32_t getBits(int n) {
+                if (n == 0) return 0;
+                if (mBitCount < n) {
+                    refill();
+                    if (mBitCount < n) {
+                        mError = true;
+                        return 0;
+                    }
+                }
+                uint32_t value = static_cast<uint32_t>(mBitBuf & ((1ull << n) - 1));
+                mBitBuf >>= n;
+                mBitCount -= n;
+                return value;
+            }
+
+            static bool build(Huffman& h, const uint8_t* lengths, int n) {
+                memset(h.count, 0, sizeof(h.count));
+                memset(h.fast, 0, sizeof(h.fast));
+                for (int s = 0; s < n; ++s) h.count[lengths[s]]++;
+                h.count[0] = 0;
+
+                int left = 1;
+                for (int len = 1; len <= kMaxBits; ++len) {
+                    left <<= 1;
+                    left -= h.count[len];
+                    if (left < 0) return false;
+                }
+
+                uint16_t offs[kMaxBits + 1];
+                offs[1] = 0;
+                for (int len = 1; len < kMaxBits; ++len) offs[len + 1] = offs[len] + h.count[len];
+                for (int s = 0; s < n; ++s) {
+                    if (lengths[s]) h.symbol[offs[lengths[s]]++] = static_cast<uint16_t>(s);
+                }
+
+                // 规范哈夫曼码按位反转后填入快速查找表
+                int code = 0;
+                int index = 0;
+                for (int len = 1; len <= kFastBits; ++len) {
+                    for (int i = 0; i < h.count[len]; ++i, ++code, ++index) {
+                        int reversed = 0;
+                        for (int b = 0; b < len; ++b) reversed |= ((code >> b) & 1) << (len - 1 - b);
+                        uint16_t entry = static_cast<uint16_t>((len << 9) | h.symbol[index]);
+                        for (int fill = reversed; fill < (1 << kFastBits); fill += (1 << len)) {
+                            h.fast[fill] = entry;
+                        }
+                    }
+                    code <<= 1;
+                }
+                return true;
+            }
+
+            int decode(const Huffman& h) {
+                if (mBitCount < kMaxBits) refill();
+                if (mBitCount >= kFastBits) {
+                    uint16_t entry = h.fast[mBitBuf & ((1u << kFastBits) - 1)];
+                    if (entry) {
+                        int len = entry >> 9;
+                        mBitBuf >>= len;
+                        mBitCount -= len;
+                        return entry & 0x1FF;
+                    }
+                }
+
+                int code = 0, first = 0, index = 0;
+                for (int len = 1; len <= kMaxBits; ++len) {
+                    code |= static_cast<int>(getBits(1));
+                    if (mError) return -1;
+                    int count = h.count[len];
+                    if (code - count < first) return h.symbol[index + (code - first)];
+                    index += count;
+                    first += count;
+                    first <<= 1;
+                    code <<= 1;
+                }
+                mError = true;
+                return -1;
+            }
+
+            bool storedBlock() {
+                // 丢弃到字节边界，并把缓冲区中未消费的整字节退回输入
+                mBitBuf >>= (mBitCount & 7);
+                mBitCount -= (mBitCount & 7);
+                mPos -= mBitCount / 8;
+                mBitBuf = 0;
+                mBitCount = 0;
+
+                if (mPos + 4 > mSrcSize) return false;
+                uint16_t len = readLE<uint16_t>(mSrc + mPos);
+                uint16_t nlen = readLE<uint16_t>(mSrc + mPos + 2);
+                mPos += 4;
+                if (len != static_cast<uint16_t>(~nlen)) return false;
+                if (mPos + len > mSrcSize || mOut + len > mDstSize) return false;
+
+                memcpy(mDst + mOut, mSrc + mPos, len);
+                mPos += len;
+                mOut += len;
+                return true;
+            }
+
+            bool codes(const Huffman& lencode, const Huffman& distcode) {
+                static const uint16_t lengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+                static const uint8_t lengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+                static const uint16_t distBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+                static const uint8_t distExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+                for (;;) {
+                    int symbol = decode(lencode);
+                    if (symbol < 0) return false;
+                    if (symbol < 256) {
+                        if (mOut >= mDstSize) return false;
+                        mDst[mOut++] = static_cast<uint8_t>(symbol);
+                    } else if (symbol == 256) {
+                        return true;
+                    } else {
+                        symbol -= 257;
+                        if (symbol >= 29) return false;
+                        size_t length = lengthBase[symbol] + getBits(lengthExtra[symbol]);
+
+                        int distSymbol = decode(distcode);
+                        if (distSymbol < 0 || distSymbol >= 30) return false;
+                        size_t dist = distBase[distSymbol] + getBits(distExtra[distSymbol]);
+                        if (mError || dist > mOut || mOut + length > mDstSize) return false;
+
+                        uint8_t* out = mDst + mOut;
+                        const uint8_t* from = out - dist;
+                        for (size_t i = 0; i < length; ++i) out[i] = from[i];
+                        mOut += length;
+                    }
+                }
+            }
+
+            bool fixedBlock() {
+                uint8_t lengths[320];
+                int s = 0;
+                for (; s < 144; ++s) lengths[s] = 8;
+                for (; s < 256; ++s) lengths[s] = 9;
+                for (; s < 280; ++s) lengths[s] = 7;
+                for (; s < 288; ++s) lengths[s] = 8;
+                Huffman lencode;
+                build(lencode, lengths, 288);
+
+                for (s = 0; s < 30; ++s) lengths[s] = 5;
+                Huffman distcode;
+                build(distcode, lengths, 30);
+
+                return codes(lencode, distcode);
+            }
+
+            bool dynamicBlock() {
+                static const uint8_t order[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+                int nlen = static_cast<int>(getBits(5)) + 257;
+                int ndist = static_cast<int>(getBits(5)) + 1;
+                int ncode = static_cast<int>(getBits(4)) + 4;
+                if (mError || nlen > 286 || ndist > 30) return false;
+
+                uint8_t lengths[320] = {0};
+                for (int i = 0; i < ncode; ++i) lengths[order[i]] = static_cast<uint8_t>(getBits(3));
+
+                Huffman lencode;
+                if (!build(lencode, lengths, 19)) return false;
+
+                int index = 0;
+                while (index < nlen + ndist) {
+                    int symbol = decode(lencode);
+                    if (symbol < 0) return false;
+                    if (symbol < 16) {
+                        lengths[index++] = static_cast<uint8_t>(symbol);
+                        continue;
+                    }
+
+                    uint8_t len = 0;
+                    int repeat = 0;
+                    if (symbol == 16) {
+                        if (index == 0) return false;
+                        len = lengths[index - 1];
+                        repeat = 3 + static_cast<int>(getBits(2));
+                    } else if (symbol == 17) {
+                        repeat = 3 + static_cast<int>(getBits(3));
+                    } else {
+                        repeat = 11 + static_cast<int>(getBits(7));
+                    }
+                    if (mError || index + repeat > nlen + ndist) return false;
+                    while (repeat--) lengths[index++] = len;
+                }
+                if (lengths[256] == 0) return false;
+
+                Huffman distcode;
+                if (!build(lencode, lengths, nlen) || !build(distcode, lengths + nlen, ndist)) return false;
+                return codes(lencode, distcode);
+            }
+
+            const uint8_t* mSrc;
+            size_t mSrcSize;
+            size_t mPos;
+            uint64_t mBitBuf;
+            int mBitCount;
+            uint8_t* mDst;
+            size_t mDstSize;
+            size_t mOut;
+            bool mError;
+        };
+
+        size_t elementSize(char type) {
+            switch (type) {
+                case 'd': case 'l': return 8;
+                case 'f': case 'i': return 4;
+                case 'b': return 1;
+                default: return 0;
+            }
+        }
+
+        // FBX 对象名以 "名称\x00\x01类名" 形式存储，只保留名称部分
+        string objectName(const uint8_t* data, uint32_t length) {
+            const char* begin = reinterpret_cast<const char*>(data);
+            size_t nameLength = 0;
+            while (nameLength < length && begin[nameLength] != '\0') ++nameLength;
+            return string(begin, nameLength);
+        }
+
+    }
+
+    struct FbxBinaryReader::NodeRecord {
+        uint64_t endOffset = 0;
+        uint64_t propertyCount = 0;
+        size_t propertiesBegin = 0;
+        size_t childrenBegin = 0;
+        string name;
+    };
+
+    struct FbxBinaryReader::Property {
+        char type = 0;
+        const uint8_t* data = nullptr;
+        uint32_t arrayLength = 0;
+        uint32_t encoding = 0;
+        uint32_t byteLength = 0;
+    };
+
+    FbxBinaryReader::FbxBinaryReader() : mVersion(0) {}
+
+    FbxBinaryReader::~FbxBinaryReader() {
+        close();
+    }
+
+    bool FbxBinaryReader::isBinaryFbx(const string& path) {
+        ifstream file(path, ios::binary);
+        char header[sizeof(kFbxBinaryMagic) - 1];
+        if (!file.read(header, sizeof(header))) {
+            return false;
+        }
+        return memcmp(header, kFbxBinaryMagic, sizeof(header)) == 0;
+    }
+
+    bool FbxBinaryReader::open(const string& path) {
+        close();
+
+        if (!mFile.open(path)) {
+            mError = "Failed to map FBX file: " + path;
+            return false;
+        }
+
+        const uint8_t* data = mFile.data();
+        if (mFile.size() < kFbxHeaderSize || memcmp(data, kFbxBinaryMagic, sizeof(kFbxBinaryMagic) - 1) != 0) {
+            mError = "Not a binary FBX file: " + path;
+            mFile.close();
+            return false;
+        }
+
+        mVersion = readLE<uint32_t>(data + 23);
+        if (mVersion < 7000 || mVersion >= 8000) {
+            mError = "Unsupported FBX version " + to_string(mVersion) + ": " + path;
+            mFile.close();
+            return false;
+        }
+
+        mError.clear();
+        return true;
+    }
+
+    void FbxBinaryReader::close() {
+        mFile.close();
+        mVersion = 0;
+    }
+
+    bool FbxBinaryReader::readNodeRecord(size_t offset, NodeRecord& record) {
+        const uint8_t* data = mFile.data();
+        const size_t size = mFile.size();
+        const bool wide = mVersion >= 7500;
+        const size_t headerSize = wide ? 25 : 13;
+
+        if (offset + headerSize > size) {
+            mError = "Truncated node record";
+            return false;
+        }
+
+        uint64_t propertyListLength = 0;
+        if (wide) {
+            record.endOffset = readLE<uint64_t>(data + offset);
+            record.propertyCount = readLE<uint64_t>(data + offset + 8);
+            propertyListLength = readLE<uint64_t>(data + offset + 16);
+        } else {
+            record.endOffset = readLE<uint32_t>(data + offset);
+            record.propertyCount = readLE<uint32_t>(data + offset + 4);
+            propertyListLength = readLE<uint32_t>(data + offset + 8);
+        }
+
+        uint8_t nameLength = data[offset + headerSize - 1];
+        record.propertiesBegin = offset + headerSize + nameLength;
+        record.childrenBegin = record.propertiesBegin + propertyListLength;
+
+        // endOffset 为 0 表示空记录（子节点列表结束标记）
+        if (record.endOffset == 0) {
+            record.name.clear();
+            return true;
+        }
+
+        if (record.endOffset > size || record.childrenBegin > record.endOffset || record.endOffset <= offset) {
+            mError = "Corrupt node record at offset " + to_string(offset);
+            return false;
+        }
+
+        record.name.assign(reinterpret_cast<const char*>(data + offset + headerSize), nameLength);
+        return true;
+    }
+
+    bool FbxBinaryReader::readProperty(size_t& offset, size_t end, Property& property) {
+        const uint8_t* data = mFile.data();
+        if (offset >= end) {
+            mError = "Truncated property list";
+            return false;
+        }
+
+        property = Property();
+        property.type = static_cast<char>(data[offset++]);
+
+        size_t payload = 0;
+        switch (property.type) {
+            case 'C': payload = 1; break;
+            case 'Y': payload = 2; break;
+            case 'I': case 'F': payload = 4; break;
+            case 'D': case 'L': payload = 8; break;
+            case 'S': case 'R':
+                if (offset + 4 > end) break;
+                property.byteLength = readLE<uint32_t>(data + offset);
+                offset += 4;
+                payload = property.byteLength;
+                break;
+            case 'f': case 'd': case 'l': case 'i': case 'b':
+                if (offset + 12 > end) break;
+                property.arrayLength = readLE<uint32_t>(data + offset);
+                property.encoding = readLE<uint32_t>(data + offset + 4);
+                property.byteLength = readLE<uint32_t>(data + offset + 8);
+                offset += 12;
+                payload = property.byteLength;
+                break;
+            default:
+                mError = string("Unknown property type '") + property.type + "'";
+                return false;
+        }
+
+        if (offset + payload > end) {
+            mError = "Truncated property data";
+            return false;
+        }
+
+        property.data = data + offset;
+        offset += payload;
+        return true;
+    }
+
+    bool FbxBinaryReader::decodeArray(const Property& property, char elementType, void* output, size_t elementCount, string& error) const {
+        const size_t byteCount = elementCount * elementSize(elementType);
+        if (property.type != elementType || property.arrayLength != elementCount) {
+            error = "Unexpected array layout";
+            return false;
+        }
+
+        if (property.encoding == 0) {
+            if (property.byteLength != byteCount) {
+                error = "Array length mismatch";
+                return false;
+            }
+            memcpy(output, property.data, byteCount);
+            return true;
+        }
+
+        if (property.encoding != 1) {
+            error = "Unsupported array encoding " + to_string(property.encoding);
+            return false;
+        }
+
+        Inflater inflater(property.data, property.byteLength, static_cast<uint8_t*>(output), byteCount);
+        if (!inflater.run()) {
+            error = "Failed to inflate compressed array";
+            return false;
+        }
+        return true;
+    }
+
+    bool FbxBinaryReader::readMeshes(const vector<string>& meshNames, bool withPolygonIndices, map<string, FbxMeshArrays>& meshes, unsigned workerCount) {
+        meshes.clear();
+        mWarnings.clear();
+        if (!mFile.isOpen()) {
+            mError = "FBX file is not open";
+            return false;
+        }
+
+        struct GeometryArrays {
+            Property vertices;
+            Property polygonVertexIndex;
+        };
+
+        unordered_map<int64_t, GeometryArrays> geometries;
+        unordered_map<int64_t, string> models;
+        vector<pair<int64_t, int64_t>> connections;
+
+        // 只遍历顶层的 Objects 与 Connections，其余节点通过 endOffset 直接跳过
+        size_t offset = kFbxHeaderSize;
+        NodeRecord top;
+        while (offset < mFile.size()) {
+            if (!readNodeRecord(offset, top)) return false;
+            if (top.endOffset == 0) break;
+
+            if (top.name == "Objects") {
+                size_t childOffset = top.childrenBegin;
+                NodeRecord object;
+                while (childOffset < top.endOffset) {
+                    if (!readNodeRecord(childOffset, object)) return false;
+                    if (object.endOffset == 0) break;
+
+                    bool isGeometry = object.name == "Geometry";
+                    bool isModel = object.name == "Model";
+                    if ((isGeometry || isModel) && object.propertyCount >= 3) {
+                        size_t propOffset = object.propertiesBegin;
+                        Property id, name, subclass;
+                        if (!readProperty(propOffset, object.childrenBegin, id) ||
+                            !readProperty(propOffset, object.childrenBegin, name) ||
+                            !readProperty(propOffset, object.childrenBegin, subclass)) {
+                            return false;
+                        }
+
+                        bool isMesh = id.type == 'L' && name.type == 'S' && subclass.type == 'S' &&
+                                      subclass.byteLength == 4 && memcmp(subclass.data, "Mesh", 4) == 0;
+                        if (isMesh && isModel) {
+                            models[readLE<int64_t>(id.data)] = objectName(name.data, name.byteLength);
+                        } else if (isMesh) {
+                            GeometryArrays arrays;
+                            size_t arrayOffset = object.childrenBegin;
+                            NodeRecord element;
+                            while (arrayOffset < object.endOffset) {
+                                if (!readNodeRecord(arrayOffset, element)) return false;
+                                if (element.endOffset == 0) break;
+
+                                Property* target = nullptr;
+                                if (element.name == "Vertices") {
+                                    target = &arrays.vertices;
+                                } else if (element.name == "PolygonVertexIndex") {
+                                    target = &arrays.polygonVertexIndex;
+                                }
+                                if (target && element.propertyCount >= 1) {
+                                    size_t valueOffset = element.propertiesBegin;
+                                    if (!readProperty(valueOffset, element.childrenBegin, *target)) return false;
+                                }
+                                arrayOffset = static_cast<size_t>(element.endOffset);
+                            }
+                            geometries[readLE<int64_t>(id.data)] = arrays;
+                        }
+                    }
+                    childOffset = static_cast<size_t>(object.endOffset);
+                }
+            } else if (top.name == "Connections") {
+                size_t childOffset = top.childrenBegin;
+                NodeRecord connection;
+                while (childOffset < top.endOffset) {
+                    if (!readNodeRecord(childOffset, connection)) return false;
+                    if (connection.endOffset == 0) break;
+
+                    if (connection.name == "C" && connection.propertyCount >= 3) {
+                        size_t propOffset = connection.propertiesBegin;
+                        Property kind, child, parent;
+                        if (!readProperty(propOffset, connection.childrenBegin, kind) ||
+                            !readProperty(propOffset, connection.childrenBegin, child) ||
+                            !readProperty(propOffset, connection.childrenBegin, parent)) {
+                            return false;
+                        }
+                        if (kind.type == 'S' && kind.byteLength == 2 && memcmp(kind.data, "OO", 2) == 0 &&
+                            child.type == 'L' && parent.type == 'L') {
+                            connections.emplace_back(readLE<int64_t>(child.data), readLE<int64_t>(parent.data));
+                        }
+                    }
+                    childOffset = static_cast<size_t>(connection.endOffset);
+                }
+            }
+
+            offset = static_cast<size_t>(top.endOffset);
+        }
+
+        set<string> wanted(meshNames.begin(), meshNames.end());
+
+        // 网格节点名取自 Model，几何数组挂在通过 OO 连接的 Geometry 上。
+        // 同名的 Model（不同父节点下的同名节点，或同一几何实例化到两个同名模型）只保留第一个连接：
+        // 解压任务持有输出数组的指针，同一名称再次 resize 会使之前的任务写入已释放或共享的缓冲
+        struct DecodeTask {
+            const Property* property;
+            char type;
+            void* output;
+            size_t count;
+        };
+        vector<DecodeTask> tasks;
+        for (const auto& [geometryId, modelId] : connections) {
+            auto geometryIt = geometries.find(geometryId);
+            auto modelIt = models.find(modelId);
+            if (geometryIt == geometries.end() || modelIt == models.end()) {
+                continue;
+            }
+            if (!wanted.empty() && wanted.find(modelIt->second) == wanted.end()) {
+                continue;
+            }
+
+            const GeometryArrays& arrays = geometryIt->second;
+            if (!arrays.vertices.data || arrays.vertices.arrayLength % 3 != 0) {
+                continue;
+            }
+
+            auto inserted = meshes.emplace(modelIt->second, FbxMeshArrays());
+            if (!inserted.second) {
+                mWarnings.push_back("Skipping duplicate mesh " + modelIt->second + " (geometry " + to_string(geometryId) + ")");
+                continue;
+            }
+            FbxMeshArrays& mesh = inserted.first->second;
+            mesh.vertices.resize(arrays.vertices.arrayLength);
+            tasks.push_back({&arrays.vertices, 'd', mesh.vertices.data(), mesh.vertices.size()});
+
+            if (withPolygonIndices && arrays.polygonVertexIndex.data) {
+                mesh.polygonVertexIndex.resize(arrays.polygonVertexIndex.arrayLength);
+                tasks.push_back({&arrays.polygonVertexIndex, 'i', mesh.polygonVertexIndex.data(), mesh.polygonVertexIndex.size()});
+            }
+        }
+
+        // 部分导出器以 float 存储顶点，此时先解压到临时缓冲再转换为 double
+        vector<string> errors(tasks.size());
+        parallelFor(tasks.size(), workerCount, [&](size_t i) {
+            const DecodeTask& task = tasks[i];
+            if (task.type == 'd' && task.property->type == 'f') {
+                vector<float> values(task.count);
+                if (decodeArray(*task.property, 'f', values.data(), task.count, errors[i])) {
+                    double* output = static_cast<double*>(task.output);
+                    for (size_t k = 0; k < task.count; ++k) output[k] = values[k];
+                }
+                return;
+            }
+            decodeArray(*task.property, task.type, task.output, task.count, errors[i]);
+        });
+
+        for (const string& error : errors) {
+            if (!error.empty()) {
+                mError = error;
+                meshes.clear();
+                return false;
+            }
+        }
+        return true;
+    }
+
+}
@@ -1,72 +1,207 @@
 #include "FbxHandle.h"
+#include "BlendShapeBuilder.h"
+#include "FbxSession.h"
+#include "Log.h"
+#include "MayaBlendShape.h"
+#include "Parallel.h"
+#include "Trace.h"
 #include <maya/MGlobal.h>
 #include <sstream>
 #include <iomanip>
-#include <nlohmann/json.hpp>
+#include <chrono>
+#include <algorithm>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <unordered_set>
 #include <maya/MFnDagNode.h>
 #include <maya/MGlobal.h>
 #include <maya/MSelectionList.h>
 #include <maya/MDagModifier.h>
+#include <maya/MItDag.h>
 #include <maya/MStatus.h>
 
 namespace cf {
 
-    FbxModelHandle::FbxModelHandle() : mFbxManager(nullptr), mFbxScene(nullptr) {
-        mFbxManager = FbxManager::Create();
-        if (!mFbxManager) {
-            MGlobal::displayError("Failed to create FBX Manager");
-            return;
-        }
+    namespace {
 
-        FbxIOSettings* ios = FbxIOSettings::Create(mFbxManager, IOSROOT);
-        mFbxManager->SetIOSettings(ios);
-    }
+        // 回退读取器（FBX SDK）完整解析过的底模场景，输出 blendShape 时直接使用，不再重新导入
+        class ParsedScenes {
+        public:
+            explicit ParsedScenes(shared_ptr<FbxManagerPool> managers) : mManagers(std::move(managers)) {}
 
-    FbxModelHandle::~FbxModelHandle() {
-        if (mFbxScene) {
-            mFbxScene->Destroy();
-            mFbxScene = nullptr;
-        }
+            void keep(const string& path, FbxManager* manager, FbxScene* scene, const FileStamp& stamp) {
+                auto parsed = make_shared<PooledFbxScene>(mManagers, manager, scene, stamp);
+                lock_guard<mutex> guard(mLock);
+                mScenes.emplace(path, std::move(parsed));
+            }
+
+            // 取出 path 的场景交给调用方，没有时返回空指针
+            shared_ptr<PooledFbxScene> take(const string& path) {
+                lock_guard<mutex> guard(mLock);
+                auto it = mScenes.find(path);
+                if (it == mScenes.end()) {
+                    return nullptr;
+                }
+                shared_ptr<PooledFbxScene> scene = std::move(it->second);
+                mScenes.erase(it);
+                return scene;
+            }
+
+        private:
+            shared_ptr<FbxManagerPool> mManagers;
+            mutex mLock;
+            map<string, shared_ptr<PooledFbxScene>> mScenes;
+        };
+
+        using SceneImporter = bool (*)(FbxManager* manager, const string& fbxPath, MeshSet& meshData, string& error, FbxScene** keptScene);
 
-        if (mFbxManager) {
-            mFbxManager->Destroy();
-            mFbxManager = nullptr;
+        // 每次调用借用一个 FbxManager；basePaths 中的文件保留解析出的场景供输出使用
+        MeshLoader pooledSdkLoader(shared_ptr<FbxManagerPool> managers, ParsedScenes& parsed, set<string> basePaths, SceneImporter importer) {
+            return [managers, &parsed, basePaths, importer](const string& fbxPath, MeshSet& meshData, string& error) {
+                FbxManager* manager = managers->acquire();
+                if (!manager) {
+                    error = "Failed to create FBX Manager";
+                    return false;
+                }
+                // 导入前取得文件状态，导入期间文件被修改时缓存的场景随即失效
+                FileStamp stamp;
+                readFileStamp(fbxPath, stamp);
+                FbxScene* scene = nullptr;
+                bool imported = importer(manager, fbxPath, meshData, error, basePaths.count(fbxPath) ? &scene : nullptr);
+                if (scene) {
+                    parsed.keep(fbxPath, manager, scene, stamp);
+                } else {
+                    managers->release(manager);
+                }
+                return imported;
+            };
+        }
+
+        // 一个底模的 blendShape 输出：在工作线程上写入并导出，主线程上输出日志并导入
+        struct BaseOutput {
+            string outputPath;
+            vector<string> channelNames;
+            BlendShapeBuildStats stats;
+            double elapsedMs = 0.0;
+            bool exported = false;
+            vector<pair<LogLevel, string>> logs;
+        };
+
+        void finishJobsOnIdle(void*) {
+            FbxModelHandle::finishPendingJobs();
         }
-    }
 
-    bool FbxModelHandle::createFbxScene(const char* fbxPath) {
-        if (mFbxScene) {
-            mFbxScene->Destroy();
-            mFbxScene = nullptr;
+        // 异步任务的后台阶段结束时在工作线程上调用，把收尾安排到 Maya 主线程的空闲时间
+        void scheduleFinishOnIdle() {
+            MGlobal::executeTaskOnIdle(finishJobsOnIdle, nullptr);
         }
 
-        mFbxScene = FbxScene::Create(mFbxManager, "");
-        if (!mFbxScene) {
-            MGlobal::displayError("Failed to create FBX Scene");
-            return false;
+        string blendShapeOutputPath(const string& basefbx) {
+            return basefbx.substr(0, basefbx.find_last_of(".")) + "_blendshape.fbx";
         }
 
-        FbxImporter* importer = FbxImporter::Create(mFbxManager, "");
-        bool importStatus = importer->Initialize(fbxPath, -1, mFbxManager->GetIOSettings());
+        // 把稀疏目标写入 FBX 场景中底模网格的 FbxBlendShape
+        class FbxSceneBlendShapeHost : public BlendShapeHost {
+        public:
+            FbxSceneBlendShapeHost(FbxScene* scene, function<FbxNode*(const string&)> findNode)
+                : mScene(scene), mFindNode(std::move(findNode)), mMesh(nullptr), mBlendShape(nullptr) {}
 
-        if (!importStatus) {
-            MGlobal::displayError(MString("Failed to initialize importer for: ") + fbxPath);
-            importer->Destroy();
-            return false;
-        }
+            bool beginMesh(const string& meshName, size_t& vertexCount) override {
+                mMesh = nullptr;
+                mBlendShape = nullptr;
+                FbxNode* meshNode = mFindNode(meshName);
+                if (!meshNode) {
+                    logWarning("Mesh not found in scene: " + meshName);
+                    return false;
+                }
+                mMesh = meshNode->GetMesh();
+                if (!mMesh) {
+                    logWarning("Node is not a mesh: " + meshName);
+                    return false;
+                }
+                mBlendShape = FbxBlendShape::Create(mScene, (meshName + "_blendshape").c_str());
+                mCreated.push_back(mBlendShape);
+                vertexCount = static_cast<size_t>(mMesh->GetControlPointsCount());
+                return true;
+            }
 
-        importStatus = importer->Import(mFbxScene);
-        importer->Destroy();
+            bool addTarget(const string& channelName, const SparseShapeDelta& delta) override {
+                FbxBlendShapeChannel* channel = FbxBlendShapeChannel::Create(mScene, channelName.c_str());
+                FbxShape* shape = FbxShape::Create(mScene, channelName.c_str());
+                mCreated.push_back(channel);
+                mCreated.push_back(shape);
+
+                // 稀疏目标：控制点数组与索引数组一一对应，控制点保存目标的绝对位置
+                const FbxVector4* meshPoints = mMesh->GetControlPoints();
+                const int pointCount = static_cast<int>(delta.size());
+                shape->InitControlPoints(pointCount);
+                shape->SetControlPointIndicesCount(pointCount);
+                FbxVector4* shapePoints = shape->GetControlPoints();
+                int* shapeIndices = shape->GetControlPointIndices();
+                for (int k = 0; k < pointCount; ++k) {
+                    const uint32_t i = delta.indices[k];
+                    shapeIndices[k] = static_cast<int>(i);
+                    shapePoints[k].Set(meshPoints[i][0] + delta.dx[k],
+                                       meshPoints[i][1] + delta.dy[k],
+                                       meshPoints[i][2] + delta.dz[k]);
+                }
 
-        if (!importStatus) {
-            MGlobal::displayError(MString("Failed to import FBX file: ") + fbxPath);
-            return false;
-        }
+                mBlendShape->AddBlendShapeChannel(channel);
+                channel->AddTargetShape(shape);
+                mChannelNames.push_back(channelName);
+                return true;
+            }
+
+            void endMesh(size_t targetCount) override {
+                if (!mBlendShape) {
+                    return;
+                }
+                if (targetCount > 0) {
+                    mMesh->AddDeformer(mBlendShape);
+                    mDeformed.emplace_back(mMesh, mBlendShape);
+                } else {
+                    mCreated.pop_back();
+                    mBlendShape->Destroy();
+                }
+                mBlendShape = nullptr;
+            }
+
+            const vector<string>& channelNames() const { return mChannelNames; }
+
+            // 去掉写入的 blendShape 并销毁创建的对象，场景恢复为写入前的状态
+            void revert() {
+                for (auto& [mesh, blendShape] : mDeformed) {
+                    for (int d = mesh->GetDeformerCount() - 1; d >= 0; --d) {
+                        if (mesh->GetDeformer(d) == blendShape) {
+                            mesh->RemoveDeformer(d);
+                        }
+                    }
+                }
+                for (auto it = mCreated.rbegin(); it != mCreated.rend(); ++it) {
+                    (*it)->Destroy();
+                }
+                mDeformed.clear();
+                mCreated.clear();
+            }
+
+        private:
+            FbxScene* mScene;
+            function<FbxNode*(const string&)> mFindNode;
+            FbxMesh* mMesh;
+            FbxBlendShape* mBlendShape;
+            vector<string> mChannelNames;
+            vector<FbxObject*> mCreated;
+            vector<pair<FbxMesh*, FbxBlendShape*>> mDeformed;
+        };
 
-        return true;
     }
 
-    void FbxModelHandle::processNode(FbxNode* node, map<string, vector<array<double, 3>>>& meshData) {
+    FbxModelHandle::FbxModelHandle() : mDirectBlendShapes(false) {}
+
+    void FbxModelHandle::processNode(FbxNode* node, MeshSet& meshData) {
         if (!node) return;
 
         FbxNodeAttribute* attr = node->GetNodeAttribute();
@@ -77,17 +212,15 @@ namespace cf {
                 int controlPointsCount = mesh->GetControlPointsCount();
                 FbxVector4* controlPoints = mesh->GetControlPoints();
 
-                vector<array<double, 3>> vertices;
+                size_t slot = meshData.addMesh(meshName, static_cast<size_t>(controlPointsCount));
+                double* x = meshData.x(slot);
+                double* y = meshData.y(slot);
+                double* z = meshData.z(slot);
                 for (int i = 0; i < controlPointsCount; ++i) {
-                    array<double, 3> vertex = {
-                        controlPoints[i][0],
-                        controlPoints[i][1],
-                        controlPoints[i][2]
-                    };
-                    vertices.push_back(vertex);
+                    x[i] = controlPoints[i][0];
+                    y[i] = controlPoints[i][1];
+                    z[i] = controlPoints[i][2];
                 }
-
-                meshData[meshName] = vertices;
             }
         }
 
@@ -96,563 +229,295 @@ namespace cf {
         }
     }
 
-    map<string, vector<array<double, 3>>> FbxModelHandle::getModelVertices() {
-        map<string, vector<array<double, 3>>> meshData;
-        if (!mFbxScene) {
-            MGlobal::displayError("FBX Scene is not initialized");
-            return meshData;
+    bool FbxModelHandle::importMeshVertices(FbxManager* manager, const string& fbxPath, MeshSet& meshData, string& error, FbxScene** keptScene) {
+        TraceSpan span("importFbxSdk", fbxPath);
+        FbxScene* scene = FbxSession::importScene(manager, fbxPath, error);
+        if (!scene) {
+            return false;
         }
 
-        FbxNode* rootNode = mFbxScene->GetRootNode();
-        if (rootNode) {
-            processNode(rootNode, meshData);
+        processNode(scene->GetRootNode(), meshData);
+        if (keptScene) {
+            *keptScene = scene;
         } else {
-            MGlobal::displayError("Root node is null");
+            scene->Destroy();
         }
-
-        return meshData;
+        span.setArg("vertices", static_cast<int64_t>(meshData.vertexCount()));
+        return true;
     }
 
-    void FbxModelHandle::processMultipleFbxFiles(const vector<string>& fbxFiles, const string& outputPath, const string& jsonPath) {
-        if (fbxFiles.size() < 2) {
-            MGlobal::displayError("Need at least two FBX files to process");
-            return;
-        }
-        
-        vector<map<string, vector<array<double,3>>>> fbxData;
-        
-        for (size_t i = 0; i < fbxFiles.size(); ++i) {
-            string fbxPath = fbxFiles[i];
-            MGlobal::displayInfo(MString("Processing FBX file: ") + fbxPath.c_str());
-            
-            if (createFbxScene(fbxPath.c_str())) {
-                auto meshData = getModelVertices();
-                if (!meshData.empty()) {
-                    fbxData.push_back(meshData);
-                }
-            }
-        }
-        vector<vector<array<double, 3>>> allHeadData;
-        for (const auto& data : fbxData) {
-            auto it = data.find("head_lod0_mesh");
-            if (it != data.end()) {
-                allHeadData.push_back(it->second);
+    struct FbxModelHandle::BlendShapeWork {
+        BlendShapeWork(const PipelineOptions& options, bool batch, bool direct)
+            : batch(batch), direct(direct), managers(FbxSession::shared().managers()), cache(FbxSession::shared().cache()),
+              parsed(managers), pipeline(options) {}
+
+        bool batch;                     // 多底模批处理：fbxFiles 全部为目标模型
+        bool direct;
+        vector<string> bases;           // 去重后的底模
+        vector<string> fbxFiles;        // 单底模时为全部输入文件，第一个为底模
+        string jsonPath;
+        shared_ptr<FbxManagerPool> managers;  // 会话打开时为会话的池
+        shared_ptr<SessionCache> cache;       // 会话缓存，未打开会话时为空
+        ParsedScenes parsed;
+        BlendShapePipeline pipeline;
+        vector<BatchResult> results;
+        vector<BaseOutput> outputs;
+    };
+
+    shared_ptr<FbxModelHandle::BlendShapeWork> FbxModelHandle::createWork(bool batch, const vector<string>& baseFiles, const vector<string>& fbxFiles,
+                                                                          const string& jsonPath) const {
+        auto work = make_shared<BlendShapeWork>(mOptions, batch, mDirectBlendShapes);
+        work->fbxFiles = fbxFiles;
+        work->jsonPath = jsonPath;
+        if (!batch && !fbxFiles.empty()) {
+            work->bases.push_back(fbxFiles[0]);
+        }
+        // 同一个底模只输出一次
+        set<string> seen;
+        for (const string& base : baseFiles) {
+            if (seen.insert(base).second) {
+                work->bases.push_back(base);
             }
         }
-    
-        vector<int> correspondenceIndices;
-        srand(static_cast<unsigned int>(time(nullptr)));
-        for (int i = 0; i < 100; i++) {
-            correspondenceIndices.push_back(rand() % 24001); // 生成0-24000范围内的随机数
-        }
-        vector<vector<array<double, 3>>> correspondencePoints;
-        for (const auto& data : allHeadData) {
-            vector<array<double, 3>> points;
-            for (int idx : correspondenceIndices) {
-                if (idx < data.size()) {
-                    points.push_back(data[idx]);
-                }
-            }
-            correspondencePoints.push_back(points);
-        }
+        return work;
+    }
 
-        vector<array<array<double,4>,4>> transforms;
-        for (size_t i = 1; i < correspondencePoints.size(); ++i) {
-            MGlobal::displayInfo(MString("Computing transform for model ") + static_cast<double>(i));
-            transforms.push_back(calculateRigidTransformation(correspondencePoints[0], correspondencePoints[i]));
+    void FbxModelHandle::processMultipleFbxFiles(const vector<string>& fbxFiles, const string& outputPath, const string& jsonPath) {
+        ScopedLogSink logSink(mayaLogSink);
+        shared_ptr<BlendShapeWork> work = createWork(false, {}, fbxFiles, jsonPath);
+        if (computeBlendShapes(*work, nullptr)) {
+            applyBlendShapes(*work);
         }
+    }
 
-        for (size_t i = 0; i < transforms.size(); ++i) {
-            MString msg;
-            msg += MString("Transform----------------------------- ") + (i+1) + ":\n";
-            for (const auto& row : transforms[i]) {
-                for (double val : row) {
-                    msg += val;
-                    msg += " ";
-                }
-                msg += "\n";
-            }
-            MGlobal::displayInfo(msg);
+    void FbxModelHandle::processBatch(const vector<string>& baseFiles, const vector<string>& targetFiles, const string& jsonPath) {
+        ScopedLogSink logSink(mayaLogSink);
+        shared_ptr<BlendShapeWork> work = createWork(true, baseFiles, targetFiles, jsonPath);
+        if (computeBlendShapes(*work, nullptr)) {
+            applyBlendShapes(*work);
         }
+    }
 
-        for (size_t i = 1; i < fbxData.size(); ++i) {
-            const auto& transform = transforms[i-1];
-            for (auto& [meshName, vertices] : fbxData[i]) {
-                vector<array<double,3>> newVertices;
-                for (const auto& vertex : vertices) {
-                    newVertices.push_back(applyTransformation(vertex, transform));
+    uint64_t FbxModelHandle::submitMultipleFbxFiles(const vector<string>& fbxFiles, const string& jsonPath, function<void(JobState)> onFinished) {
+        return submitWork(createWork(false, {}, fbxFiles, jsonPath), std::move(onFinished));
+    }
+
+    uint64_t FbxModelHandle::submitBatch(const vector<string>& baseFiles, const vector<string>& targetFiles, const string& jsonPath,
+                                         function<void(JobState)> onFinished) {
+        return submitWork(createWork(true, baseFiles, targetFiles, jsonPath), std::move(onFinished));
+    }
+
+    uint64_t FbxModelHandle::submitWork(shared_ptr<BlendShapeWork> work, function<void(JobState)> onFinished) {
+        PipelineJobEngine& engine = PipelineJobEngine::shared();
+        engine.setCompletionNotifier(scheduleFinishOnIdle);
+        return engine.submit(
+            [work](JobProgress& progress) {
+                return computeBlendShapes(*work, &progress);
+            },
+            [work, onFinished](JobState outcome) {
+                if (outcome == JobState::Succeeded) {
+                    applyBlendShapes(*work);
                 }
-                fbxData[i][meshName] = newVertices;
-            }
+                if (onFinished) {
+                    onFinished(outcome);
+                }
+            });
+    }
+
+    void FbxModelHandle::finishPendingJobs() {
+        ScopedLogSink logSink(mayaLogSink);
+        PipelineJobEngine::shared().runPendingFinalizers();
+    }
+
+    bool FbxModelHandle::computeBlendShapes(BlendShapeWork& work, JobProgress* progress) {
+        TraceSpan span(work.batch ? "processBatch" : "processMultipleFbxFiles");
+        span.setArg("bases", static_cast<int64_t>(work.bases.size()));
+        span.setArg("files", static_cast<int64_t>(work.fbxFiles.size()));
+
+        // 二进制FBX由核心库的原生读取器读取，其余文件通过 FBX SDK 导入
+        BlendShapePipeline& pipeline = work.pipeline;
+        pipeline.setProgress(progress);
+        pipeline.setSessionCache(work.cache.get());
+        pipeline.setFallbackLoader(pooledSdkLoader(work.managers, work.parsed, set<string>(work.bases.begin(), work.bases.end()),
+                                                   &FbxModelHandle::importMeshVertices));
+        if (work.batch) {
+            work.results = pipeline.prepareBatch(work.bases, work.fbxFiles, work.jsonPath);
+        } else {
+            work.results.resize(1);
+            work.results[0].baseFile = work.bases.empty() ? string() : work.bases[0];
+            work.results[0].prepared = pipeline.prepare(work.fbxFiles, work.jsonPath, work.results[0].result);
+        }
+        if (none_of(work.results.begin(), work.results.end(), [](const BatchResult& entry) { return entry.prepared; })) {
+            return false;
         }
 
-        nlohmann::json weightJson = readWeightJson(jsonPath);
-        
-        vector<map<string, vector<array<double,3>>>> alignedData = fbxData;
-        vector<map<string, vector<array<double,3>>>> meshGap;
-        map<string, vector<array<double,3>>> vertexData;
-
-        if (!weightJson.empty()) {
-            MGlobal::displayInfo("Aligning facial features based on region centers...");
-            alignedData = alignRegionsByCenter(fbxData, weightJson);
-        }
-        
-        meshGap = getMeshGap(alignedData);
-        
-        for (const auto& [regionName, vertices] : alignedData[0]) {
-            vector<array<double,3>> regionVertices;
-            for (const auto& vertex : vertices) {
-                array<double,3> v = {vertex[0], vertex[1], vertex[2]};
-                regionVertices.push_back(v);
-            }
-            vertexData[regionName] = regionVertices;
+        // 直接模式按名称修改当前场景中的底模网格，只能在主线程上进行
+        if (work.direct) {
+            return true;
         }
-        
-        createBlendShapes(fbxFiles[0], weightJson, meshGap, vertexData);
-    }
-    
-    vector<map<string, vector<array<double, 3>>>> FbxModelHandle::alignRegionsByCenter(const vector<map<string, vector<array<double, 3>>>>& fbxData, const nlohmann::json& weightJson) {
-        if (fbxData.size() < 3) {
-            MGlobal::displayWarning("Need at least two meshes to perform region alignment");
-            return fbxData;
-        }
-        
-        vector<map<string, vector<array<double, 3>>>> result = fbxData;
-        const auto& baseMesh = result[0];
-        
-        MGlobal::displayInfo("Performing region-based alignment");
-        
-        for (size_t i = 1; i < result.size(); ++i) {
-            auto& targetMesh = result[i];
-            result[i] = adjustVerticesByRegion(baseMesh, targetMesh, weightJson);
-        }
-        
-        MGlobal::displayInfo("Region alignment completed");
-        return result;
-    }
-    
-    map<string, vector<array<double, 3>>> FbxModelHandle::adjustVerticesByRegion(
-        const map<string, vector<array<double, 3>>>& baseMesh, 
-        map<string, vector<array<double, 3>>>& targetMesh, 
-        const nlohmann::json& regionWeights) {
-        
-        map<string, vector<array<double, 3>>> result = targetMesh;
-        map<string, vector<string>> regionToModelMap = {
-            {"eyes_blendshape", {"saliva_lod0_mesh", "eyeRight_lod0_mesh", "eyeLeft_lod0_mesh", "eyeshell_lod0_mesh", "eyelashes_lod0_mesh", "eyeEdge_lod0_mesh", "cartilage_lod0_mesh"}},
-            {"mouth_blendshape", {"teeth_lod0_mesh"}}
-        };
-        map<string, array<double, 3>> offsetMap;
-        for (auto& [regionName, regions] : regionWeights.items()) {
-            if (regionName != "head_lod0_mesh") {
-                continue;
+        if (progress) {
+            if (progress->cancelled()) {
+                logWarning("Cancelled before stage: export");
+                return false;
             }
-            
-            if (baseMesh.find(regionName) == baseMesh.end() || targetMesh.find(regionName) == targetMesh.end()) {
-                continue;
-            }
-            
-            const auto& baseVertices = baseMesh.at(regionName);
-            auto& targetVertices = targetMesh.at(regionName);
-            for (auto& [subRegionName, indices] : regions.items()) {
-                vector<array<double, 3>> baseRegionVertices;
-                vector<array<double, 3>> targetRegionVertices;
-                vector<size_t> vertexIndices;
-                vector<double> weights;
-                
-                for (auto& [indexStr, weight] : indices.items()) {
-                    size_t index = std::stoul(indexStr);
-                    if (index < baseVertices.size() && index < targetVertices.size()) {
-                        vertexIndices.push_back(index);
-                        baseRegionVertices.push_back(baseVertices[index]);
-                        targetRegionVertices.push_back(targetVertices[index]);
-                        weights.push_back(weight);
+            progress->beginStage("export", BlendShapePipeline::kPrepareProgressEnd, 1.0, work.results.size());
+        }
+
+        // 每个底模在各自的 FbxManager 上写入 blendShape 并导出，FBX SDK 对象不跨线程共享；
+        // 回退读取器已解析的底模场景直接使用，其余底模各导入一次
+        work.outputs.assign(work.results.size(), BaseOutput());
+        parallelFor(work.results.size(), pipeline.options().workerCount, [&](size_t b) {
+            ThreadLogBuffer buffer;
+            BaseOutput& output = work.outputs[b];
+            const string& base = work.results[b].baseFile;
+            if (work.results[b].prepared) {
+                TraceSpan baseSpan("createBlendShapes", base);
+                auto start = chrono::steady_clock::now();
+                output.outputPath = blendShapeOutputPath(base);
+                string error;
+                shared_ptr<PooledFbxScene> pooled = work.parsed.take(base);
+                if (pooled) {
+                    logInfo("Reusing FBX scene parsed during import: " + base);
+                } else if (work.cache && (pooled = work.cache->take<PooledFbxScene>(base))) {
+                    logInfo("Reusing FBX scene from session: " + base);
+                } else {
+                    TraceSpan sceneSpan("loadBaseScene", base);
+                    FileStamp stamp;
+                    readFileStamp(base, stamp);
+                    FbxManager* manager = work.managers->acquire();
+                    FbxScene* scene = manager ? FbxSession::importScene(manager, base, error) : nullptr;
+                    if (scene) {
+                        pooled = make_shared<PooledFbxScene>(work.managers, manager, scene, stamp);
+                    } else if (manager) {
+                        work.managers->release(manager);
                     }
                 }
-                
-                if (baseRegionVertices.empty() || targetRegionVertices.empty()) {
-                    continue;
-                }
-                
-                array<double, 3> baseCenter = calculateRegionCenter(baseRegionVertices);
-                array<double, 3> targetCenter = calculateRegionCenter(targetRegionVertices);
-                
-                array<double, 3> offset = {
-                    targetCenter[0] - baseCenter[0],
-                    targetCenter[1] - baseCenter[1],
-                    targetCenter[2] - baseCenter[2]
-                };
-
-                offsetMap[subRegionName] = offset;
-
-                for (size_t i = 0; i < vertexIndices.size(); ++i) {
-                    size_t index = vertexIndices[i];
-                    double weight = weights[i];
-                    
-                    for (int j = 0; j < 3; ++j) {
-                        result[regionName][index][j] -= offset[j] * weight;
+                if (pooled) {
+                    FbxScene* scene = pooled->scene();
+                    FbxSceneBlendShapeHost host(scene, [scene](const string& name) {
+                        return findNodeByName(scene->GetRootNode(), name);
+                    });
+                    output.stats = pipeline.build(work.results[b].result, host);
+                    output.channelNames = host.channelNames();
+                    output.exported = exportScene(pooled->manager(), scene, output.outputPath, error);
+                    if (work.cache) {
+                        // 去掉本次写入的 blendShape，底模场景恢复原样后留给之后的命令
+                        host.revert();
+                        work.cache->insert(base, pooled->stamp(), pooled, estimateSceneBytes(scene));
                     }
                 }
-            }
-        }
-        for (const auto& [subRegionName, offset] : offsetMap) {
-            for (const auto& modelName : regionToModelMap[subRegionName]) {
-                for (size_t i = 0; i < result[modelName].size(); ++i) {
-                    for (int j = 0; j < 3; ++j) {
-                        result[modelName][i][j] -= offset[j];
-                    }
+                if (!error.empty()) {
+                    logError(error);
                 }
+                output.elapsedMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
             }
-        }
-        
-        return result;
-    }
-    
-    array<double, 3> FbxModelHandle::calculateRegionCenter(const vector<array<double, 3>>& vertices) {
-        array<double, 3> center = {0.0, 0.0, 0.0};
-        
-        if (vertices.empty()) {
-            return center;
-        }
-        
-        for (const auto& vertex : vertices) {
-            for (int i = 0; i < 3; ++i) {
-                center[i] += vertex[i];
+            output.logs = buffer.messages();
+            if (progress) {
+                progress->advance();
             }
-        }
-        
-        for (int i = 0; i < 3; ++i) {
-            center[i] /= static_cast<double>(vertices.size());
-        }
-        
-        return center;
-    }
-    
-    vector<array<double, 3>> FbxModelHandle::adjustRegionVertices(
-        const vector<array<double, 3>>& baseVertices, 
-        vector<array<double, 3>>& targetVertices, 
-        double weight) {
-        
-        if (baseVertices.size() != targetVertices.size() || baseVertices.empty()) {
-            return targetVertices;
-        }
-        
-        array<double, 3> baseCenter = calculateRegionCenter(baseVertices);
-        array<double, 3> targetCenter = calculateRegionCenter(targetVertices);
-        
-        array<double, 3> offset = {
-            targetCenter[0] - baseCenter[0],
-            targetCenter[1] - baseCenter[1],
-            targetCenter[2] - baseCenter[2]
-        };
-        
-        vector<array<double, 3>> result = targetVertices;
-        for (size_t i = 0; i < result.size(); ++i) {
-            for (int j = 0; j < 3; ++j) {
-                result[i][j] -= offset[j] * weight;
-            }
-        }
-        
-        return result;
+        });
+        return true;
     }
 
-    array<array<double,4>,4> FbxModelHandle::calculateRigidTransformation(const vector<array<double,3>>& src_points, const vector<array<double,3>>& tgt_points) {
-        MGlobal::displayInfo(MString("Computing transform with source points: ") + static_cast<double>(src_points.size()) + " target points: " + static_cast<double>(tgt_points.size()));
-        
-        if (src_points.size() != tgt_points.size() || src_points.empty()) {
-            MGlobal::displayWarning("Invalid points for transform computation");
-            return array<array<double,4>,4>{{{0.0, 0.0, 0.0, 0.0}, {0.0, 0.0, 0.0, 0.0}, {0.0, 0.0, 0.0, 0.0}, {0.0, 0.0, 0.0, 0.0}}};
-        }
-
-        array<double,3> src_centroid = {0.0, 0.0, 0.0};
-        array<double,3> tgt_centroid = {0.0, 0.0, 0.0};
-        for (const auto& p : src_points) {
-            for (int i = 0; i < 3; ++i) src_centroid[i] += p[i];
-        }
-        for (const auto& p : tgt_points) {
-            for (int i = 0; i < 3; ++i) tgt_centroid[i] += p[i];
-        }
-        for (int i = 0; i < 3; ++i) {
-            src_centroid[i] /= src_points.size();
-            tgt_centroid[i] /= tgt_points.size();
-        }
-
-        vector<array<double,3>> src_centered(src_points.size());
-        vector<array<double,3>> tgt_centered(tgt_points.size());
-        for (size_t i = 0; i < src_points.size(); ++i) {
-            for (int j = 0; j < 3; ++j) {
-                src_centered[i][j] = src_points[i][j] - src_centroid[j];
-                tgt_centered[i][j] = tgt_points[i][j] - tgt_centroid[j];
-            }
-        }
-
-        double src_scale = 0.0, tgt_scale = 0.0;
-        for (const auto& p : src_centered) {
-            src_scale += p[0]*p[0] + p[1]*p[1] + p[2]*p[2];
-        }
-        for (const auto& p : tgt_centered) {
-            tgt_scale += p[0]*p[0] + p[1]*p[1] + p[2]*p[2];
-        }
-        src_scale = sqrt(src_scale);
-        tgt_scale = sqrt(tgt_scale);
-        double scale = src_scale / (tgt_scale + 1e-10);
-
-        array<array<double,3>,3> H = {{{0.0, 0.0, 0.0}, {0.0, 0.0, 0.0}, {0.0, 0.0, 0.0}}};
-        for (size_t i = 0; i < src_points.size(); ++i) {
-            for (int j = 0; j < 3; ++j) {
-                for (int k = 0; k < 3; ++k) {
-                    H[j][k] += tgt_centered[i][j] * src_centered[i][k];
+    void FbxModelHandle::applyBlendShapes(BlendShapeWork& work) {
+        const double deltaEpsilon = work.pipeline.options().deltaEpsilon;
+        if (work.direct) {
+            for (const BatchResult& entry : work.results) {
+                if (!entry.prepared) {
+                    continue;
                 }
+                TraceSpan baseSpan("createBlendShapes", entry.baseFile);
+                auto start = chrono::steady_clock::now();
+                MayaBlendShapeHost host;
+                logBuildStats(work.pipeline.build(entry.result, host), deltaEpsilon,
+                              chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
             }
+            return;
         }
 
-        array<array<double,3>,3> R = {{{1.0, 0.0, 0.0}, {0.0, 1.0, 0.0}, {0.0, 0.0, 1.0}}};
-
-        array<double,3> t;
-        for (int i = 0; i < 3; ++i) {
-            t[i] = src_centroid[i];
-            double Rt = 0;
-            for (int j = 0; j < 3; ++j) {
-                Rt += scale * R[i][j] * tgt_centroid[j];
+        // Maya 场景只能在主线程上修改：统一删除同名模型后依次导入各底模的输出
+        vector<string> channelNames;
+        for (size_t b = 0; b < work.outputs.size(); ++b) {
+            ThreadLogBuffer::replay(work.outputs[b].logs);
+            if (work.results[b].prepared) {
+                if (work.batch) {
+                    MGlobal::displayInfo(MString("Base ") + static_cast<unsigned>(b + 1) + ": " + work.results[b].baseFile.c_str());
+                }
+                logBuildStats(work.outputs[b].stats, deltaEpsilon, work.outputs[b].elapsedMs);
             }
-            t[i] -= Rt;
+            channelNames.insert(channelNames.end(), work.outputs[b].channelNames.begin(), work.outputs[b].channelNames.end());
         }
-
-        array<array<double,4>,4> transform = {{{0.0, 0.0, 0.0, 0.0}, {0.0, 0.0, 0.0, 0.0}, {0.0, 0.0, 0.0, 0.0}, {0.0, 0.0, 0.0, 0.0}}};
-        for (int i = 0; i < 3; ++i) {
-            array<double,3> row;
-            for (int j = 0; j < 3; ++j) {
-                row[j] = scale * R[i][j];
-                transform[i][j] = row[j];
+        deleteModelsByName(channelNames);
+        for (const BaseOutput& output : work.outputs) {
+            if (output.exported) {
+                MGlobal::displayInfo(MString("Successfully exported FBX file to: ") + output.outputPath.c_str());
+                reimportFbx(output.outputPath);
             }
-            transform[i][3] = t[i];
         }
-        transform[3][3] = 1.0;
-
-        return transform;
     }
 
-    array<double,3> FbxModelHandle::applyTransformation(const array<double,3>& point, const array<array<double,4>,4>& transform) {
-        array<double,3> result = {0.0, 0.0, 0.0};
-        for (int i = 0; i < 3; ++i) {
-            result[i] = transform[i][3];
-            for (int j = 0; j < 3; ++j) {
-                result[i] += transform[i][j] * point[j];
-            }
+    void FbxModelHandle::logBuildStats(const BlendShapeBuildStats& stats, double deltaEpsilon, double elapsedMs) {
+        MGlobal::displayInfo(MString("Blend shape channels: ") + static_cast<double>(stats.channels) + " emitted, "
+            + static_cast<double>(stats.prunedChannels) + " pruned (epsilon " + deltaEpsilon + "), "
+            + static_cast<double>(stats.shapePoints) + " shape points instead of " + static_cast<double>(stats.densePoints)
+            + " (" + elapsedMs + " ms)");
+        if (stats.skippedMeshes > 0 || stats.failedChannels > 0) {
+            MGlobal::displayWarning(MString("Skipped meshes: ") + static_cast<double>(stats.skippedMeshes)
+                + ", failed channels: " + static_cast<double>(stats.failedChannels));
         }
-        return result;
     }
 
-    vector<map<string, vector<array<double, 3>>>> FbxModelHandle::getMeshGap(const vector<map<string, vector<array<double, 3>>>>& meshData) {
-        if (meshData.size() < 2) {
-            MGlobal::displayWarning("Need at least two meshes to calculate gap");
-            return {};
-        }
-        
-        vector<map<string, vector<array<double, 3>>>> result;
-        result.reserve(meshData.size() - 1);
-        
-        const auto& baseMesh = meshData[0];
-        
-        map<string, size_t> vertexCounts;
-        for (const auto& [regionName, vertices] : baseMesh) {
-            vertexCounts[regionName] = vertices.size();
-        }
-        
-        for (size_t i = 1; i < meshData.size(); ++i) {
-            const auto& currentMesh = meshData[i];
-            map<string, vector<array<double, 3>>> regionGap;
-            
-            for (const auto& [regionName, baseVertices] : baseMesh) {
-                auto currentIt = currentMesh.find(regionName);
-                if (currentIt == currentMesh.end()) {
-                    continue;
-                }
-                
-                const auto& currentVertices = currentIt->second;
-                const size_t expectedSize = vertexCounts[regionName];
-                
-                if (currentVertices.size() != expectedSize) {
-                    continue;
-                }
-                
-                vector<array<double, 3>> meshGap;
-                meshGap.reserve(expectedSize);
-                
-                for (size_t j = 0; j < expectedSize; ++j) {
-                    const auto& baseVert = baseVertices[j];
-                    const auto& currentVert = currentVertices[j];
-                    meshGap.push_back(array<double, 3>{baseVert[0] - currentVert[0],
-                                                           baseVert[1] - currentVert[1],
-                                                           baseVert[2] - currentVert[2]});
-                }
-                
-                regionGap[regionName] = std::move(meshGap);
-            }
-            
-            result.push_back(std::move(regionGap));
-        }
-        
-        return result;
+
+    MStatus FbxModelHandle::deleteModelByName(const MString& modelName) {
+        return deleteModelsByName({modelName.asChar()});
     }
 
-    void FbxModelHandle::createBlendShapes(const string& basefbx, const nlohmann::json& weightJson, const vector<map<string, vector<array<double,3>>>>& distance, map<string, vector<array<double,3>>>& vertexData) {
-        if (!createFbxScene(basefbx.c_str())) { 
-            MGlobal::displayError(MString("Failed to create FBX scene from base file: ") + basefbx.c_str());
-            return;
+    MStatus FbxModelHandle::deleteModelsByName(const vector<string>& modelNames, unsigned* deletedCount) {
+        if (deletedCount) {
+            *deletedCount = 0;
         }
-        
-        map<string, map<string, map<string, double>>> jsonData;
-        for (auto meshIt = weightJson.begin(); meshIt != weightJson.end(); ++meshIt) {
-            for (auto blendIt = meshIt.value().begin(); blendIt != meshIt.value().end(); ++blendIt) {
-                for (auto weightIt = blendIt.value().begin(); weightIt != blendIt.value().end(); ++weightIt) {
-                    jsonData[meshIt.key()][blendIt.key()][weightIt.key()] = weightIt.value();
-                }
-            }
+        if (modelNames.empty()) {
+            return MS::kSuccess;
         }
-        
-        for (const auto& [meshName, blendShapes] : jsonData) {
-            FbxNode* rootNode = mFbxScene->GetRootNode();
-            FbxNode* meshNode = findNodeByName(rootNode, meshName);
-            
-            if (!meshNode) {
-                MGlobal::displayWarning(MString("Mesh not found in scene: ") + meshName.c_str());
-                continue;
-            }
-            
-            FbxMesh* mesh = meshNode->GetMesh();
-            if (!mesh) {
-                MGlobal::displayWarning(MString("Node is not a mesh: ") + meshName.c_str());
-                continue;
-            }
-            string meshName = meshNode->GetName();
-
-            FbxBlendShape* blendShape = FbxBlendShape::Create(mFbxScene, (meshName + "_blendshape").c_str());
-            
-            for (const auto& [regionName, weights] : blendShapes) {
-                vector<string> suffixes = {"source_L", "source_M", "source_R"};
-                
-                for (int suffixIndex = 0; suffixIndex < suffixes.size(); ++suffixIndex) {
-                    string channelName = meshName + regionName + "_" + suffixes[suffixIndex];
-                    
-                    FbxBlendShapeChannel* channel = FbxBlendShapeChannel::Create(mFbxScene, channelName.c_str());
-                    
-                    FbxShape* shape = FbxShape::Create(mFbxScene, channelName.c_str());
-                    
-                    shape->InitControlPoints(mesh->GetControlPointsCount());
-                    FbxVector4* shapePoints = shape->GetControlPoints();
-                    FbxVector4* meshPoints = mesh->GetControlPoints();
-                    
-                    for (int i = 0; i < mesh->GetControlPointsCount(); i++) {
-                        string vertexIndex = std::to_string(i);
-                        auto weightIt = weights.find(vertexIndex);
-                        if (weightIt != weights.end() && weightIt->second != 0) {
-                            if (suffixIndex < distance.size()) {
-                                auto& meshDistances = distance[suffixIndex];
-                                auto meshIt = meshDistances.find(meshName);
-                                if (meshIt != meshDistances.end() && i < meshIt->second.size()) {
-                                    double x = meshPoints[i][0] - meshIt->second[i][0] * weightIt->second;
-                                    double y = meshPoints[i][1] - meshIt->second[i][1] * weightIt->second;
-                                    double z = meshPoints[i][2] - meshIt->second[i][2] * weightIt->second;
-                                    shapePoints[i].Set(x, y, z);
-                                } else {
-                                    shapePoints[i] = meshPoints[i];
-                                }
-                            } else {
-                                shapePoints[i] = meshPoints[i];
-                            }
-                        } else {
-                            shapePoints[i] = meshPoints[i];
-                        }
-                    }
-                    
-                    blendShape->AddBlendShapeChannel(channel);
-                    channel->AddTargetShape(shape);
-                    deleteModelByName(MString(channelName.c_str()));
-                }
-            }
-            
-            mesh->AddDeformer(blendShape);
-        }
-
-        string outputPath = basefbx.substr(0, basefbx.find_last_of(".")) + "_blendshape.fbx";
-        saveFbxFile(outputPath);
-    }
 
+        TraceSpan span("deleteModels");
+        auto start = chrono::steady_clock::now();
+        unordered_set<string> names(modelNames.begin(), modelNames.end());
 
-    MStatus FbxModelHandle::deleteModelByName(const MString& modelName) {
+        // 一次遍历场景中的变换节点，名称（去掉命名空间）命中时整棵子树一起删除，不再深入
         MStatus status;
-        MSelectionList selection;
-        // 支持通配符查找
-        status = MGlobal::getSelectionListByName("*" + modelName, selection);
-        if (selection.length() == 0) {
-            MGlobal::displayWarning("No model found for: " + modelName);
-            return MS::kNotFound;
-        }
-        for (unsigned int i = 0; i < selection.length(); ++i) {
-            MDagPath dagPath;
-            status = selection.getDagPath(i, dagPath);
-            if (status == MS::kSuccess) {
-                MObject node = dagPath.node();
-                MDagModifier dagMod;
-                dagMod.deleteNode(node);
-                dagMod.doIt();
-                MGlobal::displayInfo("Deleted model: " + dagPath.fullPathName());
+        MDagModifier dagMod;
+        unsigned matched = 0;
+        MItDag it(MItDag::kDepthFirst, MFn::kTransform, &status);
+        for (; status && !it.isDone(); it.next()) {
+            MFnDagNode dagNode(it.currentItem());
+            string nodeName = dagNode.name().asChar();
+            size_t namespaceEnd = nodeName.find_last_of(':');
+            if (!names.count(nodeName) && (namespaceEnd == string::npos || !names.count(nodeName.substr(namespaceEnd + 1)))) {
+                continue;
             }
+            dagMod.deleteNode(it.currentItem());
+            ++matched;
+            it.prune();
         }
-        return MS::kSuccess;
-    }
 
-    void FbxModelHandle::saveJsonFile(const vector<map<string, vector<array<double, 3>>>>& data, const string& filePath) {
-        nlohmann::json j;
-        
-        for (size_t i = 0; i < data.size(); ++i) {
-            const auto& meshes = data[i];
-            nlohmann::json meshJson;
-            
-            for (const auto& [meshName, vertices] : meshes) {
-                meshJson[meshName] = vertices;
-            }
-            
-            j.push_back(meshJson);
-        }
-        
-        try {
-            FILE* fp = fopen(filePath.c_str(), "w");
-            if (fp) {
-                string jsonStr = j.dump(4);
-                fwrite(jsonStr.c_str(), 1, jsonStr.size(), fp);
-                fclose(fp);
-            } else {
-                MGlobal::displayError(MString("Failed to open file for writing: ") + filePath.c_str());
-            }
-        } catch (const exception& e) {
-            MGlobal::displayError(MString("Error saving JSON file: ") + e.what());
+        if (matched == 0) {
+            MGlobal::displayWarning(MString("No model found for ") + static_cast<double>(names.size()) + " names");
+            return MS::kNotFound;
         }
-    }
 
-    nlohmann::json FbxModelHandle::readWeightJson(const string& weightJsonPath) {
-        nlohmann::json weightJson;
-        
-        try {
-            FILE* fp = fopen(weightJsonPath.c_str(), "r");
-            if (fp) {
-                fseek(fp, 0, SEEK_END);
-                long fileSize = ftell(fp);
-                fseek(fp, 0, SEEK_SET);
-                
-                string jsonContent(fileSize, ' ');
-                fread(&jsonContent[0], 1, fileSize, fp);
-                fclose(fp);
-                
-                weightJson = nlohmann::json::parse(jsonContent);
-            } else {
-                MGlobal::displayError(MString("Failed to open weight JSON file: ") + weightJsonPath.c_str());
-            }
-        } catch (const exception& e) {
-            MGlobal::displayError(MString("Error parsing weight JSON: ") + e.what());
+        span.setArg("models", static_cast<int64_t>(matched));
+        status = dagMod.doIt();
+        double elapsedMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        if (!status) {
+            MGlobal::displayError("Failed to delete generated models");
+            return status;
+        }
+        if (deletedCount) {
+            *deletedCount = matched;
         }
-        
-        return weightJson;
+        MGlobal::displayInfo(MString("Deleted ") + static_cast<double>(matched) + " models for " + static_cast<double>(names.size()) + " names in " + elapsedMs + " ms");
+        return MS::kSuccess;
     }
 
     FbxNode* FbxModelHandle::findNodeByName(FbxNode* node, const string& name) {
@@ -669,70 +534,58 @@ namespace cf {
         return nullptr;
     }
     
-    bool FbxModelHandle::saveFbxFile(const string& outputPath) {
-        if (!mFbxScene || !mFbxManager) {
-            MGlobal::displayError("FBX Scene or Manager is not initialized");
+    bool FbxModelHandle::exportScene(FbxManager* manager, FbxScene* scene, const string& outputPath, string& error) {
+        if (!scene || !manager) {
+            error = "FBX Scene or Manager is not initialized";
             return false;
         }
-        
-        string dirPath = outputPath;
-        size_t lastSlash = dirPath.find_last_of("/\\");
-        if (lastSlash != string::npos) {
-            dirPath = dirPath.substr(0, lastSlash);
-            
-            MString checkDirCmd = "file -q -exists \"" + MString(dirPath.c_str()) + "\"";
-            int dirExists = 0;
-            MGlobal::executeCommand(checkDirCmd, dirExists);
-            
-            if (!dirExists) {
-                MString createDirCmd = "sysFile -makeDir \"" + MString(dirPath.c_str()) + "\"";
-                int result = 0;
-                MGlobal::executeCommand(createDirCmd, result);
-                
-                if (!result) {
-                    MGlobal::displayError(MString("Failed to create directory: ") + dirPath.c_str());
-                    return false;
-                }
-                
-                MGlobal::displayInfo(MString("Created directory: ") + dirPath.c_str());
+
+        filesystem::path dirPath = filesystem::path(outputPath).parent_path();
+        if (!dirPath.empty() && !filesystem::exists(dirPath)) {
+            error_code dirError;
+            if (!filesystem::create_directories(dirPath, dirError)) {
+                error = "Failed to create directory: " + dirPath.string();
+                return false;
             }
+            logInfo("Created directory: " + dirPath.string());
         }
-        
-        FbxExporter* exporter = FbxExporter::Create(mFbxManager, "");
+
+        TraceSpan exportSpan("exportFbx", outputPath);
+        FbxExporter* exporter = FbxExporter::Create(manager, "");
         if (!exporter) {
-            MGlobal::displayError("Failed to create FBX exporter");
+            error = "Failed to create FBX exporter";
             return false;
         }
-        
-        int fileFormat = mFbxManager->GetIOPluginRegistry()->FindWriterIDByDescription("FBX ascii (*.fbx)");
-        bool initResult = exporter->Initialize(outputPath.c_str(), fileFormat, mFbxManager->GetIOSettings());
+
+        int fileFormat = manager->GetIOPluginRegistry()->FindWriterIDByDescription("FBX ascii (*.fbx)");
+        bool initResult = exporter->Initialize(outputPath.c_str(), fileFormat, manager->GetIOSettings());
         if (!initResult) {
-            MString errorMsg = "Failed to initialize FBX exporter. Error: ";
-            errorMsg += exporter->GetStatus().GetErrorString();
-            MGlobal::displayError(errorMsg);
+            error = string("Failed to initialize FBX exporter. Error: ") + exporter->GetStatus().GetErrorString();
             exporter->Destroy();
             return false;
         }
-        
-        bool success = exporter->Export(mFbxScene);
-        
+
+        bool success = exporter->Export(scene);
         exporter->Destroy();
-        
         if (!success) {
-            MString errorMsg = "Failed to export FBX file. Error: ";
-            MGlobal::displayError(errorMsg);
+            error = "Failed to export FBX file: " + outputPath;
             return false;
         }
-        
-        MString msg = "Successfully exported FBX file to: ";
-        msg += outputPath.c_str();
-        MGlobal::displayInfo(msg);
-        
-        MString openCmd = "file -import -type \"FBX\" -ignoreVersion -ra true -mergeNamespacesOnClash false -namespace \"" + 
+
+        if (exportSpan.active()) {
+            error_code sizeError;
+            uintmax_t bytes = filesystem::file_size(outputPath, sizeError);
+            exportSpan.setArg("bytes", sizeError ? 0 : static_cast<int64_t>(bytes));
+        }
+        return true;
+    }
+
+    void FbxModelHandle::reimportFbx(const string& outputPath) {
+        MString openCmd = "file -import -type \"FBX\" -ignoreVersion -ra true -mergeNamespacesOnClash false -namespace \"" +
                           MString(outputPath.c_str()) + "\" -options \"fbx\" \"" + MString(outputPath.c_str()) + "\"";
+        TraceSpan importSpan("reimportFbx", outputPath);
         MGlobal::executeCommand(openCmd);
+        importSpan.finish();
         MGlobal::displayInfo("Opened FBX file in Maya");
-        
-        return true;
     }
 }
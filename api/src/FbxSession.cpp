@@ -0,0 +1,193 @@
+#include "FbxSession.h"
+#include "Trace.h"
+
+namespace cf {
+
+    FbxManagerPool::~FbxManagerPool() {
+        for (FbxManager* manager : mIdle) {
+            manager->Destroy();
+        }
+    }
+
+    FbxManager* FbxManagerPool::acquire() {
+        {
+            lock_guard<mutex> guard(mLock);
+            if (!mIdle.empty()) {
+                FbxManager* manager = mIdle.back();
+                mIdle.pop_back();
+                return manager;
+            }
+        }
+        FbxManager* manager = FbxManager::Create();
+        if (manager) {
+            manager->SetIOSettings(FbxIOSettings::Create(manager, IOSROOT));
+        }
+        return manager;
+    }
+
+    void FbxManagerPool::release(FbxManager* manager) {
+        lock_guard<mutex> guard(mLock);
+        mIdle.push_back(manager);
+    }
+
+    size_t FbxManagerPool::idleCount() const {
+        lock_guard<mutex> guard(mLock);
+        return mIdle.size();
+    }
+
+    PooledFbxScene::~PooledFbxScene() {
+        if (mScene) {
+            mScene->Destroy();
+        }
+        if (mManager) {
+            mPool->release(mManager);
+        }
+    }
+
+    uint64_t estimateSceneBytes(FbxScene* scene) {
+        uint64_t bytes = static_cast<uint64_t>(scene->GetNodeCount()) * 512;
+        for (int g = 0; g < scene->GetGeometryCount(); ++g) {
+            FbxGeometry* geometry = scene->GetGeometry(g);
+            bytes += static_cast<uint64_t>(geometry->GetControlPointsCount()) * sizeof(FbxVector4);
+            if (FbxMesh* mesh = FbxCast<FbxMesh>(geometry)) {
+                // 多边形顶点索引以及按多边形顶点存放的法线与UV
+                bytes += static_cast<uint64_t>(mesh->GetPolygonVertexCount()) * (sizeof(int) + sizeof(FbxVector4) + sizeof(FbxVector2));
+            }
+        }
+        return bytes;
+    }
+
+    FbxSession& FbxSession::shared() {
+        static FbxSession session;
+        return session;
+    }
+
+    FbxSession::~FbxSession() {
+        close();
+    }
+
+    void FbxSession::open(uint64_t budgetBytes) {
+        lock_guard<mutex> guard(mLock);
+        if (mCache) {
+            mCache->setBudget(budgetBytes);
+            return;
+        }
+        mManagers = make_shared<FbxManagerPool>();
+        mCache = make_shared<SessionCache>(budgetBytes);
+    }
+
+    void FbxSession::close() {
+        shared_ptr<SessionCache> cache;
+        shared_ptr<FbxManagerPool> managers;
+        unique_ptr<PooledFbxScene> autoRigScene;
+        {
+            lock_guard<mutex> guard(mLock);
+            cache = std::move(mCache);
+            managers = std::move(mManagers);
+            autoRigScene = std::move(mAutoRigScene);
+        }
+        // 仍在运行的后台任务持有的场景与管理器在任务结束后释放
+        if (cache) {
+            cache->clear();
+        }
+    }
+
+    bool FbxSession::isOpen() const {
+        lock_guard<mutex> guard(mLock);
+        return mCache != nullptr;
+    }
+
+    shared_ptr<FbxManagerPool> FbxSession::managers() {
+        lock_guard<mutex> guard(mLock);
+        return mManagers ? mManagers : make_shared<FbxManagerPool>();
+    }
+
+    shared_ptr<SessionCache> FbxSession::cache() {
+        lock_guard<mutex> guard(mLock);
+        return mCache;
+    }
+
+    FbxSessionStats FbxSession::stats() const {
+        lock_guard<mutex> guard(mLock);
+        FbxSessionStats stats;
+        stats.open = mCache != nullptr;
+        if (mCache) {
+            stats.cache = mCache->stats();
+        }
+        if (mManagers) {
+            stats.idleManagers = mManagers->idleCount();
+        }
+        return stats;
+    }
+
+    bool FbxSession::loadAutoRigScene(const string& fbxPath, string& error) {
+        TraceSpan span("loadGlobalScene", fbxPath);
+        return replaceAutoRigScene([&](FbxManager* manager, string& createError) -> FbxScene* {
+            if (!fbxPath.empty()) {
+                return importScene(manager, fbxPath, createError);
+            }
+            FbxScene* scene = FbxScene::Create(manager, "");
+            if (!scene) {
+                createError = "Failed to create global FBX Scene";
+            }
+            return scene;
+        }, error);
+    }
+
+    bool FbxSession::replaceAutoRigScene(const function<FbxScene*(FbxManager*, string&)>& create, string& error) {
+        shared_ptr<FbxManagerPool> pool = managers();
+        unique_ptr<PooledFbxScene> previous;
+        {
+            lock_guard<mutex> guard(mLock);
+            previous = std::move(mAutoRigScene);
+        }
+        previous.reset();
+
+        FbxManager* manager = pool->acquire();
+        if (!manager) {
+            error = "Failed to create global FBX Manager";
+            return false;
+        }
+        FbxScene* scene = create(manager, error);
+        if (!scene) {
+            pool->release(manager);
+            return false;
+        }
+
+        lock_guard<mutex> guard(mLock);
+        mAutoRigScene = make_unique<PooledFbxScene>(pool, manager, scene);
+        return true;
+    }
+
+    FbxScene* FbxSession::autoRigScene() const {
+        lock_guard<mutex> guard(mLock);
+        return mAutoRigScene ? mAutoRigScene->scene() : nullptr;
+    }
+
+    FbxScene* FbxSession::importScene(FbxManager* manager, const string& fbxPath, string& error) {
+        FbxScene* scene = FbxScene::Create(manager, "");
+        if (!scene) {
+            error = "Failed to create FBX Scene";
+            return nullptr;
+        }
+
+        FbxImporter* importer = FbxImporter::Create(manager, "");
+        bool importStatus = importer->Initialize(fbxPath.c_str(), -1, manager->GetIOSettings());
+        if (!importStatus) {
+            error = "Failed to initialize importer for: " + fbxPath;
+            importer->Destroy();
+            scene->Destroy();
+            return nullptr;
+        }
+
+        importStatus = importer->Import(scene);
+        importer->Destroy();
+        if (!importStatus) {
+            error = "Failed to import FBX file: " + fbxPath;
+            scene->Destroy();
+            return nullptr;
+        }
+        return scene;
+    }
+
+}
@@ -0,0 +1,424 @@
+#include "GeometryCache.h"
+#include "ContentHash.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <nlohmann/json.hpp>
+
+namespace cf {
+
+    namespace {
+
+        // 几何文件布局（小端）：
+        //   GeometryHeader | GeometryMesh[meshCount] | 名称字符串 | double x[vertexCount] | y[vertexCount] | z[vertexCount]
+        // 各段起始偏移按 kGeometryAlignment 对齐
+        const char kGeometryMagic[8] = {'C', 'F', 'G', 'E', 'O', 'M', 0, 0};
+        const uint32_t kGeometryVersion = 1;
+        const uint32_t kGeometryByteOrder = 0x01020304;
+        const uint64_t kGeometryAlignment = 64;
+        const char* kIndexFileName = "index.json";
+        const char* kEntryExtension = ".cfg";
+
+        struct GeometryHeader {
+            char magic[8];
+            uint32_t version;
+            uint32_t byteOrder;
+            uint64_t sourceHash;
+            uint64_t sourceSize;
+            uint64_t fileSize;
+            uint64_t meshCount;
+            uint64_t vertexCount;
+            uint64_t meshOffset;
+            uint64_t stringOffset;
+            uint64_t stringSize;
+            uint64_t coordOffset;
+        };
+
+        struct GeometryMesh {
+            uint32_t nameOffset;
+            uint32_t nameLength;
+            uint64_t vertexOffset;
+            uint64_t vertexCount;
+            uint64_t topology;
+        };
+
+        uint64_t alignUp(uint64_t value) {
+            return (value + kGeometryAlignment - 1) / kGeometryAlignment * kGeometryAlignment;
+        }
+
+        bool inFile(uint64_t offset, uint64_t bytes, uint64_t fileSize) {
+            return offset <= fileSize && bytes <= fileSize - offset;
+        }
+
+        string hexHash(uint64_t hash) {
+            char text[17];
+            snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(hash));
+            return text;
+        }
+
+        bool parseHexHash(const string& text, uint64_t& hash) {
+            if (text.size() != 16) {
+                return false;
+            }
+            char* end = nullptr;
+            hash = strtoull(text.c_str(), &end, 16);
+            return *end == '\0';
+        }
+
+    }
+
+    GeometryCache::GeometryCache(const string& directory, uint64_t budgetBytes) : mDirectory(directory), mBudgetBytes(budgetBytes) {
+        mStats.budgetBytes = budgetBytes;
+        loadIndex();
+    }
+
+    string GeometryCache::defaultDirectory() {
+        error_code error;
+        filesystem::path temp = filesystem::temp_directory_path(error);
+        if (error) {
+            return string();
+        }
+        return (temp / "CharacterFactory" / "geometry").string();
+    }
+
+    uint64_t GeometryCache::topologyFingerprint(const int32_t* polygonVertexIndex, size_t count) {
+        return hashBytes(polygonVertexIndex, count * sizeof(int32_t));
+    }
+
+    string GeometryCache::entryPath(uint64_t contentHash) const {
+        return (filesystem::path(mDirectory) / (hexHash(contentHash) + kEntryExtension)).string();
+    }
+
+    int64_t GeometryCache::nextUseStamp() {
+        // 调用方持有 mLock；使用时间戳严格递增，同一次运行中的使用先后也能区分
+        int64_t now = chrono::duration_cast<chrono::microseconds>(chrono::system_clock::now().time_since_epoch()).count();
+        mUseStamp = max(now, mUseStamp + 1);
+        return mUseStamp;
+    }
+
+    void GeometryCache::loadIndex() {
+        // 目录中实际存在的几何文件为准，索引只提供预检记录与使用时间
+        error_code error;
+        for (filesystem::directory_iterator it(mDirectory, error), end; !error && it != end; it.increment(error)) {
+            const filesystem::path& path = it->path();
+            uint64_t hash = 0;
+            if (path.extension() != kEntryExtension || !parseHexHash(path.stem().string(), hash)) {
+                continue;
+            }
+            error_code sizeError;
+            uint64_t bytes = filesystem::file_size(path, sizeError);
+            if (!sizeError) {
+                mEntries[hash] = {bytes, 0};
+            }
+        }
+
+        ifstream file(filesystem::path(mDirectory) / kIndexFileName);
+        if (!file) {
+            return;
+        }
+        nlohmann::json index;
+        try {
+            file >> index;
+            for (const auto& [hashText, entry] : index.at("entries").items()) {
+                uint64_t hash = 0;
+                auto it = parseHexHash(hashText, hash) ? mEntries.find(hash) : mEntries.end();
+                if (it != mEntries.end()) {
+                    it->second.lastUsed = entry.at("lastUsed").get<int64_t>();
+                    mUseStamp = max(mUseStamp, it->second.lastUsed);
+                }
+            }
+            for (const auto& [path, record] : index.at("files").items()) {
+                uint64_t hash = 0;
+                if (parseHexHash(record.at("hash").get<string>(), hash) && mEntries.count(hash)) {
+                    mFiles[path] = {record.at("size").get<uint64_t>(), record.at("mtime").get<int64_t>(), hash};
+                }
+            }
+        } catch (const exception&) {
+            // 索引损坏时只丢失预检记录，条目仍可通过内容哈希命中
+            mFiles.clear();
+        }
+    }
+
+    bool GeometryCache::lookup(const string& path, GeometryCacheKey& key, MeshSet& meshes, vector<uint64_t>* topology) {
+        key = GeometryCacheKey();
+        key.path = filesystem::absolute(filesystem::path(path)).lexically_normal().string();
+
+        error_code error;
+        key.size = filesystem::file_size(path, error);
+        if (error) {
+            return false;
+        }
+        key.modifiedTime = static_cast<int64_t>(filesystem::last_write_time(path, error).time_since_epoch().count());
+        if (error) {
+            return false;
+        }
+
+        bool precheck = false;
+        {
+            lock_guard<mutex> guard(mLock);
+            auto it = mFiles.find(key.path);
+            if (it != mFiles.end() && it->second.size == key.size && it->second.modifiedTime == key.modifiedTime) {
+                key.contentHash = it->second.contentHash;
+                precheck = true;
+            }
+        }
+        if (!precheck && !hashFile(path, key.contentHash)) {
+            return false;
+        }
+        key.valid = true;
+
+        bool found = false;
+        {
+            lock_guard<mutex> guard(mLock);
+            found = mEntries.count(key.contentHash) > 0;
+        }
+        if (found && readEntry(entryPath(key.contentHash), key, meshes, topology)) {
+            lock_guard<mutex> guard(mLock);
+            ++mStats.hits;
+            if (precheck) {
+                ++mStats.precheckHits;
+            }
+            mEntries[key.contentHash].lastUsed = nextUseStamp();
+            mFiles[key.path] = {key.size, key.modifiedTime, key.contentHash};
+            mDirty = true;
+            return true;
+        }
+
+        lock_guard<mutex> guard(mLock);
+        ++mStats.misses;
+        return false;
+    }
+
+    bool GeometryCache::readEntry(const string& entryFile, const GeometryCacheKey& key, MeshSet& meshes, vector<uint64_t>* topology) const {
+        MappedFile file;
+        if (!file.open(entryFile)) {
+            return false;
+        }
+        const uint8_t* data = file.data();
+        const uint64_t fileSize = file.size();
+        GeometryHeader header;
+        if (fileSize < sizeof(header)) {
+            return false;
+        }
+        memcpy(&header, data, sizeof(header));
+
+        const uint64_t vertexCount = header.vertexCount;
+        const bool headerOk = memcmp(header.magic, kGeometryMagic, sizeof(kGeometryMagic)) == 0
+            && header.version == kGeometryVersion && header.byteOrder == kGeometryByteOrder
+            && header.sourceHash == key.contentHash && header.sourceSize == key.size
+            && header.fileSize == fileSize
+            && header.meshOffset % kGeometryAlignment == 0 && header.coordOffset % kGeometryAlignment == 0
+            && vertexCount <= fileSize / sizeof(double)
+            && inFile(header.meshOffset, header.meshCount * sizeof(GeometryMesh), fileSize)
+            && inFile(header.stringOffset, header.stringSize, fileSize)
+            && inFile(header.coordOffset, 3 * vertexCount * sizeof(double), fileSize);
+        if (!headerOk) {
+            return false;
+        }
+
+        const GeometryMesh* entries = reinterpret_cast<const GeometryMesh*>(data + header.meshOffset);
+        const char* names = reinterpret_cast<const char*>(data + header.stringOffset);
+        const double* x = reinterpret_cast<const double*>(data + header.coordOffset);
+        const double* y = x + vertexCount;
+        const double* z = y + vertexCount;
+
+        MeshSet loaded;
+        vector<uint64_t> fingerprints;
+        loaded.reserve(static_cast<size_t>(header.meshCount), static_cast<size_t>(vertexCount));
+        for (uint64_t m = 0; m < header.meshCount; ++m) {
+            const GeometryMesh& entry = entries[m];
+            if (!inFile(entry.nameOffset, entry.nameLength, header.stringSize) || entry.vertexOffset > vertexCount
+                || entry.vertexCount > vertexCount - entry.vertexOffset) {
+                return false;
+            }
+            size_t slot = loaded.addMesh(string(names + entry.nameOffset, entry.nameLength), static_cast<size_t>(entry.vertexCount));
+            memcpy(loaded.x(slot), x + entry.vertexOffset, entry.vertexCount * sizeof(double));
+            memcpy(loaded.y(slot), y + entry.vertexOffset, entry.vertexCount * sizeof(double));
+            memcpy(loaded.z(slot), z + entry.vertexOffset, entry.vertexCount * sizeof(double));
+            fingerprints.push_back(entry.topology);
+        }
+
+        meshes = std::move(loaded);
+        if (topology) {
+            *topology = std::move(fingerprints);
+        }
+        return true;
+    }
+
+    bool GeometryCache::store(const GeometryCacheKey& key, const MeshSet& meshes, const vector<uint64_t>& topology, string& error) {
+        if (!key.valid) {
+            error = "Geometry cache key is not valid: " + key.path;
+            return false;
+        }
+
+        error_code dirError;
+        filesystem::create_directories(mDirectory, dirError);
+        if (dirError) {
+            error = "Failed to create geometry cache directory: " + mDirectory;
+            return false;
+        }
+
+        GeometryHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, kGeometryMagic, sizeof(kGeometryMagic));
+        header.version = kGeometryVersion;
+        header.byteOrder = kGeometryByteOrder;
+        header.sourceHash = key.contentHash;
+        header.sourceSize = key.size;
+        header.meshCount = meshes.meshCount();
+        header.vertexCount = meshes.vertexCount();
+
+        // 写出时按网格顺序紧凑排列坐标
+        string names;
+        vector<GeometryMesh> entries(meshes.meshCount());
+        uint64_t vertexOffset = 0;
+        for (size_t m = 0; m < meshes.meshCount(); ++m) {
+            const string& name = meshes.name(m);
+            entries[m] = {static_cast<uint32_t>(names.size()), static_cast<uint32_t>(name.size()), vertexOffset, meshes.vertexCount(m),
+                          m < topology.size() ? topology[m] : 0};
+            names += name;
+            vertexOffset += meshes.vertexCount(m);
+        }
+
+        header.meshOffset = alignUp(sizeof(GeometryHeader));
+        header.stringOffset = header.meshOffset + entries.size() * sizeof(GeometryMesh);
+        header.stringSize = names.size();
+        header.coordOffset = alignUp(header.stringOffset + names.size());
+        header.fileSize = header.coordOffset + 3 * header.vertexCount * sizeof(double);
+
+        const string entryFile = entryPath(key.contentHash);
+        // 临时文件名带上键的内容，多个线程同时写同一内容时互不干扰
+        const string tempPath = entryFile + "." + hexHash(hashBytes(key.path.data(), key.path.size())) + ".tmp";
+        FILE* fp = fopen(tempPath.c_str(), "wb");
+        if (!fp) {
+            error = "Failed to open geometry cache for writing: " + tempPath;
+            return false;
+        }
+
+        uint64_t written = 0;
+        bool ok = true;
+        auto put = [&](uint64_t offset, const void* data, size_t bytes) {
+            static const char zeros[kGeometryAlignment] = {};
+            while (ok && written < offset) {
+                size_t pad = static_cast<size_t>(min<uint64_t>(offset - written, kGeometryAlignment));
+                ok = fwrite(zeros, 1, pad, fp) == pad;
+                written += pad;
+            }
+            if (ok && bytes > 0) {
+                ok = fwrite(data, 1, bytes, fp) == bytes;
+                written += bytes;
+            }
+        };
+        put(0, &header, sizeof(header));
+        put(header.meshOffset, entries.data(), entries.size() * sizeof(GeometryMesh));
+        put(header.stringOffset, names.data(), names.size());
+        put(header.coordOffset, nullptr, 0);
+        for (int axis = 0; axis < 3; ++axis) {
+            for (size_t m = 0; m < meshes.meshCount(); ++m) {
+                const double* values = axis == 0 ? meshes.x(m) : axis == 1 ? meshes.y(m) : meshes.z(m);
+                put(written, values, meshes.vertexCount(m) * sizeof(double));
+            }
+        }
+        ok = fclose(fp) == 0 && ok;
+
+        if (!ok) {
+            remove(tempPath.c_str());
+            error = "Failed to write geometry cache: " + tempPath;
+            return false;
+        }
+
+        // Windows 下 rename 不能覆盖已存在的文件，先删除旧文件
+        remove(entryFile.c_str());
+        if (rename(tempPath.c_str(), entryFile.c_str()) != 0) {
+            remove(tempPath.c_str());
+            error = "Failed to replace geometry cache: " + entryFile;
+            return false;
+        }
+
+        lock_guard<mutex> guard(mLock);
+        mEntries[key.contentHash] = {header.fileSize, nextUseStamp()};
+        mFiles[key.path] = {key.size, key.modifiedTime, key.contentHash};
+        ++mStats.stores;
+        mDirty = true;
+        return true;
+    }
+
+    bool GeometryCache::flush(string& error) {
+        lock_guard<mutex> guard(mLock);
+
+        uint64_t total = 0;
+        for (const auto& [hash, entry] : mEntries) {
+            total += entry.bytes;
+        }
+        if (total > mBudgetBytes) {
+            vector<pair<int64_t, uint64_t>> byAge;
+            for (const auto& [hash, entry] : mEntries) {
+                byAge.push_back({entry.lastUsed, hash});
+            }
+            sort(byAge.begin(), byAge.end());
+            for (const auto& [lastUsed, hash] : byAge) {
+                if (total <= mBudgetBytes) {
+                    break;
+                }
+                remove(entryPath(hash).c_str());
+                total -= mEntries[hash].bytes;
+                mEntries.erase(hash);
+                ++mStats.evictions;
+                mDirty = true;
+            }
+            for (auto it = mFiles.begin(); it != mFiles.end();) {
+                it = mEntries.count(it->second.contentHash) ? next(it) : mFiles.erase(it);
+            }
+        }
+
+        if (!mDirty) {
+            return true;
+        }
+
+        nlohmann::json entries = nlohmann::json::object();
+        for (const auto& [hash, entry] : mEntries) {
+            entries[hexHash(hash)] = {{"bytes", entry.bytes}, {"lastUsed", entry.lastUsed}};
+        }
+        nlohmann::json files = nlohmann::json::object();
+        for (const auto& [path, record] : mFiles) {
+            files[path] = {{"size", record.size}, {"mtime", record.modifiedTime}, {"hash", hexHash(record.contentHash)}};
+        }
+
+        error_code dirError;
+        filesystem::create_directories(mDirectory, dirError);
+        const filesystem::path indexPath = filesystem::path(mDirectory) / kIndexFileName;
+        const string tempPath = indexPath.string() + ".tmp";
+        {
+            ofstream file(tempPath, ios::trunc);
+            file << nlohmann::json{{"version", kGeometryVersion}, {"entries", std::move(entries)}, {"files", std::move(files)}}.dump(1);
+            if (!file) {
+                error = "Failed to write geometry cache index: " + tempPath;
+                return false;
+            }
+        }
+        remove(indexPath.string().c_str());
+        if (rename(tempPath.c_str(), indexPath.string().c_str()) != 0) {
+            remove(tempPath.c_str());
+            error = "Failed to replace geometry cache index: " + indexPath.string();
+            return false;
+        }
+        mDirty = false;
+        return true;
+    }
+
+    GeometryCacheStats GeometryCache::stats() const {
+        lock_guard<mutex> guard(mLock);
+        GeometryCacheStats result = mStats;
+        result.entryCount = mEntries.size();
+        result.totalBytes = 0;
+        for (const auto& [hash, entry] : mEntries) {
+            result.totalBytes += entry.bytes;
+        }
+        return result;
+    }
+
+}
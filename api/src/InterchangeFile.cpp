@@ -0,0 +1,485 @@
+#include "InterchangeFile.h"
+#include "MappedFile.h"
+#include "Trace.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+
+namespace cf {
+
+    namespace {
+
+        // 交换文件布局（小端）：
+        //   FileHeader | FileMeshSet[meshSetCount] | FileMesh[meshCount] | FileChannel[channelCount] | FileWeightRegion[weightRegionCount]
+        //   | 名称字符串 | double x[vertexCount] | y | z | uint32 通道索引[pointCount] | double dx[pointCount] | dy | dz
+        //   | uint32 权重索引[weightCount] | float 权重[weightCount]
+        // 各段起始偏移按 kAlignment 对齐。新增字段时提高版本号，读取方拒绝不认识的版本
+        const char kMagic[8] = {'C', 'F', 'X', 'C', 'H', 'G', 0, 0};
+        const uint32_t kByteOrder = 0x01020304;
+        const uint64_t kAlignment = 64;
+
+        struct FileHeader {
+            char magic[8];
+            uint32_t version;
+            uint32_t byteOrder;
+            uint64_t fileSize;
+            uint64_t meshSetCount;
+            uint64_t meshCount;
+            uint64_t channelCount;
+            uint64_t weightRegionCount;
+            uint64_t vertexCount;
+            uint64_t pointCount;
+            uint64_t weightCount;
+            uint64_t meshSetOffset;
+            uint64_t meshOffset;
+            uint64_t channelOffset;
+            uint64_t weightRegionOffset;
+            uint64_t stringOffset;
+            uint64_t stringSize;
+            uint64_t coordOffset;
+            uint64_t pointIndexOffset;
+            uint64_t deltaOffset;
+            uint64_t weightIndexOffset;
+            uint64_t weightOffset;
+        };
+
+        struct FileMeshSet {
+            uint32_t nameOffset;
+            uint32_t nameLength;
+            uint32_t firstMesh;
+            uint32_t meshCount;
+        };
+
+        struct FileMesh {
+            uint32_t nameOffset;
+            uint32_t nameLength;
+            uint64_t vertexOffset;
+            uint64_t vertexCount;
+            uint64_t topology;
+        };
+
+        struct FileChannel {
+            uint32_t meshNameOffset;
+            uint32_t meshNameLength;
+            uint32_t nameOffset;
+            uint32_t nameLength;
+            uint64_t pointOffset;
+            uint64_t pointCount;
+        };
+
+        struct FileWeightRegion {
+            uint32_t meshNameOffset;
+            uint32_t meshNameLength;
+            uint32_t nameOffset;
+            uint32_t nameLength;
+            uint64_t begin;
+            uint64_t count;
+        };
+
+        uint64_t alignUp(uint64_t value) {
+            return (value + kAlignment - 1) / kAlignment * kAlignment;
+        }
+
+        bool inFile(uint64_t offset, uint64_t bytes, uint64_t fileSize) {
+            return offset <= fileSize && bytes <= fileSize - offset;
+        }
+
+        bool inRange(uint64_t first, uint64_t count, uint64_t total) {
+            return first <= total && count <= total - first;
+        }
+
+        // 相同名称只存一份
+        class StringTable {
+        public:
+            pair<uint32_t, uint32_t> add(const string& text) {
+                auto inserted = mOffsets.emplace(text, static_cast<uint32_t>(mText.size()));
+                if (inserted.second) {
+                    mText += text;
+                }
+                return {inserted.first->second, static_cast<uint32_t>(text.size())};
+            }
+
+            const string& text() const { return mText; }
+
+        private:
+            string mText;
+            unordered_map<string, uint32_t> mOffsets;
+        };
+
+    }
+
+    size_t InterchangeWriter::addMeshSet(const string& name, const MeshSet& meshes, const vector<uint64_t>& topology) {
+        MeshSetRecord record;
+        record.name = name;
+        record.meshes = meshes;
+        record.topology = topology;
+        if (record.topology.empty()) {
+            for (size_t m = 0; m < meshes.meshCount(); ++m) {
+                const MeshTopology* meshTopology = meshes.topology(m);
+                record.topology.push_back(meshTopology ? meshTopology->fingerprint : 0);
+            }
+        }
+        record.topology.resize(meshes.meshCount(), 0);
+        mMeshSets.push_back(std::move(record));
+        return mMeshSets.size() - 1;
+    }
+
+    bool InterchangeWriter::beginMesh(const string& meshName, size_t& vertexCount) {
+        if (mMeshSets.empty()) {
+            return false;
+        }
+        const MeshSet& base = mMeshSets[0].meshes;
+        int slot = base.find(meshName);
+        if (slot < 0) {
+            return false;
+        }
+        mMeshName = meshName;
+        vertexCount = base.vertexCount(slot);
+        return true;
+    }
+
+    bool InterchangeWriter::addTarget(const string& channelName, const SparseShapeDelta& delta) {
+        mChannels.push_back({mMeshName, channelName, mPointIndices.size(), delta.size()});
+        mPointIndices.insert(mPointIndices.end(), delta.indices.begin(), delta.indices.end());
+        mDx.insert(mDx.end(), delta.dx.begin(), delta.dx.end());
+        mDy.insert(mDy.end(), delta.dy.begin(), delta.dy.end());
+        mDz.insert(mDz.end(), delta.dz.begin(), delta.dz.end());
+        return true;
+    }
+
+    void InterchangeWriter::endMesh(size_t) {
+        mMeshName.clear();
+    }
+
+    bool InterchangeWriter::save(const string& path, string& error) const {
+        TraceSpan span("writeInterchange", path);
+        FileHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, kMagic, sizeof(kMagic));
+        header.version = InterchangeFile::kVersion;
+        header.byteOrder = kByteOrder;
+
+        StringTable names;
+        vector<FileMeshSet> meshSets;
+        vector<FileMesh> meshes;
+        for (const MeshSetRecord& record : mMeshSets) {
+            auto name = names.add(record.name);
+            meshSets.push_back({name.first, name.second, static_cast<uint32_t>(meshes.size()), static_cast<uint32_t>(record.meshes.meshCount())});
+            for (size_t m = 0; m < record.meshes.meshCount(); ++m) {
+                auto meshName = names.add(record.meshes.name(m));
+                meshes.push_back({meshName.first, meshName.second, header.vertexCount, record.meshes.vertexCount(m), record.topology[m]});
+                header.vertexCount += record.meshes.vertexCount(m);
+            }
+        }
+
+        vector<FileChannel> channels;
+        for (const ChannelRecord& record : mChannels) {
+            auto meshName = names.add(record.mesh);
+            auto name = names.add(record.name);
+            channels.push_back({meshName.first, meshName.second, name.first, name.second, record.pointOffset, record.pointCount});
+        }
+
+        vector<FileWeightRegion> weightRegions;
+        for (size_t r = 0; r < mWeights.regionCount(); ++r) {
+            const WeightRegion& region = mWeights.region(r);
+            auto meshName = names.add(meshNameOf(region.mesh));
+            auto name = names.add(region.regionName);
+            weightRegions.push_back({meshName.first, meshName.second, name.first, name.second, header.weightCount, mWeights.nonZeroCount(r)});
+            header.weightCount += mWeights.nonZeroCount(r);
+        }
+
+        header.meshSetCount = meshSets.size();
+        header.meshCount = meshes.size();
+        header.channelCount = channels.size();
+        header.weightRegionCount = weightRegions.size();
+        header.pointCount = mPointIndices.size();
+        header.meshSetOffset = alignUp(sizeof(FileHeader));
+        header.meshOffset = alignUp(header.meshSetOffset + meshSets.size() * sizeof(FileMeshSet));
+        header.channelOffset = alignUp(header.meshOffset + meshes.size() * sizeof(FileMesh));
+        header.weightRegionOffset = alignUp(header.channelOffset + channels.size() * sizeof(FileChannel));
+        header.stringOffset = alignUp(header.weightRegionOffset + weightRegions.size() * sizeof(FileWeightRegion));
+        header.stringSize = names.text().size();
+        header.coordOffset = alignUp(header.stringOffset + header.stringSize);
+        header.pointIndexOffset = alignUp(header.coordOffset + 3 * header.vertexCount * sizeof(double));
+        header.deltaOffset = alignUp(header.pointIndexOffset + header.pointCount * sizeof(uint32_t));
+        header.weightIndexOffset = alignUp(header.deltaOffset + 3 * header.pointCount * sizeof(double));
+        header.weightOffset = alignUp(header.weightIndexOffset + header.weightCount * sizeof(uint32_t));
+        header.fileSize = header.weightOffset + header.weightCount * sizeof(float);
+
+        const string tempPath = path + ".tmp";
+        FILE* fp = fopen(tempPath.c_str(), "wb");
+        if (!fp) {
+            error = "Failed to open interchange file for writing: " + tempPath;
+            return false;
+        }
+
+        uint64_t written = 0;
+        bool ok = true;
+        auto put = [&](uint64_t offset, const void* data, size_t bytes) {
+            static const char zeros[kAlignment] = {};
+            while (ok && written < offset) {
+                size_t pad = static_cast<size_t>(min<uint64_t>(offset - written, kAlignment));
+                ok = fwrite(zeros, 1, pad, fp) == pad;
+                written += pad;
+            }
+            if (ok && bytes > 0) {
+                ok = fwrite(data, 1, bytes, fp) == bytes;
+                written += bytes;
+            }
+        };
+        put(0, &header, sizeof(header));
+        put(header.meshSetOffset, meshSets.data(), meshSets.size() * sizeof(FileMeshSet));
+        put(header.meshOffset, meshes.data(), meshes.size() * sizeof(FileMesh));
+        put(header.channelOffset, channels.data(), channels.size() * sizeof(FileChannel));
+        put(header.weightRegionOffset, weightRegions.data(), weightRegions.size() * sizeof(FileWeightRegion));
+        put(header.stringOffset, names.text().data(), names.text().size());
+        put(header.coordOffset, nullptr, 0);
+        for (int axis = 0; axis < 3; ++axis) {
+            for (const MeshSetRecord& record : mMeshSets) {
+                for (size_t m = 0; m < record.meshes.meshCount(); ++m) {
+                    const double* values = axis == 0 ? record.meshes.x(m) : axis == 1 ? record.meshes.y(m) : record.meshes.z(m);
+                    put(written, values, record.meshes.vertexCount(m) * sizeof(double));
+                }
+            }
+        }
+        put(header.pointIndexOffset, mPointIndices.data(), mPointIndices.size() * sizeof(uint32_t));
+        put(header.deltaOffset, mDx.data(), mDx.size() * sizeof(double));
+        put(written, mDy.data(), mDy.size() * sizeof(double));
+        put(written, mDz.data(), mDz.size() * sizeof(double));
+        put(header.weightIndexOffset, nullptr, 0);
+        for (size_t r = 0; r < mWeights.regionCount(); ++r) {
+            put(written, mWeights.indices(r), mWeights.nonZeroCount(r) * sizeof(uint32_t));
+        }
+        put(header.weightOffset, nullptr, 0);
+        for (size_t r = 0; r < mWeights.regionCount(); ++r) {
+            put(written, mWeights.weights(r), mWeights.nonZeroCount(r) * sizeof(float));
+        }
+        ok = fclose(fp) == 0 && ok && written == header.fileSize;
+
+        if (!ok) {
+            remove(tempPath.c_str());
+            error = "Failed to write interchange file: " + tempPath;
+            return false;
+        }
+
+        // Windows 下 rename 不能覆盖已存在的文件，先删除旧文件
+        remove(path.c_str());
+        if (rename(tempPath.c_str(), path.c_str()) != 0) {
+            remove(tempPath.c_str());
+            error = "Failed to replace interchange file: " + path;
+            return false;
+        }
+        span.setArg("bytes", static_cast<int64_t>(header.fileSize));
+        return true;
+    }
+
+    InterchangeFile::InterchangeFile() = default;
+    InterchangeFile::~InterchangeFile() = default;
+    InterchangeFile::InterchangeFile(InterchangeFile&&) noexcept = default;
+    InterchangeFile& InterchangeFile::operator=(InterchangeFile&&) noexcept = default;
+
+    bool InterchangeFile::open(const string& path, string& error) {
+        close();
+        auto file = make_unique<MappedFile>();
+        if (!file->open(path)) {
+            error = "Failed to open interchange file: " + path;
+            return false;
+        }
+
+        const uint8_t* data = file->data();
+        const uint64_t fileSize = file->size();
+        FileHeader header;
+        if (fileSize < sizeof(header) || memcmp(data, kMagic, sizeof(kMagic)) != 0) {
+            error = "Not an interchange file: " + path;
+            return false;
+        }
+        memcpy(&header, data, sizeof(header));
+        if (header.version != kVersion || header.byteOrder != kByteOrder) {
+            error = "Unsupported interchange file version " + to_string(header.version) + ": " + path;
+            return false;
+        }
+
+        const string corrupted = "Interchange file is corrupted: " + path;
+        const uint64_t offsets[] = {header.meshSetOffset, header.meshOffset, header.channelOffset, header.weightRegionOffset,
+                                    header.coordOffset, header.pointIndexOffset, header.deltaOffset, header.weightIndexOffset, header.weightOffset};
+        const bool aligned = all_of(begin(offsets), end(offsets), [](uint64_t offset) { return offset % kAlignment == 0; });
+        const bool layoutOk = aligned && header.fileSize == fileSize
+            && header.vertexCount <= fileSize / sizeof(double) && header.pointCount <= fileSize / sizeof(double)
+            && header.weightCount <= fileSize / sizeof(float)
+            && header.meshSetCount <= fileSize && header.meshCount <= fileSize
+            && header.channelCount <= fileSize && header.weightRegionCount <= fileSize
+            && inFile(header.meshSetOffset, header.meshSetCount * sizeof(FileMeshSet), fileSize)
+            && inFile(header.meshOffset, header.meshCount * sizeof(FileMesh), fileSize)
+            && inFile(header.channelOffset, header.channelCount * sizeof(FileChannel), fileSize)
+            && inFile(header.weightRegionOffset, header.weightRegionCount * sizeof(FileWeightRegion), fileSize)
+            && inFile(header.stringOffset, header.stringSize, fileSize)
+            && inFile(header.coordOffset, 3 * header.vertexCount * sizeof(double), fileSize)
+            && inFile(header.pointIndexOffset, header.pointCount * sizeof(uint32_t), fileSize)
+            && inFile(header.deltaOffset, 3 * header.pointCount * sizeof(double), fileSize)
+            && inFile(header.weightIndexOffset, header.weightCount * sizeof(uint32_t), fileSize)
+            && inFile(header.weightOffset, header.weightCount * sizeof(float), fileSize);
+        if (!layoutOk) {
+            error = corrupted;
+            return false;
+        }
+
+        const char* names = reinterpret_cast<const char*>(data + header.stringOffset);
+        bool namesOk = true;
+        auto text = [&](uint32_t offset, uint32_t length) {
+            if (!inRange(offset, length, header.stringSize)) {
+                namesOk = false;
+                return string();
+            }
+            return string(names + offset, length);
+        };
+
+        const double* x = reinterpret_cast<const double*>(data + header.coordOffset);
+        const double* y = x + header.vertexCount;
+        const double* z = y + header.vertexCount;
+        const FileMesh* fileMeshes = reinterpret_cast<const FileMesh*>(data + header.meshOffset);
+        vector<InterchangeMesh> meshes(static_cast<size_t>(header.meshCount));
+        for (size_t m = 0; m < meshes.size(); ++m) {
+            const FileMesh& entry = fileMeshes[m];
+            if (!inRange(entry.vertexOffset, entry.vertexCount, header.vertexCount)) {
+                error = corrupted;
+                return false;
+            }
+            InterchangeMesh& mesh = meshes[m];
+            mesh.name = text(entry.nameOffset, entry.nameLength);
+            mesh.vertexCount = static_cast<size_t>(entry.vertexCount);
+            mesh.topology = entry.topology;
+            mesh.x = x + entry.vertexOffset;
+            mesh.y = y + entry.vertexOffset;
+            mesh.z = z + entry.vertexOffset;
+        }
+
+        const FileMeshSet* fileMeshSets = reinterpret_cast<const FileMeshSet*>(data + header.meshSetOffset);
+        vector<InterchangeMeshSet> meshSets(static_cast<size_t>(header.meshSetCount));
+        for (size_t s = 0; s < meshSets.size(); ++s) {
+            const FileMeshSet& entry = fileMeshSets[s];
+            if (!inRange(entry.firstMesh, entry.meshCount, header.meshCount)) {
+                error = corrupted;
+                return false;
+            }
+            meshSets[s] = {text(entry.nameOffset, entry.nameLength), entry.firstMesh, entry.meshCount};
+            for (size_t m = entry.firstMesh; m < entry.firstMesh + entry.meshCount; ++m) {
+                meshes[m].meshSet = s;
+            }
+        }
+
+        const uint32_t* pointIndices = reinterpret_cast<const uint32_t*>(data + header.pointIndexOffset);
+        const double* dx = reinterpret_cast<const double*>(data + header.deltaOffset);
+        const double* dy = dx + header.pointCount;
+        const double* dz = dy + header.pointCount;
+        const FileChannel* fileChannels = reinterpret_cast<const FileChannel*>(data + header.channelOffset);
+        vector<InterchangeChannel> channels(static_cast<size_t>(header.channelCount));
+        for (size_t c = 0; c < channels.size(); ++c) {
+            const FileChannel& entry = fileChannels[c];
+            if (!inRange(entry.pointOffset, entry.pointCount, header.pointCount)) {
+                error = corrupted;
+                return false;
+            }
+            InterchangeChannel& channel = channels[c];
+            channel.mesh = text(entry.meshNameOffset, entry.meshNameLength);
+            channel.name = text(entry.nameOffset, entry.nameLength);
+            channel.pointCount = static_cast<size_t>(entry.pointCount);
+            channel.indices = pointIndices + entry.pointOffset;
+            channel.dx = dx + entry.pointOffset;
+            channel.dy = dy + entry.pointOffset;
+            channel.dz = dz + entry.pointOffset;
+        }
+
+        const uint32_t* weightIndices = reinterpret_cast<const uint32_t*>(data + header.weightIndexOffset);
+        const float* weights = reinterpret_cast<const float*>(data + header.weightOffset);
+        const FileWeightRegion* fileRegions = reinterpret_cast<const FileWeightRegion*>(data + header.weightRegionOffset);
+        vector<InterchangeWeightRegion> weightRegions(static_cast<size_t>(header.weightRegionCount));
+        for (size_t r = 0; r < weightRegions.size(); ++r) {
+            const FileWeightRegion& entry = fileRegions[r];
+            if (!inRange(entry.begin, entry.count, header.weightCount)) {
+                error = corrupted;
+                return false;
+            }
+            InterchangeWeightRegion& region = weightRegions[r];
+            region.mesh = text(entry.meshNameOffset, entry.meshNameLength);
+            region.region = text(entry.nameOffset, entry.nameLength);
+            region.count = static_cast<size_t>(entry.count);
+            region.indices = weightIndices + entry.begin;
+            region.weights = weights + entry.begin;
+        }
+
+        if (!namesOk) {
+            error = corrupted;
+            return false;
+        }
+
+        mFile = std::move(file);
+        mMeshSets = std::move(meshSets);
+        mMeshes = std::move(meshes);
+        mChannels = std::move(channels);
+        mWeightRegions = std::move(weightRegions);
+        return true;
+    }
+
+    void InterchangeFile::close() {
+        mMeshSets.clear();
+        mMeshes.clear();
+        mChannels.clear();
+        mWeightRegions.clear();
+        mFile.reset();
+    }
+
+    bool InterchangeFile::isOpen() const {
+        return mFile != nullptr;
+    }
+
+    size_t InterchangeFile::fileSize() const {
+        return mFile ? mFile->size() : 0;
+    }
+
+    int InterchangeFile::findMeshSet(const string& name) const {
+        for (size_t s = 0; s < mMeshSets.size(); ++s) {
+            if (mMeshSets[s].name == name) {
+                return static_cast<int>(s);
+            }
+        }
+        return -1;
+    }
+
+    int InterchangeFile::findMesh(size_t meshSet, const string& name) const {
+        if (meshSet >= mMeshSets.size()) {
+            return -1;
+        }
+        const InterchangeMeshSet& set = mMeshSets[meshSet];
+        for (size_t m = set.firstMesh; m < set.firstMesh + set.meshCount; ++m) {
+            if (mMeshes[m].name == name) {
+                return static_cast<int>(m);
+            }
+        }
+        return -1;
+    }
+
+    bool InterchangeFile::readMeshSet(size_t meshSet, MeshSet& meshes) const {
+        if (meshSet >= mMeshSets.size()) {
+            return false;
+        }
+        const InterchangeMeshSet& set = mMeshSets[meshSet];
+        size_t vertexCount = 0;
+        for (size_t m = set.firstMesh; m < set.firstMesh + set.meshCount; ++m) {
+            vertexCount += mMeshes[m].vertexCount;
+        }
+
+        MeshSet loaded;
+        loaded.reserve(set.meshCount, vertexCount);
+        for (size_t m = set.firstMesh; m < set.firstMesh + set.meshCount; ++m) {
+            const InterchangeMesh& mesh = mMeshes[m];
+            size_t slot = loaded.addMesh(mesh.name, mesh.vertexCount);
+            memcpy(loaded.x(slot), mesh.x, mesh.vertexCount * sizeof(double));
+            memcpy(loaded.y(slot), mesh.y, mesh.vertexCount * sizeof(double));
+            memcpy(loaded.z(slot), mesh.z, mesh.vertexCount * sizeof(double));
+        }
+        meshes = std::move(loaded);
+        return true;
+    }
+
+}
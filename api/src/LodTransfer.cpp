@@ -0,0 +1,461 @@
+#include "LodTransfer.h"
+#include "FbxBinaryReader.h"
+#include "GeometryCache.h"
+#include "Log.h"
+#include "MappedFile.h"
+#include "Parallel.h"
+#include "SurfaceCorrespondence.h"
+#include "Trace.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <tuple>
+
+namespace cf {
+
+    namespace {
+
+        // 映射文件布局（小端）：
+        //   MapHeader | uint32 lod0 顶点[3 * lodVertexCount] | double 重心坐标[3 * lodVertexCount]
+        // 各段起始偏移按 kMapAlignment 对齐
+        const char kMapMagic[8] = {'C', 'F', 'L', 'O', 'D', 'M', 'A', 'P'};
+        const uint32_t kMapVersion = 1;
+        const uint32_t kMapByteOrder = 0x01020304;
+        const uint64_t kMapAlignment = 64;
+        const char* kMapExtension = ".cft";
+
+        struct MapHeader {
+            char magic[8];
+            uint32_t version;
+            uint32_t byteOrder;
+            uint64_t lod0Topology;
+            uint64_t lodTopology;
+            uint64_t lod0VertexCount;
+            uint64_t lodVertexCount;
+            double rmsDistance;
+            double maxDistance;
+            uint64_t vertexOffset;
+            uint64_t weightOffset;
+            uint64_t fileSize;
+        };
+
+        uint64_t alignUp(uint64_t value) {
+            return (value + kMapAlignment - 1) / kMapAlignment * kMapAlignment;
+        }
+
+        bool inFile(uint64_t offset, uint64_t bytes, uint64_t fileSize) {
+            return offset <= fileSize && bytes <= fileSize - offset;
+        }
+
+        string hexHash(uint64_t hash) {
+            char text[17];
+            snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(hash));
+            return text;
+        }
+
+        // 交错存放的 xyz 拆成三个数组
+        struct SplitPoints {
+            explicit SplitPoints(const vector<double>& xyz) : x(xyz.size() / 3), y(xyz.size() / 3), z(xyz.size() / 3) {
+                for (size_t i = 0; i < x.size(); ++i) {
+                    x[i] = xyz[3 * i];
+                    y[i] = xyz[3 * i + 1];
+                    z[i] = xyz[3 * i + 2];
+                }
+            }
+
+            PointSpan span() const { return {x.data(), y.data(), z.data(), x.size()}; }
+
+            vector<double> x;
+            vector<double> y;
+            vector<double> z;
+        };
+
+    }
+
+    bool parseLodMeshName(const string& name, string& prefix, int& lod) {
+        const string suffix = "_mesh";
+        const size_t marker = name.rfind("_lod");
+        if (marker == string::npos || marker == 0 || name.size() < suffix.size()
+            || name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0) {
+            return false;
+        }
+        const size_t digits = marker + 4;
+        const size_t end = name.size() - suffix.size();
+        if (digits >= end || end - digits > 2) {
+            return false;
+        }
+        int value = 0;
+        for (size_t i = digits; i < end; ++i) {
+            if (name[i] < '0' || name[i] > '9') {
+                return false;
+            }
+            value = value * 10 + (name[i] - '0');
+        }
+        prefix = name.substr(0, marker);
+        lod = value;
+        return true;
+    }
+
+    string lodMeshName(const string& prefix, int lod) {
+        return prefix + "_lod" + to_string(lod) + "_mesh";
+    }
+
+    LodTransferMap LodTransferMap::build(const PointSpan& lod0, const vector<uint32_t>& lod0Triangles, const PointSpan& lod, unsigned workerCount) {
+        TraceSpan span("buildLodTransfer");
+        LodTransferMap map;
+        TriangleBvh bvh(lod0, lod0Triangles);
+        if (bvh.empty() || lod.count == 0) {
+            return map;
+        }
+        SurfaceMapping mapping = projectToSurface(bvh, lod, workerCount);
+        map.mLod0VertexCount = lod0.count;
+        map.mVertices = std::move(mapping.vertices);
+        map.mWeights = std::move(mapping.weights);
+        map.mRmsDistance = mapping.rmsDistance;
+        map.mMaxDistance = mapping.maxDistance;
+        map.buildReferences();
+        span.setArg("vertices", static_cast<int64_t>(lod.count));
+        return map;
+    }
+
+    void LodTransferMap::buildReferences() {
+        mReferenceOffsets.assign(mLod0VertexCount + 1, 0);
+        const size_t count = lodVertexCount();
+        for (size_t i = 0; i < count; ++i) {
+            for (int k = 0; k < 3; ++k) {
+                if (mWeights[3 * i + k] != 0.0) {
+                    ++mReferenceOffsets[mVertices[3 * i + k] + 1];
+                }
+            }
+        }
+        for (size_t v = 0; v < mLod0VertexCount; ++v) {
+            mReferenceOffsets[v + 1] += mReferenceOffsets[v];
+        }
+        mReferences.resize(mReferenceOffsets.back());
+        vector<uint32_t> next(mReferenceOffsets.begin(), mReferenceOffsets.end() - 1);
+        for (size_t i = 0; i < count; ++i) {
+            for (int k = 0; k < 3; ++k) {
+                if (mWeights[3 * i + k] != 0.0) {
+                    mReferences[next[mVertices[3 * i + k]]++] = static_cast<uint32_t>(i);
+                }
+            }
+        }
+    }
+
+    void LodTransferMap::propagate(const SparseShapeDelta& lod0Delta, double epsilon, SparseShapeDelta& lodDelta) const {
+        lodDelta.clear();
+        vector<uint32_t> candidates;
+        for (uint32_t v : lod0Delta.indices) {
+            if (v < mLod0VertexCount) {
+                candidates.insert(candidates.end(), mReferences.begin() + mReferenceOffsets[v], mReferences.begin() + mReferenceOffsets[v + 1]);
+            }
+        }
+        sort(candidates.begin(), candidates.end());
+        candidates.erase(unique(candidates.begin(), candidates.end()), candidates.end());
+
+        lodDelta.indices.reserve(candidates.size());
+        lodDelta.dx.reserve(candidates.size());
+        lodDelta.dy.reserve(candidates.size());
+        lodDelta.dz.reserve(candidates.size());
+        const vector<uint32_t>& indices = lod0Delta.indices;
+        const double epsilonSquared = epsilon * epsilon;
+        for (uint32_t i : candidates) {
+            double x = 0.0, y = 0.0, z = 0.0;
+            for (int k = 0; k < 3; ++k) {
+                const double weight = mWeights[3 * i + k];
+                auto it = lower_bound(indices.begin(), indices.end(), mVertices[3 * i + k]);
+                if (weight == 0.0 || it == indices.end() || *it != mVertices[3 * i + k]) {
+                    continue;
+                }
+                const size_t slot = static_cast<size_t>(it - indices.begin());
+                x += weight * lod0Delta.dx[slot];
+                y += weight * lod0Delta.dy[slot];
+                z += weight * lod0Delta.dz[slot];
+            }
+            if (x * x + y * y + z * z <= epsilonSquared) {
+                continue;
+            }
+            lodDelta.indices.push_back(i);
+            lodDelta.dx.push_back(x);
+            lodDelta.dy.push_back(y);
+            lodDelta.dz.push_back(z);
+        }
+    }
+
+    bool LodTransferMap::write(const string& path, uint64_t lod0Topology, uint64_t lodTopology, string& error) const {
+        MapHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, kMapMagic, sizeof(kMapMagic));
+        header.version = kMapVersion;
+        header.byteOrder = kMapByteOrder;
+        header.lod0Topology = lod0Topology;
+        header.lodTopology = lodTopology;
+        header.lod0VertexCount = mLod0VertexCount;
+        header.lodVertexCount = lodVertexCount();
+        header.rmsDistance = mRmsDistance;
+        header.maxDistance = mMaxDistance;
+        header.vertexOffset = alignUp(sizeof(MapHeader));
+        header.weightOffset = alignUp(header.vertexOffset + mVertices.size() * sizeof(uint32_t));
+        header.fileSize = header.weightOffset + mWeights.size() * sizeof(double);
+
+        const string tempPath = path + ".tmp";
+        FILE* fp = fopen(tempPath.c_str(), "wb");
+        if (!fp) {
+            error = "Failed to open LOD transfer map for writing: " + tempPath;
+            return false;
+        }
+
+        uint64_t written = 0;
+        bool ok = true;
+        auto put = [&](uint64_t offset, const void* data, size_t bytes) {
+            static const char zeros[kMapAlignment] = {};
+            while (ok && written < offset) {
+                size_t pad = static_cast<size_t>(min<uint64_t>(offset - written, kMapAlignment));
+                ok = fwrite(zeros, 1, pad, fp) == pad;
+                written += pad;
+            }
+            if (ok && bytes > 0) {
+                ok = fwrite(data, 1, bytes, fp) == bytes;
+                written += bytes;
+            }
+        };
+        put(0, &header, sizeof(header));
+        put(header.vertexOffset, mVertices.data(), mVertices.size() * sizeof(uint32_t));
+        put(header.weightOffset, mWeights.data(), mWeights.size() * sizeof(double));
+        // 写入的字节数必须与头中的文件大小一致，否则读取时会当作损坏的文件
+        ok = ok && written == header.fileSize;
+        ok = fclose(fp) == 0 && ok;
+
+        if (!ok) {
+            remove(tempPath.c_str());
+            error = "Failed to write LOD transfer map: " + tempPath;
+            return false;
+        }
+
+        // Windows 下 rename 不能覆盖已存在的文件，先删除旧文件
+        remove(path.c_str());
+        if (rename(tempPath.c_str(), path.c_str()) != 0) {
+            remove(tempPath.c_str());
+            error = "Failed to replace LOD transfer map: " + path;
+            return false;
+        }
+        return true;
+    }
+
+    bool LodTransferMap::read(const string& path, uint64_t lod0Topology, uint64_t lodTopology, LodTransferMap& map, string& error) {
+        MappedFile file;
+        if (!file.open(path)) {
+            error = "LOD transfer map not found: " + path;
+            return false;
+        }
+        const uint8_t* data = file.data();
+        const uint64_t fileSize = file.size();
+        MapHeader header;
+        if (fileSize < sizeof(header)) {
+            error = "LOD transfer map is truncated: " + path;
+            return false;
+        }
+        memcpy(&header, data, sizeof(header));
+        if (memcmp(header.magic, kMapMagic, sizeof(kMapMagic)) != 0 || header.version != kMapVersion || header.byteOrder != kMapByteOrder) {
+            error = "LOD transfer map has an unsupported format: " + path;
+            return false;
+        }
+        if (header.lod0Topology != lod0Topology || header.lodTopology != lodTopology) {
+            error = "LOD transfer map is stale: " + path;
+            return false;
+        }
+
+        const uint64_t entries = 3 * header.lodVertexCount;
+        const bool layoutOk = header.fileSize == fileSize && header.lod0VertexCount <= 0xFFFFFFFFull
+            && header.vertexOffset % kMapAlignment == 0 && header.weightOffset % kMapAlignment == 0
+            && header.lodVertexCount <= fileSize / sizeof(uint32_t)
+            && inFile(header.vertexOffset, entries * sizeof(uint32_t), fileSize)
+            && inFile(header.weightOffset, entries * sizeof(double), fileSize);
+        if (!layoutOk) {
+            error = "LOD transfer map is corrupted: " + path;
+            return false;
+        }
+
+        LodTransferMap loaded;
+        const uint32_t* vertices = reinterpret_cast<const uint32_t*>(data + header.vertexOffset);
+        const double* weights = reinterpret_cast<const double*>(data + header.weightOffset);
+        loaded.mLod0VertexCount = static_cast<size_t>(header.lod0VertexCount);
+        loaded.mVertices.assign(vertices, vertices + entries);
+        loaded.mWeights.assign(weights, weights + entries);
+        loaded.mRmsDistance = header.rmsDistance;
+        loaded.mMaxDistance = header.maxDistance;
+        for (uint32_t v : loaded.mVertices) {
+            if (v >= loaded.mLod0VertexCount) {
+                error = "LOD transfer map is corrupted: " + path;
+                return false;
+            }
+        }
+        loaded.buildReferences();
+        map = std::move(loaded);
+        return true;
+    }
+
+    string LodTransferCache::defaultDirectory() {
+        error_code error;
+        filesystem::path temp = filesystem::temp_directory_path(error);
+        if (error) {
+            return string();
+        }
+        return (temp / "CharacterFactory" / "lod").string();
+    }
+
+    string LodTransferCache::entryPath(uint64_t lod0Topology, uint64_t lodTopology) const {
+        return (filesystem::path(mDirectory) / (hexHash(lod0Topology) + "_" + hexHash(lodTopology) + kMapExtension)).string();
+    }
+
+    bool LodTransferCache::load(const string& fbxPath, unsigned workerCount, LodTransferSet& set, string& error) const {
+        TraceSpan span("loadLodTransfers", fbxPath);
+        set = LodTransferSet();
+        if (!FbxBinaryReader::isBinaryFbx(fbxPath)) {
+            error = "LOD meshes can only be read from a binary FBX file: " + fbxPath;
+            return false;
+        }
+        FbxBinaryReader reader;
+        map<string, FbxMeshArrays> meshes;
+        if (!reader.open(fbxPath) || !reader.readMeshes({}, true, meshes, workerCount)) {
+            error = reader.lastError();
+            return false;
+        }
+        for (const string& warning : reader.warnings()) {
+            logWarning(warning + " in " + fbxPath);
+        }
+
+        // 按 (lod0 网格, LOD) 排序
+        vector<tuple<string, int, string>> pairs;
+        for (const auto& [name, arrays] : meshes) {
+            string prefix;
+            int lod = 0;
+            if (parseLodMeshName(name, prefix, lod) && lod > 0 && meshes.count(lodMeshName(prefix, 0))) {
+                pairs.emplace_back(lodMeshName(prefix, 0), lod, name);
+            }
+        }
+        sort(pairs.begin(), pairs.end());
+
+        bool directoryReady = false;
+        for (const auto& [lod0Name, lod, lodName] : pairs) {
+            const FbxMeshArrays& lod0 = meshes.at(lod0Name);
+            const FbxMeshArrays& lodMesh = meshes.at(lodName);
+            const uint64_t lod0Topology = GeometryCache::topologyFingerprint(lod0.polygonVertexIndex.data(), lod0.polygonVertexIndex.size());
+            const uint64_t lodTopology = GeometryCache::topologyFingerprint(lodMesh.polygonVertexIndex.data(), lodMesh.polygonVertexIndex.size());
+            const string cacheFile = mDirectory.empty() ? string() : entryPath(lod0Topology, lodTopology);
+
+            auto transfer = make_shared<LodTransferMap>();
+            string cacheError;
+            bool fromCache = !cacheFile.empty() && LodTransferMap::read(cacheFile, lod0Topology, lodTopology, *transfer, cacheError)
+                && transfer->lod0VertexCount() == lod0.vertices.size() / 3 && transfer->lodVertexCount() == lodMesh.vertices.size() / 3;
+            if (!fromCache) {
+                const SplitPoints lod0Points(lod0.vertices);
+                const SplitPoints lodPoints(lodMesh.vertices);
+                const vector<uint32_t> triangles = triangulatePolygons(lod0.polygonVertexIndex.data(), lod0.polygonVertexIndex.size(), lod0Points.x.size());
+                *transfer = LodTransferMap::build(lod0Points.span(), triangles, lodPoints.span(), workerCount);
+                if (transfer->empty()) {
+                    logWarning("Skipping " + lodName + ": " + lod0Name + " has no polygons");
+                    continue;
+                }
+                if (!cacheFile.empty()) {
+                    error_code dirError;
+                    directoryReady = directoryReady || filesystem::create_directories(mDirectory, dirError) || !dirError;
+                    if (!directoryReady || !transfer->write(cacheFile, lod0Topology, lodTopology, cacheError)) {
+                        logWarning(directoryReady ? cacheError : "Failed to create LOD transfer cache directory: " + mDirectory);
+                    }
+                }
+            }
+
+            logInfo("LOD transfer " + lodName + " -> " + lod0Name + ": " + to_string(transfer->lodVertexCount()) + " vertices, max distance "
+                    + to_string(transfer->maxDistance()) + (fromCache ? " (cached)" : ""));
+            ++(fromCache ? set.cached : set.built);
+            set.transfers.push_back({lod0Name, lodName, lod, std::move(transfer)});
+        }
+        span.setArg("maps", static_cast<int64_t>(set.transfers.size()));
+        return true;
+    }
+
+    LodPropagationHost::LodPropagationHost(BlendShapeHost& host, const LodTransferSet& lods, double epsilon, unsigned workerCount)
+        : mHost(host), mLods(lods), mEpsilon(epsilon), mWorkerCount(workerCount) {}
+
+    bool LodPropagationHost::beginMesh(const string& meshName, size_t& vertexCount) {
+        mMeshName = meshName;
+        mChannels.clear();
+        mActive.clear();
+        if (!mHost.beginMesh(meshName, vertexCount)) {
+            return false;
+        }
+        for (const LodTransfer& transfer : mLods.transfers) {
+            if (transfer.lod0Mesh == meshName) {
+                mActive.push_back(&transfer);
+            }
+        }
+        return true;
+    }
+
+    bool LodPropagationHost::addTarget(const string& channelName, const SparseShapeDelta& delta) {
+        if (!mHost.addTarget(channelName, delta)) {
+            return false;
+        }
+        if (!mActive.empty()) {
+            mChannels.emplace_back(channelName, delta);
+        }
+        return true;
+    }
+
+    void LodPropagationHost::endMesh(size_t targetCount) {
+        mHost.endMesh(targetCount);
+        if (mActive.empty() || mChannels.empty()) {
+            return;
+        }
+
+        TraceSpan span("propagateLods", mMeshName);
+        const size_t channelCount = mChannels.size();
+        vector<SparseShapeDelta> deltas(mActive.size() * channelCount);
+        parallelFor(deltas.size(), mWorkerCount, [&](size_t task) {
+            mActive[task / channelCount]->map->propagate(mChannels[task % channelCount].second, mEpsilon, deltas[task]);
+        });
+
+        for (size_t l = 0; l < mActive.size(); ++l) {
+            const LodTransfer& transfer = *mActive[l];
+            size_t vertexCount = 0;
+            if (!mHost.beginMesh(transfer.lodMesh, vertexCount)) {
+                ++mStats.skippedMeshes;
+                continue;
+            }
+            if (vertexCount != transfer.map->lodVertexCount()) {
+                logWarning("Skipping " + transfer.lodMesh + ": " + to_string(vertexCount) + " vertices, transfer map expects "
+                           + to_string(transfer.map->lodVertexCount()));
+                mHost.endMesh(0);
+                ++mStats.skippedMeshes;
+                continue;
+            }
+
+            size_t lodTargets = 0;
+            for (size_t c = 0; c < channelCount; ++c) {
+                const SparseShapeDelta& delta = deltas[l * channelCount + c];
+                if (delta.empty()) {
+                    ++mStats.prunedChannels;
+                    continue;
+                }
+                const string& channelName = mChannels[c].first;
+                const bool prefixed = channelName.compare(0, mMeshName.size(), mMeshName) == 0;
+                if (mHost.addTarget(prefixed ? transfer.lodMesh + channelName.substr(mMeshName.size()) : transfer.lodMesh + "_" + channelName, delta)) {
+                    ++lodTargets;
+                    mStats.points += delta.size();
+                }
+            }
+            mHost.endMesh(lodTargets);
+            mStats.channels += lodTargets;
+            if (lodTargets > 0) {
+                ++mStats.meshes;
+            }
+        }
+        span.setArg("channels", static_cast<int64_t>(mStats.channels));
+        mChannels.clear();
+    }
+
+}
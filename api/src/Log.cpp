@@ -0,0 +1,64 @@
+#include "Log.h"
+#include <cstdio>
+#include <mutex>
+
+namespace cf {
+
+    namespace {
+
+        mutex& sinkLock() {
+            static mutex lock;
+            return lock;
+        }
+
+        LogSink& currentSink() {
+            static LogSink sink;
+            return sink;
+        }
+
+        void writeToStderr(LogLevel level, const string& message) {
+            const char* prefix = level == LogLevel::Error ? "Error: " : level == LogLevel::Warning ? "Warning: " : "";
+            fprintf(stderr, "%s%s\n", prefix, message.c_str());
+        }
+
+        thread_local ThreadLogBuffer* tLogBuffer = nullptr;
+
+    }
+
+    LogSink setLogSink(LogSink sink) {
+        lock_guard<mutex> guard(sinkLock());
+        LogSink previous = std::move(currentSink());
+        currentSink() = std::move(sink);
+        return previous;
+    }
+
+    void logMessage(LogLevel level, const string& message) {
+        if (tLogBuffer) {
+            tLogBuffer->mMessages.emplace_back(level, message);
+            return;
+        }
+        // 调用期间持有锁，sink 本身不需要线程安全；
+        // 但 MGlobal 只能在主线程使用，核心库只在调用线程上输出日志
+        lock_guard<mutex> guard(sinkLock());
+        if (currentSink()) {
+            currentSink()(level, message);
+        } else {
+            writeToStderr(level, message);
+        }
+    }
+
+    ThreadLogBuffer::ThreadLogBuffer() : mPrevious(tLogBuffer) {
+        tLogBuffer = this;
+    }
+
+    ThreadLogBuffer::~ThreadLogBuffer() {
+        tLogBuffer = mPrevious;
+    }
+
+    void ThreadLogBuffer::replay(const vector<pair<LogLevel, string>>& messages) {
+        for (const auto& [level, message] : messages) {
+            logMessage(level, message);
+        }
+    }
+
+}
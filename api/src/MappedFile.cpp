@@ -0,0 +1,118 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace cf {
+
+#ifdef _WIN32
+
+    MappedFile::MappedFile() : mData(nullptr), mSize(0), mFileHandle(nullptr), mMappingHandle(nullptr) {}
+
+    MappedFile::~MappedFile() {
+        close();
+    }
+
+    bool MappedFile::open(const std::string& path) {
+        close();
+
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+            CloseHandle(file);
+            return false;
+        }
+
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping) {
+            CloseHandle(file);
+            return false;
+        }
+
+        void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!view) {
+            CloseHandle(mapping);
+            CloseHandle(file);
+            return false;
+        }
+
+        mFileHandle = file;
+        mMappingHandle = mapping;
+        mData = static_cast<const uint8_t*>(view);
+        mSize = static_cast<size_t>(fileSize.QuadPart);
+        return true;
+    }
+
+    void MappedFile::close() {
+        if (mData) {
+            UnmapViewOfFile(mData);
+            mData = nullptr;
+        }
+        if (mMappingHandle) {
+            CloseHandle(mMappingHandle);
+            mMappingHandle = nullptr;
+        }
+        if (mFileHandle) {
+            CloseHandle(mFileHandle);
+            mFileHandle = nullptr;
+        }
+        mSize = 0;
+    }
+
+#else
+
+    MappedFile::MappedFile() : mData(nullptr), mSize(0) {}
+
+    MappedFile::~MappedFile() {
+        close();
+    }
+
+    bool MappedFile::open(const std::string& path) {
+        close();
+
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+            ::close(fd);
+            return false;
+        }
+
+        void* view = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (view == MAP_FAILED) {
+            return false;
+        }
+
+        mData = static_cast<const uint8_t*>(view);
+        mSize = static_cast<size_t>(st.st_size);
+        return true;
+    }
+
+    void MappedFile::close() {
+        if (mData) {
+            munmap(const_cast<uint8_t*>(mData), mSize);
+            mData = nullptr;
+        }
+        mSize = 0;
+    }
+
+#endif
+
+}
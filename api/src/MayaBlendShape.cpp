@@ -0,0 +1,140 @@
+#include "MayaBlendShape.h"
+#include <maya/MFnBlendShapeDeformer.h>
+#include <maya/MFnComponentListData.h>
+#include <maya/MFnMesh.h>
+#include <maya/MFnPointArrayData.h>
+#include <maya/MFnSingleIndexedComponent.h>
+#include <maya/MGlobal.h>
+#include <maya/MIntArray.h>
+#include <maya/MPlug.h>
+#include <maya/MPointArray.h>
+#include <maya/MSelectionList.h>
+
+namespace cf {
+
+    namespace {
+
+        // Maya 中权重为 1 的目标项固定使用逻辑索引 6000
+        const unsigned kFullWeightItem = 6000;
+
+    }
+
+    void mayaLogSink(LogLevel level, const string& message) {
+        MString text(message.c_str());
+        switch (level) {
+        case LogLevel::Info:
+            MGlobal::displayInfo(text);
+            break;
+        case LogLevel::Warning:
+            MGlobal::displayWarning(text);
+            break;
+        case LogLevel::Error:
+            MGlobal::displayError(text);
+            break;
+        }
+    }
+
+    MayaBlendShapeHost::MayaBlendShapeHost() : mTargetIndex(0) {}
+
+    bool MayaBlendShapeHost::beginMesh(const string& meshName, size_t& vertexCount) {
+        mMeshName = meshName;
+        mBlendShape = MObject::kNullObj;
+        mTargetIndex = 0;
+
+        MSelectionList selection;
+        MDagPath path;
+        if (!selection.add(MString(meshName.c_str())) || !selection.getDagPath(0, path) || !path.extendToShape()) {
+            MGlobal::displayWarning(MString("Mesh not found in scene: ") + meshName.c_str());
+            return false;
+        }
+
+        MStatus status;
+        MFnMesh fnMesh(path, &status);
+        if (!status) {
+            MGlobal::displayWarning(MString("Node is not a mesh: ") + meshName.c_str());
+            return false;
+        }
+
+        mMeshPath = path;
+        vertexCount = static_cast<size_t>(fnMesh.numVertices());
+        return true;
+    }
+
+    bool MayaBlendShapeHost::createDeformer() {
+        MStatus status;
+        MFnBlendShapeDeformer fnBlendShape;
+        mBlendShape = fnBlendShape.create(mMeshPath.node(), MFnBlendShapeDeformer::kLocalOrigin, &status);
+        if (!status) {
+            MGlobal::displayError(MString("Failed to create blendShape for: ") + mMeshName.c_str());
+            mBlendShape = MObject::kNullObj;
+            return false;
+        }
+        fnBlendShape.setName(MString((mMeshName + "_blendshape").c_str()));
+        return true;
+    }
+
+    bool MayaBlendShapeHost::addTarget(const string& channelName, const SparseShapeDelta& delta) {
+        // 第一个通道到来时才创建节点，没有有效通道的网格不留下空的 blendShape
+        if (mBlendShape.isNull() && !createDeformer()) {
+            return false;
+        }
+
+        const unsigned count = static_cast<unsigned>(delta.size());
+        MPointArray points(count);
+        MIntArray indices(count);
+        for (unsigned k = 0; k < count; ++k) {
+            points.set(k, delta.dx[k], delta.dy[k], delta.dz[k]);
+            indices[k] = static_cast<int>(delta.indices[k]);
+        }
+
+        MStatus status;
+        MFnPointArrayData fnPoints;
+        MObject pointsData = fnPoints.create(points, &status);
+        if (!status) {
+            return false;
+        }
+
+        MFnSingleIndexedComponent fnComponent;
+        MObject component = fnComponent.create(MFn::kMeshVertComponent, &status);
+        if (!status) {
+            return false;
+        }
+        fnComponent.addElements(indices);
+
+        MFnComponentListData fnComponentList;
+        MObject componentData = fnComponentList.create(&status);
+        if (!status) {
+            return false;
+        }
+        fnComponentList.add(component);
+
+        MFnDependencyNode fnNode(mBlendShape);
+        MPlug inputTarget = fnNode.findPlug("inputTarget", false, &status).elementByLogicalIndex(0);
+        if (!status) {
+            return false;
+        }
+        MPlug targetItem = inputTarget.child(fnNode.attribute("inputTargetGroup")).elementByLogicalIndex(mTargetIndex)
+                                      .child(fnNode.attribute("inputTargetItem")).elementByLogicalIndex(kFullWeightItem);
+        if (!targetItem.child(fnNode.attribute("inputPointsTarget")).setValue(pointsData)
+            || !targetItem.child(fnNode.attribute("inputComponentsTarget")).setValue(componentData)) {
+            MGlobal::displayWarning(MString("Failed to set blendShape target: ") + channelName.c_str());
+            return false;
+        }
+
+        MPlug weight = fnNode.findPlug("weight", false).elementByLogicalIndex(mTargetIndex);
+        weight.setValue(0.0);
+        fnNode.setAlias(MString(channelName.c_str()), MString("w[") + mTargetIndex + "]", weight);
+
+        ++mTargetIndex;
+        return true;
+    }
+
+    void MayaBlendShapeHost::endMesh(size_t targetCount) {
+        if (targetCount > 0) {
+            MGlobal::displayInfo(MString("Created blendShape on ") + mMeshName.c_str() + " with " + static_cast<double>(targetCount) + " targets");
+        }
+        mBlendShape = MObject::kNullObj;
+        mTargetIndex = 0;
+    }
+
+}
@@ -0,0 +1,79 @@
+#include "MeshCapture.h"
+#include "Log.h"
+#include "Trace.h"
+
+namespace cf {
+
+    bool convertRawMesh(const string& name, const RawMesh& raw, CapturedMesh& mesh, string& error) {
+        if (raw.vertexCount > 0 && !raw.points) {
+            error = "Mesh " + name + " has no points";
+            return false;
+        }
+        if ((raw.polygonCount > 0 && !raw.polygonCounts) || (raw.polygonVertexCount > 0 && !raw.polygonVertices)) {
+            error = "Mesh " + name + " has no polygons";
+            return false;
+        }
+
+        size_t expected = 0;
+        for (size_t p = 0; p < raw.polygonCount; ++p) {
+            if (raw.polygonCounts[p] < 3) {
+                error = "Mesh " + name + " has a polygon with " + to_string(raw.polygonCounts[p]) + " vertices";
+                return false;
+            }
+            expected += static_cast<size_t>(raw.polygonCounts[p]);
+        }
+        if (expected != raw.polygonVertexCount) {
+            error = "Mesh " + name + " has " + to_string(raw.polygonVertexCount) + " polygon vertices, expected " + to_string(expected);
+            return false;
+        }
+        for (size_t k = 0; k < raw.polygonVertexCount; ++k) {
+            if (raw.polygonVertices[k] < 0 || static_cast<size_t>(raw.polygonVertices[k]) >= raw.vertexCount) {
+                error = "Mesh " + name + " has a vertex index out of range: " + to_string(raw.polygonVertices[k]);
+                return false;
+            }
+        }
+
+        mesh.name = name;
+        mesh.transform = raw.transform;
+        mesh.points.assign(raw.points, raw.points + 3 * raw.vertexCount);
+        mesh.polygonCounts.assign(raw.polygonCounts, raw.polygonCounts + raw.polygonCount);
+        mesh.polygonVertices.assign(raw.polygonVertices, raw.polygonVertices + raw.polygonVertexCount);
+        return true;
+    }
+
+    MeshCaptureStats captureMeshes(MeshCaptureSource& source, const vector<string>& names, vector<CapturedMesh>& meshes) {
+        TraceSpan span("captureMeshes");
+        MeshCaptureStats stats;
+        meshes.clear();
+        meshes.reserve(names.size());
+        for (const string& name : names) {
+            RawMesh raw;
+            string error;
+            if (!source.readMesh(name, raw, error)) {
+                if (error.empty()) {
+                    ++stats.missingMeshes;
+                    logWarning("Mesh not found: " + name);
+                } else {
+                    ++stats.invalidMeshes;
+                    logWarning(error);
+                }
+                continue;
+            }
+
+            CapturedMesh mesh;
+            if (!convertRawMesh(name, raw, mesh, error)) {
+                ++stats.invalidMeshes;
+                logWarning(error);
+                continue;
+            }
+            ++stats.meshes;
+            stats.vertices += mesh.vertexCount();
+            stats.polygons += mesh.polygonCount();
+            meshes.push_back(std::move(mesh));
+        }
+        span.setArg("meshes", static_cast<int64_t>(stats.meshes));
+        span.setArg("vertices", static_cast<int64_t>(stats.vertices));
+        return stats;
+    }
+
+}
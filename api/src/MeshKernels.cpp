@@ -0,0 +1,483 @@
+#include "MeshKernels.h"
+#include <atomic>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CF_KERNELS_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// GCC/Clang 需要为单个函数开启 AVX2 代码生成；MSVC 可直接使用 intrinsics。
+// 只开启 avx2 而不开启 fma，避免编译器把乘加合并成 FMA 改变舍入
+#if defined(CF_KERNELS_X86) && (defined(__GNUC__) || defined(__clang__))
+#define CF_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define CF_TARGET_AVX2
+#endif
+
+namespace cf {
+
+    namespace {
+
+        using Matrix = array<array<double, 4>, 4>;
+        using MatrixF = array<array<float, 4>, 4>;
+
+        template <typename T>
+        struct KernelTypes {
+            using MatrixType = array<array<T, 4>, 4>;
+            using Transform = void (*)(const MatrixType&, const T*, const T*, const T*, T*, T*, T*, size_t);
+            using Gap = void (*)(const MatrixType&, const array<T, 3>&, const T*, const T*, const T*,
+                                 const T*, const T*, const T*, T*, T*, T*, size_t);
+            using Subtract = void (*)(const T*, const T*, const T*, const T*, const T*, const T*, T*, T*, T*, size_t);
+        };
+
+        // 单个坐标分量：t03 + t00*x + t01*y + t02*z，按此顺序逐项累加
+        template <typename T>
+        inline T transformRow(const array<T, 4>& row, T px, T py, T pz) {
+            T r = row[3];
+            r += row[0] * px;
+            r += row[1] * py;
+            r += row[2] * pz;
+            return r;
+        }
+
+        template <typename T>
+        void transformScalar(const array<array<T, 4>, 4>& m, const T* x, const T* y, const T* z,
+                             T* outX, T* outY, T* outZ, size_t count) {
+            for (size_t k = 0; k < count; ++k) {
+                const T px = x[k];
+                const T py = y[k];
+                const T pz = z[k];
+                outX[k] = transformRow(m[0], px, py, pz);
+                outY[k] = transformRow(m[1], px, py, pz);
+                outZ[k] = transformRow(m[2], px, py, pz);
+            }
+        }
+
+        template <typename T>
+        void gapScalar(const array<array<T, 4>, 4>& m, const array<T, 3>& offset,
+                       const T* bx, const T* by, const T* bz,
+                       const T* x, const T* y, const T* z,
+                       T* outX, T* outY, T* outZ, size_t count) {
+            for (size_t k = 0; k < count; ++k) {
+                const T px = x[k];
+                const T py = y[k];
+                const T pz = z[k];
+                outX[k] = bx[k] - (transformRow(m[0], px, py, pz) - offset[0]);
+                outY[k] = by[k] - (transformRow(m[1], px, py, pz) - offset[1]);
+                outZ[k] = bz[k] - (transformRow(m[2], px, py, pz) - offset[2]);
+            }
+        }
+
+        template <typename T>
+        void subtractScalar(const T* ax, const T* ay, const T* az,
+                            const T* bx, const T* by, const T* bz,
+                            T* outX, T* outY, T* outZ, size_t count) {
+            for (size_t k = 0; k < count; ++k) {
+                outX[k] = ax[k] - bx[k];
+                outY[k] = ay[k] - by[k];
+                outZ[k] = az[k] - bz[k];
+            }
+        }
+
+        MatrixF toFloat(const Matrix& m) {
+            MatrixF result;
+            for (int i = 0; i < 4; ++i) {
+                for (int j = 0; j < 4; ++j) {
+                    result[i][j] = static_cast<float>(m[i][j]);
+                }
+            }
+            return result;
+        }
+
+#ifdef CF_KERNELS_X86
+
+        struct MatrixSse2 {
+            __m128d c[3][4];
+            explicit MatrixSse2(const Matrix& m) {
+                for (int i = 0; i < 3; ++i) {
+                    for (int j = 0; j < 4; ++j) {
+                        c[i][j] = _mm_set1_pd(m[i][j]);
+                    }
+                }
+            }
+            __m128d row(int i, __m128d px, __m128d py, __m128d pz) const {
+                __m128d r = _mm_add_pd(c[i][3], _mm_mul_pd(c[i][0], px));
+                r = _mm_add_pd(r, _mm_mul_pd(c[i][1], py));
+                return _mm_add_pd(r, _mm_mul_pd(c[i][2], pz));
+            }
+        };
+
+        void transformSse2(const Matrix& m, const double* x, const double* y, const double* z,
+                           double* outX, double* outY, double* outZ, size_t count) {
+            const MatrixSse2 c(m);
+            size_t k = 0;
+            for (; k + 2 <= count; k += 2) {
+                const __m128d px = _mm_loadu_pd(x + k);
+                const __m128d py = _mm_loadu_pd(y + k);
+                const __m128d pz = _mm_loadu_pd(z + k);
+                _mm_storeu_pd(outX + k, c.row(0, px, py, pz));
+                _mm_storeu_pd(outY + k, c.row(1, px, py, pz));
+                _mm_storeu_pd(outZ + k, c.row(2, px, py, pz));
+            }
+            transformScalar(m, x + k, y + k, z + k, outX + k, outY + k, outZ + k, count - k);
+        }
+
+        void gapSse2(const Matrix& m, const array<double, 3>& offset,
+                     const double* bx, const double* by, const double* bz,
+                     const double* x, const double* y, const double* z,
+                     double* outX, double* outY, double* outZ, size_t count) {
+            const MatrixSse2 c(m);
+            const __m128d ox = _mm_set1_pd(offset[0]);
+            const __m128d oy = _mm_set1_pd(offset[1]);
+            const __m128d oz = _mm_set1_pd(offset[2]);
+            size_t k = 0;
+            for (; k + 2 <= count; k += 2) {
+                const __m128d px = _mm_loadu_pd(x + k);
+                const __m128d py = _mm_loadu_pd(y + k);
+                const __m128d pz = _mm_loadu_pd(z + k);
+                _mm_storeu_pd(outX + k, _mm_sub_pd(_mm_loadu_pd(bx + k), _mm_sub_pd(c.row(0, px, py, pz), ox)));
+                _mm_storeu_pd(outY + k, _mm_sub_pd(_mm_loadu_pd(by + k), _mm_sub_pd(c.row(1, px, py, pz), oy)));
+                _mm_storeu_pd(outZ + k, _mm_sub_pd(_mm_loadu_pd(bz + k), _mm_sub_pd(c.row(2, px, py, pz), oz)));
+            }
+            gapScalar(m, offset, bx + k, by + k, bz + k, x + k, y + k, z + k, outX + k, outY + k, outZ + k, count - k);
+        }
+
+        void subtractSse2(const double* ax, const double* ay, const double* az,
+                          const double* bx, const double* by, const double* bz,
+                          double* outX, double* outY, double* outZ, size_t count) {
+            size_t k = 0;
+            for (; k + 2 <= count; k += 2) {
+                _mm_storeu_pd(outX + k, _mm_sub_pd(_mm_loadu_pd(ax + k), _mm_loadu_pd(bx + k)));
+                _mm_storeu_pd(outY + k, _mm_sub_pd(_mm_loadu_pd(ay + k), _mm_loadu_pd(by + k)));
+                _mm_storeu_pd(outZ + k, _mm_sub_pd(_mm_loadu_pd(az + k), _mm_loadu_pd(bz + k)));
+            }
+            subtractScalar(ax + k, ay + k, az + k, bx + k, by + k, bz + k, outX + k, outY + k, outZ + k, count - k);
+        }
+
+        struct MatrixAvx2 {
+            __m256d c[3][4];
+            CF_TARGET_AVX2 explicit MatrixAvx2(const Matrix& m) {
+                for (int i = 0; i < 3; ++i) {
+                    for (int j = 0; j < 4; ++j) {
+                        c[i][j] = _mm256_set1_pd(m[i][j]);
+                    }
+                }
+            }
+            CF_TARGET_AVX2 __m256d row(int i, __m256d px, __m256d py, __m256d pz) const {
+                __m256d r = _mm256_add_pd(c[i][3], _mm256_mul_pd(c[i][0], px));
+                r = _mm256_add_pd(r, _mm256_mul_pd(c[i][1], py));
+                return _mm256_add_pd(r, _mm256_mul_pd(c[i][2], pz));
+            }
+        };
+
+        CF_TARGET_AVX2 void transformAvx2(const Matrix& m, const double* x, const double* y, const double* z,
+                                          double* outX, double* outY, double* outZ, size_t count) {
+            const MatrixAvx2 c(m);
+            size_t k = 0;
+            for (; k + 4 <= count; k += 4) {
+                const __m256d px = _mm256_loadu_pd(x + k);
+                const __m256d py = _mm256_loadu_pd(y + k);
+                const __m256d pz = _mm256_loadu_pd(z + k);
+                _mm256_storeu_pd(outX + k, c.row(0, px, py, pz));
+                _mm256_storeu_pd(outY + k, c.row(1, px, py, pz));
+                _mm256_storeu_pd(outZ + k, c.row(2, px, py, pz));
+            }
+            transformScalar(m, x + k, y + k, z + k, outX + k, outY + k, outZ + k, count - k);
+        }
+
+        CF_TARGET_AVX2 void gapAvx2(const Matrix& m, const array<double, 3>& offset,
+                                    const double* bx, const double* by, const double* bz,
+                                    const double* x, const double* y, const double* z,
+                                    double* outX, double* outY, double* outZ, size_t count) {
+            const MatrixAvx2 c(m);
+            const __m256d ox = _mm256_set1_pd(offset[0]);
+            const __m256d oy = _mm256_set1_pd(offset[1]);
+            const __m256d oz = _mm256_set1_pd(offset[2]);
+            size_t k = 0;
+            for (; k + 4 <= count; k += 4) {
+                const __m256d px = _mm256_loadu_pd(x + k);
+                const __m256d py = _mm256_loadu_pd(y + k);
+                const __m256d pz = _mm256_loadu_pd(z + k);
+                _mm256_storeu_pd(outX + k, _mm256_sub_pd(_mm256_loadu_pd(bx + k), _mm256_sub_pd(c.row(0, px, py, pz), ox)));
+                _mm256_storeu_pd(outY + k, _mm256_sub_pd(_mm256_loadu_pd(by + k), _mm256_sub_pd(c.row(1, px, py, pz), oy)));
+                _mm256_storeu_pd(outZ + k, _mm256_sub_pd(_mm256_loadu_pd(bz + k), _mm256_sub_pd(c.row(2, px, py, pz), oz)));
+            }
+            gapScalar(m, offset, bx + k, by + k, bz + k, x + k, y + k, z + k, outX + k, outY + k, outZ + k, count - k);
+        }
+
+        CF_TARGET_AVX2 void subtractAvx2(const double* ax, const double* ay, const double* az,
+                                         const double* bx, const double* by, const double* bz,
+                                         double* outX, double* outY, double* outZ, size_t count) {
+            size_t k = 0;
+            for (; k + 4 <= count; k += 4) {
+                _mm256_storeu_pd(outX + k, _mm256_sub_pd(_mm256_loadu_pd(ax + k), _mm256_loadu_pd(bx + k)));
+                _mm256_storeu_pd(outY + k, _mm256_sub_pd(_mm256_loadu_pd(ay + k), _mm256_loadu_pd(by + k)));
+                _mm256_storeu_pd(outZ + k, _mm256_sub_pd(_mm256_loadu_pd(az + k), _mm256_loadu_pd(bz + k)));
+            }
+            subtractScalar(ax + k, ay + k, az + k, bx + k, by + k, bz + k, outX + k, outY + k, outZ + k, count - k);
+        }
+
+        // 单精度：SSE 每次 4 个顶点，AVX2 每次 8 个
+        struct MatrixSse2F {
+            __m128 c[3][4];
+            explicit MatrixSse2F(const MatrixF& m) {
+                for (int i = 0; i < 3; ++i) {
+                    for (int j = 0; j < 4; ++j) {
+                        c[i][j] = _mm_set1_ps(m[i][j]);
+                    }
+                }
+            }
+            __m128 row(int i, __m128 px, __m128 py, __m128 pz) const {
+                __m128 r = _mm_add_ps(c[i][3], _mm_mul_ps(c[i][0], px));
+                r = _mm_add_ps(r, _mm_mul_ps(c[i][1], py));
+                return _mm_add_ps(r, _mm_mul_ps(c[i][2], pz));
+            }
+        };
+
+        void transformSse2F(const MatrixF& m, const float* x, const float* y, const float* z,
+                            float* outX, float* outY, float* outZ, size_t count) {
+            const MatrixSse2F c(m);
+            size_t k = 0;
+            for (; k + 4 <= count; k += 4) {
+                const __m128 px = _mm_loadu_ps(x + k);
+                const __m128 py = _mm_loadu_ps(y + k);
+                const __m128 pz = _mm_loadu_ps(z + k);
+                _mm_storeu_ps(outX + k, c.row(0, px, py, pz));
+                _mm_storeu_ps(outY + k, c.row(1, px, py, pz));
+                _mm_storeu_ps(outZ + k, c.row(2, px, py, pz));
+            }
+            transformScalar(m, x + k, y + k, z + k, outX + k, outY + k, outZ + k, count - k);
+        }
+
+        void gapSse2F(const MatrixF& m, const array<float, 3>& offset,
+                      const float* bx, const float* by, const float* bz,
+                      const float* x, const float* y, const float* z,
+                      float* outX, float* outY, float* outZ, size_t count) {
+            const MatrixSse2F c(m);
+            const __m128 ox = _mm_set1_ps(offset[0]);
+            const __m128 oy = _mm_set1_ps(offset[1]);
+            const __m128 oz = _mm_set1_ps(offset[2]);
+            size_t k = 0;
+            for (; k + 4 <= count; k += 4) {
+                const __m128 px = _mm_loadu_ps(x + k);
+                const __m128 py = _mm_loadu_ps(y + k);
+                const __m128 pz = _mm_loadu_ps(z + k);
+                _mm_storeu_ps(outX + k, _mm_sub_ps(_mm_loadu_ps(bx + k), _mm_sub_ps(c.row(0, px, py, pz), ox)));
+                _mm_storeu_ps(outY + k, _mm_sub_ps(_mm_loadu_ps(by + k), _mm_sub_ps(c.row(1, px, py, pz), oy)));
+                _mm_storeu_ps(outZ + k, _mm_sub_ps(_mm_loadu_ps(bz + k), _mm_sub_ps(c.row(2, px, py, pz), oz)));
+            }
+            gapScalar(m, offset, bx + k, by + k, bz + k, x + k, y + k, z + k, outX + k, outY + k, outZ + k, count - k);
+        }
+
+        void subtractSse2F(const float* ax, const float* ay, const float* az,
+                           const float* bx, const float* by, const float* bz,
+                           float* outX, float* outY, float* outZ, size_t count) {
+            size_t k = 0;
+            for (; k + 4 <= count; k += 4) {
+                _mm_storeu_ps(outX + k, _mm_sub_ps(_mm_loadu_ps(ax + k), _mm_loadu_ps(bx + k)));
+                _mm_storeu_ps(outY + k, _mm_sub_ps(_mm_loadu_ps(ay + k), _mm_loadu_ps(by + k)));
+                _mm_storeu_ps(outZ + k, _mm_sub_ps(_mm_loadu_ps(az + k), _mm_loadu_ps(bz + k)));
+            }
+            subtractScalar(ax + k, ay + k, az + k, bx + k, by + k, bz + k, outX + k, outY + k, outZ + k, count - k);
+        }
+
+        struct MatrixAvx2F {
+            __m256 c[3][4];
+            CF_TARGET_AVX2 explicit MatrixAvx2F(const MatrixF& m) {
+                for (int i = 0; i < 3; ++i) {
+                    for (int j = 0; j < 4; ++j) {
+                        c[i][j] = _mm256_set1_ps(m[i][j]);
+                    }
+                }
+            }
+            CF_TARGET_AVX2 __m256 row(int i, __m256 px, __m256 py, __m256 pz) const {
+                __m256 r = _mm256_add_ps(c[i][3], _mm256_mul_ps(c[i][0], px));
+                r = _mm256_add_ps(r, _mm256_mul_ps(c[i][1], py));
+                return _mm256_add_ps(r, _mm256_mul_ps(c[i][2], pz));
+            }
+        };
+
+        CF_TARGET_AVX2 void transformAvx2F(const MatrixF& m, const float* x, const float* y, const float* z,
+                                           float* outX, float* outY, float* outZ, size_t count) {
+            const MatrixAvx2F c(m);
+            size_t k = 0;
+            for (; k + 8 <= count; k += 8) {
+                const __m256 px = _mm256_loadu_ps(x + k);
+                const __m256 py = _mm256_loadu_ps(y + k);
+                const __m256 pz = _mm256_loadu_ps(z + k);
+                _mm256_storeu_ps(outX + k, c.row(0, px, py, pz));
+                _mm256_storeu_ps(outY + k, c.row(1, px, py, pz));
+                _mm256_storeu_ps(outZ + k, c.row(2, px, py, pz));
+            }
+            transformScalar(m, x + k, y + k, z + k, outX + k, outY + k, outZ + k, count - k);
+        }
+
+        CF_TARGET_AVX2 void gapAvx2F(const MatrixF& m, const array<float, 3>& offset,
+                                     const float* bx, const float* by, const float* bz,
+                                     const float* x, const float* y, const float* z,
+                                     float* outX, float* outY, float* outZ, size_t count) {
+            const MatrixAvx2F c(m);
+            const __m256 ox = _mm256_set1_ps(offset[0]);
+            const __m256 oy = _mm256_set1_ps(offset[1]);
+            const __m256 oz = _mm256_set1_ps(offset[2]);
+            size_t k = 0;
+            for (; k + 8 <= count; k += 8) {
+                const __m256 px = _mm256_loadu_ps(x + k);
+                const __m256 py = _mm256_loadu_ps(y + k);
+                const __m256 pz = _mm256_loadu_ps(z + k);
+                _mm256_storeu_ps(outX + k, _mm256_sub_ps(_mm256_loadu_ps(bx + k), _mm256_sub_ps(c.row(0, px, py, pz), ox)));
+                _mm256_storeu_ps(outY + k, _mm256_sub_ps(_mm256_loadu_ps(by + k), _mm256_sub_ps(c.row(1, px, py, pz), oy)));
+                _mm256_storeu_ps(outZ + k, _mm256_sub_ps(_mm256_loadu_ps(bz + k), _mm256_sub_ps(c.row(2, px, py, pz), oz)));
+            }
+            gapScalar(m, offset, bx + k, by + k, bz + k, x + k, y + k, z + k, outX + k, outY + k, outZ + k, count - k);
+        }
+
+        CF_TARGET_AVX2 void subtractAvx2F(const float* ax, const float* ay, const float* az,
+                                          const float* bx, const float* by, const float* bz,
+                                          float* outX, float* outY, float* outZ, size_t count) {
+            size_t k = 0;
+            for (; k + 8 <= count; k += 8) {
+                _mm256_storeu_ps(outX + k, _mm256_sub_ps(_mm256_loadu_ps(ax + k), _mm256_loadu_ps(bx + k)));
+                _mm256_storeu_ps(outY + k, _mm256_sub_ps(_mm256_loadu_ps(ay + k), _mm256_loadu_ps(by + k)));
+                _mm256_storeu_ps(outZ + k, _mm256_sub_ps(_mm256_loadu_ps(az + k), _mm256_loadu_ps(bz + k)));
+            }
+            subtractScalar(ax + k, ay + k, az + k, bx + k, by + k, bz + k, outX + k, outY + k, outZ + k, count - k);
+        }
+
+        bool cpuHasAvx2() {
+#if defined(_MSC_VER)
+            int info[4];
+            __cpuid(info, 0);
+            if (info[0] < 7) {
+                return false;
+            }
+            __cpuid(info, 1);
+            const bool osxsave = (info[2] & (1 << 27)) != 0;
+            const bool avx = (info[2] & (1 << 28)) != 0;
+            if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) {
+                return false;
+            }
+            __cpuidex(info, 7, 0);
+            return (info[1] & (1 << 5)) != 0;
+#else
+            return __builtin_cpu_supports("avx2");
+#endif
+        }
+
+#endif
+
+        struct KernelTable {
+            KernelIsa isa;
+            KernelTypes<double>::Transform transform;
+            KernelTypes<double>::Gap gap;
+            KernelTypes<double>::Subtract subtract;
+            KernelTypes<float>::Transform transformF;
+            KernelTypes<float>::Gap gapF;
+            KernelTypes<float>::Subtract subtractF;
+        };
+
+        const KernelTable* tableFor(KernelIsa isa) {
+            static const KernelTable tables[] = {
+                {KernelIsa::Scalar, transformScalar<double>, gapScalar<double>, subtractScalar<double>,
+                 transformScalar<float>, gapScalar<float>, subtractScalar<float>},
+#ifdef CF_KERNELS_X86
+                {KernelIsa::Sse2, transformSse2, gapSse2, subtractSse2, transformSse2F, gapSse2F, subtractSse2F},
+                {KernelIsa::Avx2, transformAvx2, gapAvx2, subtractAvx2, transformAvx2F, gapAvx2F, subtractAvx2F},
+#endif
+            };
+            return &tables[static_cast<int>(isa)];
+        }
+
+        // 当前实现的函数表，只在首次使用与 setKernelIsa 时替换
+        atomic<const KernelTable*>& currentTable() {
+            static atomic<const KernelTable*> table(tableFor(detectKernelIsa()));
+            return table;
+        }
+
+        const KernelTable& kernels() {
+            return *currentTable().load(memory_order_acquire);
+        }
+
+    }
+
+    KernelIsa detectKernelIsa() {
+#ifdef CF_KERNELS_X86
+        static const KernelIsa detected = cpuHasAvx2() ? KernelIsa::Avx2 : KernelIsa::Sse2;
+        return detected;
+#else
+        return KernelIsa::Scalar;
+#endif
+    }
+
+    KernelIsa activeKernelIsa() {
+        return kernels().isa;
+    }
+
+    KernelIsa setKernelIsa(KernelIsa isa) {
+        if (static_cast<int>(isa) > static_cast<int>(detectKernelIsa())) {
+            isa = detectKernelIsa();
+        }
+        currentTable().store(tableFor(isa), memory_order_release);
+        return isa;
+    }
+
+    const char* kernelIsaName(KernelIsa isa) {
+        switch (isa) {
+        case KernelIsa::Avx2:
+            return "avx2";
+        case KernelIsa::Sse2:
+            return "sse2";
+        default:
+            return "scalar";
+        }
+    }
+
+    void transformPoints(const array<array<double, 4>, 4>& transform, double* x, double* y, double* z, size_t count) {
+        kernels().transform(transform, x, y, z, x, y, z, count);
+    }
+
+    void transformPoints(const array<array<double, 4>, 4>& transform, const double* x, const double* y, const double* z,
+                         double* outX, double* outY, double* outZ, size_t count) {
+        kernels().transform(transform, x, y, z, outX, outY, outZ, count);
+    }
+
+    void transformedGap(const array<array<double, 4>, 4>& transform, const array<double, 3>& offset,
+                        const double* bx, const double* by, const double* bz,
+                        const double* x, const double* y, const double* z,
+                        double* outX, double* outY, double* outZ, size_t count) {
+        kernels().gap(transform, offset, bx, by, bz, x, y, z, outX, outY, outZ, count);
+    }
+
+    void subtractPoints(const double* ax, const double* ay, const double* az,
+                        const double* bx, const double* by, const double* bz,
+                        double* outX, double* outY, double* outZ, size_t count) {
+        kernels().subtract(ax, ay, az, bx, by, bz, outX, outY, outZ, count);
+    }
+
+    void transformPoints(const array<array<double, 4>, 4>& transform, float* x, float* y, float* z, size_t count) {
+        kernels().transformF(toFloat(transform), x, y, z, x, y, z, count);
+    }
+
+    void transformPoints(const array<array<double, 4>, 4>& transform, const float* x, const float* y, const float* z,
+                         float* outX, float* outY, float* outZ, size_t count) {
+        kernels().transformF(toFloat(transform), x, y, z, outX, outY, outZ, count);
+    }
+
+    void transformedGap(const array<array<double, 4>, 4>& transform, const array<double, 3>& offset,
+                        const float* bx, const float* by, const float* bz,
+                        const float* x, const float* y, const float* z,
+                        float* outX, float* outY, float* outZ, size_t count) {
+        const array<float, 3> offsetF = {static_cast<float>(offset[0]), static_cast<float>(offset[1]), static_cast<float>(offset[2])};
+        kernels().gapF(toFloat(transform), offsetF, bx, by, bz, x, y, z, outX, outY, outZ, count);
+    }
+
+    void subtractPoints(const float* ax, const float* ay, const float* az,
+                        const float* bx, const float* by, const float* bz,
+                        float* outX, float* outY, float* outZ, size_t count) {
+        kernels().subtractF(ax, ay, az, bx, by, bz, outX, outY, outZ, count);
+    }
+
+}
@@ -0,0 +1,174 @@
+#include "MeshSet.h"
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+namespace cf {
+
+    namespace {
+
+        struct MeshNameTable {
+            mutex lock;
+            unordered_map<string, MeshNameId> ids;
+            deque<string> names;  // deque 保证已返回的引用在扩容后仍然有效
+        };
+
+        MeshNameTable& nameTable() {
+            static MeshNameTable table;
+            return table;
+        }
+
+    }
+
+    MeshNameId internMeshName(const string& name) {
+        MeshNameTable& table = nameTable();
+        lock_guard<mutex> guard(table.lock);
+        auto it = table.ids.find(name);
+        if (it != table.ids.end()) {
+            return it->second;
+        }
+        MeshNameId id = static_cast<MeshNameId>(table.names.size());
+        table.names.push_back(name);
+        table.ids.emplace(name, id);
+        return id;
+    }
+
+    MeshNameId findMeshName(const string& name) {
+        MeshNameTable& table = nameTable();
+        lock_guard<mutex> guard(table.lock);
+        auto it = table.ids.find(name);
+        return it != table.ids.end() ? it->second : kInvalidMeshName;
+    }
+
+    const string& meshNameOf(MeshNameId id) {
+        static const string empty;
+        MeshNameTable& table = nameTable();
+        lock_guard<mutex> guard(table.lock);
+        return id < table.names.size() ? table.names[id] : empty;
+    }
+
+    template <typename Scalar>
+    BasicMeshSet<Scalar>::BasicMeshSet() : mCapacity(0), mUsed(0) {}
+
+    template <typename Scalar>
+    template <typename Other>
+    BasicMeshSet<Scalar>::BasicMeshSet(const BasicMeshSet<Other>& other)
+        : mMeshes(other.mMeshes), mSlotByName(other.mSlotByName), mTopology(other.mTopology), mCapacity(other.mUsed), mUsed(other.mUsed) {
+        mCoords.resize(3 * mCapacity);
+        const Other* sources[3] = {other.xData(), other.yData(), other.zData()};
+        for (size_t axis = 0; axis < 3; ++axis) {
+            transform(sources[axis], sources[axis] + mUsed, mCoords.begin() + axis * mCapacity,
+                      [](Other value) { return static_cast<Scalar>(value); });
+        }
+    }
+
+    template <typename Scalar>
+    int BasicMeshSet<Scalar>::find(MeshNameId name) const {
+        if (name >= mSlotByName.size()) {
+            return -1;
+        }
+        return mSlotByName[name];
+    }
+
+    template <typename Scalar>
+    size_t BasicMeshSet<Scalar>::addMesh(MeshNameId name, size_t count) {
+        int existing = find(name);
+        if (existing >= 0) {
+            MeshRange& range = mMeshes[existing];
+            if (range.count != count) {
+                // 替换为不同大小的网格：移除旧区间并压缩缓冲，再追加到末尾
+                BasicMeshSet compacted;
+                compacted.reserve(mMeshes.size(), mUsed - range.count + count);
+                for (size_t m = 0; m < mMeshes.size(); ++m) {
+                    if (static_cast<int>(m) == existing) continue;
+                    size_t slot = compacted.addMesh(mMeshes[m].name, mMeshes[m].count);
+                    copy(x(m), x(m) + mMeshes[m].count, compacted.x(slot));
+                    copy(y(m), y(m) + mMeshes[m].count, compacted.y(slot));
+                    copy(z(m), z(m) + mMeshes[m].count, compacted.z(slot));
+                    compacted.mTopology[slot] = mTopology[m];
+                }
+                *this = std::move(compacted);
+                return addMesh(name, count);
+            }
+            fill(x(existing), x(existing) + count, Scalar(0));
+            fill(y(existing), y(existing) + count, Scalar(0));
+            fill(z(existing), z(existing) + count, Scalar(0));
+            mTopology[existing].reset();
+            return static_cast<size_t>(existing);
+        }
+
+        if (mUsed + count > mCapacity) {
+            grow(max(mUsed + count, mCapacity * 2));
+        }
+
+        if (name >= mSlotByName.size()) {
+            mSlotByName.resize(name + 1, -1);
+        }
+        mSlotByName[name] = static_cast<int32_t>(mMeshes.size());
+        mMeshes.push_back({name, mUsed, count});
+        mTopology.emplace_back();
+        mUsed += count;
+        return mMeshes.size() - 1;
+    }
+
+    template <typename Scalar>
+    void BasicMeshSet<Scalar>::setInterleaved(size_t mesh, const double* xyz) {
+        Scalar* px = x(mesh);
+        Scalar* py = y(mesh);
+        Scalar* pz = z(mesh);
+        const size_t count = mMeshes[mesh].count;
+        for (size_t i = 0; i < count; ++i) {
+            px[i] = static_cast<Scalar>(xyz[i * 3]);
+            py[i] = static_cast<Scalar>(xyz[i * 3 + 1]);
+            pz[i] = static_cast<Scalar>(xyz[i * 3 + 2]);
+        }
+    }
+
+    template <typename Scalar>
+    vector<array<double, 3>> BasicMeshSet<Scalar>::vertices(size_t mesh) const {
+        const Scalar* px = x(mesh);
+        const Scalar* py = y(mesh);
+        const Scalar* pz = z(mesh);
+        vector<array<double, 3>> result(mMeshes[mesh].count);
+        for (size_t i = 0; i < result.size(); ++i) {
+            result[i] = {static_cast<double>(px[i]), static_cast<double>(py[i]), static_cast<double>(pz[i])};
+        }
+        return result;
+    }
+
+    template <typename Scalar>
+    void BasicMeshSet<Scalar>::reserve(size_t meshCount, size_t vertexCount) {
+        mMeshes.reserve(meshCount);
+        mTopology.reserve(meshCount);
+        if (vertexCount > mCapacity) {
+            grow(vertexCount);
+        }
+    }
+
+    template <typename Scalar>
+    void BasicMeshSet<Scalar>::clear() {
+        mMeshes.clear();
+        mSlotByName.clear();
+        mTopology.clear();
+        mCoords.clear();
+        mCapacity = 0;
+        mUsed = 0;
+    }
+
+    template <typename Scalar>
+    void BasicMeshSet<Scalar>::grow(size_t capacity) {
+        vector<Scalar> coords(3 * capacity, Scalar(0));
+        for (size_t axis = 0; axis < 3; ++axis) {
+            copy(mCoords.begin() + axis * mCapacity, mCoords.begin() + axis * mCapacity + mUsed, coords.begin() + axis * capacity);
+        }
+        mCoords.swap(coords);
+        mCapacity = capacity;
+    }
+
+    template class BasicMeshSet<double>;
+    template class BasicMeshSet<float>;
+    template BasicMeshSet<float>::BasicMeshSet(const BasicMeshSet<double>& other);
+    template BasicMeshSet<double>::BasicMeshSet(const BasicMeshSet<float>& other);
+
+}
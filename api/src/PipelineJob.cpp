@@ -0,0 +1,254 @@
+#include "PipelineJob.h"
+#include <algorithm>
+#include <exception>
+
+namespace cf {
+
+    namespace {
+
+        // 已结束的任务只保留最近的若干个供查询
+        const size_t kRetainedJobs = 64;
+
+    }
+
+    JobProgress::JobProgress()
+        : mStart(chrono::steady_clock::now()), mStopped(false), mStageStart(0.0), mStageEnd(0.0), mSteps(0), mDone(0), mCancelled(false) {}
+
+    void JobProgress::beginStage(const string& stage, double start, double end, size_t steps) {
+        lock_guard<mutex> guard(mLock);
+        mStage = stage;
+        mStageStart = start;
+        mStageEnd = max(start, end);
+        mSteps = steps;
+        mDone = 0;
+    }
+
+    void JobProgress::advance(size_t steps) {
+        lock_guard<mutex> guard(mLock);
+        mDone = min(mDone + steps, mSteps);
+    }
+
+    void JobProgress::stop() {
+        lock_guard<mutex> guard(mLock);
+        if (!mStopped) {
+            mStop = chrono::steady_clock::now();
+            mStopped = true;
+        }
+    }
+
+    JobProgressSnapshot JobProgress::snapshot() const {
+        lock_guard<mutex> guard(mLock);
+        JobProgressSnapshot snapshot;
+        snapshot.stage = mStage;
+        snapshot.stepsDone = mDone;
+        snapshot.stepCount = mSteps;
+        const double stageFraction = mSteps > 0 ? static_cast<double>(mDone) / static_cast<double>(mSteps) : 0.0;
+        snapshot.fraction = min(1.0, mStageStart + (mStageEnd - mStageStart) * stageFraction);
+        snapshot.elapsedSeconds = chrono::duration<double>((mStopped ? mStop : chrono::steady_clock::now()) - mStart).count();
+        if (snapshot.fraction > 0.0) {
+            snapshot.etaSeconds = snapshot.elapsedSeconds * (1.0 - snapshot.fraction) / snapshot.fraction;
+        }
+        return snapshot;
+    }
+
+    const char* jobStateName(JobState state) {
+        switch (state) {
+        case JobState::Running:
+            return "running";
+        case JobState::Finishing:
+            return "finishing";
+        case JobState::Succeeded:
+            return "succeeded";
+        case JobState::Failed:
+            return "failed";
+        case JobState::Cancelled:
+            return "cancelled";
+        }
+        return "unknown";
+    }
+
+    PipelineJobEngine::~PipelineJobEngine() {
+        shutdown();
+    }
+
+    PipelineJobEngine& PipelineJobEngine::shared() {
+        static PipelineJobEngine engine;
+        return engine;
+    }
+
+    void PipelineJobEngine::setCompletionNotifier(CompletionNotifier notifier) {
+        lock_guard<mutex> guard(mLock);
+        mNotifier = std::move(notifier);
+    }
+
+    uint64_t PipelineJobEngine::submit(Work work, Finish finish) {
+        auto job = make_unique<Job>();
+        job->work = std::move(work);
+        job->finish = std::move(finish);
+
+        lock_guard<mutex> guard(mLock);
+        const uint64_t id = mNextId++;
+        Job& entry = *job;
+        entry.id = id;
+        mJobs[id] = std::move(job);
+        entry.worker = thread(&PipelineJobEngine::execute, this, ref(entry));
+        return id;
+    }
+
+    void PipelineJobEngine::execute(Job& job) {
+        bool succeeded = false;
+        vector<pair<LogLevel, string>> logs;
+        {
+            // 后台线程不能直接输出日志（MGlobal 只能在主线程使用），收尾时在主线程上按顺序输出
+            ThreadLogBuffer buffer;
+            if (!job.progress.cancelled()) {
+                try {
+                    succeeded = job.work(job.progress);
+                } catch (const exception& e) {
+                    logError("Job " + to_string(job.id) + " failed: " + e.what());
+                }
+            }
+            job.work = nullptr;
+            logs = buffer.messages();
+        }
+
+        CompletionNotifier notifier;
+        {
+            lock_guard<mutex> guard(mLock);
+            job.succeeded = succeeded;
+            job.logs = std::move(logs);
+            job.state = JobState::Finishing;
+            notifier = mNotifier;
+        }
+        // 先通知宿主再唤醒 waitForWork，等待方返回时收尾已经安排好
+        if (notifier) {
+            notifier();
+        }
+        mWorkDone.notify_all();
+    }
+
+    bool PipelineJobEngine::status(uint64_t id, JobStatus& status) const {
+        lock_guard<mutex> guard(mLock);
+        auto it = mJobs.find(id);
+        if (it == mJobs.end()) {
+            return false;
+        }
+        status.id = id;
+        status.state = it->second->state;
+        status.progress = it->second->progress.snapshot();
+        return true;
+    }
+
+    bool PipelineJobEngine::cancel(uint64_t id) {
+        lock_guard<mutex> guard(mLock);
+        auto it = mJobs.find(id);
+        if (it == mJobs.end() || (it->second->state != JobState::Running && it->second->state != JobState::Finishing)) {
+            return false;
+        }
+        it->second->progress.cancel();
+        return true;
+    }
+
+    size_t PipelineJobEngine::runPendingFinalizers() {
+        size_t finished = 0;
+        for (;;) {
+            Job* job = nullptr;
+            {
+                lock_guard<mutex> guard(mLock);
+                for (auto& [id, entry] : mJobs) {
+                    if (entry->state == JobState::Finishing && !entry->finalizing) {
+                        job = entry.get();
+                        job->finalizing = true;
+                        break;
+                    }
+                }
+            }
+            if (!job) {
+                break;
+            }
+
+            // work 已结束，线程随即退出
+            if (job->worker.joinable()) {
+                job->worker.join();
+            }
+            ThreadLogBuffer::replay(job->logs);
+            const JobState outcome = job->progress.cancelled() ? JobState::Cancelled
+                                   : job->succeeded ? JobState::Succeeded : JobState::Failed;
+            if (outcome == JobState::Cancelled) {
+                logWarning("Job " + to_string(job->id) + " cancelled");
+            }
+            if (job->finish) {
+                try {
+                    job->finish(outcome);
+                } catch (const exception& e) {
+                    logError("Job " + to_string(job->id) + " failed while finishing: " + e.what());
+                }
+            }
+            if (outcome == JobState::Succeeded) {
+                job->progress.beginStage("done", 1.0, 1.0);
+            }
+            job->progress.stop();
+
+            lock_guard<mutex> guard(mLock);
+            job->state = outcome;
+            job->finish = nullptr;
+            job->logs.clear();
+            ++finished;
+
+            // 超出保留个数时丢弃最早结束的任务记录
+            vector<uint64_t> ended;
+            for (const auto& [id, entry] : mJobs) {
+                if (entry->state != JobState::Running && entry->state != JobState::Finishing) {
+                    ended.push_back(id);
+                }
+            }
+            for (size_t k = 0; k + kRetainedJobs < ended.size(); ++k) {
+                mJobs.erase(ended[k]);
+            }
+        }
+        return finished;
+    }
+
+    void PipelineJobEngine::waitForWork(uint64_t id) {
+        unique_lock<mutex> guard(mLock);
+        mWorkDone.wait(guard, [&] {
+            auto it = mJobs.find(id);
+            return it == mJobs.end() || it->second->state != JobState::Running;
+        });
+    }
+
+    size_t PipelineJobEngine::activeCount() const {
+        lock_guard<mutex> guard(mLock);
+        return static_cast<size_t>(count_if(mJobs.begin(), mJobs.end(), [](const auto& entry) {
+            return entry.second->state == JobState::Running || entry.second->state == JobState::Finishing;
+        }));
+    }
+
+    void PipelineJobEngine::shutdown() {
+        vector<Job*> jobs;
+        {
+            lock_guard<mutex> guard(mLock);
+            mNotifier = nullptr;
+            for (auto& [id, job] : mJobs) {
+                job->progress.cancel();
+                jobs.push_back(job.get());
+            }
+        }
+        for (Job* job : jobs) {
+            if (job->worker.joinable() && !job->finalizing) {
+                job->worker.join();
+            }
+        }
+
+        lock_guard<mutex> guard(mLock);
+        for (auto& [id, job] : mJobs) {
+            if (job->state == JobState::Finishing && !job->finalizing) {
+                job->state = JobState::Cancelled;
+                job->finish = nullptr;
+                job->logs.clear();
+                job->progress.stop();
+            }
+        }
+    }
+
+}
@@ -0,0 +1,346 @@
+#include "RegionWeights.h"
+#include "ContentHash.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace cf {
+
+    namespace {
+
+        // 缓存文件布局（小端）：
+        //   CacheHeader | CacheMesh[meshCount] | CacheRegion[regionCount] | 名称字符串 | uint32 索引[nnz] | float 权重[nnz]
+        // 各段起始偏移按 kCacheAlignment 对齐，映射后可直接作为数组使用
+        const char kCacheMagic[8] = {'C', 'F', 'W', 'E', 'I', 'G', 'H', 'T'};
+        const uint32_t kCacheVersion = 1;
+        const uint32_t kCacheByteOrder = 0x01020304;
+        const uint64_t kCacheAlignment = 64;
+
+        struct CacheHeader {
+            char magic[8];
+            uint32_t version;
+            uint32_t byteOrder;
+            uint64_t sourceHash;
+            uint64_t sourceSize;
+            uint64_t fileSize;
+            uint32_t meshCount;
+            uint32_t regionCount;
+            uint64_t nonZeroCount;
+            uint64_t meshOffset;
+            uint64_t regionOffset;
+            uint64_t stringOffset;
+            uint64_t stringSize;
+            uint64_t indexOffset;
+            uint64_t weightOffset;
+        };
+
+        struct CacheMesh {
+            uint32_t nameOffset;
+            uint32_t nameLength;
+            uint32_t firstRegion;
+            uint32_t regionCount;
+        };
+
+        struct CacheRegion {
+            uint32_t meshIndex;
+            uint32_t nameOffset;
+            uint32_t nameLength;
+            uint32_t begin;
+            uint32_t end;
+            uint32_t reserved;
+        };
+
+        struct CompiledArrays {
+            vector<uint32_t> indices;
+            vector<float> weights;
+        };
+
+        uint64_t alignUp(uint64_t value) {
+            return (value + kCacheAlignment - 1) / kCacheAlignment * kCacheAlignment;
+        }
+
+        bool inFile(uint64_t offset, uint64_t bytes, uint64_t fileSize) {
+            return offset <= fileSize && bytes <= fileSize - offset;
+        }
+
+    }
+
+    RegionWeightMap RegionWeightMap::compile(const nlohmann::json& weightJson) {
+        RegionWeightMap map;
+        if (!weightJson.is_object()) {
+            return map;
+        }
+
+        auto arrays = make_shared<CompiledArrays>();
+        vector<pair<uint32_t, float>> entries;
+        for (auto meshIt = weightJson.begin(); meshIt != weightJson.end(); ++meshIt) {
+            if (!meshIt.value().is_object()) {
+                continue;
+            }
+
+            WeightMesh mesh;
+            mesh.mesh = internMeshName(meshIt.key());
+            mesh.firstRegion = static_cast<uint32_t>(map.mRegions.size());
+            mesh.regionCount = 0;
+
+            for (auto regionIt = meshIt.value().begin(); regionIt != meshIt.value().end(); ++regionIt) {
+                if (!regionIt.value().is_object()) {
+                    continue;
+                }
+
+                entries.clear();
+                for (auto weightIt = regionIt.value().begin(); weightIt != regionIt.value().end(); ++weightIt) {
+                    if (!weightIt.value().is_number()) {
+                        continue;
+                    }
+                    double weight = weightIt.value().get<double>();
+                    if (weight == 0.0) {
+                        continue;
+                    }
+
+                    const string& key = weightIt.key();
+                    char* end = nullptr;
+                    unsigned long index = strtoul(key.c_str(), &end, 10);
+                    if (key.empty() || *end != '\0' || index > 0xFFFFFFFFul) {
+                        continue;
+                    }
+                    entries.emplace_back(static_cast<uint32_t>(index), static_cast<float>(weight));
+                }
+
+                // JSON键按字符串排序，这里改为按顶点索引升序
+                sort(entries.begin(), entries.end(), [](const pair<uint32_t, float>& a, const pair<uint32_t, float>& b) {
+                    return a.first < b.first;
+                });
+
+                WeightRegion region;
+                region.mesh = mesh.mesh;
+                region.regionName = regionIt.key();
+                region.begin = static_cast<uint32_t>(arrays->indices.size());
+                for (const auto& [index, weight] : entries) {
+                    arrays->indices.push_back(index);
+                    arrays->weights.push_back(weight);
+                }
+                region.end = static_cast<uint32_t>(arrays->indices.size());
+
+                map.mRegions.push_back(std::move(region));
+                ++mesh.regionCount;
+            }
+
+            map.mMeshes.push_back(mesh);
+        }
+
+        map.mIndices = arrays->indices.data();
+        map.mWeights = arrays->weights.data();
+        map.mNonZeroCount = arrays->indices.size();
+        map.mStorage = std::move(arrays);
+        return map;
+    }
+
+    bool RegionWeightMap::load(const string& jsonPath, RegionWeightMap& map, string& error, const string& cachePath, RegionWeightLoadInfo* info) {
+        RegionWeightLoadInfo localInfo;
+        RegionWeightLoadInfo& result = info ? *info : localInfo;
+        result = RegionWeightLoadInfo();
+        const string cacheFile = cachePath.empty() ? defaultCachePath(jsonPath) : cachePath;
+
+        MappedFile source;
+        if (!source.open(jsonPath)) {
+            error = "Failed to open weight JSON file: " + jsonPath;
+            return false;
+        }
+        result.sourceHash = hashBytes(source.data(), source.size());
+
+        string cacheError;
+        if (openCache(cacheFile, result.sourceHash, source.size(), map, cacheError)) {
+            result.fromCache = true;
+            return true;
+        }
+        result.cacheMessage = cacheError;
+
+        nlohmann::json weightJson;
+        try {
+            weightJson = nlohmann::json::parse(source.data(), source.data() + source.size());
+        } catch (const exception& e) {
+            error = string("Error parsing weight JSON: ") + e.what();
+            return false;
+        }
+        map = compile(weightJson);
+
+        // 缓存写出失败（如目录只读）不影响本次结果
+        if (map.writeCache(cacheFile, result.sourceHash, source.size(), cacheError)) {
+            result.cacheWritten = true;
+        } else {
+            result.cacheMessage = cacheError;
+        }
+        return true;
+    }
+
+    bool RegionWeightMap::writeCache(const string& cachePath, uint64_t sourceHash, uint64_t sourceSize, string& error) const {
+        CacheHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, kCacheMagic, sizeof(kCacheMagic));
+        header.version = kCacheVersion;
+        header.byteOrder = kCacheByteOrder;
+        header.sourceHash = sourceHash;
+        header.sourceSize = sourceSize;
+        header.meshCount = static_cast<uint32_t>(mMeshes.size());
+        header.regionCount = static_cast<uint32_t>(mRegions.size());
+        header.nonZeroCount = mNonZeroCount;
+
+        string names;
+        vector<CacheMesh> meshes(mMeshes.size());
+        for (size_t m = 0; m < mMeshes.size(); ++m) {
+            const string& name = meshNameOf(mMeshes[m].mesh);
+            meshes[m] = {static_cast<uint32_t>(names.size()), static_cast<uint32_t>(name.size()), mMeshes[m].firstRegion, mMeshes[m].regionCount};
+            names += name;
+        }
+        vector<CacheRegion> regions(mRegions.size());
+        for (size_t m = 0; m < mMeshes.size(); ++m) {
+            for (uint32_t r = mMeshes[m].firstRegion; r < mMeshes[m].firstRegion + mMeshes[m].regionCount; ++r) {
+                const WeightRegion& region = mRegions[r];
+                regions[r] = {static_cast<uint32_t>(m), static_cast<uint32_t>(names.size()), static_cast<uint32_t>(region.regionName.size()), region.begin, region.end, 0};
+                names += region.regionName;
+            }
+        }
+
+        header.meshOffset = alignUp(sizeof(CacheHeader));
+        header.regionOffset = alignUp(header.meshOffset + meshes.size() * sizeof(CacheMesh));
+        header.stringOffset = alignUp(header.regionOffset + regions.size() * sizeof(CacheRegion));
+        header.stringSize = names.size();
+        header.indexOffset = alignUp(header.stringOffset + names.size());
+        header.weightOffset = alignUp(header.indexOffset + mNonZeroCount * sizeof(uint32_t));
+        header.fileSize = header.weightOffset + mNonZeroCount * sizeof(float);
+
+        const string tempPath = cachePath + ".tmp";
+        FILE* fp = fopen(tempPath.c_str(), "wb");
+        if (!fp) {
+            error = "Failed to open weight cache for writing: " + tempPath;
+            return false;
+        }
+
+        uint64_t written = 0;
+        bool ok = true;
+        auto put = [&](uint64_t offset, const void* data, size_t bytes) {
+            static const char zeros[kCacheAlignment] = {};
+            while (ok && written < offset) {
+                size_t pad = static_cast<size_t>(min<uint64_t>(offset - written, kCacheAlignment));
+                ok = fwrite(zeros, 1, pad, fp) == pad;
+                written += pad;
+            }
+            if (ok && bytes > 0) {
+                ok = fwrite(data, 1, bytes, fp) == bytes;
+                written += bytes;
+            }
+        };
+        put(0, &header, sizeof(header));
+        put(header.meshOffset, meshes.data(), meshes.size() * sizeof(CacheMesh));
+        put(header.regionOffset, regions.data(), regions.size() * sizeof(CacheRegion));
+        put(header.stringOffset, names.data(), names.size());
+        put(header.indexOffset, mIndices, mNonZeroCount * sizeof(uint32_t));
+        put(header.weightOffset, mWeights, mNonZeroCount * sizeof(float));
+        ok = fclose(fp) == 0 && ok;
+
+        if (!ok) {
+            remove(tempPath.c_str());
+            error = "Failed to write weight cache: " + tempPath;
+            return false;
+        }
+
+        // Windows 下 rename 不能覆盖已存在的文件，先删除旧缓存
+        remove(cachePath.c_str());
+        if (rename(tempPath.c_str(), cachePath.c_str()) != 0) {
+            remove(tempPath.c_str());
+            error = "Failed to replace weight cache: " + cachePath;
+            return false;
+        }
+        return true;
+    }
+
+    bool RegionWeightMap::openCache(const string& cachePath, uint64_t sourceHash, uint64_t sourceSize, RegionWeightMap& map, string& error) {
+        auto file = make_shared<MappedFile>();
+        if (!file->open(cachePath)) {
+            error = "Weight cache not found: " + cachePath;
+            return false;
+        }
+
+        const uint8_t* data = file->data();
+        const uint64_t fileSize = file->size();
+        CacheHeader header;
+        if (fileSize < sizeof(header)) {
+            error = "Weight cache is truncated: " + cachePath;
+            return false;
+        }
+        memcpy(&header, data, sizeof(header));
+
+        if (memcmp(header.magic, kCacheMagic, sizeof(kCacheMagic)) != 0 || header.version != kCacheVersion || header.byteOrder != kCacheByteOrder) {
+            error = "Weight cache has an unsupported format: " + cachePath;
+            return false;
+        }
+        if (header.sourceHash != sourceHash || header.sourceSize != sourceSize) {
+            error = "Weight cache is stale: " + cachePath;
+            return false;
+        }
+
+        const uint64_t nnz = header.nonZeroCount;
+        const bool layoutOk = header.fileSize == fileSize
+            && header.meshOffset % kCacheAlignment == 0 && header.regionOffset % kCacheAlignment == 0
+            && header.indexOffset % kCacheAlignment == 0 && header.weightOffset % kCacheAlignment == 0
+            && nnz <= 0xFFFFFFFFull
+            && inFile(header.meshOffset, uint64_t(header.meshCount) * sizeof(CacheMesh), fileSize)
+            && inFile(header.regionOffset, uint64_t(header.regionCount) * sizeof(CacheRegion), fileSize)
+            && inFile(header.stringOffset, header.stringSize, fileSize)
+            && inFile(header.indexOffset, nnz * sizeof(uint32_t), fileSize)
+            && inFile(header.weightOffset, nnz * sizeof(float), fileSize);
+        if (!layoutOk) {
+            error = "Weight cache is corrupted: " + cachePath;
+            return false;
+        }
+
+        const CacheMesh* meshes = reinterpret_cast<const CacheMesh*>(data + header.meshOffset);
+        const CacheRegion* regions = reinterpret_cast<const CacheRegion*>(data + header.regionOffset);
+        const char* names = reinterpret_cast<const char*>(data + header.stringOffset);
+        auto nameOk = [&](uint32_t offset, uint32_t length) {
+            return inFile(offset, length, header.stringSize);
+        };
+
+        RegionWeightMap loaded;
+        loaded.mMeshes.reserve(header.meshCount);
+        for (uint32_t m = 0; m < header.meshCount; ++m) {
+            const CacheMesh& mesh = meshes[m];
+            if (!nameOk(mesh.nameOffset, mesh.nameLength) || uint64_t(mesh.firstRegion) + mesh.regionCount > header.regionCount) {
+                error = "Weight cache is corrupted: " + cachePath;
+                return false;
+            }
+            loaded.mMeshes.push_back({internMeshName(string(names + mesh.nameOffset, mesh.nameLength)), mesh.firstRegion, mesh.regionCount});
+        }
+
+        loaded.mRegions.reserve(header.regionCount);
+        for (uint32_t r = 0; r < header.regionCount; ++r) {
+            const CacheRegion& region = regions[r];
+            if (region.meshIndex >= header.meshCount || !nameOk(region.nameOffset, region.nameLength) || region.begin > region.end || region.end > nnz) {
+                error = "Weight cache is corrupted: " + cachePath;
+                return false;
+            }
+            loaded.mRegions.push_back({loaded.mMeshes[region.meshIndex].mesh, string(names + region.nameOffset, region.nameLength), region.begin, region.end});
+        }
+
+        loaded.mIndices = reinterpret_cast<const uint32_t*>(data + header.indexOffset);
+        loaded.mWeights = reinterpret_cast<const float*>(data + header.weightOffset);
+        loaded.mNonZeroCount = static_cast<size_t>(nnz);
+        loaded.mStorage = std::move(file);
+        loaded.mMapped = true;
+        map = std::move(loaded);
+        return true;
+    }
+
+    int RegionWeightMap::findMesh(MeshNameId mesh) const {
+        for (size_t m = 0; m < mMeshes.size(); ++m) {
+            if (mMeshes[m].mesh == mesh) {
+                return static_cast<int>(m);
+            }
+        }
+        return -1;
+    }
+
+}
@@ -0,0 +1,320 @@
+#include "Registration.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace cf {
+
+    namespace {
+
+        // 归约按 4 路分块累加：求和顺序固定（结果可重复），且每一路可映射到一个 SIMD 通道
+        const size_t kLanes = 4;
+
+        using Matrix3 = array<array<double, 3>, 3>;
+
+        struct Centroids {
+            double weight = 0.0;
+            array<double, 3> from = {0.0, 0.0, 0.0};
+            array<double, 3> to = {0.0, 0.0, 0.0};
+        };
+
+        Centroids accumulateCentroids(const PointSpan& from, const PointSpan& to, const double* weights) {
+            const size_t n = from.count;
+            double acc[7][kLanes] = {};
+
+            size_t i = 0;
+            for (; i + kLanes <= n; i += kLanes) {
+                for (size_t l = 0; l < kLanes; ++l) {
+                    const double w = weights ? weights[i + l] : 1.0;
+                    acc[0][l] += w;
+                    acc[1][l] += w * from.x[i + l];
+                    acc[2][l] += w * from.y[i + l];
+                    acc[3][l] += w * from.z[i + l];
+                    acc[4][l] += w * to.x[i + l];
+                    acc[5][l] += w * to.y[i + l];
+                    acc[6][l] += w * to.z[i + l];
+                }
+            }
+            for (size_t l = 0; i < n; ++i, ++l) {
+                const double w = weights ? weights[i] : 1.0;
+                acc[0][l] += w;
+                acc[1][l] += w * from.x[i];
+                acc[2][l] += w * from.y[i];
+                acc[3][l] += w * from.z[i];
+                acc[4][l] += w * to.x[i];
+                acc[5][l] += w * to.y[i];
+                acc[6][l] += w * to.z[i];
+            }
+
+            double sums[7];
+            for (int k = 0; k < 7; ++k) {
+                sums[k] = (acc[k][0] + acc[k][1]) + (acc[k][2] + acc[k][3]);
+            }
+
+            Centroids c;
+            c.weight = sums[0];
+            if (c.weight > 0.0) {
+                for (int k = 0; k < 3; ++k) {
+                    c.from[k] = sums[1 + k] / c.weight;
+                    c.to[k] = sums[4 + k] / c.weight;
+                }
+            }
+            return c;
+        }
+
+        // 去中心化后的互协方差 Σ w (to - μto)(from - μfrom)^T 以及 Σ w ||from - μfrom||²
+        void accumulateCovariance(const PointSpan& from, const PointSpan& to, const double* weights, const Centroids& c, Matrix3& covariance, double& fromVariance) {
+            const size_t n = from.count;
+            double acc[10][kLanes] = {};
+
+            auto accumulate = [&](size_t i, size_t l) {
+                const double w = weights ? weights[i] : 1.0;
+                const double fx = from.x[i] - c.from[0];
+                const double fy = from.y[i] - c.from[1];
+                const double fz = from.z[i] - c.from[2];
+                const double tx = (to.x[i] - c.to[0]) * w;
+                const double ty = (to.y[i] - c.to[1]) * w;
+                const double tz = (to.z[i] - c.to[2]) * w;
+                acc[0][l] += tx * fx;
+                acc[1][l] += tx * fy;
+                acc[2][l] += tx * fz;
+                acc[3][l] += ty * fx;
+                acc[4][l] += ty * fy;
+                acc[5][l] += ty * fz;
+                acc[6][l] += tz * fx;
+                acc[7][l] += tz * fy;
+                acc[8][l] += tz * fz;
+                acc[9][l] += w * (fx * fx + fy * fy + fz * fz);
+            };
+
+            size_t i = 0;
+            for (; i + kLanes <= n; i += kLanes) {
+                for (size_t l = 0; l < kLanes; ++l) {
+                    accumulate(i + l, l);
+                }
+            }
+            for (size_t l = 0; i < n; ++i, ++l) {
+                accumulate(i, l);
+            }
+
+            double sums[10];
+            for (int k = 0; k < 10; ++k) {
+                sums[k] = ((acc[k][0] + acc[k][1]) + (acc[k][2] + acc[k][3])) / c.weight;
+            }
+            for (int r = 0; r < 3; ++r) {
+                for (int col = 0; col < 3; ++col) {
+                    covariance[r][col] = sums[r * 3 + col];
+                }
+            }
+            fromVariance = sums[9];
+        }
+
+        double determinant(const Matrix3& m) {
+            return m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1])
+                 - m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0])
+                 + m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+        }
+
+        SimilarityTransform identityTransform() {
+            SimilarityTransform result;
+            result.matrix = {{{1.0, 0.0, 0.0, 0.0}, {0.0, 1.0, 0.0, 0.0}, {0.0, 0.0, 1.0, 0.0}, {0.0, 0.0, 0.0, 1.0}}};
+            return result;
+        }
+
+        SimilarityTransform solveWeighted(const PointSpan& from, const PointSpan& to, const double* weights, bool withScale) {
+            SimilarityTransform result = identityTransform();
+
+            Centroids c = accumulateCentroids(from, to, weights);
+            if (c.weight <= 0.0) {
+                return result;
+            }
+
+            Matrix3 covariance;
+            double fromVariance = 0.0;
+            accumulateCovariance(from, to, weights, c, covariance, fromVariance);
+            if (fromVariance <= 1e-300) {
+                return result;
+            }
+
+            Matrix3 u, v;
+            array<double, 3> s;
+            singularValueDecomposition3x3(covariance, u, s, v);
+
+            // det(U)det(V) < 0 时翻转最小奇异值对应的方向，保证得到旋转而不是反射
+            double d = determinant(u) * determinant(v) < 0.0 ? -1.0 : 1.0;
+            Matrix3 rotation;
+            for (int r = 0; r < 3; ++r) {
+                for (int col = 0; col < 3; ++col) {
+                    rotation[r][col] = u[r][0] * v[col][0] + u[r][1] * v[col][1] + d * u[r][2] * v[col][2];
+                }
+            }
+
+            double scale = withScale ? (s[0] + s[1] + d * s[2]) / fromVariance : 1.0;
+            if (!(scale > 0.0) || !std::isfinite(scale)) {
+                return result;
+            }
+
+            for (int r = 0; r < 3; ++r) {
+                double rotated = 0.0;
+                for (int col = 0; col < 3; ++col) {
+                    result.matrix[r][col] = scale * rotation[r][col];
+                    rotated += rotation[r][col] * c.from[col];
+                }
+                result.matrix[r][3] = c.to[r] - scale * rotated;
+            }
+            result.scale = scale;
+            result.valid = true;
+            return result;
+        }
+
+        // 逐点残差 ||to - M from||，返回平方和用于 RMS
+        double computeResiduals(const PointSpan& from, const PointSpan& to, const array<array<double, 4>, 4>& m, vector<double>& residuals) {
+            residuals.resize(from.count);
+            double acc[kLanes] = {};
+            for (size_t i = 0; i < from.count; ++i) {
+                const double dx = to.x[i] - (m[0][0] * from.x[i] + m[0][1] * from.y[i] + m[0][2] * from.z[i] + m[0][3]);
+                const double dy = to.y[i] - (m[1][0] * from.x[i] + m[1][1] * from.y[i] + m[1][2] * from.z[i] + m[1][3]);
+                const double dz = to.z[i] - (m[2][0] * from.x[i] + m[2][1] * from.y[i] + m[2][2] * from.z[i] + m[2][3]);
+                const double squared = dx * dx + dy * dy + dz * dz;
+                residuals[i] = std::sqrt(squared);
+                acc[i % kLanes] += squared;
+            }
+            return (acc[0] + acc[1]) + (acc[2] + acc[3]);
+        }
+
+    }
+
+    void singularValueDecomposition3x3(const Matrix3& a, Matrix3& u, array<double, 3>& s, Matrix3& v) {
+        // 单边 Jacobi：对 B = A 的列反复做平面旋转直至两两正交，此时 B = U diag(s)，累积的旋转即 V
+        Matrix3 b = a;
+        v = {{{1.0, 0.0, 0.0}, {0.0, 1.0, 0.0}, {0.0, 0.0, 1.0}}};
+
+        const int pairs[3][2] = {{0, 1}, {0, 2}, {1, 2}};
+        for (int sweep = 0; sweep < 32; ++sweep) {
+            bool rotated = false;
+            for (const auto& pair : pairs) {
+                const int p = pair[0];
+                const int q = pair[1];
+                double alpha = 0.0, beta = 0.0, gamma = 0.0;
+                for (int i = 0; i < 3; ++i) {
+                    alpha += b[i][p] * b[i][p];
+                    beta += b[i][q] * b[i][q];
+                    gamma += b[i][p] * b[i][q];
+                }
+                if (std::fabs(gamma) <= 1e-15 * std::sqrt(alpha * beta) || gamma == 0.0) {
+                    continue;
+                }
+
+                rotated = true;
+                const double zeta = (beta - alpha) / (2.0 * gamma);
+                const double t = (zeta >= 0.0 ? 1.0 : -1.0) / (std::fabs(zeta) + std::sqrt(1.0 + zeta * zeta));
+                const double cs = 1.0 / std::sqrt(1.0 + t * t);
+                const double sn = cs * t;
+                for (int i = 0; i < 3; ++i) {
+                    const double bp = b[i][p];
+                    const double bq = b[i][q];
+                    b[i][p] = cs * bp - sn * bq;
+                    b[i][q] = sn * bp + cs * bq;
+                    const double vp = v[i][p];
+                    const double vq = v[i][q];
+                    v[i][p] = cs * vp - sn * vq;
+                    v[i][q] = sn * vp + cs * vq;
+                }
+            }
+            if (!rotated) {
+                break;
+            }
+        }
+
+        for (int j = 0; j < 3; ++j) {
+            s[j] = std::sqrt(b[0][j] * b[0][j] + b[1][j] * b[1][j] + b[2][j] * b[2][j]);
+        }
+
+        // 按奇异值降序排列列向量
+        int order[3] = {0, 1, 2};
+        std::sort(order, order + 3, [&](int l, int r) { return s[l] > s[r]; });
+        Matrix3 sortedB, sortedV;
+        array<double, 3> sortedS;
+        for (int j = 0; j < 3; ++j) {
+            sortedS[j] = s[order[j]];
+            for (int i = 0; i < 3; ++i) {
+                sortedB[i][j] = b[i][order[j]];
+                sortedV[i][j] = v[i][order[j]];
+            }
+        }
+        s = sortedS;
+        v = sortedV;
+
+        // U 的列为归一化后的 B 列；奇异值接近 0 时用叉积补全为正交基
+        const double tiny = 1e-12 * std::max(s[0], 1e-300);
+        for (int j = 0; j < 3; ++j) {
+            if (s[j] > tiny) {
+                for (int i = 0; i < 3; ++i) {
+                    u[i][j] = sortedB[i][j] / s[j];
+                }
+                continue;
+            }
+
+            if (j == 0) {
+                u = {{{1.0, 0.0, 0.0}, {0.0, 1.0, 0.0}, {0.0, 0.0, 1.0}}};
+                break;
+            }
+            if (j == 1) {
+                // 取一个与 u0 不平行的坐标轴，与 u0 叉乘得到 u1
+                int axis = std::fabs(u[0][0]) < 0.9 ? 0 : 1;
+                array<double, 3> e = {0.0, 0.0, 0.0};
+                e[axis] = 1.0;
+                array<double, 3> c = {u[1][0] * e[2] - u[2][0] * e[1], u[2][0] * e[0] - u[0][0] * e[2], u[0][0] * e[1] - u[1][0] * e[0]};
+                double len = std::sqrt(c[0] * c[0] + c[1] * c[1] + c[2] * c[2]);
+                for (int i = 0; i < 3; ++i) u[i][1] = c[i] / len;
+                continue;
+            }
+            u[0][2] = u[1][0] * u[2][1] - u[2][0] * u[1][1];
+            u[1][2] = u[2][0] * u[0][1] - u[0][0] * u[2][1];
+            u[2][2] = u[0][0] * u[1][1] - u[1][0] * u[0][1];
+        }
+    }
+
+    SimilarityTransform solveSimilarity(const PointSpan& from, const PointSpan& to, const SimilarityOptions& options) {
+        if (from.count != to.count || from.count < 3) {
+            return identityTransform();
+        }
+
+        SimilarityTransform result = solveWeighted(from, to, nullptr, options.withScale);
+        if (!result.valid) {
+            return result;
+        }
+
+        vector<double> residuals;
+        vector<double> weights;
+        vector<double> sorted;
+        double squaredSum = computeResiduals(from, to, result.matrix, residuals);
+
+        for (int iteration = 0; iteration < options.robustIterations; ++iteration) {
+            // Huber 权重：阈值取残差中位数的倍数，超过阈值的点按 k/r 降权
+            sorted = residuals;
+            auto mid = sorted.begin() + sorted.size() / 2;
+            std::nth_element(sorted.begin(), mid, sorted.end());
+            const double cutoff = options.robustCutoff * *mid;
+            if (!(cutoff > 0.0)) {
+                break;
+            }
+
+            weights.resize(residuals.size());
+            for (size_t i = 0; i < residuals.size(); ++i) {
+                weights[i] = residuals[i] <= cutoff ? 1.0 : cutoff / residuals[i];
+            }
+
+            SimilarityTransform refined = solveWeighted(from, to, weights.data(), options.withScale);
+            if (!refined.valid) {
+                break;
+            }
+            result = refined;
+            squaredSum = computeResiduals(from, to, result.matrix, residuals);
+        }
+
+        result.rmsError = std::sqrt(squaredSum / static_cast<double>(from.count));
+        return result;
+    }
+
+}
@@ -0,0 +1,122 @@
+#include "SessionCache.h"
+#include <filesystem>
+
+namespace cf {
+
+    namespace {
+
+        string normalizedPath(const string& path) {
+            error_code error;
+            filesystem::path absolute = filesystem::absolute(filesystem::path(path), error);
+            return error ? path : absolute.lexically_normal().string();
+        }
+
+    }
+
+    bool readFileStamp(const string& path, FileStamp& stamp) {
+        error_code error;
+        stamp.size = filesystem::file_size(path, error);
+        if (error) {
+            return false;
+        }
+        stamp.modifiedTime = static_cast<int64_t>(filesystem::last_write_time(path, error).time_since_epoch().count());
+        return !error;
+    }
+
+    SessionCache::SessionCache(uint64_t budgetBytes) {
+        mStats.budgetBytes = budgetBytes;
+    }
+
+    shared_ptr<void> SessionCache::lookup(type_index type, const string& path, bool remove) {
+        const string key = normalizedPath(path);
+        FileStamp stamp;
+        const bool readable = readFileStamp(key, stamp);
+
+        shared_ptr<void> value;
+        vector<shared_ptr<void>> released;
+        {
+            lock_guard<mutex> guard(mLock);
+            auto it = mEntries.find(Key(type, key));
+            if (it == mEntries.end()) {
+                ++mStats.misses;
+            } else if (!readable || it->second.stamp != stamp) {
+                ++mStats.stale;
+                ++mStats.misses;
+                erase(it, released);
+            } else {
+                ++mStats.hits;
+                value = it->second.value;
+                if (remove) {
+                    erase(it, released);
+                } else {
+                    mUse.splice(mUse.begin(), mUse, it->second.use);
+                }
+            }
+        }
+        return value;
+    }
+
+    bool SessionCache::store(type_index type, const string& path, const FileStamp& stamp, shared_ptr<void> value, uint64_t bytes) {
+        if (!value) {
+            return false;
+        }
+        const string key = normalizedPath(path);
+
+        vector<shared_ptr<void>> released;
+        lock_guard<mutex> guard(mLock);
+        auto it = mEntries.find(Key(type, key));
+        if (it != mEntries.end()) {
+            erase(it, released);
+        }
+        if (bytes > mStats.budgetBytes) {
+            return false;
+        }
+        mUse.push_front(Key(type, key));
+        Entry& entry = mEntries[Key(type, key)];
+        entry.value = std::move(value);
+        entry.stamp = stamp;
+        entry.bytes = bytes;
+        entry.use = mUse.begin();
+        ++mStats.entryCount;
+        mStats.totalBytes += bytes;
+        evictToBudget(released);
+        return true;
+    }
+
+    void SessionCache::erase(map<Key, Entry>::iterator it, vector<shared_ptr<void>>& released) {
+        released.push_back(std::move(it->second.value));
+        mStats.totalBytes -= it->second.bytes;
+        --mStats.entryCount;
+        mUse.erase(it->second.use);
+        mEntries.erase(it);
+    }
+
+    void SessionCache::evictToBudget(vector<shared_ptr<void>>& released) {
+        while (mStats.totalBytes > mStats.budgetBytes && !mUse.empty()) {
+            erase(mEntries.find(mUse.back()), released);
+            ++mStats.evictions;
+        }
+    }
+
+    void SessionCache::setBudget(uint64_t budgetBytes) {
+        vector<shared_ptr<void>> released;
+        lock_guard<mutex> guard(mLock);
+        mStats.budgetBytes = budgetBytes;
+        evictToBudget(released);
+    }
+
+    void SessionCache::clear() {
+        map<Key, Entry> entries;
+        lock_guard<mutex> guard(mLock);
+        entries.swap(mEntries);
+        mUse.clear();
+        mStats.entryCount = 0;
+        mStats.totalBytes = 0;
+    }
+
+    SessionCacheStats SessionCache::stats() const {
+        lock_guard<mutex> guard(mLock);
+        return mStats;
+    }
+
+}
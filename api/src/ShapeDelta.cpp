@@ -0,0 +1,59 @@
+#include "ShapeDelta.h"
+
+namespace cf {
+
+    void SparseShapeDelta::clear() {
+        indices.clear();
+        dx.clear();
+        dy.clear();
+        dz.clear();
+    }
+
+    namespace {
+
+        template <typename Scalar>
+        void buildSparseDeltaFrom(const uint32_t* indices, const float* weights, size_t count,
+                                  const Scalar* gapX, const Scalar* gapY, const Scalar* gapZ, size_t vertexLimit,
+                                  double epsilon, SparseShapeDelta& out) {
+            out.clear();
+            out.indices.reserve(count);
+            out.dx.reserve(count);
+            out.dy.reserve(count);
+            out.dz.reserve(count);
+
+            // epsilon 为 0 时只剔除位移恰好为零的顶点
+            const double epsilonSquared = epsilon * epsilon;
+            for (size_t k = 0; k < count; ++k) {
+                const uint32_t i = indices[k];
+                if (i >= vertexLimit) {
+                    continue;
+                }
+                const double weight = weights[k];
+                const double x = -(static_cast<double>(gapX[i]) * weight);
+                const double y = -(static_cast<double>(gapY[i]) * weight);
+                const double z = -(static_cast<double>(gapZ[i]) * weight);
+                if (x * x + y * y + z * z <= epsilonSquared) {
+                    continue;
+                }
+                out.indices.push_back(i);
+                out.dx.push_back(x);
+                out.dy.push_back(y);
+                out.dz.push_back(z);
+            }
+        }
+
+    }
+
+    void buildSparseDelta(const uint32_t* indices, const float* weights, size_t count,
+                          const double* gapX, const double* gapY, const double* gapZ, size_t vertexLimit,
+                          double epsilon, SparseShapeDelta& out) {
+        buildSparseDeltaFrom(indices, weights, count, gapX, gapY, gapZ, vertexLimit, epsilon, out);
+    }
+
+    void buildSparseDelta(const uint32_t* indices, const float* weights, size_t count,
+                          const float* gapX, const float* gapY, const float* gapZ, size_t vertexLimit,
+                          double epsilon, SparseShapeDelta& out) {
+        buildSparseDeltaFrom(indices, weights, count, gapX, gapY, gapZ, vertexLimit, epsilon, out);
+    }
+
+}
@@ -0,0 +1,560 @@
+#include "SurfaceCorrespondence.h"
+#include "MeshKernels.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace cf {
+
+    namespace {
+
+        const uint32_t kLeafSize = 4;
+        const size_t kProjectChunk = 1024;
+
+        inline array<double, 3> sub(const array<double, 3>& a, const array<double, 3>& b) {
+            return {a[0] - b[0], a[1] - b[1], a[2] - b[2]};
+        }
+
+        inline double dot(const array<double, 3>& a, const array<double, 3>& b) {
+            return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+        }
+
+        inline double boxDistanceSquared(const array<double, 3>& p, const array<double, 3>& boxMin, const array<double, 3>& boxMax) {
+            double d = 0.0;
+            for (int k = 0; k < 3; ++k) {
+                double e = max(max(boxMin[k] - p[k], p[k] - boxMax[k]), 0.0);
+                d += e * e;
+            }
+            return d;
+        }
+
+        // 点到三角形的最近点（Ericson, Real-Time Collision Detection 5.1.5），返回重心坐标
+        array<double, 3> closestBarycentric(const array<double, 3>& p, const array<double, 3>& a, const array<double, 3>& b, const array<double, 3>& c) {
+            array<double, 3> ab = sub(b, a);
+            array<double, 3> ac = sub(c, a);
+            array<double, 3> ap = sub(p, a);
+            double d1 = dot(ab, ap);
+            double d2 = dot(ac, ap);
+            if (d1 <= 0.0 && d2 <= 0.0) {
+                return {1.0, 0.0, 0.0};
+            }
+
+            array<double, 3> bp = sub(p, b);
+            double d3 = dot(ab, bp);
+            double d4 = dot(ac, bp);
+            if (d3 >= 0.0 && d4 <= d3) {
+                return {0.0, 1.0, 0.0};
+            }
+
+            double vc = d1 * d4 - d3 * d2;
+            if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0) {
+                double v = d1 / (d1 - d3);
+                return {1.0 - v, v, 0.0};
+            }
+
+            array<double, 3> cp = sub(p, c);
+            double d5 = dot(ab, cp);
+            double d6 = dot(ac, cp);
+            if (d6 >= 0.0 && d5 <= d6) {
+                return {0.0, 0.0, 1.0};
+            }
+
+            double vb = d5 * d2 - d1 * d6;
+            if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0) {
+                double w = d2 / (d2 - d6);
+                return {1.0 - w, 0.0, w};
+            }
+
+            double va = d3 * d6 - d5 * d4;
+            if (va <= 0.0 && (d4 - d3) >= 0.0 && (d5 - d6) >= 0.0) {
+                double w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+                return {0.0, 1.0 - w, w};
+            }
+
+            double sum = va + vb + vc;
+            if (!(sum > 0.0)) {
+                // 退化三角形：取最近的顶点
+                double da = dot(ap, ap), db = dot(bp, bp), dc = dot(cp, cp);
+                if (da <= db && da <= dc) return {1.0, 0.0, 0.0};
+                return db <= dc ? array<double, 3>{0.0, 1.0, 0.0} : array<double, 3>{0.0, 0.0, 1.0};
+            }
+            double v = vb / sum;
+            double w = vc / sum;
+            return {1.0 - v - w, v, w};
+        }
+
+        inline array<double, 3> cross(const array<double, 3>& a, const array<double, 3>& b) {
+            return {a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0]};
+        }
+
+        // 部分主元高斯消元求解 7x7 增广方程组，奇异时返回 false
+        bool solveLinear7(array<array<double, 8>, 7> a, array<double, 7>& x) {
+            for (int col = 0; col < 7; ++col) {
+                int pivot = col;
+                for (int row = col + 1; row < 7; ++row) {
+                    if (fabs(a[row][col]) > fabs(a[pivot][col])) {
+                        pivot = row;
+                    }
+                }
+                if (!(fabs(a[pivot][col]) > 1e-300)) {
+                    return false;
+                }
+                swap(a[col], a[pivot]);
+                for (int row = col + 1; row < 7; ++row) {
+                    double factor = a[row][col] / a[col][col];
+                    for (int k = col; k < 8; ++k) {
+                        a[row][k] -= factor * a[col][k];
+                    }
+                }
+            }
+            for (int row = 6; row >= 0; --row) {
+                double value = a[row][7];
+                for (int k = row + 1; k < 7; ++k) {
+                    value -= a[row][k] * x[k];
+                }
+                x[row] = value / a[row][row];
+            }
+            return true;
+        }
+
+        // 增量 [σ, ω, τ] 对应的相似变换 (1 + σ) R(ω) y + τ，R 由旋转向量按 Rodrigues 公式得到
+        array<array<double, 4>, 4> similarityStep(const array<double, 7>& step) {
+            const double angle = sqrt(step[1] * step[1] + step[2] * step[2] + step[3] * step[3]);
+            array<array<double, 3>, 3> r = {{{1.0, 0.0, 0.0}, {0.0, 1.0, 0.0}, {0.0, 0.0, 1.0}}};
+            if (angle > 0.0) {
+                const array<double, 3> k = {step[1] / angle, step[2] / angle, step[3] / angle};
+                const double c = cos(angle);
+                const double s = sin(angle);
+                const double t = 1.0 - c;
+                r = {{{c + t * k[0] * k[0], t * k[0] * k[1] - s * k[2], t * k[0] * k[2] + s * k[1]},
+                      {t * k[1] * k[0] + s * k[2], c + t * k[1] * k[1], t * k[1] * k[2] - s * k[0]},
+                      {t * k[2] * k[0] - s * k[1], t * k[2] * k[1] + s * k[0], c + t * k[2] * k[2]}}};
+            }
+            array<array<double, 4>, 4> m = {};
+            for (int i = 0; i < 3; ++i) {
+                for (int j = 0; j < 3; ++j) {
+                    m[i][j] = (1.0 + step[0]) * r[i][j];
+                }
+                m[i][3] = step[4 + i];
+            }
+            m[3][3] = 1.0;
+            return m;
+        }
+
+        array<array<double, 4>, 4> multiplyAffine(const array<array<double, 4>, 4>& a, const array<array<double, 4>, 4>& b) {
+            array<array<double, 4>, 4> m = {};
+            for (int i = 0; i < 4; ++i) {
+                for (int j = 0; j < 4; ++j) {
+                    for (int k = 0; k < 4; ++k) {
+                        m[i][j] += a[i][k] * b[k][j];
+                    }
+                }
+            }
+            return m;
+        }
+
+        array<double, 3> centroidOf(const PointSpan& points) {
+            array<double, 3> c = {0.0, 0.0, 0.0};
+            for (size_t i = 0; i < points.count; ++i) {
+                c[0] += points.x[i];
+                c[1] += points.y[i];
+                c[2] += points.z[i];
+            }
+            for (double& v : c) {
+                v /= static_cast<double>(max<size_t>(points.count, 1));
+            }
+            return c;
+        }
+
+        double rmsRadius(const PointSpan& points, const array<double, 3>& center) {
+            double sum = 0.0;
+            for (size_t i = 0; i < points.count; ++i) {
+                double dx = points.x[i] - center[0];
+                double dy = points.y[i] - center[1];
+                double dz = points.z[i] - center[2];
+                sum += dx * dx + dy * dy + dz * dz;
+            }
+            return sqrt(sum / static_cast<double>(max<size_t>(points.count, 1)));
+        }
+
+    }
+
+    vector<uint32_t> triangulatePolygons(const int32_t* polygonVertexIndex, size_t count, size_t vertexCount) {
+        vector<uint32_t> triangles;
+        triangles.reserve(count * 2);
+        vector<uint32_t> polygon;
+        bool valid = true;
+        for (size_t i = 0; i < count; ++i) {
+            int32_t raw = polygonVertexIndex[i];
+            bool last = raw < 0;
+            uint32_t index = static_cast<uint32_t>(last ? ~raw : raw);
+            valid = valid && index < vertexCount;
+            polygon.push_back(index);
+            if (!last) {
+                continue;
+            }
+            if (valid) {
+                for (size_t k = 1; k + 1 < polygon.size(); ++k) {
+                    triangles.push_back(polygon[0]);
+                    triangles.push_back(polygon[k]);
+                    triangles.push_back(polygon[k + 1]);
+                }
+            }
+            polygon.clear();
+            valid = true;
+        }
+        return triangles;
+    }
+
+    TriangleBvh::TriangleBvh(const PointSpan& points, const vector<uint32_t>& triangles) : mPoints(points), mTriangles(triangles) {
+        const uint32_t triangleCount = static_cast<uint32_t>(triangles.size() / 3);
+        if (triangleCount == 0) {
+            return;
+        }
+
+        vector<array<double, 3>> centroids(triangleCount);
+        mTriangleOrder.resize(triangleCount);
+        for (uint32_t t = 0; t < triangleCount; ++t) {
+            mTriangleOrder[t] = t;
+            for (int k = 0; k < 3; ++k) {
+                array<double, 3> p = corner(t, k);
+                for (int axis = 0; axis < 3; ++axis) {
+                    centroids[t][axis] += p[axis] / 3.0;
+                }
+            }
+        }
+        mNodes.reserve(2 * (triangleCount / kLeafSize + 1));
+        build(centroids, 0, triangleCount);
+    }
+
+    array<double, 3> TriangleBvh::corner(uint32_t triangle, int k) const {
+        uint32_t v = mTriangles[3 * triangle + k];
+        return {mPoints.x[v], mPoints.y[v], mPoints.z[v]};
+    }
+
+    uint32_t TriangleBvh::build(vector<array<double, 3>>& centroids, uint32_t begin, uint32_t end) {
+        const uint32_t index = static_cast<uint32_t>(mNodes.size());
+        mNodes.push_back(Node());
+
+        const double inf = numeric_limits<double>::infinity();
+        array<double, 3> boxMin = {inf, inf, inf};
+        array<double, 3> boxMax = {-inf, -inf, -inf};
+        array<double, 3> centerMin = boxMin;
+        array<double, 3> centerMax = boxMax;
+        for (uint32_t i = begin; i < end; ++i) {
+            uint32_t t = mTriangleOrder[i];
+            for (int k = 0; k < 3; ++k) {
+                array<double, 3> p = corner(t, k);
+                for (int axis = 0; axis < 3; ++axis) {
+                    boxMin[axis] = min(boxMin[axis], p[axis]);
+                    boxMax[axis] = max(boxMax[axis], p[axis]);
+                }
+            }
+            for (int axis = 0; axis < 3; ++axis) {
+                centerMin[axis] = min(centerMin[axis], centroids[t][axis]);
+                centerMax[axis] = max(centerMax[axis], centroids[t][axis]);
+            }
+        }
+        mNodes[index].boxMin = boxMin;
+        mNodes[index].boxMax = boxMax;
+
+        if (end - begin <= kLeafSize) {
+            mNodes[index].first = begin;
+            mNodes[index].count = end - begin;
+            return index;
+        }
+
+        // 在三角形中心跨度最大的轴上按中位数划分
+        int axis = 0;
+        for (int k = 1; k < 3; ++k) {
+            if (centerMax[k] - centerMin[k] > centerMax[axis] - centerMin[axis]) {
+                axis = k;
+            }
+        }
+        uint32_t middle = begin + (end - begin) / 2;
+        nth_element(mTriangleOrder.begin() + begin, mTriangleOrder.begin() + middle, mTriangleOrder.begin() + end,
+                    [&](uint32_t a, uint32_t b) { return centroids[a][axis] < centroids[b][axis]; });
+
+        build(centroids, begin, middle);
+        uint32_t right = build(centroids, middle, end);
+        mNodes[index].first = right;
+        mNodes[index].count = 0;
+        return index;
+    }
+
+    SurfacePoint TriangleBvh::closestPoint(const array<double, 3>& point) const {
+        SurfacePoint best;
+        if (mNodes.empty()) {
+            return best;
+        }
+        best.distanceSquared = numeric_limits<double>::infinity();
+
+        // 先序存放的树深度不超过 log2(n) + 1，固定大小的栈足够
+        uint32_t stack[64];
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0) {
+            const Node& node = mNodes[stack[--top]];
+            if (boxDistanceSquared(point, node.boxMin, node.boxMax) >= best.distanceSquared) {
+                continue;
+            }
+            if (node.count > 0) {
+                for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+                    uint32_t t = mTriangleOrder[i];
+                    array<double, 3> a = corner(t, 0);
+                    array<double, 3> b = corner(t, 1);
+                    array<double, 3> c = corner(t, 2);
+                    array<double, 3> bary = closestBarycentric(point, a, b, c);
+                    array<double, 3> q;
+                    for (int k = 0; k < 3; ++k) {
+                        q[k] = bary[0] * a[k] + bary[1] * b[k] + bary[2] * c[k];
+                    }
+                    array<double, 3> d = sub(point, q);
+                    double distanceSquared = dot(d, d);
+                    if (distanceSquared < best.distanceSquared) {
+                        best.triangle = t;
+                        best.barycentric = bary;
+                        best.position = q;
+                        best.distanceSquared = distanceSquared;
+                    }
+                }
+                continue;
+            }
+
+            // 较近的子节点后入栈、先访问
+            uint32_t left = static_cast<uint32_t>(&node - mNodes.data()) + 1;
+            uint32_t right = node.first;
+            double leftDistance = boxDistanceSquared(point, mNodes[left].boxMin, mNodes[left].boxMax);
+            double rightDistance = boxDistanceSquared(point, mNodes[right].boxMin, mNodes[right].boxMax);
+            if (leftDistance < rightDistance) {
+                stack[top++] = right;
+                stack[top++] = left;
+            } else {
+                stack[top++] = left;
+                stack[top++] = right;
+            }
+        }
+        return best;
+    }
+
+    SurfaceMapping projectToSurface(const TriangleBvh& bvh, const PointSpan& query, unsigned workerCount) {
+        SurfaceMapping mapping;
+        mapping.vertices.assign(3 * query.count, 0);
+        mapping.weights.assign(3 * query.count, 0.0);
+        if (bvh.empty() || query.count == 0) {
+            return mapping;
+        }
+
+        const vector<uint32_t>& triangles = bvh.triangles();
+        const size_t chunkCount = (query.count + kProjectChunk - 1) / kProjectChunk;
+        vector<double> chunkSum(chunkCount, 0.0);
+        vector<double> chunkMax(chunkCount, 0.0);
+        parallelFor(chunkCount, workerCount, [&](size_t chunk) {
+            const size_t begin = chunk * kProjectChunk;
+            const size_t end = min(begin + kProjectChunk, query.count);
+            for (size_t i = begin; i < end; ++i) {
+                SurfacePoint hit = bvh.closestPoint({query.x[i], query.y[i], query.z[i]});
+                for (int k = 0; k < 3; ++k) {
+                    mapping.vertices[3 * i + k] = triangles[3 * hit.triangle + k];
+                    mapping.weights[3 * i + k] = hit.barycentric[k];
+                }
+                chunkSum[chunk] += hit.distanceSquared;
+                chunkMax[chunk] = max(chunkMax[chunk], hit.distanceSquared);
+            }
+        });
+
+        double sum = 0.0;
+        double maxSquared = 0.0;
+        for (size_t chunk = 0; chunk < chunkCount; ++chunk) {
+            sum += chunkSum[chunk];
+            maxSquared = max(maxSquared, chunkMax[chunk]);
+        }
+        mapping.rmsDistance = sqrt(sum / static_cast<double>(query.count));
+        mapping.maxDistance = sqrt(maxSquared);
+        return mapping;
+    }
+
+    void interpolateSurface(const SurfaceMapping& mapping, const PointSpan& source, double* x, double* y, double* z) {
+        const size_t count = mapping.size();
+        const uint32_t* vertices = mapping.vertices.data();
+        const double* weights = mapping.weights.data();
+        for (size_t i = 0; i < count; ++i) {
+            const uint32_t a = vertices[3 * i], b = vertices[3 * i + 1], c = vertices[3 * i + 2];
+            const double wa = weights[3 * i], wb = weights[3 * i + 1], wc = weights[3 * i + 2];
+            x[i] = wa * source.x[a] + wb * source.x[b] + wc * source.x[c];
+            y[i] = wa * source.y[a] + wb * source.y[b] + wc * source.y[c];
+            z[i] = wa * source.z[a] + wb * source.z[b] + wc * source.z[c];
+        }
+    }
+
+    bool invertAffine(const array<array<double, 4>, 4>& m, array<array<double, 4>, 4>& inverse) {
+        const double c00 = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+        const double c01 = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+        const double c02 = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+        const double det = m[0][0] * c00 + m[0][1] * c01 + m[0][2] * c02;
+        if (!(fabs(det) > 1e-300)) {
+            return false;
+        }
+
+        const double invDet = 1.0 / det;
+        array<array<double, 3>, 3> r;
+        r[0] = {c00 * invDet, (m[0][2] * m[2][1] - m[0][1] * m[2][2]) * invDet, (m[0][1] * m[1][2] - m[0][2] * m[1][1]) * invDet};
+        r[1] = {c01 * invDet, (m[0][0] * m[2][2] - m[0][2] * m[2][0]) * invDet, (m[0][2] * m[1][0] - m[0][0] * m[1][2]) * invDet};
+        r[2] = {c02 * invDet, (m[0][1] * m[2][0] - m[0][0] * m[2][1]) * invDet, (m[0][0] * m[1][1] - m[0][1] * m[1][0]) * invDet};
+        for (int i = 0; i < 3; ++i) {
+            for (int j = 0; j < 3; ++j) {
+                inverse[i][j] = r[i][j];
+            }
+            inverse[i][3] = -(r[i][0] * m[0][3] + r[i][1] * m[1][3] + r[i][2] * m[2][3]);
+        }
+        inverse[3] = {0.0, 0.0, 0.0, 1.0};
+        return true;
+    }
+
+    SimilarityTransform registerToSurface(const PointSpan& base, const TriangleBvh& targetBvh, const SurfaceRegistrationOptions& options,
+                                          unsigned workerCount, SurfaceMapping* mapping) {
+        SimilarityTransform transform;
+        transform.matrix = {{{1.0, 0.0, 0.0, 0.0}, {0.0, 1.0, 0.0, 0.0}, {0.0, 0.0, 1.0, 0.0}, {0.0, 0.0, 0.0, 1.0}}};
+        const PointSpan& target = targetBvh.points();
+        if (targetBvh.empty() || base.count < 3) {
+            return transform;
+        }
+
+        // 求解的是 base 到目标坐标系的变换 U，返回其逆。初始值：质心重合、RMS 半径一致，不含旋转
+        array<double, 3> baseCenter = centroidOf(base);
+        array<double, 3> targetCenter = centroidOf(target);
+        double baseRadius = rmsRadius(base, baseCenter);
+        double scale = baseRadius > 0.0 ? rmsRadius(target, targetCenter) / baseRadius : 1.0;
+        array<array<double, 4>, 4> toTarget = transform.matrix;
+        for (int k = 0; k < 3; ++k) {
+            toTarget[k][k] = scale;
+            toTarget[k][3] = targetCenter[k] - scale * baseCenter[k];
+        }
+
+        vector<double> query(3 * base.count);
+        vector<double> matched(3 * base.count);
+        double* qx = query.data();
+        double* qy = qx + base.count;
+        double* qz = qy + base.count;
+        double* cx = matched.data();
+        double* cy = cx + base.count;
+        double* cz = cy + base.count;
+        PointSpan queryPoints = {qx, qy, qz, base.count};
+
+        SurfaceMapping current;
+        for (int iteration = 0; iteration < max(options.maxIterations, 1); ++iteration) {
+            transformPoints(toTarget, base.x, base.y, base.z, qx, qy, qz, base.count);
+            current = projectToSurface(targetBvh, queryPoints, workerCount);
+            interpolateSurface(current, target, cx, cy, cz);
+
+            // 点到面为主、点到点为辅的线性化相似变换增量 [σ, ω, τ]：y' = y + σ y + ω × y + τ。
+            // 点到点项保证平坦区域沿切向也有约束，点到面项让切向滑动一步到位，比纯点到点 ICP 收敛快得多
+            array<array<double, 8>, 7> system = {};
+            const double pointWeight = options.pointToPointWeight;
+            for (size_t i = 0; i < base.count; ++i) {
+                const array<double, 3> y = {qx[i], qy[i], qz[i]};
+                const array<double, 3> r = {cx[i] - qx[i], cy[i] - qy[i], cz[i] - qz[i]};
+                const uint32_t* v = &current.vertices[3 * i];
+                array<double, 3> a = {target.x[v[0]], target.y[v[0]], target.z[v[0]]};
+                array<double, 3> e1 = sub({target.x[v[1]], target.y[v[1]], target.z[v[1]]}, a);
+                array<double, 3> e2 = sub({target.x[v[2]], target.y[v[2]], target.z[v[2]]}, a);
+                array<double, 3> n = cross(e1, e2);
+                double length = sqrt(dot(n, n));
+                auto accumulate = [&](const array<double, 7>& row, double rhs, double weight) {
+                    for (int j = 0; j < 7; ++j) {
+                        for (int k = 0; k < 7; ++k) {
+                            system[j][k] += weight * row[j] * row[k];
+                        }
+                        system[j][7] += weight * row[j] * rhs;
+                    }
+                };
+                if (length > 0.0) {
+                    n = {n[0] / length, n[1] / length, n[2] / length};
+                    array<double, 3> yn = cross(y, n);
+                    accumulate({dot(n, y), yn[0], yn[1], yn[2], n[0], n[1], n[2]}, dot(n, r), 1.0);
+                }
+                // (ω × y)_k = ω · (y × e_k)
+                accumulate({y[0], 0.0, y[2], -y[1], 1.0, 0.0, 0.0}, r[0], pointWeight);
+                accumulate({y[1], -y[2], 0.0, y[0], 0.0, 1.0, 0.0}, r[1], pointWeight);
+                accumulate({y[2], y[1], -y[0], 0.0, 0.0, 0.0, 1.0}, r[2], pointWeight);
+            }
+
+            array<double, 7> step;
+            if (!solveLinear7(system, step)) {
+                break;
+            }
+            toTarget = multiplyAffine(similarityStep(step), toTarget);
+
+            double change = max(fabs(step[0]), sqrt(step[1] * step[1] + step[2] * step[2] + step[3] * step[3]));
+            change = max(change, sqrt(step[4] * step[4] + step[5] * step[5] + step[6] * step[6]) / max(scale * baseRadius, 1e-300));
+            if (change <= options.tolerance) {
+                break;
+            }
+        }
+
+        if (!invertAffine(toTarget, transform.matrix)) {
+            return transform;
+        }
+        transformPoints(toTarget, base.x, base.y, base.z, qx, qy, qz, base.count);
+        current = projectToSurface(targetBvh, queryPoints, workerCount);
+        const array<array<double, 4>, 4>& m = transform.matrix;
+        const double det = m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) - m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0])
+                           + m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+        transform.scale = cbrt(det);
+        transform.rmsError = current.rmsDistance * transform.scale;
+        transform.valid = det > 0.0;
+        if (mapping) {
+            *mapping = std::move(current);
+        }
+        return transform;
+    }
+
+    SurfaceMappingCache& SurfaceMappingCache::shared() {
+        static SurfaceMappingCache cache;
+        return cache;
+    }
+
+    shared_ptr<const SurfaceMapping> SurfaceMappingCache::find(const SurfaceMappingKey& key) {
+        lock_guard<mutex> guard(mLock);
+        auto it = mIndex.find(key);
+        if (it == mIndex.end()) {
+            ++mStats.misses;
+            return nullptr;
+        }
+        ++mStats.hits;
+        mEntries.splice(mEntries.begin(), mEntries, it->second);
+        return it->second->second;
+    }
+
+    void SurfaceMappingCache::insert(const SurfaceMappingKey& key, shared_ptr<const SurfaceMapping> mapping) {
+        lock_guard<mutex> guard(mLock);
+        auto it = mIndex.find(key);
+        if (it != mIndex.end()) {
+            it->second->second = std::move(mapping);
+            mEntries.splice(mEntries.begin(), mEntries, it->second);
+            return;
+        }
+        mEntries.emplace_front(key, std::move(mapping));
+        mIndex[key] = mEntries.begin();
+        while (mEntries.size() > max<size_t>(mCapacity, 1)) {
+            mIndex.erase(mEntries.back().first);
+            mEntries.pop_back();
+        }
+    }
+
+    void SurfaceMappingCache::clear() {
+        lock_guard<mutex> guard(mLock);
+        mEntries.clear();
+        mIndex.clear();
+        mStats = SurfaceMappingCacheStats();
+    }
+
+    SurfaceMappingCacheStats SurfaceMappingCache::stats() const {
+        lock_guard<mutex> guard(mLock);
+        SurfaceMappingCacheStats stats = mStats;
+        stats.entryCount = mEntries.size();
+        return stats;
+    }
+
+}
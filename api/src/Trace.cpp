@@ -0,0 +1,142 @@
+#include "Trace.h"
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+namespace cf {
+
+    namespace detail {
+        atomic<bool> gTracingEnabled(false);
+    }
+
+    namespace {
+
+        struct TraceEvent {
+            const char* name;
+            string detail;
+            uint32_t threadId;
+            int64_t startUs;
+            int64_t durationUs;
+            const char* argKeys[TraceSpan::kMaxArgs];
+            int64_t argValues[TraceSpan::kMaxArgs];
+            int argCount;
+        };
+
+        struct TraceBuffer {
+            mutex lock;
+            vector<TraceEvent> events;
+            chrono::steady_clock::time_point origin = chrono::steady_clock::now();
+        };
+
+        TraceBuffer& traceBuffer() {
+            static TraceBuffer buffer;
+            return buffer;
+        }
+
+        int64_t nowUs() {
+            return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - traceBuffer().origin).count();
+        }
+
+        // 线程按第一次记录区间的顺序编号，比 thread::id 的哈希值更易读
+        uint32_t currentThreadId() {
+            static atomic<uint32_t> nextId(1);
+            thread_local uint32_t id = nextId.fetch_add(1);
+            return id;
+        }
+
+    }
+
+    bool startTracing() {
+        TraceBuffer& buffer = traceBuffer();
+        lock_guard<mutex> guard(buffer.lock);
+        if (detail::gTracingEnabled.load()) {
+            return false;
+        }
+        buffer.events.clear();
+        detail::gTracingEnabled.store(true);
+        return true;
+    }
+
+    bool stopTracing(const string& path, string& error) {
+        detail::gTracingEnabled.store(false);
+
+        vector<TraceEvent> events;
+        {
+            TraceBuffer& buffer = traceBuffer();
+            lock_guard<mutex> guard(buffer.lock);
+            events.swap(buffer.events);
+        }
+
+        nlohmann::json traceEvents = nlohmann::json::array();
+        for (const TraceEvent& event : events) {
+            nlohmann::json args = nlohmann::json::object();
+            if (!event.detail.empty()) {
+                args["detail"] = event.detail;
+            }
+            for (int i = 0; i < event.argCount; ++i) {
+                args[event.argKeys[i]] = event.argValues[i];
+            }
+            traceEvents.push_back({
+                {"name", event.name}, {"cat", "cf"}, {"ph", "X"},
+                {"ts", event.startUs}, {"dur", event.durationUs},
+                {"pid", 1}, {"tid", event.threadId}, {"args", std::move(args)}
+            });
+        }
+
+        ofstream file(path, ios::trunc);
+        if (!file) {
+            error = "Cannot write trace file: " + path;
+            return false;
+        }
+        file << nlohmann::json{{"traceEvents", std::move(traceEvents)}, {"displayTimeUnit", "ms"}}.dump();
+        if (!file) {
+            error = "Failed to write trace file: " + path;
+            return false;
+        }
+        return true;
+    }
+
+    void TraceSpan::begin() {
+        mStartUs = nowUs();
+    }
+
+    void TraceSpan::addArg(const char* key, int64_t value) {
+        for (int i = 0; i < mArgCount; ++i) {
+            if (strcmp(mArgKeys[i], key) == 0) {
+                mArgValues[i] = value;
+                return;
+            }
+        }
+        if (mArgCount < kMaxArgs) {
+            mArgKeys[mArgCount] = key;
+            mArgValues[mArgCount] = value;
+            ++mArgCount;
+        }
+    }
+
+    void TraceSpan::end() {
+        TraceEvent event;
+        event.name = mName;
+        event.detail = std::move(mDetail);
+        event.threadId = currentThreadId();
+        event.startUs = mStartUs;
+        event.durationUs = nowUs() - mStartUs;
+        event.argCount = mArgCount;
+        for (int i = 0; i < mArgCount; ++i) {
+            event.argKeys[i] = mArgKeys[i];
+            event.argValues[i] = mArgValues[i];
+        }
+
+        // 追踪在区间进行中被停止时丢弃该区间
+        TraceBuffer& buffer = traceBuffer();
+        lock_guard<mutex> guard(buffer.lock);
+        if (isTracing()) {
+            buffer.events.push_back(std::move(event));
+        }
+    }
+
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "MeshSet.h"
+#include "Registration.h"
+
+// 无外部依赖的最小断言工具，失败时记录并继续执行，main 返回失败数
+namespace cf {
+namespace test {
+
+inline int& failureCount() {
+    static int failures = 0;
+    return failures;
+}
+
+inline std::string resourcePath(int argc, char** argv, const std::string& fileName) {
+    std::string dir = argc > 1 ? argv[1] : "resources";
+    return dir + "/" + fileName;
+}
+
+// 覆盖写入一个源文件，用于测试按文件内容与时间戳失效的缓存
+inline void writeSource(const std::string& path, const std::string& content) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file << content;
+}
+
+// 两个网格（4 个与 2 个顶点）的小网格组，坐标随 offset 平移
+inline MeshSet makeMeshes(double offset) {
+    MeshSet meshes;
+    size_t head = meshes.addMesh("head_lod0_mesh", 4);
+    size_t teeth = meshes.addMesh("teeth_lod0_mesh", 2);
+    for (size_t i = 0; i < 4; ++i) {
+        meshes.setVertex(head, i, {offset + i, 2.0 * i, -1.0 * i});
+    }
+    meshes.setVertex(teeth, 0, {offset, 0.5, 0.25});
+    meshes.setVertex(teeth, 1, {offset, 1.5, 1.25});
+    return meshes;
+}
+
+// 按网格名对应后逐字节比较坐标，网格顺序可以不同
+inline bool sameMeshes(const MeshSet& a, const MeshSet& b) {
+    if (a.meshCount() != b.meshCount() || a.vertexCount() != b.vertexCount()) {
+        return false;
+    }
+    for (size_t m = 0; m < a.meshCount(); ++m) {
+        int slot = b.find(a.nameId(m));
+        if (slot < 0 || b.vertexCount(slot) != a.vertexCount(m)) {
+            return false;
+        }
+        const size_t bytes = a.vertexCount(m) * sizeof(double);
+        if (std::memcmp(a.x(m), b.x(slot), bytes) != 0 || std::memcmp(a.y(m), b.y(slot), bytes) != 0
+            || std::memcmp(a.z(m), b.z(slot), bytes) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// [-1,1]² 上 resolution x resolution 个顶点的网格，z 取 height(u, v)（为空时 z = 0），
+// 输出 SoA 坐标与 FBX 形式的四边形索引（每个四边形最后一个索引按位取反）
+inline void makeGridMesh(int resolution, std::vector<double>& coords, std::vector<int32_t>& polygons,
+                         double (*height)(double u, double v) = nullptr) {
+    const size_t count = static_cast<size_t>(resolution) * resolution;
+    coords.assign(3 * count, 0.0);
+    for (int r = 0; r < resolution; ++r) {
+        for (int c = 0; c < resolution; ++c) {
+            size_t i = static_cast<size_t>(r) * resolution + c;
+            double u = -1.0 + 2.0 * c / (resolution - 1);
+            double v = -1.0 + 2.0 * r / (resolution - 1);
+            coords[i] = u;
+            coords[count + i] = v;
+            coords[2 * count + i] = height ? height(u, v) : 0.0;
+        }
+    }
+    polygons.clear();
+    for (int r = 0; r + 1 < resolution; ++r) {
+        for (int c = 0; c + 1 < resolution; ++c) {
+            int32_t a = r * resolution + c;
+            polygons.insert(polygons.end(), {a, a + 1, a + resolution + 1, ~(a + resolution)});
+        }
+    }
+}
+
+// SoA 坐标数组的 PointSpan 视图
+inline PointSpan spanOf(const std::vector<double>& coords) {
+    size_t count = coords.size() / 3;
+    return {coords.data(), coords.data() + count, coords.data() + 2 * count, count};
+}
+
+}
+}
+
+#define CF_CHECK(cond)                                                          \
+    do {                                                                        \
+        if (!(cond)) {                                                          \
+            std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+            ++cf::test::failureCount();                                         \
+        }                                                                       \
+    } while (0)
+
+#define CF_CHECK_NEAR(a, b, tol)                                                \
+    do {                                                                        \
+        double cfA = (a), cfB = (b);                                            \
+        if (!(std::fabs(cfA - cfB) <= (tol))) {                                 \
+            std::fprintf(stderr, "%s:%d: CHECK_NEAR failed: %s=%.17g %s=%.17g\n", \
+                         __FILE__, __LINE__, #a, cfA, #b, cfB);                 \
+            ++cf::test::failureCount();                                         \
+        }                                                                       \
+    } while (0)
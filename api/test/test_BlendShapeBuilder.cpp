@@ -0,0 +1,112 @@
+#include "BlendShapeBuilder.h"
+#include "TestCommon.h"
+#include <map>
+
+using namespace cf;
+
+// 代替 Maya/FBX 场景的内存宿主，记录收到的目标
+class RecordingHost : public BlendShapeHost {
+public:
+    map<string, size_t> meshes;  // 场景中存在的网格及其顶点数
+    map<string, SparseShapeDelta> targets;
+    vector<string> targetOrder;
+    vector<pair<string, size_t>> finished;
+
+    bool beginMesh(const string& meshName, size_t& vertexCount) override {
+        auto it = meshes.find(meshName);
+        if (it == meshes.end()) {
+            return false;
+        }
+        mCurrent = meshName;
+        vertexCount = it->second;
+        return true;
+    }
+
+    bool addTarget(const string& channelName, const SparseShapeDelta& delta) override {
+        targets[channelName] = delta;
+        targetOrder.push_back(channelName);
+        return true;
+    }
+
+    void endMesh(size_t targetCount) override {
+        finished.emplace_back(mCurrent, targetCount);
+    }
+
+private:
+    string mCurrent;
+};
+
+static MeshSet makeGap(const string& mesh, const vector<double>& x) {
+    MeshSet set;
+    size_t slot = set.addMesh(mesh, x.size());
+    for (size_t i = 0; i < x.size(); ++i) {
+        set.setVertex(slot, i, {x[i], 0.0, 0.0});
+    }
+    return set;
+}
+
+static void testBuildThroughHost() {
+    RegionWeightMap weights = RegionWeightMap::compile(nlohmann::json::parse(R"({
+        "head_lod0_mesh": {
+            "eyes_blendshape": {"0": 1.0, "2": 0.5, "5": 1.0},
+            "nose_blendshape": {"1": 1.0}
+        },
+        "teeth_lod0_mesh": {
+            "mouth_blendshape": {"0": 1.0}
+        }
+    })"));
+
+    // 三个后缀各自的网格差值：source_R 中 nose 区域（顶点 1）没有位移
+    vector<MeshSet> distance = {
+        makeGap("head_lod0_mesh", {1.0, 2.0, 4.0, 0.0, 0.0, 8.0}),
+        makeGap("head_lod0_mesh", {-1.0, 3.0, 0.0, 0.0, 0.0, 0.0}),
+        makeGap("head_lod0_mesh", {0.0, 0.0, 2.0, 0.0, 0.0, 0.0}),
+    };
+    const vector<string> suffixes = {"source_L", "source_M", "source_R"};
+
+    RecordingHost host;
+    host.meshes["head_lod0_mesh"] = 5;  // 顶点 5 超出底模范围，被忽略
+
+    BlendShapeBuildStats stats = buildBlendShapes(weights, distance, suffixes, 1e-9, host);
+
+    // teeth 不在场景中，整个网格被跳过
+    CF_CHECK(stats.skippedMeshes == 1);
+    CF_CHECK(stats.meshes == 1);
+    CF_CHECK(host.finished.size() == 1 && host.finished[0].second == 5);
+
+    // 6 个通道中 nose_source_R 被剔除
+    CF_CHECK(stats.channels == 5);
+    CF_CHECK(stats.prunedChannels == 1);
+    CF_CHECK(host.targets.count("head_lod0_meshnose_blendshape_source_R") == 0);
+    CF_CHECK(host.targetOrder.front() == "head_lod0_mesheyes_blendshape_source_L");
+
+    const SparseShapeDelta& eyesL = host.targets["head_lod0_mesheyes_blendshape_source_L"];
+    CF_CHECK(eyesL.size() == 2);
+    CF_CHECK(eyesL.indices[0] == 0 && eyesL.indices[1] == 2);
+    CF_CHECK(eyesL.dx[0] == -1.0 && eyesL.dx[1] == -2.0);
+
+    const SparseShapeDelta& eyesM = host.targets["head_lod0_mesheyes_blendshape_source_M"];
+    CF_CHECK(eyesM.size() == 1 && eyesM.dx[0] == 1.0);
+
+    CF_CHECK(stats.shapePoints == 2 + 1 + 1 + 1 + 1);
+    CF_CHECK(stats.densePoints == 5 * 5);
+}
+
+static void testMissingDistance() {
+    RegionWeightMap weights = RegionWeightMap::compile(nlohmann::json::parse(R"({
+        "head_lod0_mesh": {"eyes_blendshape": {"0": 1.0}}
+    })"));
+    RecordingHost host;
+    host.meshes["head_lod0_mesh"] = 3;
+
+    // 没有差值数据时所有通道都被剔除，宿主仍然收到 endMesh(0)
+    BlendShapeBuildStats stats = buildBlendShapes(weights, vector<MeshSet>(), {"source_L"}, 0.0, host);
+    CF_CHECK(stats.channels == 0 && stats.prunedChannels == 1 && stats.meshes == 0);
+    CF_CHECK(host.finished.size() == 1 && host.finished[0].second == 0);
+}
+
+int main() {
+    testBuildThroughHost();
+    testMissingDistance();
+    return test::failureCount() == 0 ? 0 : 1;
+}
@@ -0,0 +1,354 @@
+#include "BlendShapePipeline.h"
+#include "BlendShapeJson.h"
+#include "Log.h"
+#include "TestCommon.h"
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+using namespace cf;
+
+namespace {
+
+// 只统计收到的目标，不保存数据
+class CountingHost : public BlendShapeHost {
+public:
+    size_t meshes = 0;
+    size_t targets = 0;
+
+    bool beginMesh(const string& meshName, size_t& vertexCount) override {
+        (void)meshName;
+        vertexCount = 1u << 20;
+        ++meshes;
+        return true;
+    }
+    bool addTarget(const string& channelName, const SparseShapeDelta& delta) override {
+        (void)channelName;
+        (void)delta;
+        ++targets;
+        return true;
+    }
+    void endMesh(size_t targetCount) override { (void)targetCount; }
+};
+
+MeshSet makeHead(const vector<array<double, 3>>& points) {
+    MeshSet meshes;
+    size_t slot = meshes.addMesh("head_lod0_mesh", points.size());
+    for (size_t i = 0; i < points.size(); ++i) {
+        meshes.setVertex(slot, i, points[i]);
+    }
+    return meshes;
+}
+
+}
+
+static void testRegisterAndGap() {
+    const vector<array<double, 3>> base = {{0, 0, 0}, {1, 0, 0}, {0, 2, 0}, {0, 0, 3}, {1, 1, 1}};
+    vector<array<double, 3>> moved;
+    for (const auto& p : base) {
+        moved.push_back({p[0] * 2.0 + 5.0, p[1] * 2.0 - 1.0, p[2] * 2.0 + 0.5});
+    }
+
+    vector<MeshSet> meshes = {makeHead(base), makeHead(moved)};
+    BlendShapePipeline pipeline;
+    vector<SimilarityTransform> transforms = pipeline.registerHeads(meshes);
+    CF_CHECK(transforms.size() == 1);
+    CF_CHECK_NEAR(transforms[0].scale, 0.5, 1e-12);
+
+    // 配准后目标与底模重合，差值为零
+    vector<MeshSet> gaps = BlendShapePipeline::getMeshGap(meshes);
+    CF_CHECK(gaps.size() == 1 && gaps[0].meshCount() == 1);
+    for (size_t i = 0; i < base.size(); ++i) {
+        CF_CHECK_NEAR(gaps[0].vertex(0, i)[0], 0.0, 1e-12);
+        CF_CHECK_NEAR(gaps[0].vertex(0, i)[1], 0.0, 1e-12);
+    }
+}
+
+static void testLogSink() {
+    vector<pair<LogLevel, string>> messages;
+    {
+        ScopedLogSink sink([&](LogLevel level, const string& message) {
+            messages.emplace_back(level, message);
+        });
+        BlendShapePipeline pipeline;
+        PipelineResult result;
+        CF_CHECK(!pipeline.prepare({"only_one.fbx"}, string(), result));
+    }
+    CF_CHECK(messages.size() == 1 && messages[0].first == LogLevel::Error);
+
+    // 作用域结束后恢复原来的输出目标
+    logInfo("restored");
+    CF_CHECK(messages.size() == 1);
+}
+
+static void testRunOnResources(int argc, char** argv) {
+    const vector<string> files = {
+        test::resourcePath(argc, argv, "trump.fbx"),
+        test::resourcePath(argc, argv, "bigear.fbx"),
+        test::resourcePath(argc, argv, "cooper.fbx"),
+        test::resourcePath(argc, argv, "farrukh.fbx"),
+    };
+
+    PipelineOptions options;
+    options.weightCachePath = "test_pipeline_weights.cfw";
+    BlendShapePipeline pipeline(options);
+
+    ScopedLogSink quiet([](LogLevel, const string&) {});
+    PipelineResult result;
+    CF_CHECK(pipeline.prepare(files, test::resourcePath(argc, argv, "skin_weights.json"), result));
+    CF_CHECK(result.gaps.size() == 3);
+    CF_CHECK(result.transforms.size() == 3);
+    CF_CHECK(result.weights.regionCount() == 19);
+    CF_CHECK(result.base.find("head_lod0_mesh") >= 0);
+
+    CountingHost counting;
+    BlendShapeBuildStats stats = pipeline.build(result, counting);
+    CF_CHECK(counting.meshes == result.weights.meshCount());
+    CF_CHECK(stats.channels + stats.prunedChannels == result.weights.regionCount() * 3);
+    CF_CHECK(stats.channels > 0 && stats.shapePoints > 0);
+
+    JsonBlendShapeHost json(result.base);
+    BlendShapeBuildStats jsonStats = pipeline.build(result, json);
+    CF_CHECK(jsonStats.channels == stats.channels);
+    CF_CHECK(json.json().contains("head_lod0_mesh"));
+    const auto& eyes = json.json()["head_lod0_mesh"]["head_lod0_mesheyes_blendshape_source_L"];
+    CF_CHECK(eyes["deltas"].size() == eyes["indices"].size() * 3);
+
+    remove(options.weightCachePath.c_str());
+}
+
+// 融合求差与分阶段的 registerHeads -> alignRegionsByCenter -> getMeshGap 逐位一致，且读写量更少
+static void testFusedMatchesStaged(int argc, char** argv) {
+    const vector<string> files = {
+        test::resourcePath(argc, argv, "trump.fbx"),
+        test::resourcePath(argc, argv, "bigear.fbx"),
+        test::resourcePath(argc, argv, "cooper.fbx"),
+    };
+
+    ScopedLogSink quiet([](LogLevel, const string&) {});
+    PipelineOptions options;
+    options.weightCachePath = "test_pipeline_fused.cfw";
+    options.fusedEvaluation = false;
+    BlendShapePipeline staged(options);
+    PipelineResult stagedResult;
+    CF_CHECK(staged.prepare(files, test::resourcePath(argc, argv, "skin_weights.json"), stagedResult));
+
+    options.fusedEvaluation = true;
+    BlendShapePipeline fused(options);
+    PipelineResult fusedResult;
+    CF_CHECK(fused.prepare(files, test::resourcePath(argc, argv, "skin_weights.json"), fusedResult));
+
+    CF_CHECK(fusedResult.gaps.size() == stagedResult.gaps.size());
+    for (size_t i = 0; i < fusedResult.gaps.size() && i < stagedResult.gaps.size(); ++i) {
+        const MeshSet& fusedGap = fusedResult.gaps[i];
+        const MeshSet& stagedGap = stagedResult.gaps[i];
+        // 融合模式只输出有权重的网格
+        CF_CHECK(fusedGap.meshCount() == fusedResult.weights.meshCount());
+        for (size_t m = 0; m < fusedGap.meshCount(); ++m) {
+            int slot = stagedGap.find(fusedGap.nameId(m));
+            CF_CHECK(slot >= 0);
+            if (slot < 0 || stagedGap.vertexCount(slot) != fusedGap.vertexCount(m)) {
+                continue;
+            }
+            const size_t bytes = fusedGap.vertexCount(m) * sizeof(double);
+            CF_CHECK(memcmp(fusedGap.x(m), stagedGap.x(slot), bytes) == 0);
+            CF_CHECK(memcmp(fusedGap.y(m), stagedGap.y(slot), bytes) == 0);
+            CF_CHECK(memcmp(fusedGap.z(m), stagedGap.z(slot), bytes) == 0);
+        }
+    }
+
+    JsonBlendShapeHost stagedJson(stagedResult.base);
+    JsonBlendShapeHost fusedJson(fusedResult.base);
+    staged.build(stagedResult, stagedJson);
+    fused.build(fusedResult, fusedJson);
+    CF_CHECK(stagedJson.json() == fusedJson.json());
+
+    CF_CHECK(fusedResult.traffic.bytesRead < stagedResult.traffic.bytesRead);
+    CF_CHECK(fusedResult.traffic.bytesWritten < stagedResult.traffic.bytesWritten);
+    CF_CHECK(fusedResult.traffic.transientBytes < stagedResult.traffic.transientBytes);
+
+    remove(options.weightCachePath.c_str());
+}
+
+// 单精度融合求差与双精度结果的差值不超过坐标量级乘以 float 机器精度的小倍数，读写量减半
+static void testFloatPrecisionBounded(int argc, char** argv) {
+    const vector<string> files = {
+        test::resourcePath(argc, argv, "trump.fbx"),
+        test::resourcePath(argc, argv, "bigear.fbx"),
+        test::resourcePath(argc, argv, "cooper.fbx"),
+        test::resourcePath(argc, argv, "farrukh.fbx"),
+    };
+    const string weights = test::resourcePath(argc, argv, "skin_weights.json");
+
+    ScopedLogSink quiet([](LogLevel, const string&) {});
+    PipelineOptions options;
+    options.weightCachePath = "test_pipeline_float.cfw";
+    BlendShapePipeline doublePipeline(options);
+    PipelineResult doubleResult;
+    CF_CHECK(doublePipeline.prepare(files, weights, doubleResult));
+
+    options.precision = GeometryPrecision::Float;
+    BlendShapePipeline floatPipeline(options);
+    PipelineResult floatResult;
+    CF_CHECK(floatPipeline.prepare(files, weights, floatResult));
+    CF_CHECK(floatResult.precision == GeometryPrecision::Float);
+    CF_CHECK(floatResult.gaps.empty());
+    CF_CHECK(floatResult.floatGaps.size() == doubleResult.gaps.size());
+
+    double extent = 0.0;
+    for (size_t k = 0; k < doubleResult.base.vertexCount(); ++k) {
+        extent = max({extent, fabs(doubleResult.base.xData()[k]), fabs(doubleResult.base.yData()[k]), fabs(doubleResult.base.zData()[k])});
+    }
+    const double bound = 16.0 * FLT_EPSILON * extent;
+    double maxError = 0.0;
+    for (size_t i = 0; i < floatResult.floatGaps.size() && i < doubleResult.gaps.size(); ++i) {
+        const MeshSetF& floatGap = floatResult.floatGaps[i];
+        const MeshSet& doubleGap = doubleResult.gaps[i];
+        CF_CHECK(floatGap.meshCount() == doubleGap.meshCount() && floatGap.vertexCount() == doubleGap.vertexCount());
+        for (size_t k = 0; k < floatGap.vertexCount() && k < doubleGap.vertexCount(); ++k) {
+            maxError = max(maxError, fabs(floatGap.xData()[k] - doubleGap.xData()[k]));
+            maxError = max(maxError, fabs(floatGap.yData()[k] - doubleGap.yData()[k]));
+            maxError = max(maxError, fabs(floatGap.zData()[k] - doubleGap.zData()[k]));
+        }
+    }
+    printf("Float gap max error %.3g (bound %.3g, extent %.3g)\n", maxError, bound, extent);
+    CF_CHECK(maxError <= bound);
+    CF_CHECK(floatResult.traffic.bytesRead * 2 == doubleResult.traffic.bytesRead);
+    CF_CHECK(floatResult.traffic.transientBytes * 2 == doubleResult.traffic.transientBytes);
+
+    // 双精度生成的每个通道在单精度结果中都存在，位移之差同样有界
+    JsonBlendShapeHost doubleJson(doubleResult.base);
+    JsonBlendShapeHost floatJson(floatResult.base);
+    doublePipeline.build(doubleResult, doubleJson);
+    floatPipeline.build(floatResult, floatJson);
+    for (const auto& [meshName, channels] : doubleJson.json().items()) {
+        for (const auto& [channelName, channel] : channels.items()) {
+            CF_CHECK(floatJson.json()[meshName].contains(channelName));
+        }
+    }
+
+    remove(options.weightCachePath.c_str());
+}
+
+static bool sameGaps(const vector<MeshSet>& a, const vector<MeshSet>& b);
+static bool sameMeshes(const MeshSet& a, const MeshSet& b);
+
+// 区域对齐与融合求差在多个线程上执行时与单线程逐位一致；预先计算的底模区域与逐目标过滤的结果相同
+static void testParallelAlignmentMatchesSerial(int argc, char** argv) {
+    const vector<string> files = {
+        test::resourcePath(argc, argv, "trump.fbx"),
+        test::resourcePath(argc, argv, "bigear.fbx"),
+        test::resourcePath(argc, argv, "cooper.fbx"),
+        test::resourcePath(argc, argv, "farrukh.fbx"),
+    };
+
+    ScopedLogSink quiet([](LogLevel, const string&) {});
+    PipelineOptions options;
+    options.workerCount = 1;
+    BlendShapePipeline serial(options);
+    options.workerCount = 4;
+    BlendShapePipeline parallel(options);
+
+    vector<MeshSet> meshes = serial.loadFbxFiles(files);
+    CF_CHECK(meshes.size() == 4);
+    serial.registerHeads(meshes);
+    const RegionWeightMap weights = BlendShapePipeline::loadRegionWeights(test::resourcePath(argc, argv, "skin_weights.json"), "test_pipeline_align.cfw");
+
+    vector<MeshSet> serialAligned = serial.alignRegionsByCenter(meshes, weights);
+    vector<MeshSet> parallelAligned = parallel.alignRegionsByCenter(meshes, weights);
+    CF_CHECK(serialAligned.size() == parallelAligned.size());
+    for (size_t i = 0; i < serialAligned.size() && i < parallelAligned.size(); ++i) {
+        CF_CHECK(sameMeshes(serialAligned[i], parallelAligned[i]));
+    }
+
+    // 与逐个目标调用 adjustVerticesByRegion 的结果一致
+    for (size_t i = 1; i < meshes.size(); ++i) {
+        MeshSet adjusted = meshes[i];
+        serial.adjustVerticesByRegion(meshes[0], adjusted, weights);
+        CF_CHECK(sameMeshes(adjusted, parallelAligned[i]));
+    }
+
+    HeadRegionCenters centers = BlendShapePipeline::computeHeadRegionCenters(meshes[0], weights);
+    const int headEntry = weights.findMesh(findMeshName("head_lod0_mesh"));
+    CF_CHECK(headEntry >= 0 && centers.regions.size() == weights.mesh(headEntry).regionCount);
+    CF_CHECK(centers.vertexLimit == meshes[0].vertexCount(meshes[0].find("head_lod0_mesh")));
+
+    vector<SimilarityTransform> transforms = serial.solveHeadTransforms(meshes);
+    PipelineTraffic serialTraffic, parallelTraffic;
+    vector<MeshSet> serialGaps = serial.evaluateGaps(meshes, transforms, weights, &serialTraffic);
+    vector<MeshSet> parallelGaps = parallel.evaluateGaps(meshes, transforms, weights, &parallelTraffic);
+    CF_CHECK(sameGaps(serialGaps, parallelGaps));
+    CF_CHECK(serialTraffic.bytesRead == parallelTraffic.bytesRead && serialTraffic.transientBytes == parallelTraffic.transientBytes);
+
+    remove("test_pipeline_align.cfw");
+}
+
+static bool sameGaps(const vector<MeshSet>& a, const vector<MeshSet>& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i].meshCount() != b[i].meshCount() || a[i].vertexCount() != b[i].vertexCount()) {
+            return false;
+        }
+        for (size_t m = 0; m < a[i].meshCount(); ++m) {
+            const size_t bytes = a[i].vertexCount(m) * sizeof(double);
+            if (a[i].nameId(m) != b[i].nameId(m) || memcmp(a[i].x(m), b[i].x(m), bytes) != 0
+                || memcmp(a[i].y(m), b[i].y(m), bytes) != 0 || memcmp(a[i].z(m), b[i].z(m), bytes) != 0) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static bool sameMeshes(const MeshSet& a, const MeshSet& b) {
+    return sameGaps({a}, {b});
+}
+
+static void testBatchMatchesSingleBase(int argc, char** argv) {
+    const string trump = test::resourcePath(argc, argv, "trump.fbx");
+    const string bigear = test::resourcePath(argc, argv, "bigear.fbx");
+    const string cooper = test::resourcePath(argc, argv, "cooper.fbx");
+    const string farrukh = test::resourcePath(argc, argv, "farrukh.fbx");
+    const string weights = test::resourcePath(argc, argv, "skin_weights.json");
+
+    // 拦截日志，确认工作线程上的日志都回到调用线程输出
+    const thread::id caller = this_thread::get_id();
+    bool offThread = false;
+    ScopedLogSink sink([&](LogLevel, const string&) { offThread = offThread || this_thread::get_id() != caller; });
+    PipelineOptions options;
+    options.weightCachePath = "test_pipeline_batch.cfw";
+    options.workerCount = 2;
+    BlendShapePipeline pipeline(options);
+
+    // 底模同时出现在目标列表中时跳过自身
+    vector<BatchResult> batch = pipeline.prepareBatch({trump, bigear, "missing.fbx"}, {trump, bigear, cooper, farrukh}, weights);
+    CF_CHECK(batch.size() == 3);
+    CF_CHECK(!offThread);
+    CF_CHECK(!batch[2].prepared);
+
+    const vector<vector<string>> singles = {{trump, bigear, cooper, farrukh}, {bigear, trump, cooper, farrukh}};
+    for (size_t b = 0; b < singles.size() && b < batch.size(); ++b) {
+        CF_CHECK(batch[b].prepared);
+        CF_CHECK(batch[b].baseFile == singles[b][0]);
+        PipelineResult single;
+        CF_CHECK(pipeline.prepare(singles[b], weights, single));
+        CF_CHECK(sameGaps(batch[b].result.gaps, single.gaps));
+        CF_CHECK(batch[b].result.base.vertexCount() == single.base.vertexCount());
+        CF_CHECK(memcmp(batch[b].result.base.xData(), single.base.xData(), single.base.vertexCount() * sizeof(double)) == 0);
+    }
+}
+
+int main(int argc, char** argv) {
+    testRegisterAndGap();
+    testLogSink();
+    testRunOnResources(argc, argv);
+    testFusedMatchesStaged(argc, argv);
+    testBatchMatchesSingleBase(argc, argv);
+    testFloatPrecisionBounded(argc, argv);
+    testParallelAlignmentMatchesSerial(argc, argv);
+    return test::failureCount() == 0 ? 0 : 1;
+}
@@ -0,0 +1,36 @@
+#include "ContentHash.h"
+#include "TestCommon.h"
+#include <cstdio>
+#include <vector>
+
+using namespace cf;
+
+// 参考值来自 xxHash 官方实现（python-xxhash 的 xxh64）
+static void testReferenceValues() {
+    CF_CHECK(hashBytes("", 0) == 0xEF46DB3751D8E999ull);
+    CF_CHECK(hashBytes("abc", 3) == 0x44BC2CF5AD770999ull);
+
+    vector<uint8_t> bytes(100);
+    for (size_t i = 0; i < bytes.size(); ++i) {
+        bytes[i] = static_cast<uint8_t>(i);
+    }
+    CF_CHECK(hashBytes(bytes.data(), bytes.size()) == 0x6AC1E58032166597ull);
+    CF_CHECK(hashBytes(bytes.data(), bytes.size(), 7) == 0x80653E7E9B887CDDull);
+}
+
+static void testHashFile(const string& path) {
+    uint64_t first = 0;
+    uint64_t second = 0;
+    CF_CHECK(hashFile(path, first));
+    CF_CHECK(hashFile(path, second));
+    CF_CHECK(first == second && first != 0);
+
+    uint64_t missing = 0;
+    CF_CHECK(!hashFile(path + ".missing", missing));
+}
+
+int main(int argc, char** argv) {
+    testReferenceValues();
+    testHashFile(test::resourcePath(argc, argv, "skin_weights.json"));
+    return test::failureCount() == 0 ? 0 : 1;
+}
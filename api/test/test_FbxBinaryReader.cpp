@@ -0,0 +1,195 @@
+#include "FbxBinaryReader.h"
+#include "TestCommon.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+using namespace cf;
+
+// 资源文件中的九个 lod0 网格
+static const char* kMeshNames[] = {
+    "head_lod0_mesh", "teeth_lod0_mesh", "saliva_lod0_mesh", "eyeRight_lod0_mesh", "eyeLeft_lod0_mesh",
+    "eyeshell_lod0_mesh", "eyelashes_lod0_mesh", "eyeEdge_lod0_mesh", "cartilage_lod0_mesh"
+};
+
+static void testReadAllMeshes(const string& path) {
+    CF_CHECK(FbxBinaryReader::isBinaryFbx(path));
+
+    FbxBinaryReader reader;
+    CF_CHECK(reader.open(path));
+    CF_CHECK(reader.version() == 7700);
+
+    map<string, FbxMeshArrays> meshes;
+    CF_CHECK(reader.readMeshes({}, true, meshes));
+    CF_CHECK(meshes.size() == 9);
+    for (const char* name : kMeshNames) {
+        CF_CHECK(meshes.count(name) == 1);
+    }
+
+    const FbxMeshArrays& head = meshes["head_lod0_mesh"];
+    CF_CHECK(head.vertices.size() == 24049 * 3);
+    CF_CHECK(head.polygonVertexIndex.size() == 96008);
+
+    // 每个多边形以按位取反的索引结尾，所有索引都必须落在控制点范围内
+    int32_t maxIndex = 0;
+    for (int32_t index : head.polygonVertexIndex) {
+        int32_t vertex = index < 0 ? ~index : index;
+        maxIndex = vertex > maxIndex ? vertex : maxIndex;
+    }
+    CF_CHECK(maxIndex == 24048);
+    CF_CHECK(!head.polygonVertexIndex.empty() && head.polygonVertexIndex.back() < 0);
+}
+
+static void testMeshNameFilter(const string& path) {
+    FbxBinaryReader reader;
+    CF_CHECK(reader.open(path));
+
+    map<string, FbxMeshArrays> meshes;
+    CF_CHECK(reader.readMeshes({"teeth_lod0_mesh", "missing_mesh"}, false, meshes, 1));
+    CF_CHECK(meshes.size() == 1);
+    CF_CHECK(meshes["teeth_lod0_mesh"].vertices.size() == 4246 * 3);
+    CF_CHECK(meshes["teeth_lod0_mesh"].polygonVertexIndex.empty());
+}
+
+static void testParallelMatchesSerial(const string& path) {
+    FbxBinaryReader reader;
+    CF_CHECK(reader.open(path));
+
+    map<string, FbxMeshArrays> serial;
+    map<string, FbxMeshArrays> parallel;
+    CF_CHECK(reader.readMeshes({}, true, serial, 1));
+    CF_CHECK(reader.readMeshes({}, true, parallel, 4));
+    CF_CHECK(serial.size() == parallel.size());
+    for (const auto& [name, arrays] : serial) {
+        CF_CHECK(arrays.vertices == parallel[name].vertices);
+        CF_CHECK(arrays.polygonVertexIndex == parallel[name].polygonVertexIndex);
+    }
+}
+
+static void testRejectsNonFbx(const string& path) {
+    CF_CHECK(!FbxBinaryReader::isBinaryFbx(path));
+
+    FbxBinaryReader reader;
+    CF_CHECK(!reader.open(path));
+    CF_CHECK(!reader.lastError().empty());
+}
+
+// 最小的二进制FBX 7.5 节点树：记录头为 endOffset、属性数、属性字节数（各 8 字节）与名称长度，
+// 有子节点时以 25 字节的空记录结尾
+struct SyntheticNode {
+    string name;
+    string properties;
+    uint64_t propertyCount = 0;
+    vector<SyntheticNode> children;
+
+    explicit SyntheticNode(const string& nodeName) : name(nodeName) {}
+
+    SyntheticNode& raw(char type, const void* data, size_t bytes) {
+        properties.push_back(type);
+        properties.append(static_cast<const char*>(data), bytes);
+        ++propertyCount;
+        return *this;
+    }
+    SyntheticNode& id(int64_t value) { return raw('L', &value, sizeof(value)); }
+    SyntheticNode& text(const string& value) {
+        uint32_t length = static_cast<uint32_t>(value.size());
+        raw('S', &length, sizeof(length));
+        properties.append(value);
+        return *this;
+    }
+    template <typename T>
+    SyntheticNode& array(char type, const vector<T>& values) {
+        const uint32_t header[3] = {static_cast<uint32_t>(values.size()), 0, static_cast<uint32_t>(values.size() * sizeof(T))};
+        raw(type, header, sizeof(header));
+        properties.append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+        return *this;
+    }
+
+    void write(string& out) const {
+        const size_t begin = out.size();
+        out.append(25, '\0');
+        out[begin + 24] = static_cast<char>(name.size());
+        out.append(name);
+        out.append(properties);
+        for (const SyntheticNode& child : children) {
+            child.write(out);
+        }
+        if (!children.empty()) {
+            out.append(25, '\0');
+        }
+        const uint64_t fields[3] = {out.size(), propertyCount, properties.size()};
+        memcpy(&out[begin], fields, sizeof(fields));
+    }
+};
+
+static SyntheticNode meshModel(int64_t id, const string& name) {
+    SyntheticNode node{"Model"};
+    node.id(id).text(name + string("\0\x01Model", 7)).text("Mesh");
+    return node;
+}
+
+static SyntheticNode meshGeometry(int64_t id, const vector<double>& vertices) {
+    SyntheticNode node{"Geometry"};
+    node.id(id).text("Geometry").text("Mesh");
+    SyntheticNode verticesNode{"Vertices"};
+    verticesNode.array('d', vertices);
+    SyntheticNode polygonsNode{"PolygonVertexIndex"};
+    polygonsNode.array('i', vector<int32_t>{0, 1, ~2});
+    node.children = {verticesNode, polygonsNode};
+    return node;
+}
+
+static SyntheticNode connection(int64_t child, int64_t parent) {
+    SyntheticNode node{"C"};
+    node.text("OO").id(child).id(parent);
+    return node;
+}
+
+static void testDuplicateModelNames() {
+    // 两个同名的 head 模型各连接一个几何（第二个顶点更多，重复 resize 会使第一个解压任务的指针失效），
+    // 另有一个几何实例化到两个不同名的模型上
+    const vector<double> head = {0, 0, 0, 1, 0, 0, 0, 1, 0};
+    vector<double> duplicate(3000, 7.0);
+    const vector<double> teeth = {5, 5, 5, 6, 5, 5, 5, 6, 5};
+    SyntheticNode objects{"Objects"};
+    objects.children = {meshModel(1, "head_lod0_mesh"), meshModel(2, "head_lod0_mesh"), meshModel(3, "teeth_lod0_mesh"),
+                        meshModel(4, "teeth_lod1_mesh"), meshGeometry(10, head), meshGeometry(11, duplicate), meshGeometry(12, teeth)};
+    SyntheticNode connections{"Connections"};
+    connections.children = {connection(10, 1), connection(11, 2), connection(12, 3), connection(12, 4)};
+
+    string content("Kaydara FBX Binary  \0\x1a\0", 23);
+    const uint32_t version = 7500;
+    content.append(reinterpret_cast<const char*>(&version), sizeof(version));
+    objects.write(content);
+    connections.write(content);
+    content.append(25, '\0');
+    const char* path = "test_duplicate_names.fbx";
+    ofstream(path, ios::binary | ios::trunc) << content;
+
+    FbxBinaryReader reader;
+    CF_CHECK(reader.open(path));
+    for (unsigned workers : {1u, 4u}) {
+        map<string, FbxMeshArrays> meshes;
+        CF_CHECK(reader.readMeshes({}, true, meshes, workers));
+        CF_CHECK(meshes.size() == 3);
+        CF_CHECK(meshes["head_lod0_mesh"].vertices == head);
+        CF_CHECK(meshes["teeth_lod0_mesh"].vertices == teeth && meshes["teeth_lod1_mesh"].vertices == teeth);
+        CF_CHECK(meshes["teeth_lod1_mesh"].polygonVertexIndex.size() == 3);
+        CF_CHECK(reader.warnings().size() == 1);
+        CF_CHECK(!reader.warnings().empty() && reader.warnings()[0].find("head_lod0_mesh") != string::npos);
+    }
+    reader.close();
+    remove(path);
+}
+
+int main(int argc, char** argv) {
+    const char* files[] = {"trump.fbx", "bigear.fbx", "cooper.fbx", "farrukh.fbx"};
+    for (const char* file : files) {
+        testReadAllMeshes(test::resourcePath(argc, argv, file));
+    }
+    testMeshNameFilter(test::resourcePath(argc, argv, "trump.fbx"));
+    testParallelMatchesSerial(test::resourcePath(argc, argv, "cooper.fbx"));
+    testDuplicateModelNames();
+    testRejectsNonFbx(test::resourcePath(argc, argv, "skin_weights.json"));
+    return test::failureCount() == 0 ? 0 : 1;
+}
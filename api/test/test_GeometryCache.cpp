@@ -0,0 +1,119 @@
+#include "GeometryCache.h"
+#include "TestCommon.h"
+#include <filesystem>
+
+using namespace cf;
+
+static const char* kCacheDir = "test_geometry_cache";
+
+static void testStoreAndLookup() {
+    filesystem::remove_all(kCacheDir);
+    test::writeSource("test_geometry_a.fbx", "character a");
+    test::writeSource("test_geometry_copy.fbx", "character a");
+    const MeshSet original = test::makeMeshes(1.5);
+    const vector<uint64_t> topology = {0x1234, 0x5678};
+
+    {
+        GeometryCache cache(kCacheDir);
+        GeometryCacheKey key;
+        MeshSet meshes;
+        CF_CHECK(!cache.lookup("test_geometry_a.fbx", key, meshes));
+        CF_CHECK(key.valid && key.contentHash != 0);
+        string error;
+        CF_CHECK(cache.store(key, original, topology, error));
+
+        vector<uint64_t> loadedTopology;
+        CF_CHECK(cache.lookup("test_geometry_a.fbx", key, meshes, &loadedTopology));
+        CF_CHECK(test::sameMeshes(original, meshes));
+        CF_CHECK(loadedTopology == topology);
+
+        // 内容相同的其他文件命中同一条目，但需要计算内容哈希
+        MeshSet copy;
+        CF_CHECK(cache.lookup("test_geometry_copy.fbx", key, copy));
+        CF_CHECK(test::sameMeshes(original, copy));
+
+        GeometryCacheStats stats = cache.stats();
+        CF_CHECK(stats.hits == 2 && stats.precheckHits == 1 && stats.misses == 1 && stats.stores == 1);
+        CF_CHECK(stats.entryCount == 1 && stats.totalBytes > 0);
+        CF_CHECK(cache.flush(error));
+    }
+
+    // 新实例从索引恢复预检记录
+    {
+        GeometryCache cache(kCacheDir);
+        GeometryCacheKey key;
+        MeshSet meshes;
+        CF_CHECK(cache.lookup("test_geometry_a.fbx", key, meshes));
+        CF_CHECK(cache.stats().precheckHits == 1);
+        CF_CHECK(test::sameMeshes(original, meshes));
+
+        // 文件内容改变后不再命中
+        test::writeSource("test_geometry_a.fbx", "character a, edited");
+        CF_CHECK(!cache.lookup("test_geometry_a.fbx", key, meshes));
+        CF_CHECK(key.valid);
+    }
+}
+
+static void testCorruptedEntryIsMiss() {
+    filesystem::remove_all(kCacheDir);
+    test::writeSource("test_geometry_b.fbx", "character b");
+    GeometryCache cache(kCacheDir);
+    GeometryCacheKey key;
+    MeshSet meshes;
+    string error;
+    cache.lookup("test_geometry_b.fbx", key, meshes);
+    CF_CHECK(cache.store(key, test::makeMeshes(2.0), {}, error));
+
+    for (const auto& entry : filesystem::directory_iterator(kCacheDir)) {
+        if (entry.path().extension() == ".cfg") {
+            filesystem::resize_file(entry.path(), 100);
+        }
+    }
+    CF_CHECK(!cache.lookup("test_geometry_b.fbx", key, meshes));
+}
+
+static void testEvictionKeepsRecentEntries() {
+    filesystem::remove_all(kCacheDir);
+    const vector<string> paths = {"test_geometry_e0.fbx", "test_geometry_e1.fbx", "test_geometry_e2.fbx"};
+    uint64_t entryBytes = 0;
+    {
+        GeometryCache cache(kCacheDir);
+        for (size_t i = 0; i < paths.size(); ++i) {
+            test::writeSource(paths[i], "character " + to_string(i));
+            GeometryCacheKey key;
+            MeshSet meshes;
+            string error;
+            cache.lookup(paths[i], key, meshes);
+            CF_CHECK(cache.store(key, test::makeMeshes(static_cast<double>(i)), {}, error));
+        }
+        entryBytes = cache.stats().totalBytes / paths.size();
+        string error;
+        CF_CHECK(cache.flush(error));
+    }
+
+    // 预算只够两个条目：重新使用 e0 之后，最久未用的 e1 被淘汰
+    GeometryCache cache(kCacheDir, entryBytes * 2);
+    GeometryCacheKey key;
+    MeshSet meshes;
+    CF_CHECK(cache.lookup(paths[0], key, meshes));
+    string error;
+    CF_CHECK(cache.flush(error));
+    GeometryCacheStats stats = cache.stats();
+    CF_CHECK(stats.evictions == 1 && stats.entryCount == 2);
+    CF_CHECK(stats.totalBytes <= entryBytes * 2);
+    CF_CHECK(cache.lookup(paths[0], key, meshes));
+    CF_CHECK(!cache.lookup(paths[1], key, meshes));
+    CF_CHECK(cache.lookup(paths[2], key, meshes));
+}
+
+int main() {
+    testStoreAndLookup();
+    testCorruptedEntryIsMiss();
+    testEvictionKeepsRecentEntries();
+    filesystem::remove_all(kCacheDir);
+    for (const char* path : {"test_geometry_a.fbx", "test_geometry_copy.fbx", "test_geometry_b.fbx",
+                             "test_geometry_e0.fbx", "test_geometry_e1.fbx", "test_geometry_e2.fbx"}) {
+        remove(path);
+    }
+    return test::failureCount() == 0 ? 0 : 1;
+}
@@ -0,0 +1,197 @@
+#include "InterchangeFile.h"
+#include "BlendShapeJson.h"
+#include "BlendShapePipeline.h"
+#include "Log.h"
+#include "TestCommon.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+using namespace cf;
+
+static string readBytes(const string& path) {
+    ifstream file(path, ios::binary);
+    return string(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+}
+
+static void writeBytes(const string& path, const string& bytes) {
+    ofstream file(path, ios::binary | ios::trunc);
+    file << bytes;
+}
+
+static bool aligned(const void* pointer) {
+    return reinterpret_cast<uintptr_t>(pointer) % 64 == 0;
+}
+
+static void testRoundTrip() {
+    RegionWeightMap weights = RegionWeightMap::compile(nlohmann::json::parse(R"({
+        "head_lod0_mesh": {"eyes_blendshape": {"1": 1.0, "3": 0.5}, "nose_blendshape": {"2": 0.25}},
+        "teeth_lod0_mesh": {"mouth_blendshape": {"0": 1.0}}
+    })"));
+
+    InterchangeWriter writer;
+    CF_CHECK(writer.addMeshSet("base", test::makeMeshes(0.0), {11, 22}) == 0);
+    CF_CHECK(writer.addMeshSet("target", test::makeMeshes(10.0)) == 1);
+    writer.setWeights(weights);
+
+    // 通道只能添加到第一组网格中存在的网格
+    size_t vertexCount = 0;
+    CF_CHECK(!writer.beginMesh("eyeLeft_lod0_mesh", vertexCount));
+    CF_CHECK(writer.beginMesh("head_lod0_mesh", vertexCount) && vertexCount == 4);
+    SparseShapeDelta eyes;
+    eyes.indices = {1, 3};
+    eyes.dx = {0.1, 0.3};
+    eyes.dy = {-0.1, -0.3};
+    eyes.dz = {1.0, 3.0};
+    CF_CHECK(writer.addTarget("head_lod0_mesheyes_blendshape_A", eyes));
+    SparseShapeDelta empty;
+    CF_CHECK(writer.addTarget("head_lod0_meshnose_blendshape_A", empty));
+    writer.endMesh(2);
+
+    string error;
+    CF_CHECK(writer.save("test_interchange.cfx", error));
+
+    InterchangeFile file;
+    CF_CHECK(file.open("test_interchange.cfx", error));
+    CF_CHECK(file.isOpen() && file.fileSize() > 0);
+    CF_CHECK(file.meshSetCount() == 2);
+    CF_CHECK(file.findMeshSet("target") == 1 && file.findMeshSet("missing") == -1);
+    CF_CHECK(file.meshCount() == 4);
+    CF_CHECK(file.meshSet(1).firstMesh == 2 && file.meshSet(1).meshCount == 2);
+
+    int head = file.findMesh(0, "head_lod0_mesh");
+    int targetTeeth = file.findMesh(1, "teeth_lod0_mesh");
+    CF_CHECK(head == 0 && targetTeeth == 3);
+    CF_CHECK(file.mesh(head).topology == 11 && file.mesh(1).topology == 22);
+    CF_CHECK(file.mesh(targetTeeth).topology == 0 && file.mesh(targetTeeth).meshSet == 1);
+    CF_CHECK(file.mesh(head).vertexCount == 4);
+    CF_CHECK(file.mesh(head).x[3] == 3.0 && file.mesh(head).y[3] == 6.0 && file.mesh(head).z[3] == -3.0);
+    CF_CHECK(file.mesh(targetTeeth).x[1] == 10.0 && file.mesh(targetTeeth).z[1] == 1.25);
+    CF_CHECK(aligned(file.mesh(0).x));
+
+    CF_CHECK(file.channelCount() == 2);
+    const InterchangeChannel& channel = file.channel(0);
+    CF_CHECK(channel.mesh == "head_lod0_mesh" && channel.name == "head_lod0_mesheyes_blendshape_A");
+    CF_CHECK(channel.pointCount == 2 && channel.indices[1] == 3);
+    CF_CHECK(channel.dx[0] == 0.1 && channel.dy[1] == -0.3 && channel.dz[1] == 3.0);
+    CF_CHECK(aligned(channel.indices) && aligned(channel.dx));
+    CF_CHECK(file.channel(1).pointCount == 0);
+
+    CF_CHECK(file.weightRegionCount() == 3);
+    const InterchangeWeightRegion& region = file.weightRegion(0);
+    CF_CHECK(region.mesh == "head_lod0_mesh" && region.region == "eyes_blendshape");
+    CF_CHECK(region.count == 2 && region.indices[0] == 1 && region.weights[1] == 0.5f);
+    CF_CHECK(file.weightRegion(2).mesh == "teeth_lod0_mesh" && file.weightRegion(2).indices[0] == 0);
+    CF_CHECK(aligned(region.indices) && aligned(region.weights));
+
+    MeshSet target;
+    CF_CHECK(file.readMeshSet(1, target));
+    CF_CHECK(target.meshCount() == 2 && target.vertex(0, 2)[0] == 12.0);
+    CF_CHECK(!file.readMeshSet(2, target));
+
+    // 移动后映射随对象转移
+    InterchangeFile moved(std::move(file));
+    CF_CHECK(moved.isOpen() && !file.isOpen());
+    CF_CHECK(moved.mesh(head).x[3] == 3.0);
+    moved.close();
+    CF_CHECK(!moved.isOpen() && moved.meshCount() == 0);
+}
+
+static void testRejectsInvalidFiles() {
+    const string bytes = readBytes("test_interchange.cfx");
+    CF_CHECK(bytes.size() > 64);
+    InterchangeFile file;
+    string error;
+
+    CF_CHECK(!file.open("test_interchange_missing.cfx", error));
+
+    writeBytes("test_interchange_bad.cfx", "not an interchange file at all, just some text");
+    CF_CHECK(!file.open("test_interchange_bad.cfx", error));
+    CF_CHECK(error.find("Not an interchange file") != string::npos);
+
+    // 版本号位于魔数之后
+    string newer = bytes;
+    uint32_t version = InterchangeFile::kVersion + 1;
+    memcpy(&newer[8], &version, sizeof(version));
+    writeBytes("test_interchange_bad.cfx", newer);
+    CF_CHECK(!file.open("test_interchange_bad.cfx", error));
+    CF_CHECK(error.find("version") != string::npos);
+
+    writeBytes("test_interchange_bad.cfx", bytes.substr(0, bytes.size() - 4));
+    CF_CHECK(!file.open("test_interchange_bad.cfx", error));
+    CF_CHECK(error.find("corrupted") != string::npos);
+
+    // 网格的顶点区间越界（第一个网格的 vertexOffset 改为极大值）；meshOffset 是文件头中的第 11 个 uint64
+    string corrupt = bytes;
+    uint64_t meshOffset = 0;
+    memcpy(&meshOffset, &corrupt[16 + 8 * 9], sizeof(meshOffset));
+    uint64_t hugeOffset = 1ull << 40;
+    memcpy(&corrupt[meshOffset + 8], &hugeOffset, sizeof(hugeOffset));
+    writeBytes("test_interchange_bad.cfx", corrupt);
+    CF_CHECK(!file.open("test_interchange_bad.cfx", error));
+    CF_CHECK(!file.isOpen());
+
+    CF_CHECK(file.open("test_interchange.cfx", error));
+    remove("test_interchange_bad.cfx");
+}
+
+// 流程结果写成交换文件后与JSON输出的通道一致
+static void testPipelineResult(int argc, char** argv) {
+    const vector<string> files = {test::resourcePath(argc, argv, "trump.fbx"), test::resourcePath(argc, argv, "bigear.fbx")};
+    ScopedLogSink quiet([](LogLevel, const string&) {});
+    PipelineOptions options;
+    options.weightCachePath = "test_interchange_weights.cfw";
+    options.geometryCacheDir.clear();
+    BlendShapePipeline pipeline(options);
+    PipelineResult result;
+    CF_CHECK(pipeline.prepare(files, test::resourcePath(argc, argv, "skin_weights.json"), result));
+
+    InterchangeWriter writer;
+    writer.addMeshSet("base", result.base);
+    writer.setWeights(result.weights);
+    BlendShapeBuildStats stats = pipeline.build(result, writer);
+    JsonBlendShapeHost json(result.base);
+    pipeline.build(result, json);
+    string error;
+    CF_CHECK(writer.save("test_interchange_pipeline.cfx", error));
+
+    InterchangeFile file;
+    CF_CHECK(file.open("test_interchange_pipeline.cfx", error));
+    CF_CHECK(file.channelCount() == stats.channels && stats.channels > 0);
+    CF_CHECK(file.weightRegionCount() == result.weights.regionCount());
+    CF_CHECK(file.meshCount() == result.base.meshCount());
+    size_t points = 0;
+    bool same = true;
+    for (size_t c = 0; c < file.channelCount(); ++c) {
+        const InterchangeChannel& channel = file.channel(c);
+        points += channel.pointCount;
+        const nlohmann::json& expected = json.json()[channel.mesh][channel.name];
+        same = same && expected["indices"].size() == channel.pointCount;
+        for (size_t k = 0; same && k < channel.pointCount; ++k) {
+            same = expected["indices"][k].get<uint32_t>() == channel.indices[k] && expected["deltas"][3 * k].get<double>() == channel.dx[k]
+                && expected["deltas"][3 * k + 1].get<double>() == channel.dy[k] && expected["deltas"][3 * k + 2].get<double>() == channel.dz[k];
+        }
+    }
+    CF_CHECK(same);
+    CF_CHECK(points == stats.shapePoints);
+
+    int head = file.findMesh(0, "head_lod0_mesh");
+    int baseHead = result.base.find("head_lod0_mesh");
+    CF_CHECK(head >= 0 && baseHead >= 0);
+    if (head >= 0 && baseHead >= 0) {
+        CF_CHECK(memcmp(file.mesh(head).y, result.base.y(baseHead), result.base.vertexCount(baseHead) * sizeof(double)) == 0);
+    }
+
+    file.close();
+    remove("test_interchange_pipeline.cfx");
+    remove(options.weightCachePath.c_str());
+}
+
+int main(int argc, char** argv) {
+    testRoundTrip();
+    testRejectsInvalidFiles();
+    testPipelineResult(argc, argv);
+    remove("test_interchange.cfx");
+    return test::failureCount() == 0 ? 0 : 1;
+}
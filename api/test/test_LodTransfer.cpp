@@ -0,0 +1,248 @@
+#include "LodTransfer.h"
+#include "GeometryCache.h"
+#include "Log.h"
+#include "SurfaceCorrespondence.h"
+#include "TestCommon.h"
+#include <filesystem>
+#include <map>
+
+using namespace cf;
+
+static const char* kCacheDir = "test_lod_cache";
+
+// z = 0 平面上 lod0 为 9x9 的网格，lod1 为与其顶点不重合的 6x6 网格
+struct GridPair {
+    GridPair() {
+        test::makeGridMesh(9, lod0, lod0Polygons);
+        test::makeGridMesh(6, lod1, lod1Polygons);
+        triangles = triangulatePolygons(lod0Polygons.data(), lod0Polygons.size(), lod0.size() / 3);
+    }
+
+    LodTransferMap build() const { return LodTransferMap::build(test::spanOf(lod0), triangles, test::spanOf(lod1), 2); }
+
+    vector<double> lod0;
+    vector<double> lod1;
+    vector<int32_t> lod0Polygons;
+    vector<int32_t> lod1Polygons;
+    vector<uint32_t> triangles;
+};
+
+static SparseShapeDelta denseDelta(const vector<double>& coords) {
+    const size_t count = coords.size() / 3;
+    SparseShapeDelta delta;
+    for (size_t i = 0; i < count; ++i) {
+        const double x = coords[i], y = coords[count + i];
+        delta.indices.push_back(static_cast<uint32_t>(i));
+        delta.dx.push_back(2.0 * x + 0.5);
+        delta.dy.push_back(-y);
+        delta.dz.push_back(x + y + 3.0);
+    }
+    return delta;
+}
+
+static void testParseLodMeshName() {
+    string prefix;
+    int lod = -1;
+    CF_CHECK(parseLodMeshName("head_lod3_mesh", prefix, lod) && prefix == "head" && lod == 3);
+    CF_CHECK(parseLodMeshName("eyeLeft_lod0_mesh", prefix, lod) && prefix == "eyeLeft" && lod == 0);
+    CF_CHECK(!parseLodMeshName("head_lodX_mesh", prefix, lod));
+    CF_CHECK(!parseLodMeshName("head_lod1", prefix, lod));
+    CF_CHECK(!parseLodMeshName("_lod1_mesh", prefix, lod));
+    CF_CHECK(lodMeshName("teeth", 2) == "teeth_lod2_mesh");
+}
+
+static void testLinearFieldPropagatesExactly() {
+    GridPair grids;
+    LodTransferMap map = grids.build();
+    CF_CHECK(map.lod0VertexCount() == 81 && map.lodVertexCount() == 36);
+    CF_CHECK(map.maxDistance() < 1e-12);
+
+    // 平面上的线性位移场经重心插值不变
+    SparseShapeDelta lodDelta;
+    map.propagate(denseDelta(grids.lod0), 1e-9, lodDelta);
+    CF_CHECK(lodDelta.size() == 36);
+    for (size_t k = 0; k < lodDelta.size(); ++k) {
+        const size_t i = lodDelta.indices[k];
+        const double x = grids.lod1[i], y = grids.lod1[36 + i];
+        CF_CHECK_NEAR(lodDelta.dx[k], 2.0 * x + 0.5, 1e-12);
+        CF_CHECK_NEAR(lodDelta.dy[k], -y, 1e-12);
+        CF_CHECK_NEAR(lodDelta.dz[k], x + y + 3.0, 1e-12);
+    }
+}
+
+static void testSparseGatherMatchesDenseInterpolation() {
+    GridPair grids;
+    LodTransferMap map = grids.build();
+    TriangleBvh bvh(test::spanOf(grids.lod0), grids.triangles);
+    SurfaceMapping mapping = projectToSurface(bvh, test::spanOf(grids.lod1), 1);
+
+    // lod0 上只有三个顶点有位移，其中一个低于阈值
+    SparseShapeDelta sparse;
+    sparse.indices = {10, 40, 41};
+    sparse.dx = {1.0, 0.0, 1e-8};
+    sparse.dy = {0.0, 2.0, 0.0};
+    sparse.dz = {0.5, 0.0, 0.0};
+    vector<double> dense(3 * 81, 0.0);
+    for (size_t k = 0; k < sparse.size(); ++k) {
+        dense[sparse.indices[k]] = sparse.dx[k];
+        dense[81 + sparse.indices[k]] = sparse.dy[k];
+        dense[162 + sparse.indices[k]] = sparse.dz[k];
+    }
+    vector<double> expected(3 * 36);
+    interpolateSurface(mapping, test::spanOf(dense), expected.data(), expected.data() + 36, expected.data() + 72);
+
+    const double epsilon = 1e-6;
+    SparseShapeDelta lodDelta;
+    map.propagate(sparse, epsilon, lodDelta);
+    size_t expectedCount = 0;
+    for (size_t i = 0; i < 36; ++i) {
+        const double x = expected[i], y = expected[36 + i], z = expected[72 + i];
+        expectedCount += x * x + y * y + z * z > epsilon * epsilon ? 1 : 0;
+    }
+    CF_CHECK(lodDelta.size() == expectedCount && expectedCount > 0 && expectedCount < 36);
+    for (size_t k = 0; k < lodDelta.size(); ++k) {
+        const size_t i = lodDelta.indices[k];
+        CF_CHECK(k == 0 || lodDelta.indices[k - 1] < i);
+        CF_CHECK_NEAR(lodDelta.dx[k], expected[i], 1e-12);
+        CF_CHECK_NEAR(lodDelta.dy[k], expected[36 + i], 1e-12);
+        CF_CHECK_NEAR(lodDelta.dz[k], expected[72 + i], 1e-12);
+    }
+
+    // 空的 lod0 通道传播后仍为空
+    map.propagate(SparseShapeDelta(), 0.0, lodDelta);
+    CF_CHECK(lodDelta.empty());
+}
+
+static void testWriteAndRead() {
+    filesystem::remove_all(kCacheDir);
+    filesystem::create_directories(kCacheDir);
+    GridPair grids;
+    LodTransferMap map = grids.build();
+    const uint64_t lod0Topology = GeometryCache::topologyFingerprint(grids.lod0Polygons.data(), grids.lod0Polygons.size());
+    const uint64_t lod1Topology = GeometryCache::topologyFingerprint(grids.lod1Polygons.data(), grids.lod1Polygons.size());
+    const LodTransferCache cache(kCacheDir);
+    const string path = cache.entryPath(lod0Topology, lod1Topology);
+    string error;
+    CF_CHECK(map.write(path, lod0Topology, lod1Topology, error));
+
+    LodTransferMap loaded;
+    CF_CHECK(LodTransferMap::read(path, lod0Topology, lod1Topology, loaded, error));
+    CF_CHECK(loaded.lod0VertexCount() == 81 && loaded.lodVertexCount() == 36);
+    CF_CHECK(loaded.maxDistance() == map.maxDistance());
+    SparseShapeDelta expected, actual;
+    map.propagate(denseDelta(grids.lod0), 1e-9, expected);
+    loaded.propagate(denseDelta(grids.lod0), 1e-9, actual);
+    CF_CHECK(actual.indices == expected.indices && actual.dx == expected.dx && actual.dz == expected.dz);
+
+    // 拓扑指纹不一致
+    CF_CHECK(!LodTransferMap::read(path, lod0Topology, lod1Topology + 1, loaded, error));
+    CF_CHECK(error.find("stale") != string::npos);
+
+    // 截断的文件
+    filesystem::resize_file(path, 200);
+    CF_CHECK(!LodTransferMap::read(path, lod0Topology, lod1Topology, loaded, error));
+    CF_CHECK(loaded.lodVertexCount() == 36);
+    filesystem::remove_all(kCacheDir);
+}
+
+// 代替 Maya/FBX 场景的内存宿主，记录收到的目标
+class RecordingHost : public BlendShapeHost {
+public:
+    map<string, size_t> meshes;
+    map<string, SparseShapeDelta> targets;
+    vector<pair<string, size_t>> finished;
+
+    bool beginMesh(const string& meshName, size_t& vertexCount) override {
+        auto it = meshes.find(meshName);
+        if (it == meshes.end()) {
+            return false;
+        }
+        mCurrent = meshName;
+        vertexCount = it->second;
+        return true;
+    }
+
+    bool addTarget(const string& channelName, const SparseShapeDelta& delta) override {
+        targets[channelName] = delta;
+        return true;
+    }
+
+    void endMesh(size_t targetCount) override {
+        finished.emplace_back(mCurrent, targetCount);
+    }
+
+private:
+    string mCurrent;
+};
+
+static void testPropagationHost() {
+    GridPair grids;
+    auto map = make_shared<const LodTransferMap>(grids.build());
+    LodTransferSet lods;
+    lods.transfers.push_back({"head_lod0_mesh", "head_lod1_mesh", 1, map});
+    lods.transfers.push_back({"head_lod0_mesh", "head_lod2_mesh", 2, map});
+    lods.transfers.push_back({"head_lod0_mesh", "head_lod3_mesh", 3, map});
+
+    RecordingHost host;
+    host.meshes = {{"head_lod0_mesh", 81}, {"head_lod1_mesh", 36}, {"head_lod2_mesh", 20}, {"teeth_lod0_mesh", 4}};
+
+    vector<string> warnings;
+    ScopedLogSink sink([&](LogLevel level, const string& message) {
+        if (level == LogLevel::Warning) {
+            warnings.push_back(message);
+        }
+    });
+
+    LodPropagationHost lodHost(host, lods, 1e-6, 2);
+    size_t vertexCount = 0;
+    CF_CHECK(lodHost.beginMesh("head_lod0_mesh", vertexCount) && vertexCount == 81);
+    SparseShapeDelta zero;
+    zero.indices = {5};
+    zero.dx = {1e-9};
+    zero.dy = {0.0};
+    zero.dz = {0.0};
+    CF_CHECK(lodHost.addTarget("head_lod0_meshjaw_blendshape_source_L", denseDelta(grids.lod0)));
+    CF_CHECK(lodHost.addTarget("head_lod0_meshnose_blendshape_source_L", zero));
+    lodHost.endMesh(2);
+
+    // 没有 LOD 的网格原样转交
+    CF_CHECK(lodHost.beginMesh("teeth_lod0_mesh", vertexCount) && vertexCount == 4);
+    CF_CHECK(lodHost.addTarget("teeth_lod0_meshmouth_blendshape_source_L", zero));
+    lodHost.endMesh(1);
+    CF_CHECK(!lodHost.beginMesh("eyeLeft_lod0_mesh", vertexCount));
+
+    // lod1 得到改名后的通道；lod2 顶点数与映射不符被跳过；lod3 不在宿主中
+    CF_CHECK(host.targets.count("head_lod1_meshjaw_blendshape_source_L") == 1);
+    CF_CHECK(host.targets["head_lod1_meshjaw_blendshape_source_L"].size() == 36);
+    CF_CHECK(host.targets.count("head_lod1_meshnose_blendshape_source_L") == 0);
+    CF_CHECK(host.targets.size() == 4);
+    const vector<pair<string, size_t>> finished = {
+        {"head_lod0_mesh", 2}, {"head_lod1_mesh", 1}, {"head_lod2_mesh", 0}, {"teeth_lod0_mesh", 1}};
+    CF_CHECK(host.finished == finished);
+
+    const LodPropagationStats& stats = lodHost.stats();
+    CF_CHECK(stats.meshes == 1 && stats.skippedMeshes == 2);
+    CF_CHECK(stats.channels == 1 && stats.prunedChannels == 1 && stats.points == 36);
+    CF_CHECK(warnings.size() == 1);
+}
+
+static void testLoadWithoutLods(int argc, char** argv) {
+    // resources 中的模型只含 lod0 网格
+    LodTransferSet set;
+    string error;
+    const LodTransferCache cache(kCacheDir);
+    CF_CHECK(cache.load(test::resourcePath(argc, argv, "trump.fbx"), 0, set, error));
+    CF_CHECK(set.empty() && set.built == 0 && set.cached == 0);
+    CF_CHECK(!filesystem::exists(kCacheDir));
+    CF_CHECK(!cache.load(test::resourcePath(argc, argv, "skin_weights.json"), 0, set, error));
+}
+
+int main(int argc, char** argv) {
+    testParseLodMeshName();
+    testLinearFieldPropagatesExactly();
+    testSparseGatherMatchesDenseInterpolation();
+    testWriteAndRead();
+    testPropagationHost();
+    testLoadWithoutLods(argc, argv);
+    return test::failureCount() == 0 ? 0 : 1;
+}
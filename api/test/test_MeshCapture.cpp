@@ -0,0 +1,136 @@
+#include "MeshCapture.h"
+#include "Log.h"
+#include "TestCommon.h"
+#include <map>
+
+using namespace cf;
+
+// 代替 Maya 场景的网格源，数据按名称保存在内存中
+class StandInSource : public MeshCaptureSource {
+public:
+    struct Mesh {
+        vector<float> points;
+        vector<int32_t> counts;
+        vector<int32_t> vertices;
+        MeshTransform transform;
+        string readError;
+    };
+
+    bool readMesh(const string& name, RawMesh& mesh, string& error) override {
+        ++reads;
+        auto it = meshes.find(name);
+        if (it == meshes.end()) {
+            return false;
+        }
+        const Mesh& source = it->second;
+        if (!source.readError.empty()) {
+            error = source.readError;
+            return false;
+        }
+        mesh.points = source.points.data();
+        mesh.vertexCount = source.points.size() / 3;
+        mesh.polygonCounts = source.counts.data();
+        mesh.polygonCount = source.counts.size();
+        mesh.polygonVertices = source.vertices.data();
+        mesh.polygonVertexCount = source.vertices.size();
+        mesh.transform = source.transform;
+        return true;
+    }
+
+    map<string, Mesh> meshes;
+    int reads = 0;
+};
+
+// 一个四边形加一个三角形
+static StandInSource::Mesh quadAndTriangle(float offset) {
+    StandInSource::Mesh mesh;
+    mesh.points = {offset, 0, 0, offset + 1, 0, 0, offset + 1, 1, 0, offset, 1, 0, offset + 2, 0.5f, 0};
+    mesh.counts = {4, 3};
+    mesh.vertices = {0, 1, 2, 3, 1, 4, 2};
+    return mesh;
+}
+
+static void testCaptureFromSource() {
+    StandInSource source;
+    source.meshes["head_lod0_mesh"] = quadAndTriangle(0.0f);
+    source.meshes["head_lod0_mesh"].transform.translation = {1.0, 2.0, 3.0};
+    source.meshes["head_lod0_mesh"].transform.rotation = {90.0, 0.0, 0.0};
+    source.meshes["head_lod0_mesh"].transform.rotationOrder = RotationOrder::ZXY;
+    source.meshes["teeth_lod0_mesh"] = quadAndTriangle(10.0f);
+    source.meshes["eyeLeft_lod0_mesh"] = quadAndTriangle(0.0f);
+    source.meshes["eyeLeft_lod0_mesh"].readError = "Not a mesh: eyeLeft_lod0_mesh";
+    source.meshes["saliva_lod0_mesh"] = quadAndTriangle(0.0f);
+    source.meshes["saliva_lod0_mesh"].vertices[6] = 5;
+
+    vector<string> warnings;
+    ScopedLogSink sink([&](LogLevel level, const string& message) {
+        if (level == LogLevel::Warning) {
+            warnings.push_back(message);
+        }
+    });
+
+    vector<CapturedMesh> meshes;
+    const vector<string> names = {"head_lod0_mesh", "cartilage_lod0_mesh", "eyeLeft_lod0_mesh", "saliva_lod0_mesh", "teeth_lod0_mesh"};
+    MeshCaptureStats stats = captureMeshes(source, names, meshes);
+    CF_CHECK(source.reads == 5);
+    CF_CHECK(stats.meshes == 2 && stats.missingMeshes == 1 && stats.invalidMeshes == 2);
+    CF_CHECK(stats.vertices == 10 && stats.polygons == 4);
+    CF_CHECK(warnings.size() == 3);
+
+    // 保持请求的顺序，坐标与多边形原样复制，源数组之后可以释放
+    CF_CHECK(meshes.size() == 2);
+    CF_CHECK(meshes[0].name == "head_lod0_mesh" && meshes[1].name == "teeth_lod0_mesh");
+    source.meshes.clear();
+    const CapturedMesh& head = meshes[0];
+    CF_CHECK(head.vertexCount() == 5 && head.polygonCount() == 2);
+    CF_CHECK(head.points[12] == 2.0 && head.points[13] == 0.5);
+    CF_CHECK(head.polygonCounts[0] == 4 && head.polygonVertices[6] == 2);
+    CF_CHECK(head.transform.translation[2] == 3.0 && head.transform.rotation[0] == 90.0);
+    CF_CHECK(head.transform.rotationOrder == RotationOrder::ZXY);
+    CF_CHECK(meshes[1].points[0] == 10.0 && meshes[1].transform.scale[1] == 1.0);
+}
+
+static void testRejectsInvalidTopology() {
+    StandInSource::Mesh source = quadAndTriangle(0.0f);
+    RawMesh raw;
+    raw.points = source.points.data();
+    raw.vertexCount = 5;
+    raw.polygonCounts = source.counts.data();
+    raw.polygonCount = 2;
+    raw.polygonVertices = source.vertices.data();
+    raw.polygonVertexCount = 7;
+
+    CapturedMesh mesh;
+    string error;
+    CF_CHECK(convertRawMesh("mesh", raw, mesh, error));
+
+    // 多边形顶点数之和与索引个数不一致
+    raw.polygonVertexCount = 6;
+    CF_CHECK(!convertRawMesh("mesh", raw, mesh, error));
+    CF_CHECK(error.find("expected 7") != string::npos);
+    raw.polygonVertexCount = 7;
+
+    // 少于三个顶点的多边形
+    source.counts = {4, 2, 1};
+    raw.polygonCounts = source.counts.data();
+    raw.polygonCount = 3;
+    CF_CHECK(!convertRawMesh("mesh", raw, mesh, error));
+
+    // 负索引
+    source.counts = {4, 3};
+    raw.polygonCounts = source.counts.data();
+    raw.polygonCount = 2;
+    source.vertices[0] = -1;
+    CF_CHECK(!convertRawMesh("mesh", raw, mesh, error));
+    CF_CHECK(error.find("out of range") != string::npos);
+
+    // 空网格可以转换
+    CF_CHECK(convertRawMesh("empty", RawMesh(), mesh, error));
+    CF_CHECK(mesh.vertexCount() == 0 && mesh.polygonCount() == 0);
+}
+
+int main() {
+    testCaptureFromSource();
+    testRejectsInvalidTopology();
+    return test::failureCount() == 0 ? 0 : 1;
+}
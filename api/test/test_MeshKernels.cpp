@@ -0,0 +1,180 @@
+#include "BlendShapePipeline.h"
+#include "MeshKernels.h"
+#include "TestCommon.h"
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <random>
+
+using namespace cf;
+
+// 两个 double 之间相差的 ULP 数，符号相同时按位序比较
+static uint64_t ulpDistance(double a, double b) {
+    int64_t ia, ib;
+    memcpy(&ia, &a, sizeof(a));
+    memcpy(&ib, &b, sizeof(b));
+    if (ia < 0) ia = INT64_MIN - ia;
+    if (ib < 0) ib = INT64_MIN - ib;
+    return ia > ib ? static_cast<uint64_t>(ia - ib) : static_cast<uint64_t>(ib - ia);
+}
+
+static void fillRandom(vector<double>& values, mt19937_64& rng) {
+    uniform_real_distribution<double> dist(-50.0, 50.0);
+    for (double& v : values) {
+        v = dist(rng);
+    }
+}
+
+// 不使用 FMA、累加顺序与标量实现相同，因此允许的 ULP 差为 0
+static const uint64_t kMaxUlp = 0;
+
+static void testTransformMatchesReference(KernelIsa isa) {
+    mt19937_64 rng(1234);
+    const array<array<double, 4>, 4> transform = {{
+        {0.98, -0.17, 0.05, 1.25},
+        {0.17, 0.97, -0.12, -3.5},
+        {-0.03, 0.13, 0.99, 0.75},
+        {0.0, 0.0, 0.0, 1.0}
+    }};
+
+    // 长度覆盖向量宽度的整数倍与余数，起始偏移 1 使数据不对齐
+    for (size_t count : {size_t(0), size_t(1), size_t(3), size_t(4), size_t(7), size_t(1001)}) {
+        vector<double> x(count + 1), y(count + 1), z(count + 1);
+        fillRandom(x, rng);
+        fillRandom(y, rng);
+        fillRandom(z, rng);
+        vector<double> tx = x, ty = y, tz = z;
+
+        transformPoints(transform, tx.data() + 1, ty.data() + 1, tz.data() + 1, count);
+
+        uint64_t maxUlp = 0;
+        for (size_t k = 1; k <= count; ++k) {
+            array<double, 3> expected = BlendShapePipeline::applyTransformation({x[k], y[k], z[k]}, transform);
+            maxUlp = max(maxUlp, ulpDistance(expected[0], tx[k]));
+            maxUlp = max(maxUlp, ulpDistance(expected[1], ty[k]));
+            maxUlp = max(maxUlp, ulpDistance(expected[2], tz[k]));
+        }
+        if (maxUlp > kMaxUlp) {
+            fprintf(stderr, "%s transform, count %zu: max ulp %llu\n", kernelIsaName(isa), count, static_cast<unsigned long long>(maxUlp));
+        }
+        CF_CHECK(maxUlp <= kMaxUlp);
+        // 范围外的元素不被修改
+        CF_CHECK(tx[0] == x[0] && ty[0] == y[0] && tz[0] == z[0]);
+    }
+}
+
+static void testSubtractMatchesReference(KernelIsa isa) {
+    mt19937_64 rng(99);
+    for (size_t count : {size_t(0), size_t(2), size_t(5), size_t(33), size_t(1000)}) {
+        vector<double> a(count * 3 + 1), b(count * 3 + 1);
+        fillRandom(a, rng);
+        fillRandom(b, rng);
+        vector<double> out(count * 3, 0.0);
+
+        const double* ax = a.data() + 1;
+        const double* bx = b.data() + 1;
+        subtractPoints(ax, ax + count, ax + 2 * count, bx, bx + count, bx + 2 * count,
+                       out.data(), out.data() + count, out.data() + 2 * count, count);
+        bool equal = true;
+        for (size_t k = 0; k < count * 3; ++k) {
+            equal = equal && ulpDistance(out[k], ax[k] - bx[k]) <= kMaxUlp;
+        }
+        if (!equal) {
+            fprintf(stderr, "%s subtract, count %zu differs\n", kernelIsaName(isa), count);
+        }
+        CF_CHECK(equal);
+
+        // 输出与输入为同一数组
+        vector<double> inPlace(a.begin() + 1, a.end());
+        subtractPoints(inPlace.data(), inPlace.data() + count, inPlace.data() + 2 * count, bx, bx + count, bx + 2 * count,
+                       inPlace.data(), inPlace.data() + count, inPlace.data() + 2 * count, count);
+        CF_CHECK(inPlace == out);
+    }
+}
+
+// 单精度内核：各实现与按同样顺序计算的 float 参考逐位一致，与双精度结果之差不超过舍入误差的上界
+static void testFloatKernels(KernelIsa isa) {
+    mt19937_64 rng(4321);
+    const array<array<double, 4>, 4> transform = {{
+        {1.02, -0.17, 0.05, 1.25},
+        {0.17, 0.99, -0.12, -3.5},
+        {-0.03, 0.13, 1.01, 0.75},
+        {0.0, 0.0, 0.0, 1.0}
+    }};
+    const array<double, 3> offset = {0.125, -0.5, 0.0625};
+    array<array<float, 4>, 4> m;
+    for (int i = 0; i < 4; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            m[i][j] = static_cast<float>(transform[i][j]);
+        }
+    }
+
+    for (size_t count : {size_t(0), size_t(1), size_t(7), size_t(8), size_t(9), size_t(1003)}) {
+        vector<double> values(6 * count + 1);
+        fillRandom(values, rng);
+        vector<float> floats(values.begin(), values.end());
+        const float* x = floats.data() + 1;
+        const float* b = x + 3 * count;
+        vector<float> out(3 * count), gap(3 * count);
+        transformPoints(transform, x, x + count, x + 2 * count, out.data(), out.data() + count, out.data() + 2 * count, count);
+        transformedGap(transform, offset, b, b + count, b + 2 * count, x, x + count, x + 2 * count,
+                       gap.data(), gap.data() + count, gap.data() + 2 * count, count);
+
+        bool exact = true;
+        double maxRelative = 0.0;
+        for (size_t k = 0; k < count; ++k) {
+            const float p[3] = {x[k], x[count + k], x[2 * count + k]};
+            for (int axis = 0; axis < 3; ++axis) {
+                float r = m[axis][3];
+                r += m[axis][0] * p[0];
+                r += m[axis][1] * p[1];
+                r += m[axis][2] * p[2];
+                const float g = b[axis * count + k] - (r - static_cast<float>(offset[axis]));
+                exact = exact && out[axis * count + k] == r && gap[axis * count + k] == g;
+
+                // 相对参与运算的各项量级衡量误差
+                double reference = transform[axis][3];
+                double magnitude = fabs(transform[axis][3]);
+                for (int j = 0; j < 3; ++j) {
+                    reference += transform[axis][j] * p[j];
+                    magnitude += fabs(transform[axis][j] * p[j]);
+                }
+                const double referenceGap = b[axis * count + k] - (reference - offset[axis]);
+                maxRelative = max(maxRelative, fabs(r - reference) / magnitude);
+                maxRelative = max(maxRelative, fabs(g - referenceGap) / (magnitude + fabs(b[axis * count + k]) + fabs(offset[axis])));
+            }
+        }
+        if (!exact) {
+            fprintf(stderr, "%s float kernels, count %zu differ from the scalar reference\n", kernelIsaName(isa), count);
+        }
+        CF_CHECK(exact);
+        CF_CHECK(maxRelative <= 8.0 * FLT_EPSILON);
+
+        vector<float> difference(3 * count);
+        subtractPoints(b, b + count, b + 2 * count, x, x + count, x + 2 * count,
+                       difference.data(), difference.data() + count, difference.data() + 2 * count, count);
+        bool subtracted = true;
+        for (size_t k = 0; k < 3 * count; ++k) {
+            subtracted = subtracted && difference[k] == b[k] - x[k];
+        }
+        CF_CHECK(subtracted);
+    }
+}
+
+int main() {
+    const KernelIsa detected = detectKernelIsa();
+    printf("Detected kernels: %s\n", kernelIsaName(detected));
+    CF_CHECK(activeKernelIsa() == detected);
+
+    for (KernelIsa isa : {KernelIsa::Scalar, KernelIsa::Sse2, KernelIsa::Avx2}) {
+        KernelIsa active = setKernelIsa(isa);
+        CF_CHECK(activeKernelIsa() == active);
+        CF_CHECK(static_cast<int>(active) <= static_cast<int>(isa));
+        testTransformMatchesReference(active);
+        testSubtractMatchesReference(active);
+        testFloatKernels(active);
+    }
+    setKernelIsa(detected);
+    return test::failureCount() == 0 ? 0 : 1;
+}
@@ -0,0 +1,100 @@
+#include "MeshSet.h"
+#include "TestCommon.h"
+
+using namespace cf;
+
+static void testInternedNames() {
+    MeshNameId head = internMeshName("head_lod0_mesh");
+    CF_CHECK(internMeshName("head_lod0_mesh") == head);
+    CF_CHECK(findMeshName("head_lod0_mesh") == head);
+    CF_CHECK(findMeshName("never_interned_mesh") == kInvalidMeshName);
+    CF_CHECK(meshNameOf(head) == "head_lod0_mesh");
+}
+
+static void testContiguousLayout() {
+    MeshSet meshes;
+    size_t head = meshes.addMesh("head_lod0_mesh", 4);
+    size_t teeth = meshes.addMesh("teeth_lod0_mesh", 2);
+    CF_CHECK(meshes.meshCount() == 2);
+    CF_CHECK(meshes.vertexCount() == 6);
+    CF_CHECK(meshes.range(teeth).offset == 4);
+    CF_CHECK(meshes.find("teeth_lod0_mesh") == static_cast<int>(teeth));
+    CF_CHECK(meshes.find("missing_lod0_mesh") == -1);
+
+    const double headXyz[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+    meshes.setInterleaved(head, headXyz);
+    meshes.setVertex(teeth, 1, {20, 21, 22});
+
+    // 每个分量在整块缓冲中连续存放
+    CF_CHECK(meshes.x(head) == meshes.xData());
+    CF_CHECK(meshes.xData()[3] == 9 && meshes.yData()[3] == 10 && meshes.zData()[3] == 11);
+    CF_CHECK(meshes.xData()[5] == 20);
+    CF_CHECK(meshes.vertex(head, 1) == (array<double, 3>{3, 4, 5}));
+
+    vector<array<double, 3>> teethVertices = meshes.vertices(teeth);
+    CF_CHECK(teethVertices.size() == 2);
+    CF_CHECK(teethVertices[1] == (array<double, 3>{20, 21, 22}));
+}
+
+static void testGrowthKeepsData() {
+    MeshSet meshes;
+    for (int m = 0; m < 20; ++m) {
+        size_t slot = meshes.addMesh("grow_mesh_" + to_string(m), 100 + m);
+        for (size_t i = 0; i < meshes.vertexCount(slot); ++i) {
+            meshes.setVertex(slot, i, {double(m), double(i), -double(i)});
+        }
+    }
+    for (int m = 0; m < 20; ++m) {
+        int slot = meshes.find("grow_mesh_" + to_string(m));
+        CF_CHECK(slot == m);
+        CF_CHECK(meshes.vertex(slot, 99) == (array<double, 3>{double(m), 99, -99}));
+    }
+}
+
+static void testReplaceMesh() {
+    MeshSet meshes;
+    meshes.addMesh("a_mesh", 3);
+    meshes.addMesh("b_mesh", 2);
+    meshes.setVertex(1, 1, {7, 8, 9});
+
+    size_t slot = meshes.addMesh("a_mesh", 5);
+    CF_CHECK(meshes.meshCount() == 2);
+    CF_CHECK(meshes.vertexCount() == 7);
+    CF_CHECK(meshes.vertexCount(slot) == 5);
+    CF_CHECK(meshes.vertex(meshes.find("b_mesh"), 1) == (array<double, 3>{7, 8, 9}));
+}
+
+static void testPrecisionConversion() {
+    MeshSet meshes;
+    meshes.addMesh("a_mesh", 3);
+    size_t b = meshes.addMesh("b_mesh", 2);
+    auto topology = make_shared<MeshTopology>();
+    topology->fingerprint = 42;
+    meshes.setTopology(b, topology);
+    meshes.setVertex(b, 1, {0.1, -2.5, 1e6 + 0.3});
+
+    MeshSetF single(meshes);
+    CF_CHECK(single.meshCount() == 2 && single.vertexCount() == 5);
+    CF_CHECK(single.find("b_mesh") == static_cast<int>(b));
+    CF_CHECK(single.topology(b) == topology.get());
+    CF_CHECK(single.y(b)[1] == -2.5f);
+    CF_CHECK(single.x(b)[1] == static_cast<float>(0.1) && single.z(b)[1] == static_cast<float>(1e6 + 0.3));
+    CF_CHECK(single.coordinateBytes() * 2 == meshes.coordinateBytes());
+
+    // 转换后的网格可以继续追加
+    size_t c = single.addMesh("c_mesh", 4);
+    single.setVertex(c, 3, {1, 2, 3});
+    CF_CHECK(single.vertex(b, 1)[1] == -2.5 && single.vertex(c, 3) == (array<double, 3>{1, 2, 3}));
+
+    MeshSet back(single);
+    CF_CHECK(back.meshCount() == 3 && back.vertex(b, 1)[0] == static_cast<double>(static_cast<float>(0.1)));
+}
+
+int main() {
+    testInternedNames();
+    testContiguousLayout();
+    testGrowthKeepsData();
+    testReplaceMesh();
+    testPrecisionConversion();
+    return test::failureCount() == 0 ? 0 : 1;
+}
@@ -0,0 +1,266 @@
+#include "PipelineJob.h"
+#include "BlendShapePipeline.h"
+#include "TestCommon.h"
+#include <future>
+#include <thread>
+
+using namespace cf;
+
+namespace {
+
+// 代替 Maya 场景的宿主：只允许在主线程上修改
+struct StandInScene {
+    thread::id mainThread = this_thread::get_id();
+    vector<string> edits;
+    bool editedOffThread = false;
+
+    void edit(const string& name) {
+        editedOffThread = editedOffThread || this_thread::get_id() != mainThread;
+        edits.push_back(name);
+    }
+};
+
+class CountingHost : public BlendShapeHost {
+public:
+    size_t targets = 0;
+
+    bool beginMesh(const string& meshName, size_t& vertexCount) override {
+        (void)meshName;
+        vertexCount = 1u << 20;
+        return true;
+    }
+    bool addTarget(const string& channelName, const SparseShapeDelta& delta) override {
+        (void)channelName;
+        (void)delta;
+        ++targets;
+        return true;
+    }
+    void endMesh(size_t targetCount) override { (void)targetCount; }
+};
+
+}
+
+static void testProgressAndFinalize() {
+    const thread::id caller = this_thread::get_id();
+    vector<string> messages;
+    bool loggedOffThread = false;
+    ScopedLogSink sink([&](LogLevel, const string& message) {
+        loggedOffThread = loggedOffThread || this_thread::get_id() != caller;
+        messages.push_back(message);
+    });
+
+    PipelineJobEngine engine;
+    atomic<size_t> notified(0);
+    engine.setCompletionNotifier([&]() { ++notified; });
+
+    StandInScene scene;
+    promise<void> loaded;
+    promise<void> release;
+    shared_future<void> released = release.get_future().share();
+    JobState finishedWith = JobState::Running;
+    const uint64_t id = engine.submit(
+        [&](JobProgress& progress) {
+            progress.beginStage("load", 0.0, 0.5, 4);
+            for (int i = 0; i < 3; ++i) {
+                logInfo("loaded " + to_string(i));
+                progress.advance();
+            }
+            loaded.set_value();
+            released.wait();
+            progress.advance();
+            progress.beginStage("evaluate", 0.5, 1.0);
+            return true;
+        },
+        [&](JobState outcome) {
+            finishedWith = outcome;
+            scene.edit("blendShape");
+        });
+    CF_CHECK(id == 1);
+
+    // 提交后立即返回，进度可在 work 运行期间查询
+    loaded.get_future().wait();
+    JobStatus status;
+    CF_CHECK(engine.status(id, status));
+    CF_CHECK(status.state == JobState::Running);
+    CF_CHECK(status.progress.stage == "load");
+    CF_CHECK(status.progress.stepsDone == 3);
+    CF_CHECK(status.progress.stepCount == 4);
+    CF_CHECK_NEAR(status.progress.fraction, 0.375, 1e-12);
+    CF_CHECK(status.progress.etaSeconds >= 0.0);
+    CF_CHECK(engine.activeCount() == 1);
+    CF_CHECK(engine.runPendingFinalizers() == 0);
+
+    release.set_value();
+    engine.waitForWork(id);
+    CF_CHECK(engine.status(id, status));
+    CF_CHECK(status.state == JobState::Finishing);
+    CF_CHECK(notified == 1);
+    // work 结束后场景仍未修改，日志也还没有输出
+    CF_CHECK(scene.edits.empty());
+    CF_CHECK(messages.empty());
+
+    CF_CHECK(engine.runPendingFinalizers() == 1);
+    CF_CHECK(finishedWith == JobState::Succeeded);
+    CF_CHECK(scene.edits.size() == 1);
+    CF_CHECK(!scene.editedOffThread);
+    CF_CHECK(messages.size() == 3 && messages[0] == "loaded 0" && messages[2] == "loaded 2");
+    CF_CHECK(!loggedOffThread);
+
+    CF_CHECK(engine.status(id, status));
+    CF_CHECK(status.state == JobState::Succeeded);
+    CF_CHECK(status.progress.stage == "done");
+    CF_CHECK_NEAR(status.progress.fraction, 1.0, 0.0);
+    CF_CHECK_NEAR(status.progress.etaSeconds, 0.0, 0.0);
+    CF_CHECK(engine.activeCount() == 0);
+    CF_CHECK(engine.runPendingFinalizers() == 0);
+    CF_CHECK(!engine.status(id + 1, status));
+}
+
+static void testCooperativeCancel() {
+    ScopedLogSink quiet([](LogLevel, const string&) {});
+    PipelineJobEngine engine;
+    StandInScene scene;
+
+    // work 在阶段之间检查取消标志，取消后的任务仍会收尾，但不修改场景
+    promise<void> started;
+    promise<void> release;
+    shared_future<void> released = release.get_future().share();
+    int stagesRun = 0;
+    JobState finishedWith = JobState::Running;
+    const uint64_t id = engine.submit(
+        [&](JobProgress& progress) {
+            const char* stages[] = {"load", "register", "evaluate", "export"};
+            for (int s = 0; s < 4; ++s) {
+                if (progress.cancelled()) {
+                    return false;
+                }
+                progress.beginStage(stages[s], s * 0.25, (s + 1) * 0.25);
+                ++stagesRun;
+                if (s == 0) {
+                    started.set_value();
+                    released.wait();
+                }
+            }
+            return true;
+        },
+        [&](JobState outcome) {
+            finishedWith = outcome;
+            if (outcome == JobState::Succeeded) {
+                scene.edit("blendShape");
+            }
+        });
+
+    started.get_future().wait();
+    CF_CHECK(engine.cancel(id));
+    release.set_value();
+    engine.waitForWork(id);
+    CF_CHECK(stagesRun == 1);
+    CF_CHECK(engine.runPendingFinalizers() == 1);
+    CF_CHECK(finishedWith == JobState::Cancelled);
+    CF_CHECK(scene.edits.empty());
+    JobStatus status;
+    CF_CHECK(engine.status(id, status) && status.state == JobState::Cancelled);
+    CF_CHECK(!engine.cancel(id));
+    CF_CHECK(!engine.cancel(id + 100));
+
+    // work 结束后、收尾前取消：仍然得到 Cancelled
+    const uint64_t late = engine.submit([](JobProgress&) { return true; }, [&](JobState outcome) { finishedWith = outcome; });
+    engine.waitForWork(late);
+    CF_CHECK(engine.cancel(late));
+    CF_CHECK(engine.runPendingFinalizers() == 1);
+    CF_CHECK(finishedWith == JobState::Cancelled);
+
+    // 失败与异常
+    const uint64_t failing = engine.submit([](JobProgress&) { return false; }, [&](JobState outcome) { finishedWith = outcome; });
+    engine.waitForWork(failing);
+    engine.runPendingFinalizers();
+    CF_CHECK(finishedWith == JobState::Failed);
+    const uint64_t throwing = engine.submit([](JobProgress&) -> bool { throw runtime_error("boom"); }, [&](JobState outcome) { finishedWith = outcome; });
+    engine.waitForWork(throwing);
+    engine.runPendingFinalizers();
+    CF_CHECK(finishedWith == JobState::Failed);
+
+    // 关闭时取消仍在运行的任务并等待线程结束，不再收尾
+    bool finishCalled = false;
+    const uint64_t blocked = engine.submit(
+        [](JobProgress& progress) {
+            while (!progress.cancelled()) {
+                this_thread::sleep_for(chrono::milliseconds(1));
+            }
+            return false;
+        },
+        [&](JobState) { finishCalled = true; });
+    engine.shutdown();
+    CF_CHECK(!finishCalled);
+    CF_CHECK(engine.status(blocked, status) && status.state == JobState::Cancelled);
+    CF_CHECK(engine.activeCount() == 0);
+}
+
+static void testPipelineJobOnResources(int argc, char** argv) {
+    const vector<string> files = {test::resourcePath(argc, argv, "trump.fbx"), test::resourcePath(argc, argv, "bigear.fbx"),
+                                  test::resourcePath(argc, argv, "cooper.fbx"), test::resourcePath(argc, argv, "farrukh.fbx")};
+    const string weights = test::resourcePath(argc, argv, "skin_weights.json");
+    ScopedLogSink quiet([](LogLevel, const string&) {});
+    PipelineOptions options;
+    options.weightCachePath = "test_pipeline_job.cfw";
+    options.workerCount = 2;
+
+    CountingHost direct;
+    CF_CHECK(BlendShapePipeline(options).run(files, weights, direct));
+
+    // prepare 在后台线程上执行，build 在收尾时交给主线程上的宿主
+    PipelineJobEngine engine;
+    BlendShapePipeline pipeline(options);
+    PipelineResult result;
+    CountingHost host;
+    JobProgressSnapshot afterPrepare;
+    const uint64_t id = engine.submit(
+        [&](JobProgress& progress) {
+            pipeline.setProgress(&progress);
+            bool prepared = pipeline.prepare(files, weights, result);
+            afterPrepare = progress.snapshot();
+            return prepared;
+        },
+        [&](JobState outcome) {
+            if (outcome == JobState::Succeeded) {
+                pipeline.build(result, host);
+            }
+        });
+    engine.waitForWork(id);
+    CF_CHECK(afterPrepare.stage == "prepared");
+    CF_CHECK_NEAR(afterPrepare.fraction, BlendShapePipeline::kPrepareProgressEnd, 1e-12);
+    CF_CHECK(engine.runPendingFinalizers() == 1);
+    CF_CHECK(host.targets > 0);
+    CF_CHECK(host.targets == direct.targets);
+
+    // 读取阶段按文件报告进度
+    JobProgress loadProgress;
+    BlendShapePipeline counted(options);
+    counted.setProgress(&loadProgress);
+    counted.loadFbxFiles(files);
+    JobProgressSnapshot snapshot = loadProgress.snapshot();
+    CF_CHECK(snapshot.stepsDone == 0);
+    loadProgress.beginStage("load", 0.0, 0.5, files.size());
+    counted.loadFbxFiles(files);
+    snapshot = loadProgress.snapshot();
+    CF_CHECK(snapshot.stepsDone == files.size());
+    CF_CHECK_NEAR(snapshot.fraction, 0.5, 1e-12);
+
+    // 已取消时 prepare 与 prepareBatch 在第一个阶段之前返回
+    JobProgress cancelled;
+    cancelled.cancel();
+    BlendShapePipeline stopped(options);
+    stopped.setProgress(&cancelled);
+    PipelineResult unused;
+    CF_CHECK(!stopped.prepare(files, weights, unused));
+    vector<BatchResult> batch = stopped.prepareBatch({files[0], files[1]}, {files[2], files[3]}, weights);
+    CF_CHECK(batch.size() == 2 && !batch[0].prepared && !batch[1].prepared);
+    CF_CHECK(cancelled.snapshot().stage.empty());
+}
+
+int main(int argc, char** argv) {
+    testProgressAndFinalize();
+    testCooperativeCancel();
+    testPipelineJobOnResources(argc, argv);
+    return test::failureCount() == 0 ? 0 : 1;
+}
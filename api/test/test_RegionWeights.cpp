@@ -0,0 +1,157 @@
+#include "RegionWeights.h"
+#include "TestCommon.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+using namespace cf;
+
+static void testCompileSmallJson() {
+    nlohmann::json j = nlohmann::json::parse(R"({
+        "head_lod0_mesh": {
+            "eyes_blendshape": {"10": 1.0, "2": 0.5, "7": 0.0, "bad": 1.0},
+            "nose_blendshape": {"3": 0.25}
+        },
+        "teeth_lod0_mesh": {
+            "mouth_blendshape": {"0": 1.0}
+        }
+    })");
+
+    RegionWeightMap weights = RegionWeightMap::compile(j);
+    CF_CHECK(weights.meshCount() == 2);
+    CF_CHECK(weights.regionCount() == 3);
+    CF_CHECK(weights.totalNonZeroCount() == 4);
+
+    int head = weights.findMesh(internMeshName("head_lod0_mesh"));
+    CF_CHECK(head == 0);
+    CF_CHECK(weights.mesh(head).regionCount == 2);
+    CF_CHECK(weights.findMesh(internMeshName("eyeLeft_lod0_mesh")) == -1);
+
+    // 零权重与非数字索引被剔除，索引按数值升序（而非JSON键的字符串顺序）
+    const WeightRegion& eyes = weights.region(0);
+    CF_CHECK(eyes.regionName == "eyes_blendshape");
+    CF_CHECK(weights.nonZeroCount(0) == 2);
+    CF_CHECK(weights.indices(0)[0] == 2 && weights.indices(0)[1] == 10);
+    CF_CHECK(weights.weights(0)[0] == 0.5f && weights.weights(0)[1] == 1.0f);
+
+    CF_CHECK(weights.region(2).mesh == internMeshName("teeth_lod0_mesh"));
+    CF_CHECK(weights.indices(2)[0] == 0);
+}
+
+static void testCompileSkinWeights(const string& path) {
+    ifstream file(path);
+    nlohmann::json j = nlohmann::json::parse(file);
+    RegionWeightMap weights = RegionWeightMap::compile(j);
+
+    CF_CHECK(weights.meshCount() == 9);
+    int head = weights.findMesh(internMeshName("head_lod0_mesh"));
+    CF_CHECK(head >= 0 && weights.mesh(head).regionCount == 11);
+
+    size_t expectedNonZero = 0;
+    for (auto& [meshName, regions] : j.items()) {
+        for (auto& [regionName, entries] : regions.items()) {
+            for (auto& [index, weight] : entries.items()) {
+                expectedNonZero += weight.get<double>() != 0.0 ? 1 : 0;
+            }
+        }
+    }
+    CF_CHECK(weights.totalNonZeroCount() == expectedNonZero);
+
+    for (size_t r = 0; r < weights.regionCount(); ++r) {
+        for (size_t k = 1; k < weights.nonZeroCount(r); ++k) {
+            CF_CHECK(weights.indices(r)[k - 1] < weights.indices(r)[k]);
+        }
+    }
+}
+
+static bool sameWeights(const RegionWeightMap& a, const RegionWeightMap& b) {
+    if (a.meshCount() != b.meshCount() || a.regionCount() != b.regionCount() || a.totalNonZeroCount() != b.totalNonZeroCount()) {
+        return false;
+    }
+    for (size_t m = 0; m < a.meshCount(); ++m) {
+        if (a.mesh(m).mesh != b.mesh(m).mesh || a.mesh(m).firstRegion != b.mesh(m).firstRegion || a.mesh(m).regionCount != b.mesh(m).regionCount) {
+            return false;
+        }
+    }
+    for (size_t r = 0; r < a.regionCount(); ++r) {
+        if (a.region(r).mesh != b.region(r).mesh || a.region(r).regionName != b.region(r).regionName || a.nonZeroCount(r) != b.nonZeroCount(r)) {
+            return false;
+        }
+        for (size_t k = 0; k < a.nonZeroCount(r); ++k) {
+            if (a.indices(r)[k] != b.indices(r)[k] || a.weights(r)[k] != b.weights(r)[k]) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static void writeText(const string& path, const string& text) {
+    ofstream file(path, ios::binary | ios::trunc);
+    file << text;
+}
+
+// 缓存写在测试工作目录中，不修改资源目录
+static void testWeightCache(const string& resourceJson) {
+    ifstream source(resourceJson, ios::binary);
+    stringstream content;
+    content << source.rdbuf();
+    const string text = content.str();
+    const RegionWeightMap expected = RegionWeightMap::compile(nlohmann::json::parse(text));
+
+    const string jsonPath = "test_weight_cache.json";
+    const string cachePath = RegionWeightMap::defaultCachePath(jsonPath);
+    writeText(jsonPath, text);
+    remove(cachePath.c_str());
+
+    // 首次加载：解析JSON并写出缓存
+    RegionWeightMap first;
+    RegionWeightLoadInfo info;
+    string error;
+    CF_CHECK(RegionWeightMap::load(jsonPath, first, error, string(), &info));
+    CF_CHECK(!info.fromCache && info.cacheWritten);
+    CF_CHECK(!first.isMapped());
+    CF_CHECK(sameWeights(first, expected));
+
+    // 再次加载：直接映射缓存，结果逐位一致
+    RegionWeightMap second;
+    CF_CHECK(RegionWeightMap::load(jsonPath, second, error, string(), &info));
+    CF_CHECK(info.fromCache && second.isMapped());
+    CF_CHECK(sameWeights(second, expected));
+
+    // 拷贝共享映射，原对象析构后仍然有效
+    RegionWeightMap copy;
+    {
+        RegionWeightMap mapped;
+        CF_CHECK(RegionWeightMap::load(jsonPath, mapped, error));
+        copy = mapped;
+    }
+    CF_CHECK(sameWeights(copy, expected));
+
+    // JSON 内容改变：哈希不一致，缓存失效并重建
+    writeText(jsonPath, R"({"head_lod0_mesh": {"eyes_blendshape": {"5": 0.5, "1": 1.0}}})");
+    RegionWeightMap changed;
+    CF_CHECK(RegionWeightMap::load(jsonPath, changed, error, string(), &info));
+    CF_CHECK(!info.fromCache && info.cacheWritten);
+    CF_CHECK(changed.regionCount() == 1 && changed.totalNonZeroCount() == 2);
+    CF_CHECK(RegionWeightMap::load(jsonPath, changed, error, string(), &info));
+    CF_CHECK(info.fromCache && changed.indices(0)[0] == 1 && changed.weights(0)[1] == 0.5f);
+
+    // 损坏的缓存被拒绝，回退到解析JSON
+    writeText(cachePath, "CFWEIGHT");
+    CF_CHECK(RegionWeightMap::load(jsonPath, changed, error, string(), &info));
+    CF_CHECK(!info.fromCache && changed.totalNonZeroCount() == 2);
+
+    RegionWeightMap missing;
+    CF_CHECK(!RegionWeightMap::load("test_weight_cache_missing.json", missing, error));
+
+    remove(jsonPath.c_str());
+    remove(cachePath.c_str());
+}
+
+int main(int argc, char** argv) {
+    testCompileSmallJson();
+    testCompileSkinWeights(test::resourcePath(argc, argv, "skin_weights.json"));
+    testWeightCache(test::resourcePath(argc, argv, "skin_weights.json"));
+    return test::failureCount() == 0 ? 0 : 1;
+}
@@ -0,0 +1,186 @@
+#include "Registration.h"
+#include "FbxBinaryReader.h"
+#include "TestCommon.h"
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+using namespace cf;
+
+namespace {
+
+struct Points {
+    vector<double> x, y, z;
+    PointSpan span() const { return {x.data(), y.data(), z.data(), x.size()}; }
+};
+
+// 固定种子的线性同余生成器，保证测试数据可重复
+double nextRandom(uint64_t& state) {
+    state = state * 6364136223846793005ull + 1442695040888963407ull;
+    return static_cast<double>(state >> 11) / static_cast<double>(1ull << 53) * 2.0 - 1.0;
+}
+
+Points randomPoints(size_t count, uint64_t seed) {
+    Points p;
+    for (size_t i = 0; i < count; ++i) {
+        p.x.push_back(nextRandom(seed) * 10.0);
+        p.y.push_back(nextRandom(seed) * 20.0);
+        p.z.push_back(nextRandom(seed) * 5.0);
+    }
+    return p;
+}
+
+Points transformPoints(const Points& p, const array<array<double, 4>, 4>& m) {
+    Points out;
+    for (size_t i = 0; i < p.x.size(); ++i) {
+        out.x.push_back(m[0][0] * p.x[i] + m[0][1] * p.y[i] + m[0][2] * p.z[i] + m[0][3]);
+        out.y.push_back(m[1][0] * p.x[i] + m[1][1] * p.y[i] + m[1][2] * p.z[i] + m[1][3]);
+        out.z.push_back(m[2][0] * p.x[i] + m[2][1] * p.y[i] + m[2][2] * p.z[i] + m[2][3]);
+    }
+    return out;
+}
+
+// 绕任意轴旋转 + 均匀缩放 + 平移
+array<array<double, 4>, 4> makeSimilarity(double scale, double angle, array<double, 3> axis, array<double, 3> t) {
+    double len = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+    double x = axis[0] / len, y = axis[1] / len, z = axis[2] / len;
+    double c = std::cos(angle), s = std::sin(angle), C = 1.0 - c;
+    double r[3][3] = {
+        {x * x * C + c, x * y * C - z * s, x * z * C + y * s},
+        {y * x * C + z * s, y * y * C + c, y * z * C - x * s},
+        {z * x * C - y * s, z * y * C + x * s, z * z * C + c}};
+    array<array<double, 4>, 4> m = {};
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) m[i][j] = scale * r[i][j];
+        m[i][3] = t[i];
+    }
+    m[3][3] = 1.0;
+    return m;
+}
+
+void checkMatrixNear(const array<array<double, 4>, 4>& a, const array<array<double, 4>, 4>& b, double tol) {
+    for (int i = 0; i < 4; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            CF_CHECK_NEAR(a[i][j], b[i][j], tol);
+        }
+    }
+}
+
+}
+
+static void testSvdReconstructs() {
+    array<array<double, 3>, 3> a = {{{2.0, -1.0, 0.5}, {0.3, 4.0, -2.0}, {1.0, 1.0, 1.0}}};
+    array<array<double, 3>, 3> u, v;
+    array<double, 3> s;
+    singularValueDecomposition3x3(a, u, s, v);
+    CF_CHECK(s[0] >= s[1] && s[1] >= s[2] && s[2] >= 0.0);
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            double value = 0.0;
+            for (int k = 0; k < 3; ++k) value += u[i][k] * s[k] * v[j][k];
+            CF_CHECK_NEAR(value, a[i][j], 1e-12);
+        }
+    }
+}
+
+static void testRecoversSimilarity() {
+    Points from = randomPoints(1000, 42);
+    auto expected = makeSimilarity(1.37, 0.6, {0.2, 1.0, -0.4}, {3.0, -7.5, 12.0});
+    Points to = transformPoints(from, expected);
+
+    SimilarityTransform result = solveSimilarity(from.span(), to.span());
+    CF_CHECK(result.valid);
+    CF_CHECK_NEAR(result.scale, 1.37, 1e-10);
+    CF_CHECK(result.rmsError < 1e-9);
+    checkMatrixNear(result.matrix, expected, 1e-9);
+
+    // 结果只依赖输入，重复求解必须逐位一致
+    SimilarityTransform again = solveSimilarity(from.span(), to.span());
+    CF_CHECK(again.matrix == result.matrix);
+}
+
+static void testRejectsReflection() {
+    Points from = randomPoints(500, 7);
+    Points to = from;
+    for (double& v : to.x) v = -v;  // 镜像数据，最优解不能是反射
+
+    SimilarityTransform result = solveSimilarity(from.span(), to.span());
+    CF_CHECK(result.valid);
+    array<array<double, 3>, 3> r;
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j) r[i][j] = result.matrix[i][j] / result.scale;
+    double det = r[0][0] * (r[1][1] * r[2][2] - r[1][2] * r[2][1]) - r[0][1] * (r[1][0] * r[2][2] - r[1][2] * r[2][0]) + r[0][2] * (r[1][0] * r[2][1] - r[1][1] * r[2][0]);
+    CF_CHECK_NEAR(det, 1.0, 1e-9);
+}
+
+static void testRobustReweighting() {
+    Points from = randomPoints(2000, 99);
+    auto expected = makeSimilarity(0.9, -0.3, {1.0, 0.0, 0.5}, {1.0, 2.0, 3.0});
+    Points to = transformPoints(from, expected);
+    for (size_t i = 0; i < to.x.size(); i += 20) {
+        to.x[i] += 25.0;  // 5% 离群点
+    }
+
+    SimilarityOptions plain;
+    SimilarityOptions robust;
+    robust.robustIterations = 10;
+    SimilarityTransform a = solveSimilarity(from.span(), to.span(), plain);
+    SimilarityTransform b = solveSimilarity(from.span(), to.span(), robust);
+
+    double errorPlain = 0.0, errorRobust = 0.0;
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            errorPlain += std::fabs(a.matrix[i][j] - expected[i][j]);
+            errorRobust += std::fabs(b.matrix[i][j] - expected[i][j]);
+        }
+    }
+    CF_CHECK(errorRobust < errorPlain * 0.1);
+}
+
+static void testDegenerateInput() {
+    Points from = randomPoints(2, 1);
+    CF_CHECK(!solveSimilarity(from.span(), from.span()).valid);
+
+    Points same;
+    same.x.assign(10, 1.0);
+    same.y.assign(10, 2.0);
+    same.z.assign(10, 3.0);
+    CF_CHECK(!solveSimilarity(same.span(), same.span()).valid);
+}
+
+static void testHeadRegistration(const string& basePath, const string& targetPath) {
+    FbxBinaryReader reader;
+    map<string, FbxMeshArrays> base, target;
+    CF_CHECK(reader.open(basePath) && reader.readMeshes({"head_lod0_mesh"}, false, base));
+    CF_CHECK(reader.open(targetPath) && reader.readMeshes({"head_lod0_mesh"}, false, target));
+
+    auto toPoints = [](const vector<double>& xyz) {
+        Points p;
+        for (size_t i = 0; i + 2 < xyz.size(); i += 3) {
+            p.x.push_back(xyz[i]);
+            p.y.push_back(xyz[i + 1]);
+            p.z.push_back(xyz[i + 2]);
+        }
+        return p;
+    };
+    Points to = toPoints(base["head_lod0_mesh"].vertices);
+    Points from = toPoints(target["head_lod0_mesh"].vertices);
+
+    auto start = std::chrono::steady_clock::now();
+    SimilarityTransform result = solveSimilarity(from.span(), to.span());
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::printf("head registration: %zu vertices, scale %.6f, rms %.6f, %.3f ms\n", from.x.size(), result.scale, result.rmsError, ms);
+
+    CF_CHECK(result.valid);
+    CF_CHECK(result.scale > 0.5 && result.scale < 2.0);
+}
+
+int main(int argc, char** argv) {
+    testSvdReconstructs();
+    testRecoversSimilarity();
+    testRejectsReflection();
+    testRobustReweighting();
+    testDegenerateInput();
+    testHeadRegistration(test::resourcePath(argc, argv, "trump.fbx"), test::resourcePath(argc, argv, "cooper.fbx"));
+    return test::failureCount() == 0 ? 0 : 1;
+}
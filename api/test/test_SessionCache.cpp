@@ -0,0 +1,127 @@
+#include "SessionCache.h"
+#include "BlendShapePipeline.h"
+#include "Log.h"
+#include "TestCommon.h"
+
+using namespace cf;
+
+// 析构时计数，确认淘汰后的对象何时释放
+struct Tracked {
+    explicit Tracked(int& destroyed) : destroyed(destroyed) {}
+    ~Tracked() { ++destroyed; }
+    int& destroyed;
+};
+
+static FileStamp stampOf(const string& path) {
+    FileStamp stamp;
+    readFileStamp(path, stamp);
+    return stamp;
+}
+
+static void testHitsAndInvalidation() {
+    test::writeSource("test_session_a.bin", "first");
+    SessionCache cache(1000);
+    CF_CHECK(!cache.find<string>("test_session_a.bin"));
+    CF_CHECK(cache.insert("test_session_a.bin", stampOf("test_session_a.bin"), make_shared<string>("parsed"), 10));
+    shared_ptr<string> hit = cache.find<string>("test_session_a.bin");
+    CF_CHECK(hit && *hit == "parsed");
+    // 同一路径的不同类型互不影响，路径按绝对路径比较
+    CF_CHECK(!cache.find<MeshSet>("test_session_a.bin"));
+    CF_CHECK(cache.find<string>("./test_session_a.bin") == hit);
+
+    // 文件变化后条目失效
+    test::writeSource("test_session_a.bin", "changed content");
+    CF_CHECK(!cache.find<string>("test_session_a.bin"));
+    SessionCacheStats stats = cache.stats();
+    CF_CHECK(stats.hits == 2);
+    CF_CHECK(stats.stale == 1);
+    CF_CHECK(stats.entryCount == 0 && stats.totalBytes == 0);
+
+    // 读取期间文件被修改：按读取前的状态放入的条目在查找时失效
+    const FileStamp before = stampOf("test_session_a.bin");
+    test::writeSource("test_session_a.bin", "changed again while loading");
+    CF_CHECK(cache.insert("test_session_a.bin", before, make_shared<string>("outdated"), 10));
+    CF_CHECK(!cache.find<string>("test_session_a.bin"));
+    CF_CHECK(cache.stats().stale == 2);
+
+    // 不存在的文件读不到状态，放入的条目不会命中
+    FileStamp missing;
+    CF_CHECK(!readFileStamp("test_session_missing.bin", missing));
+    CF_CHECK(cache.insert("test_session_missing.bin", missing, make_shared<string>("x"), 1));
+    CF_CHECK(!cache.find<string>("test_session_missing.bin"));
+
+    // take 移出缓存，调用方用完后放回
+    CF_CHECK(cache.insert("test_session_a.bin", stampOf("test_session_a.bin"), make_shared<string>("scene"), 10));
+    shared_ptr<string> taken = cache.take<string>("test_session_a.bin");
+    CF_CHECK(taken && *taken == "scene");
+    CF_CHECK(!cache.find<string>("test_session_a.bin"));
+    CF_CHECK(cache.insert("test_session_a.bin", stampOf("test_session_a.bin"), taken, 10));
+    CF_CHECK(cache.find<string>("test_session_a.bin") == taken);
+}
+
+static void testBudgetEviction() {
+    test::writeSource("test_session_a.bin", "a");
+    test::writeSource("test_session_b.bin", "b");
+    test::writeSource("test_session_c.bin", "c");
+    int destroyed = 0;
+    SessionCache cache(100);
+    CF_CHECK(cache.insert("test_session_a.bin", stampOf("test_session_a.bin"), make_shared<Tracked>(destroyed), 40));
+    CF_CHECK(cache.insert("test_session_b.bin", stampOf("test_session_b.bin"), make_shared<Tracked>(destroyed), 40));
+    shared_ptr<Tracked> held = cache.find<Tracked>("test_session_b.bin");
+    CF_CHECK(cache.find<Tracked>("test_session_a.bin"));
+
+    // 超出预算时淘汰最久未使用的 b；调用方仍持有 b，释放后才析构
+    CF_CHECK(cache.insert("test_session_c.bin", stampOf("test_session_c.bin"), make_shared<Tracked>(destroyed), 40));
+    CF_CHECK(!cache.find<Tracked>("test_session_b.bin"));
+    CF_CHECK(cache.find<Tracked>("test_session_a.bin"));
+    CF_CHECK(cache.find<Tracked>("test_session_c.bin"));
+    CF_CHECK(destroyed == 0);
+    held.reset();
+    CF_CHECK(destroyed == 1);
+    SessionCacheStats stats = cache.stats();
+    CF_CHECK(stats.evictions == 1);
+    CF_CHECK(stats.entryCount == 2 && stats.totalBytes == 80);
+
+    // 超过整个预算的对象不缓存；缩小预算立即淘汰
+    CF_CHECK(!cache.insert("test_session_b.bin", stampOf("test_session_b.bin"), make_shared<Tracked>(destroyed), 101));
+    CF_CHECK(destroyed == 2);
+    cache.setBudget(50);
+    CF_CHECK(cache.stats().entryCount == 1);
+    CF_CHECK(destroyed == 3);
+    CF_CHECK(cache.find<Tracked>("test_session_c.bin"));
+    cache.clear();
+    CF_CHECK(destroyed == 4);
+    CF_CHECK(cache.stats().totalBytes == 0);
+}
+
+static void testPipelineReusesLoadedMeshes(int argc, char** argv) {
+    const vector<string> files = {test::resourcePath(argc, argv, "trump.fbx"), test::resourcePath(argc, argv, "bigear.fbx")};
+    ScopedLogSink quiet([](LogLevel, const string&) {});
+    SessionCache cache;
+    PipelineOptions options;
+    options.geometryCacheDir.clear();
+    BlendShapePipeline pipeline(options);
+    pipeline.setSessionCache(&cache);
+
+    vector<MeshSet> first = pipeline.loadFbxFiles(files);
+    CF_CHECK(cache.stats().entryCount == files.size());
+    CF_CHECK(cache.stats().hits == 0);
+    vector<MeshSet> second = pipeline.loadFbxFiles(files);
+    CF_CHECK(cache.stats().hits == files.size());
+    CF_CHECK(first.size() == files.size() && second.size() == files.size());
+    for (size_t i = 0; i < first.size() && i < second.size(); ++i) {
+        CF_CHECK(test::sameMeshes(first[i], second[i]));
+    }
+
+    // 调用方修改读取结果不影响缓存中的网格
+    second[0].setVertex(0, 0, {1e9, 1e9, 1e9});
+    vector<MeshSet> third = pipeline.loadFbxFiles({files[0]});
+    CF_CHECK(third.size() == 1 && test::sameMeshes(first[0], third[0]));
+}
+
+int main(int argc, char** argv) {
+    testHitsAndInvalidation();
+    testBudgetEviction();
+    testPipelineReusesLoadedMeshes(argc, argv);
+    return test::failureCount() == 0 ? 0 : 1;
+}
@@ -0,0 +1,39 @@
+#include "ShapeDelta.h"
+#include "TestCommon.h"
+
+using namespace cf;
+
+static void testBuildSparseDelta() {
+    const double gapX[6] = {1.0, 0.0, 2.0, 1e-9, 0.0, 4.0};
+    const double gapY[6] = {0.0, 0.0, 0.0, 0.0, 3.0, 0.0};
+    const double gapZ[6] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    const uint32_t indices[5] = {0, 1, 2, 3, 9};
+    const float weights[5] = {0.5f, 1.0f, 1.0f, 1.0f, 1.0f};
+
+    SparseShapeDelta delta;
+    buildSparseDelta(indices, weights, 5, gapX, gapY, gapZ, 6, 0.0, delta);
+    // 零位移的顶点 1 与越界索引 9 被剔除
+    CF_CHECK(delta.size() == 3);
+    CF_CHECK(delta.indices[0] == 0 && delta.indices[1] == 2 && delta.indices[2] == 3);
+    CF_CHECK(delta.dx[0] == -0.5 && delta.dx[1] == -2.0);
+    CF_CHECK(delta.dy[0] == 0.0 && delta.dz[1] == 0.0);
+
+    // 阈值剔除微小位移
+    buildSparseDelta(indices, weights, 5, gapX, gapY, gapZ, 6, 1e-6, delta);
+    CF_CHECK(delta.size() == 2);
+    CF_CHECK(delta.indices[1] == 2);
+
+    // 所有位移都低于阈值时通道为空
+    buildSparseDelta(indices, weights, 5, gapX, gapY, gapZ, 6, 10.0, delta);
+    CF_CHECK(delta.empty());
+
+    // 与稠密写法 base - gap * w 的结果逐位一致
+    const double base = 1.25;
+    buildSparseDelta(indices, weights, 1, gapX, gapY, gapZ, 6, 0.0, delta);
+    CF_CHECK(base + delta.dx[0] == base - gapX[0] * static_cast<double>(weights[0]));
+}
+
+int main() {
+    testBuildSparseDelta();
+    return test::failureCount() == 0 ? 0 : 1;
+}
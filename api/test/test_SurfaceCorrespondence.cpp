@@ -0,0 +1,245 @@
+#include "BlendShapePipeline.h"
+#include "MeshKernels.h"
+#include "SurfaceCorrespondence.h"
+#include "TestCommon.h"
+#include <cmath>
+#include <limits>
+#include <random>
+
+using namespace cf;
+
+// 不对称的高度场，避免配准出现对称解
+static double heightAt(double u, double v) {
+    return 0.3 * sin(2.0 * u) + 0.2 * cos(3.0 * v) + 0.1 * u * v;
+}
+
+static void testTriangulatePolygons() {
+    // 一个四边形、一个三角形、一个越界的多边形
+    const int32_t polygons[] = {0, 1, 2, ~3, 2, 1, ~4, 0, 9, ~1};
+    vector<uint32_t> triangles = triangulatePolygons(polygons, sizeof(polygons) / sizeof(polygons[0]), 5);
+    const vector<uint32_t> expected = {0, 1, 2, 0, 2, 3, 2, 1, 4};
+    CF_CHECK(triangles == expected);
+}
+
+static void testClosestPointMatchesBruteForce() {
+    vector<double> coords;
+    vector<int32_t> polygons;
+    test::makeGridMesh(17, coords, polygons, heightAt);
+    PointSpan points = test::spanOf(coords);
+    vector<uint32_t> triangles = triangulatePolygons(polygons.data(), polygons.size(), points.count);
+    TriangleBvh bvh(points, triangles);
+    CF_CHECK(bvh.triangleCount() == triangles.size() / 3);
+
+    mt19937_64 rng(77);
+    uniform_real_distribution<double> dist(-1.5, 1.5);
+    for (int q = 0; q < 300; ++q) {
+        array<double, 3> p = {dist(rng), dist(rng), dist(rng)};
+        SurfacePoint hit = bvh.closestPoint(p);
+
+        // 逐个三角形的暴力搜索
+        double best = numeric_limits<double>::infinity();
+        for (size_t t = 0; t < triangles.size() / 3; ++t) {
+            SurfacePoint single = TriangleBvh(points, vector<uint32_t>(triangles.begin() + 3 * t, triangles.begin() + 3 * t + 3)).closestPoint(p);
+            best = min(best, single.distanceSquared);
+        }
+        CF_CHECK_NEAR(hit.distanceSquared, best, 1e-12);
+
+        double weightSum = hit.barycentric[0] + hit.barycentric[1] + hit.barycentric[2];
+        CF_CHECK_NEAR(weightSum, 1.0, 1e-12);
+        for (double w : hit.barycentric) {
+            CF_CHECK(w >= -1e-12 && w <= 1.0 + 1e-12);
+        }
+    }
+}
+
+static void testProjectionIsDeterministicAcrossWorkers() {
+    vector<double> target;
+    vector<int32_t> polygons;
+    test::makeGridMesh(13, target, polygons, heightAt);
+    PointSpan targetPoints = test::spanOf(target);
+    vector<uint32_t> triangles = triangulatePolygons(polygons.data(), polygons.size(), targetPoints.count);
+    TriangleBvh bvh(targetPoints, triangles);
+
+    // 目标网格上的顶点投影回自身，插值结果与原坐标一致
+    SurfaceMapping self = projectToSurface(bvh, targetPoints, 4);
+    CF_CHECK(self.size() == targetPoints.count);
+    CF_CHECK_NEAR(self.maxDistance, 0.0, 1e-12);
+    vector<double> back(target.size());
+    const size_t n = targetPoints.count;
+    interpolateSurface(self, targetPoints, back.data(), back.data() + n, back.data() + 2 * n);
+    for (size_t i = 0; i < back.size(); ++i) {
+        CF_CHECK_NEAR(back[i], target[i], 1e-12);
+    }
+
+    vector<double> query;
+    test::makeGridMesh(40, query, polygons, heightAt);
+    SurfaceMapping serial = projectToSurface(bvh, test::spanOf(query), 1);
+    SurfaceMapping parallel = projectToSurface(bvh, test::spanOf(query), 3);
+    CF_CHECK(serial.vertices == parallel.vertices);
+    CF_CHECK(serial.weights == parallel.weights);
+    CF_CHECK_NEAR(serial.rmsDistance, parallel.rmsDistance, 1e-15);
+}
+
+static array<array<double, 4>, 4> knownTransform() {
+    // 绕 z 轴 8 度、缩放 1.3 再平移
+    const double angle = 8.0 * 3.14159265358979323846 / 180.0;
+    const double s = 1.3;
+    return {{
+        {s * cos(angle), -s * sin(angle), 0.0, 0.4},
+        {s * sin(angle), s * cos(angle), 0.0, -0.25},
+        {0.0, 0.0, s, 0.1},
+        {0.0, 0.0, 0.0, 1.0}
+    }};
+}
+
+static void testRegisterToSurface() {
+    vector<double> base;
+    vector<double> target;
+    vector<int32_t> basePolygons;
+    vector<int32_t> targetPolygons;
+    test::makeGridMesh(41, base, basePolygons, heightAt);
+    test::makeGridMesh(29, target, targetPolygons, heightAt);
+
+    // 目标用不同分辨率采样同一曲面，再整体移到另一个坐标系
+    const array<array<double, 4>, 4> moved = knownTransform();
+    const size_t n = target.size() / 3;
+    transformPoints(moved, target.data(), target.data() + n, target.data() + 2 * n, n);
+
+    PointSpan targetPoints = test::spanOf(target);
+    vector<uint32_t> triangles = triangulatePolygons(targetPolygons.data(), targetPolygons.size(), n);
+    TriangleBvh bvh(targetPoints, triangles);
+    SurfaceMapping mapping;
+    SimilarityTransform transform = registerToSurface(test::spanOf(base), bvh, SurfaceRegistrationOptions(), 2, &mapping);
+    CF_CHECK(transform.valid);
+    CF_CHECK_NEAR(transform.scale, 1.0 / 1.3, 1e-3);
+    CF_CHECK(mapping.size() == base.size() / 3);
+    CF_CHECK(mapping.rmsDistance < 2e-3);
+
+    // 配准后的目标表面上插值得到的点落回底模顶点附近
+    array<array<double, 4>, 4> expected;
+    CF_CHECK(invertAffine(moved, expected));
+    for (int r = 0; r < 3; ++r) {
+        for (int c = 0; c < 4; ++c) {
+            CF_CHECK_NEAR(transform.matrix[r][c], expected[r][c], 5e-3);
+        }
+    }
+}
+
+static void testInvertAffine() {
+    array<array<double, 4>, 4> m = knownTransform();
+    array<array<double, 4>, 4> inverse;
+    CF_CHECK(invertAffine(m, inverse));
+    array<double, 3> p = {0.3, -1.2, 2.5};
+    array<double, 3> q = BlendShapePipeline::applyTransformation(BlendShapePipeline::applyTransformation(p, m), inverse);
+    for (int k = 0; k < 3; ++k) {
+        CF_CHECK_NEAR(q[k], p[k], 1e-12);
+    }
+    array<array<double, 4>, 4> singular = {{{1, 0, 0, 0}, {0, 0, 0, 0}, {0, 0, 1, 0}, {0, 0, 0, 1}}};
+    CF_CHECK(!invertAffine(singular, inverse));
+}
+
+static void testMappingCacheEviction() {
+    SurfaceMappingCache cache(2);
+    auto mapping = make_shared<SurfaceMapping>();
+    SurfaceMappingKey a = {1, 10, 100};
+    SurfaceMappingKey b = {1, 10, 200};
+    SurfaceMappingKey c = {2, 10, 100};
+    cache.insert(a, mapping);
+    cache.insert(b, mapping);
+    CF_CHECK(cache.find(a) != nullptr);   // a 成为最近使用
+    cache.insert(c, mapping);              // 淘汰 b
+    CF_CHECK(cache.find(b) == nullptr);
+    CF_CHECK(cache.find(a) != nullptr);
+    CF_CHECK(cache.find(c) != nullptr);
+    SurfaceMappingCacheStats stats = cache.stats();
+    CF_CHECK(stats.entryCount == 2);
+    CF_CHECK(stats.hits == 3);
+    CF_CHECK(stats.misses == 1);
+}
+
+static MeshSet makeCharacter(int headResolution, const array<array<double, 4>, 4>* moved, bool withTopology) {
+    vector<double> coords;
+    vector<int32_t> polygons;
+    test::makeGridMesh(headResolution, coords, polygons, heightAt);
+    MeshSet meshes;
+    const size_t n = coords.size() / 3;
+    size_t head = meshes.addMesh("head_lod0_mesh", n);
+    copy(coords.begin(), coords.begin() + n, meshes.x(head));
+    copy(coords.begin() + n, coords.begin() + 2 * n, meshes.y(head));
+    copy(coords.begin() + 2 * n, coords.end(), meshes.z(head));
+    size_t teeth = meshes.addMesh("teeth_lod0_mesh", 2);
+    meshes.setVertex(teeth, 0, {0.1, 0.2, 0.3});
+    meshes.setVertex(teeth, 1, {0.2, 0.1, 0.3});
+    if (moved) {
+        transformPoints(*moved, meshes.xData(), meshes.yData(), meshes.zData(), meshes.vertexCount());
+    }
+    if (withTopology) {
+        auto topology = make_shared<MeshTopology>();
+        topology->triangles = triangulatePolygons(polygons.data(), polygons.size(), n);
+        topology->fingerprint = GeometryCache::topologyFingerprint(polygons.data(), polygons.size());
+        meshes.setTopology(head, topology);
+    }
+    return meshes;
+}
+
+static void testPipelineTransfersMismatchedHead() {
+    SurfaceMappingCache::shared().clear();
+    const array<array<double, 4>, 4> moved = knownTransform();
+    vector<MeshSet> meshes;
+    meshes.push_back(makeCharacter(41, nullptr, false));
+    meshes.push_back(makeCharacter(29, &moved, true));
+    meshes.push_back(makeCharacter(29, &moved, false));
+
+    // 没有拓扑的网格仍被跳过，getMeshGap 也不会为它输出差值
+    PipelineOptions options;
+    options.workerCount = 2;
+    BlendShapePipeline pipeline(options);
+    CF_CHECK(pipeline.transferMismatchedTopology(meshes) == 1);
+    const MeshSet& base = meshes[0];
+    const int baseHead = base.find("head_lod0_mesh");
+    const int head = meshes[1].find("head_lod0_mesh");
+    CF_CHECK(meshes[1].vertexCount(head) == base.vertexCount(baseHead));
+    CF_CHECK(meshes[1].topology(head) == nullptr);
+    CF_CHECK(meshes[2].vertexCount(meshes[2].find("head_lod0_mesh")) != base.vertexCount(baseHead));
+    // 其他网格原样保留
+    int teeth = meshes[1].find("teeth_lod0_mesh");
+    CF_CHECK(teeth >= 0 && meshes[1].vertexCount(teeth) == 2);
+
+    const vector<array<double, 3>> resampled = meshes[1].vertices(head);
+
+    // 重采样后的 head 与底模逐顶点对应，配准后的差值只剩分段线性插值误差
+    pipeline.registerHeads(meshes);
+    vector<MeshSet> gaps = BlendShapePipeline::getMeshGap(meshes);
+    CF_CHECK(gaps.size() == 2);
+    int gapHead = gaps[0].find("head_lod0_mesh");
+    CF_CHECK(gapHead >= 0);
+    double maxGap = 0.0;
+    for (size_t i = 0; gapHead >= 0 && i < gaps[0].vertexCount(gapHead); ++i) {
+        array<double, 3> g = gaps[0].vertex(gapHead, i);
+        maxGap = max(maxGap, sqrt(g[0] * g[0] + g[1] * g[1] + g[2] * g[2]));
+    }
+    CF_CHECK(maxGap < 5e-3);
+    CF_CHECK(gaps[1].find("head_lod0_mesh") < 0);
+
+    // 同一拓扑的第二个目标直接复用映射
+    SurfaceMappingCacheStats before = SurfaceMappingCache::shared().stats();
+    vector<MeshSet> again;
+    again.push_back(makeCharacter(41, nullptr, false));
+    again.push_back(makeCharacter(29, &moved, true));
+    CF_CHECK(pipeline.transferMismatchedTopology(again) == 1);
+    SurfaceMappingCacheStats after = SurfaceMappingCache::shared().stats();
+    CF_CHECK(after.hits >= before.hits + 2);
+    CF_CHECK(after.misses == before.misses);
+    CF_CHECK(again[1].vertices(again[1].find("head_lod0_mesh")) == resampled);
+}
+
+int main() {
+    testTriangulatePolygons();
+    testClosestPointMatchesBruteForce();
+    testProjectionIsDeterministicAcrossWorkers();
+    testRegisterToSurface();
+    testInvertAffine();
+    testMappingCacheEviction();
+    testPipelineTransfersMismatchedHead();
+    return test::failureCount() == 0 ? 0 : 1;
+}
@@ -0,0 +1,92 @@
+#include "Trace.h"
+#include "TestCommon.h"
+#include <fstream>
+#include <thread>
+#include <nlohmann/json.hpp>
+
+using namespace cf;
+
+static nlohmann::json readTrace(const string& path) {
+    ifstream file(path);
+    nlohmann::json trace;
+    file >> trace;
+    return trace;
+}
+
+static void testDisabledSpansAreDropped() {
+    CF_CHECK(!isTracing());
+    {
+        TraceSpan span("idle");
+        CF_CHECK(!span.active());
+        span.setArg("vertices", 1);
+    }
+
+    string error;
+    CF_CHECK(stopTracing("test_trace_empty.json", error));
+    nlohmann::json trace = readTrace("test_trace_empty.json");
+    CF_CHECK(trace["traceEvents"].is_array());
+    CF_CHECK(trace["traceEvents"].empty());
+}
+
+static void testSpansAreWritten() {
+    CF_CHECK(startTracing());
+    CF_CHECK(isTracing());
+    {
+        TraceSpan outer("outer", "detail text");
+        outer.setArg("bytes", 42);
+        outer.setArg("vertices", 7);
+        outer.setArg("bytes", 43);  // 同名参数覆盖
+
+        thread worker([]() {
+            TraceSpan inner("worker");
+            inner.setArg("vertices", 3);
+        });
+        worker.join();
+
+        TraceSpan early("early");
+        early.finish();
+        CF_CHECK(!early.active());
+    }
+
+    string error;
+    CF_CHECK(stopTracing("test_trace.json", error));
+    CF_CHECK(!isTracing());
+
+    nlohmann::json events = readTrace("test_trace.json")["traceEvents"];
+    CF_CHECK(events.size() == 3);
+    if (events.size() != 3) {
+        return;
+    }
+    // 区间按结束顺序记录
+    CF_CHECK(events[0]["name"] == "worker");
+    CF_CHECK(events[1]["name"] == "early");
+    CF_CHECK(events[2]["name"] == "outer");
+    CF_CHECK(events[2]["ph"] == "X");
+    CF_CHECK(events[2]["args"]["detail"] == "detail text");
+    CF_CHECK(events[2]["args"]["bytes"] == 43);
+    CF_CHECK(events[2]["args"]["vertices"] == 7);
+    CF_CHECK(events[0]["args"]["vertices"] == 3);
+    CF_CHECK(events[0]["tid"] != events[2]["tid"]);
+    CF_CHECK(events[1]["tid"] == events[2]["tid"]);
+    CF_CHECK(events[2]["dur"].get<int64_t>() >= events[0]["dur"].get<int64_t>());
+    CF_CHECK(events[2]["ts"].get<int64_t>() <= events[0]["ts"].get<int64_t>());
+
+    // 再次开始时清空上一次的记录；记录中再次开始被拒绝，已记录的区间保留
+    CF_CHECK(startTracing());
+    {
+        TraceSpan kept("kept");
+    }
+    CF_CHECK(!startTracing());
+    CF_CHECK(isTracing());
+    CF_CHECK(stopTracing("test_trace.json", error));
+    CF_CHECK(readTrace("test_trace.json")["traceEvents"].size() == 1);
+    CF_CHECK(startTracing());
+    CF_CHECK(stopTracing("test_trace.json", error));
+    CF_CHECK(readTrace("test_trace.json")["traceEvents"].empty());
+}
+
+int main() {
+    testDisabledSpansAreDropped();
+    testSpansAreWritten();
+    return test::failureCount() == 0 ? 0 : 1;
+}